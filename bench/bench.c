@@ -0,0 +1,300 @@
+#include "ff/ff_common.h"
+#include "ff/ff_core.h"
+#include "ff/ff_fiber.h"
+#include "ff/ff_event.h"
+#include "ff/ff_tcp.h"
+#include "ff/arch/ff_arch_net_addr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOG_FILENAME L"ff_bench_log.txt"
+
+static int64_t get_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t) ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+static void print_result(const char *name, int64_t operations_cnt, int64_t elapsed_ns)
+{
+	printf("%-40s %10lld ops %10.1f ns/op\n", name, (long long) operations_cnt, (double) elapsed_ns / operations_cnt);
+}
+
+/* start of fiber benchmarks */
+
+#define PING_PONG_ROUND_TRIPS 1000000
+
+struct ping_pong_data
+{
+	struct ff_event *ping_event;
+	struct ff_event *pong_event;
+	int round_trips_cnt;
+};
+
+static void pong_func(void *ctx)
+{
+	struct ping_pong_data *data;
+	int i;
+
+	data = (struct ping_pong_data *) ctx;
+	for (i = 0; i < data->round_trips_cnt; i++)
+	{
+		ff_event_wait(data->ping_event);
+		ff_event_set(data->pong_event);
+	}
+}
+
+/**
+ * Two fibers pass control to each other using auto-reset events.
+ * Each round trip consists of two fiber switches.
+ */
+static void bench_fiber_ping_pong(void)
+{
+	struct ping_pong_data data;
+	struct ff_fiber *pong_fiber;
+	int64_t start_time;
+	int64_t elapsed_ns;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	data.ping_event = ff_event_create(FF_EVENT_AUTO);
+	data.pong_event = ff_event_create(FF_EVENT_AUTO);
+	data.round_trips_cnt = PING_PONG_ROUND_TRIPS;
+	pong_fiber = ff_fiber_create(pong_func, 0);
+	ff_fiber_start(pong_fiber, &data);
+
+	start_time = get_time_ns();
+	for (i = 0; i < PING_PONG_ROUND_TRIPS; i++)
+	{
+		ff_event_set(data.ping_event);
+		ff_event_wait(data.pong_event);
+	}
+	elapsed_ns = get_time_ns() - start_time;
+
+	ff_fiber_join(pong_fiber);
+	ff_fiber_delete(pong_fiber);
+	ff_event_delete(data.pong_event);
+	ff_event_delete(data.ping_event);
+	ff_core_shutdown();
+
+	print_result("fiber ping-pong (per switch)", 2 * (int64_t) PING_PONG_ROUND_TRIPS, elapsed_ns);
+}
+
+#define CREATE_DELETE_FIBERS_CNT 100000
+
+static void empty_fiber_func(void *ctx)
+{
+	(void)ctx;
+}
+
+/**
+ * Creates, runs and deletes short-living fibers one by one.
+ */
+static void bench_fiber_create_delete(void)
+{
+	int64_t start_time;
+	int64_t elapsed_ns;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	start_time = get_time_ns();
+	for (i = 0; i < CREATE_DELETE_FIBERS_CNT; i++)
+	{
+		struct ff_fiber *fiber;
+
+		fiber = ff_fiber_create(empty_fiber_func, 0);
+		ff_fiber_start(fiber, NULL);
+		ff_fiber_join(fiber);
+		ff_fiber_delete(fiber);
+	}
+	elapsed_ns = get_time_ns() - start_time;
+	ff_core_shutdown();
+
+	print_result("fiber create/start/join/delete", CREATE_DELETE_FIBERS_CNT, elapsed_ns);
+}
+
+static void bench_fiber_all(void)
+{
+	bench_fiber_ping_pong();
+	bench_fiber_create_delete();
+}
+
+/* end of fiber benchmarks */
+
+/* start of tcp benchmarks */
+
+#define TCP_ECHO_CONNECTIONS_CNT 200
+#define TCP_ECHO_ROUND_TRIPS 100
+#define TCP_ECHO_PORT 43211
+
+struct tcp_echo_data
+{
+	struct ff_arch_net_addr *addr;
+	struct ff_tcp *tcp_server;
+	struct ff_event *done_event;
+	int active_clients_cnt;
+};
+
+static void tcp_echo_server_func(void *ctx)
+{
+	struct ff_tcp *tcp;
+	uint8_t buf[1];
+	enum ff_result result;
+
+	tcp = (struct ff_tcp *) ctx;
+	for (;;)
+	{
+		result = ff_tcp_read(tcp, buf, 1);
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_tcp_write(tcp, buf, 1);
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_tcp_flush(tcp);
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+	}
+	ff_tcp_delete(tcp);
+}
+
+static void tcp_echo_acceptor_func(void *ctx)
+{
+	struct tcp_echo_data *data;
+	struct ff_arch_net_addr *remote_addr;
+	int i;
+
+	data = (struct tcp_echo_data *) ctx;
+	remote_addr = ff_arch_net_addr_create();
+	for (i = 0; i < TCP_ECHO_CONNECTIONS_CNT; i++)
+	{
+		struct ff_tcp *tcp;
+
+		tcp = ff_tcp_accept(data->tcp_server, remote_addr);
+		if (tcp == NULL)
+		{
+			break;
+		}
+		ff_core_fiberpool_execute_async(tcp_echo_server_func, tcp);
+	}
+	ff_arch_net_addr_delete(remote_addr);
+}
+
+static void tcp_echo_client_func(void *ctx)
+{
+	struct tcp_echo_data *data;
+	struct ff_tcp *tcp;
+	uint8_t buf[1];
+	enum ff_result result;
+	int i;
+
+	data = (struct tcp_echo_data *) ctx;
+	tcp = ff_tcp_create();
+	result = ff_tcp_connect(tcp, data->addr);
+	for (i = 0; i < TCP_ECHO_ROUND_TRIPS && result == FF_SUCCESS; i++)
+	{
+		buf[0] = (uint8_t) i;
+		result = ff_tcp_write(tcp, buf, 1);
+		if (result == FF_SUCCESS)
+		{
+			result = ff_tcp_flush(tcp);
+		}
+		if (result == FF_SUCCESS)
+		{
+			result = ff_tcp_read(tcp, buf, 1);
+		}
+	}
+	if (result != FF_SUCCESS)
+	{
+		fprintf(stderr, "tcp echo client failed\n");
+	}
+	ff_tcp_delete(tcp);
+
+	/* all fibers run on a single scheduler, so the counter doesn't need atomic operations */
+	data->active_clients_cnt--;
+	if (data->active_clients_cnt == 0)
+	{
+		ff_event_set(data->done_event);
+	}
+}
+
+/**
+ * Many clients concurrently exchange 1-byte messages with echo servers over TCP loopback.
+ * Reports the time per request and the number of completion port waits per request
+ * for the given I/O backend and the given number of completions harvested per wait.
+ * Only the epoll backend honours the io batch size, while io_uring harvests all available completions per wait.
+ * Schedulers fall back to epoll if io_uring isn't supported by the kernel.
+ */
+static void bench_tcp_echo(int is_uring, int io_batch_size)
+{
+	struct tcp_echo_data data;
+	struct ff_core_stats stats_before;
+	struct ff_core_stats stats_after;
+	int64_t start_time;
+	int64_t elapsed_ns;
+	int64_t requests_cnt;
+	enum ff_result result;
+	char name[64];
+	int i;
+
+	/* the backend is chosen when completion ports of schedulers are created */
+	setenv("FF_IO_URING", is_uring ? "1" : "0", 1);
+	ff_core_initialize(LOG_FILENAME);
+	ff_core_set_io_batch_size(io_batch_size);
+	data.addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(data.addr, L"127.0.0.1", TCP_ECHO_PORT);
+	ff_assert(result == FF_SUCCESS);
+	data.tcp_server = ff_tcp_create();
+	result = ff_tcp_bind(data.tcp_server, data.addr, FF_TCP_SERVER);
+	ff_assert(result == FF_SUCCESS);
+	data.done_event = ff_event_create(FF_EVENT_AUTO);
+	data.active_clients_cnt = TCP_ECHO_CONNECTIONS_CNT;
+
+	ff_core_get_stats(&stats_before);
+	start_time = get_time_ns();
+	ff_core_fiberpool_execute_async(tcp_echo_acceptor_func, &data);
+	for (i = 0; i < TCP_ECHO_CONNECTIONS_CNT; i++)
+	{
+		ff_core_fiberpool_execute_async(tcp_echo_client_func, &data);
+	}
+	ff_event_wait(data.done_event);
+	elapsed_ns = get_time_ns() - start_time;
+	ff_core_get_stats(&stats_after);
+
+	ff_tcp_delete(data.tcp_server);
+	ff_event_delete(data.done_event);
+	ff_arch_net_addr_delete(data.addr);
+	ff_core_shutdown();
+
+	requests_cnt = ((int64_t) TCP_ECHO_CONNECTIONS_CNT) * TCP_ECHO_ROUND_TRIPS;
+	snprintf(name, sizeof(name), "tcp echo (%s, io batch size %d)", is_uring ? "io_uring" : "epoll", io_batch_size);
+	print_result(name, requests_cnt, elapsed_ns);
+	printf("%-40s %10.3f completion port waits per request\n", "",
+		(double) (stats_after.completion_port_waits_cnt - stats_before.completion_port_waits_cnt) / requests_cnt);
+}
+
+static void bench_tcp_all(void)
+{
+	bench_tcp_echo(0, 10);
+	bench_tcp_echo(0, 256);
+	bench_tcp_echo(1, 256);
+}
+
+/* end of tcp benchmarks */
+
+int main(void)
+{
+	bench_fiber_all();
+	bench_tcp_all();
+
+	return 0;
+}
@@ -23,6 +23,15 @@ enum ff_result
 	FF_FAILURE
 };
 
+/**
+ * The buffer for scatter/gather I/O operations.
+ */
+struct ff_iovec
+{
+	void *buf;
+	int len;
+};
+
 #include "ff/ff_api.h"
 #include "ff/ff_malloc.h"
 #include "ff/ff_assert.h"
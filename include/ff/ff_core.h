@@ -13,12 +13,117 @@ extern "C" {
  */
 FF_API void ff_core_initialize(const wchar_t *log_filename);
 
+/**
+ * @public
+ * Initializes the fiber framework with the given number of schedulers.
+ * Each scheduler runs fibers on its own thread. Idle schedulers steal
+ * runnable fibers from busy schedulers, so fibers can migrate between threads.
+ * The first scheduler runs on the thread, which calls this function.
+ * If schedulers_cnt is 0, then the number of schedulers is equal to the number of CPUs.
+ * ff_core_initialize() is equivalent to ff_core_initialize_with_schedulers(log_filename, 1).
+ */
+FF_API void ff_core_initialize_with_schedulers(const wchar_t *log_filename, int schedulers_cnt);
+
 /**
  * @public
  * Shutdowns the fiber framework
  */
 FF_API void ff_core_shutdown();
 
+/**
+ * @public
+ * Returns the number of schedulers, which run fibers
+ */
+FF_API int ff_core_get_schedulers_cnt();
+
+/**
+ * @public
+ * Enables busy polling on all schedulers. This trades CPU time for lower latency.
+ * Before blocking in wait for I/O and threadpool completions, an idle scheduler spins
+ * for up to the given interval in microseconds, polling for completions without blocking.
+ * The actual spin time adapts to how often spinning finds completions.
+ * Busy polling is disabled if the interval is 0. This is the default.
+ * If is_socket_busy_poll is non-zero, then sockets created after this call also busy-poll
+ * network devices for the given interval (SO_BUSY_POLL on Linux).
+ * This option is ignored on platforms, which don't support it.
+ */
+FF_API void ff_core_set_busy_poll(int interval, int is_socket_busy_poll);
+
+/**
+ * @public
+ * Sets the maximum number of I/O and threadpool completions, which an idle scheduler
+ * harvests per wait. Harvested fibers are placed into the run queue of the scheduler,
+ * so other schedulers can steal them. Larger batches reduce the number of waits
+ * under heavy load. The default batch size is 256.
+ * The new size is applied by each scheduler on its next wait.
+ */
+FF_API void ff_core_set_io_batch_size(int batch_size);
+
+/**
+ * @public
+ * Sets the time in milliseconds, after which idle threads of threadpools exit.
+ * Threadpools start new threads on demand, so bursts of threadpool functions don't leave
+ * idle threads behind for the life of the process. The default idle timeout is 10 seconds.
+ */
+FF_API void ff_core_set_threadpool_idle_timeout(int idle_timeout);
+
+/**
+ * @public
+ * Sets the time in milliseconds, after which idle fibers of the fiberpool exit.
+ * The fiberpool starts new fibers on demand, so stacks of fibers, which were started
+ * for bursts of tasks, are freed after the burst. The default idle timeout is 10 seconds.
+ */
+FF_API void ff_core_set_fiberpool_idle_timeout(int idle_timeout);
+
+/**
+ * @public
+ * statistics of the core.
+ * Counters are collected per scheduler and are summed up by ff_core_get_stats().
+ */
+struct ff_core_stats
+{
+	/* the number of switches between fibers on all schedulers */
+	int64_t context_switches_cnt;
+
+	/* the maximum number of runnable fibers, which were waiting in the run queue of a single scheduler */
+	int max_run_queue_depth;
+
+	/* the number of blocking waits for I/O and threadpool completions performed by schedulers */
+	int64_t completion_port_waits_cnt;
+
+	/* the number of completions returned by these waits.
+	 * The average number of events per wait is completion_port_events_cnt / completion_port_waits_cnt
+	 */
+	int64_t completion_port_events_cnt;
+
+	/* the number of busy-poll spins, which found completions, and spins, which ran out of the budget.
+	 * See ff_core_set_busy_poll()
+	 */
+	int64_t busy_poll_hits_cnt;
+	int64_t busy_poll_misses_cnt;
+
+	/* the number of tasks, which were picked up by threads of all threadpools */
+	int64_t threadpool_tasks_cnt;
+
+	/* the total and the maximum time in nanoseconds, which tasks spent in threadpool queues */
+	int64_t threadpool_total_queue_latency;
+	int64_t threadpool_max_queue_latency;
+
+	/* the number of running threads in each threadpool */
+	int blocking_threadpool_threads_cnt;
+	int compute_threadpool_threads_cnt;
+
+	/* the number of running fibers in the fiberpool */
+	int fiberpool_fibers_cnt;
+};
+
+/**
+ * @public
+ * fills the stats with the current statistics of the core.
+ * Counters are cheap enough to be collected always, so this function can be called at any time.
+ */
+FF_API void ff_core_get_stats(struct ff_core_stats *stats);
+
 /**
  * @public
  * sleeps the current fiber for the given interval milliseconds
@@ -30,18 +135,54 @@ typedef void (*ff_core_threadpool_func)(void *ctx);
 
 /**
  * @public
- * Synchronously executes the func in the threadpool
+ * threadpools, which execute functions passed to ff_core_threadpool_execute()
  */
-FF_API void ff_core_threadpool_execute(ff_core_threadpool_func func, void *ctx);
+enum ff_core_threadpool_type
+{
+	/* functions, which block in system calls, e.g. DNS resolution or file I/O.
+	 * The threadpool starts a new thread whenever queued functions outnumber idle threads,
+	 * so blocked functions don't delay the queued ones
+	 */
+	FF_CORE_THREADPOOL_BLOCKING,
+
+	/* CPU-bound functions. The number of threads is limited by the number of CPUs */
+	FF_CORE_THREADPOOL_COMPUTE
+};
+
+/**
+ * @public
+ * Synchronously executes the func in the given threadpool
+ */
+FF_API void ff_core_threadpool_execute(enum ff_core_threadpool_type threadpool_type, ff_core_threadpool_func func, void *ctx);
+
+typedef void (*ff_core_parallel_for_func)(int begin, int end, void *ctx);
+
+/**
+ * @public
+ * Synchronously executes the func for all the chunks of the range [begin, end) in the compute threadpool.
+ * The range is split into chunks of grain elements, so each func call processes the range [chunk_begin, chunk_end)
+ * with up to grain elements. Chunks are executed concurrently in arbitrary order.
+ * Threads, which finish their share of chunks, steal chunks from other threads.
+ * The current fiber is suspended without blocking the scheduler until all the chunks are processed.
+ */
+FF_API void ff_core_parallel_for(int begin, int end, int grain, ff_core_parallel_for_func func, void *ctx);
 
 typedef void (*ff_core_fiberpool_func)(void *ctx);
 
 /**
  * @public
- * Schedules the func for execution in the fiberpool
+ * Schedules the func for execution in the fiberpool.
+ * Functions are picked up by fibers of the fiberpool in FIFO order.
  */
 FF_API void ff_core_fiberpool_execute_async(ff_core_fiberpool_func func, void *ctx);
 
+/**
+ * @public
+ * Schedules the func for execution in the fiberpool with each of ctxs_cnt contexts.
+ * This is cheaper than ctxs_cnt calls to ff_core_fiberpool_execute_async().
+ */
+FF_API void ff_core_fiberpool_execute_batch_async(ff_core_fiberpool_func func, void **ctxs, int ctxs_cnt);
+
 /**
  * @public
  * Schedules the func for execution in the fiberpool after the given interval in milliseconds.
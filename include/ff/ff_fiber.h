@@ -19,6 +19,25 @@ struct ff_fiber;
  */
 typedef void (*ff_fiber_func)(void *ctx);
 
+/**
+ * @public
+ * priority classes of fibers.
+ * Runnable fibers of the same class are executed in FIFO order.
+ * Higher classes receive bigger share of the scheduler time, but lower classes
+ * are never starved.
+ */
+enum ff_fiber_priority
+{
+	/* latency-critical fibers, e.g. fibers, which serve requests */
+	FF_FIBER_PRIORITY_HIGH,
+
+	/* the default priority for newly created fibers */
+	FF_FIBER_PRIORITY_NORMAL,
+
+	/* background fibers, e.g. fibers, which perform maintenance tasks */
+	FF_FIBER_PRIORITY_LOW
+};
+
 /**
  * @public
  * creates the new fiber, which will execute the given fiber_func
@@ -52,6 +71,33 @@ FF_API void ff_fiber_start(struct ff_fiber *fiber, void *ctx);
  */
 FF_API void ff_fiber_join(struct ff_fiber *fiber);
 
+/**
+ * @public
+ * sets the priority class for the given fiber.
+ * The new priority is taken into account next time the fiber is scheduled for execution.
+ */
+FF_API void ff_fiber_set_priority(struct ff_fiber *fiber, enum ff_fiber_priority priority);
+
+/**
+ * @public
+ * statistics of the fiber
+ */
+struct ff_fiber_stats
+{
+	/* cumulative time in nanoseconds, which the fiber has been running on schedulers */
+	int64_t run_time;
+
+	/* the number of times the fiber has been switched in */
+	int64_t switches_cnt;
+};
+
+/**
+ * @public
+ * fills the stats with statistics of the given fiber.
+ * Statistics of fibers running on other threads may be slightly outdated.
+ */
+FF_API void ff_fiber_get_stats(struct ff_fiber *fiber, struct ff_fiber_stats *stats);
+
 /**
  * @public
  * Returns the current fiber
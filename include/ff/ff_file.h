@@ -9,12 +9,37 @@ extern "C" {
 
 struct ff_file;
 
+/**
+ * The read-only view of the file mapped into memory.
+ */
+struct ff_file_map;
+
 enum ff_file_access_mode
 {
 	FF_FILE_READ,
 	FF_FILE_WRITE
 };
 
+/**
+ * Hints about the expected access pattern for the mapped view of the file.
+ */
+enum ff_file_map_advice
+{
+	/* no special treatment */
+	FF_FILE_MAP_ADVICE_NORMAL,
+
+	/* pages are accessed in sequential order, so they can be read ahead aggressively
+	 * and released soon after they are accessed
+	 */
+	FF_FILE_MAP_ADVICE_SEQUENTIAL,
+
+	/* pages are accessed in random order, so read-ahead is useless */
+	FF_FILE_MAP_ADVICE_RANDOM,
+
+	/* pages are going to be accessed soon, so they should be read ahead in background */
+	FF_FILE_MAP_ADVICE_WILLNEED
+};
+
 /**
  * Opens the file on the given path in the given access_mode.
  * Returns opened file on success, NULL on error.
@@ -38,12 +63,59 @@ FF_API enum ff_result ff_file_read(struct ff_file *file, void *buf, int len);
  */
 FF_API enum ff_result ff_file_write(struct ff_file *file, const void *buf, int len);
 
+/**
+ * Fills exactly iov_cnt buffers from the iov in order by data from the file.
+ * Large buffers are filled directly from the file by a single scatter read, bypassing the read buffer.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_file_readv(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Writes exactly iov_cnt buffers from the iov in order into the file.
+ * Small buffers are coalesced in the write buffer, while large buffers are written directly
+ * to the file by a single gather write, bypassing the write buffer.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_file_writev(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt);
+
 /**
  * Flushes write buffer of the file.
  * Returns FF_SUCCESS on success, FF_FAILURE on error.
  */
 FF_API enum ff_result ff_file_flush(struct ff_file *file);
 
+/**
+ * Reads exactly len bytes from the file at the given offset into the buf.
+ * The file must be opened for reading. Positional reads bypass the read buffer
+ * and don't change the current position of the file, so they can be issued
+ * concurrently by multiple fibers on the same file.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error or if the end of file is reached.
+ */
+FF_API enum ff_result ff_file_pread(struct ff_file *file, void *buf, int len, int64_t offset);
+
+/**
+ * Writes exactly len bytes from the buf into the file at the given offset.
+ * The file must be opened for writing. Positional writes bypass the write buffer
+ * and don't change the current position of the file, so they can be issued
+ * concurrently by multiple fibers on the same file.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_file_pwrite(struct ff_file *file, const void *buf, int len, int64_t offset);
+
+/**
+ * Reads data from the file at the given offset into iov_cnt buffers from the iov.
+ * Buffers are filled in order, each one exactly. See ff_file_pread() for details.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error or if the end of file is reached.
+ */
+FF_API enum ff_result ff_file_preadv(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset);
+
+/**
+ * Writes data from iov_cnt buffers from the iov into the file at the given offset.
+ * Buffers are written in order, each one exactly. See ff_file_pwrite() for details.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_file_pwritev(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset);
+
 /**
  * Erases the file on the given path.
  * Returns FF_SUCCESS on success, FF_FAILURE on error.
@@ -67,6 +139,45 @@ FF_API enum ff_result ff_file_move(const wchar_t *src_path, const wchar_t *dst_p
  */
 FF_API int64_t ff_file_get_size(struct ff_file *file);
 
+/**
+ * Maps len bytes of the file starting from the given offset into memory for reading.
+ * The file must be opened for reading. The offset doesn't need to be aligned.
+ * The view remains valid after the file is closed, until ff_file_map_delete() is called.
+ * Accessing pages of the view can block the current thread on page faults,
+ * so use ff_file_map_prefault() before accessing large cold views.
+ * The view must fit into the file.
+ * Returns the view on success, NULL on error or if the view runs past the end of the file.
+ */
+FF_API struct ff_file_map *ff_file_map_create(struct ff_file *file, int64_t offset, int64_t len);
+
+/**
+ * Unmaps the view.
+ */
+FF_API void ff_file_map_delete(struct ff_file_map *map);
+
+/**
+ * Returns the pointer to the first byte of the view.
+ */
+FF_API const void *ff_file_map_get_data(struct ff_file_map *map);
+
+/**
+ * Returns the size of the view in bytes.
+ */
+FF_API int64_t ff_file_map_get_size(struct ff_file_map *map);
+
+/**
+ * Gives the hint about the expected access pattern for len bytes of the view starting from the given offset.
+ * Hints don't change the contents of the view and can be ignored by the OS.
+ */
+FF_API void ff_file_map_advise(struct ff_file_map *map, int64_t offset, int64_t len, enum ff_file_map_advice advice);
+
+/**
+ * Loads len bytes of the view starting from the given offset into memory.
+ * Page faults are taken by the threadpool, so other fibers of the current thread aren't blocked.
+ * Pages can be evicted later under memory pressure.
+ */
+FF_API void ff_file_map_prefault(struct ff_file_map *map, int64_t offset, int64_t len);
+
 #ifdef __cplusplus
 }
 #endif
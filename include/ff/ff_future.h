@@ -0,0 +1,94 @@
+#ifndef FF_FUTURE_PUBLIC_H
+#define FF_FUTURE_PUBLIC_H
+
+#include "ff/ff_common.h"
+#include "ff/ff_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * the opaque future structure.
+ * The future holds the result of the function, which is executed asynchronously
+ * in the fiberpool or in a threadpool. Futures are recycled through a free list,
+ * so creating many futures for concurrent fan-out doesn't allocate memory on each call.
+ */
+struct ff_future;
+
+/**
+ * @public
+ * the function, which is executed by the future. Its return value becomes the result of the future.
+ */
+typedef void *(*ff_future_func)(void *ctx);
+
+/**
+ * @public
+ * Creates the future and schedules the func for execution in the fiberpool.
+ * Always returns correct result.
+ */
+FF_API struct ff_future *ff_future_fiberpool_execute_async(ff_future_func func, void *ctx);
+
+/**
+ * @public
+ * Creates the future and schedules the func for execution in the given threadpool.
+ * Always returns correct result.
+ */
+FF_API struct ff_future *ff_future_threadpool_execute_async(enum ff_core_threadpool_type threadpool_type, ff_future_func func, void *ctx);
+
+/**
+ * @public
+ * Deletes the future. The future can be deleted before its func completes.
+ * In this case the result of the func is discarded, so it is usually combined with ff_future_cancel().
+ */
+FF_API void ff_future_delete(struct ff_future *future);
+
+/**
+ * @public
+ * Cancels the future if it isn't completed yet and wakes up fibers, which wait for it.
+ * The func isn't executed if it hasn't been started yet. Otherwise its result is discarded.
+ * This function doesn't wait for the func, so it never blocks.
+ */
+FF_API void ff_future_cancel(struct ff_future *future);
+
+/**
+ * @public
+ * Waits until the future is completed or cancelled.
+ * Returns FF_SUCCESS if the future is completed, FF_FAILURE if it is cancelled.
+ */
+FF_API enum ff_result ff_future_wait(struct ff_future *future);
+
+/**
+ * @public
+ * Waits until the future is completed or cancelled during the given timeout in milliseconds.
+ * Returns FF_SUCCESS if the future is completed, FF_FAILURE if it is cancelled or the timeout expired.
+ */
+FF_API enum ff_result ff_future_wait_with_timeout(struct ff_future *future, int timeout);
+
+/**
+ * @public
+ * Waits until all the futures are completed or cancelled.
+ * Returns FF_SUCCESS if all the futures are completed, FF_FAILURE if any of them is cancelled.
+ */
+FF_API enum ff_result ff_future_wait_all(struct ff_future **futures, int futures_cnt);
+
+/**
+ * @public
+ * Waits until any of the futures is completed or cancelled.
+ * Returns the index of this future in the futures array.
+ */
+FF_API int ff_future_wait_any(struct ff_future **futures, int futures_cnt);
+
+/**
+ * @public
+ * Returns the result of the completed future.
+ * The future must be completed, i.e. one of wait functions must return FF_SUCCESS for it.
+ */
+FF_API void *ff_future_get_result(struct ff_future *future);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,6 +9,11 @@ extern "C" {
 
 struct ff_stream;
 
+/**
+ * The kernel object backing the stream. See ff_stream_vtable::get_endpoint().
+ */
+struct ff_stream_endpoint;
+
 struct ff_stream_vtable
 {
 	/**
@@ -39,6 +44,38 @@ struct ff_stream_vtable
 	 * All subsequent write*() and read*() calls should return FF_FAILURE immediately.
 	 */
 	void (*disconnect)(void *ctx);
+
+	/**
+	 * the optional read_direct() callback should return the pointer to the next len bytes
+	 * of the stream and skip them, so the data can be consumed without copying.
+	 * The returned memory must remain valid until the stream is deleted.
+	 * It should return NULL on error.
+	 * Streams, which don't keep their data in memory, should set this callback to NULL.
+	 */
+	const void *(*read_direct)(void *ctx, int len);
+
+	/**
+	 * the optional get_endpoint() callback should return the kernel object such as a socket or a file
+	 * backing the stream, so ff_stream_copy() can move data between streams without passing it
+	 * through user-space buffers. It should return NULL if the stream isn't backed by such an object
+	 * or if it is disconnected. Endpoints can be provided only by streams implemented in the library,
+	 * so user-defined streams should set this callback to NULL.
+	 */
+	struct ff_stream_endpoint *(*get_endpoint)(void *ctx);
+
+	/**
+	 * the optional readv() callback should fill exactly iov_cnt buffers from the iov in order.
+	 * It should return FF_SUCCESS on success, FF_FAILURE on error.
+	 * If it is NULL, then ff_stream_readv() reads buffers one by one using the read() callback.
+	 */
+	enum ff_result (*readv)(void *ctx, const struct ff_iovec *iov, int iov_cnt);
+
+	/**
+	 * the optional writev() callback should write exactly iov_cnt buffers from the iov in order.
+	 * It should return FF_SUCCESS on success, FF_FAILURE on error.
+	 * If it is NULL, then ff_stream_writev() writes buffers one by one using the write() callback.
+	 */
+	enum ff_result (*writev)(void *ctx, const struct ff_iovec *iov, int iov_cnt);
 };
 
 /**
@@ -66,6 +103,22 @@ FF_API enum ff_result ff_stream_read(struct ff_stream *stream, void *buf, int le
  */
 FF_API enum ff_result ff_stream_write(struct ff_stream *stream, const void *buf, int len);
 
+/**
+ * Fills exactly iov_cnt buffers from the iov in order by data from the stream.
+ * Streams backed by sockets and files fill large buffers by a single scatter read,
+ * so the data isn't copied through the stream's read buffer.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_stream_readv(struct ff_stream *stream, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Writes exactly iov_cnt buffers from the iov in order into the stream.
+ * Streams backed by sockets and files coalesce small buffers in the write buffer
+ * and write large buffers by a single gather write, so they aren't copied into the write buffer.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_stream_writev(struct ff_stream *stream, const struct ff_iovec *iov, int iov_cnt);
+
 /**
  * Flushes the stream's write buffer.
  * Returns FF_SUCCESS on success, FF_FAILURE on error.
@@ -0,0 +1,23 @@
+#ifndef FF_STREAM_FILE_PUBLIC_H
+#define FF_STREAM_FILE_PUBLIC_H
+
+#include "ff/ff_file.h"
+#include "ff/ff_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates file stream using the given file.
+ * The stream can be read if the file is opened for reading and written if the file is opened for writing.
+ * This function acquires the file, so the caller mustn't close the file!
+ * Always returns correct result.
+ */
+FF_API struct ff_stream *ff_stream_file_create(struct ff_file *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef FF_STREAM_FILE_MAP_PUBLIC_H
+#define FF_STREAM_FILE_MAP_PUBLIC_H
+
+#include "ff/ff_file.h"
+#include "ff/ff_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates read-only stream using the given mapped view of the file.
+ * The stream reads the view from the beginning. ff_stream_copy() and ff_stream_get_hash()
+ * consume the view directly without copying it into intermediate buffers.
+ * This function acquires the map, so the caller mustn't delete the map!
+ * Always returns correct result.
+ */
+FF_API struct ff_stream *ff_stream_file_map_create(struct ff_file_map *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -73,6 +73,21 @@ FF_API enum ff_result ff_tcp_write(struct ff_tcp *tcp, const void *buf, int len)
  */
 FF_API enum ff_result ff_tcp_write_with_timeout(struct ff_tcp *tcp, const void *buf, int len, int timeout);
 
+/**
+ * Fills exactly iov_cnt buffers from the iov in order by data from the tcp.
+ * Large buffers are filled directly from the socket by a single scatter read, bypassing the read buffer.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_tcp_readv(struct ff_tcp *tcp, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Writes exactly iov_cnt buffers from the iov in order into the tcp.
+ * Small buffers are coalesced in the write buffer, while large buffers are written directly
+ * to the socket by a single gather write, bypassing the write buffer.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+FF_API enum ff_result ff_tcp_writev(struct ff_tcp *tcp, const struct ff_iovec *iov, int iov_cnt);
+
 /**
  * Flushes the tcp write buffer.
  * Returns FF_SUCCESS on success, FF_FAILURE on error.
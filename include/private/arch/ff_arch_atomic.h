@@ -0,0 +1,50 @@
+#ifndef FF_ARCH_ATOMIC_PRIVATE_H
+#define FF_ARCH_ATOMIC_PRIVATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * Atomically reads the value.
+ * All ff_arch_atomic_*() functions act as full memory barriers.
+ */
+int ff_arch_atomic_get(int *value);
+
+/**
+ * @public
+ * Atomically stores the new_value into the value.
+ */
+void ff_arch_atomic_set(int *value, int new_value);
+
+/**
+ * @public
+ * Atomically stores the new_value into the value and returns the previous value.
+ */
+int ff_arch_atomic_exchange(int *value, int new_value);
+
+/**
+ * @public
+ * Atomically adds the delta to the value and returns the resulting value.
+ */
+int ff_arch_atomic_add(int *value, int delta);
+
+/**
+ * @public
+ * Atomically stores the new_value into the value if it equals to the expected_value.
+ * Returns the previous value, so the exchange has succeeded if it equals to the expected_value.
+ */
+int ff_arch_atomic_compare_exchange(int *value, int expected_value, int new_value);
+
+/**
+ * @public
+ * Hints the processor that the current thread is spinning in a busy-wait loop.
+ */
+void ff_arch_atomic_pause();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,20 +1,71 @@
 #ifndef FF_ARCH_COMPLETION_PORT_PRIVATE_H
 #define FF_ARCH_COMPLETION_PORT_PRIVATE_H
 
+#include "private/ff_common.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct ff_arch_completion_port;
 
+/**
+ * Non-NULL data passed to the ff_arch_completion_port_put() must point to a structure,
+ * which starts with this entry. The completion port links queued data using this entry,
+ * so ff_arch_completion_port_put() doesn't allocate memory.
+ * The data can be put only into one completion port at a time.
+ */
+struct ff_arch_completion_port_entry
+{
+	struct ff_arch_completion_port_entry *next;
+};
+
+/**
+ * Counters collected by the completion port.
+ */
+struct ff_arch_completion_port_stats
+{
+	/* the number of blocking waits for completions */
+	int64_t waits_cnt;
+
+	/* the number of completions returned by these waits */
+	int64_t events_cnt;
+
+	/* the number of busy-poll spins, which found completions, and spins, which ran out of the budget */
+	int64_t busy_poll_hits_cnt;
+	int64_t busy_poll_misses_cnt;
+};
+
 struct ff_arch_completion_port *ff_arch_completion_port_create(int concurrency);
 
 void ff_arch_completion_port_delete(struct ff_arch_completion_port *completion_port);
 
 void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port, const void **data);
 
+/**
+ * Waits for at least one completion and returns up to max_cnt completions in the data array.
+ * Returns the number of returned completions. Completions posted by ff_arch_completion_port_put()
+ * with NULL data are returned as NULL items.
+ * Completions are harvested from the OS in batches of up to max_cnt items per wait,
+ * so a busy port requires less waits per completion than ff_arch_completion_port_get().
+ * Only one thread at a time can call this function for the given completion port.
+ */
+int ff_arch_completion_port_get_many(struct ff_arch_completion_port *completion_port, const void **data, int max_cnt);
+
 void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data);
 
+/**
+ * Enables busy polling in ff_arch_completion_port_get(). Before blocking, the thread spins
+ * for up to the given interval in microseconds, polling for completions without blocking.
+ * The actual spin time adapts to how often spinning finds completions.
+ * Busy polling is disabled if the interval is 0.
+ * If is_socket_busy_poll is non-zero, then sockets created after this call will busy-poll
+ * the network device for the same interval if the platform supports it.
+ */
+void ff_arch_completion_port_set_busy_poll(struct ff_arch_completion_port *completion_port, int interval, int is_socket_busy_poll);
+
+void ff_arch_completion_port_get_stats(struct ff_arch_completion_port *completion_port, struct ff_arch_completion_port_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
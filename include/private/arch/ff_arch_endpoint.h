@@ -0,0 +1,34 @@
+#ifndef FF_ARCH_ENDPOINT_PRIVATE_H
+#define FF_ARCH_ENDPOINT_PRIVATE_H
+
+#include "private/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The kernel object such as a socket or a file, which can be used for copying data
+ * between objects in the kernel without passing it through user-space buffers.
+ * Endpoints are owned by their objects, so they are valid until the object is deleted.
+ */
+struct ff_arch_endpoint;
+
+/**
+ * Returns non-zero if data can be transferred from the src endpoint to the dst endpoint in the kernel.
+ */
+int ff_arch_endpoint_can_transfer(const struct ff_arch_endpoint *src, const struct ff_arch_endpoint *dst);
+
+/**
+ * Transfers exactly len bytes from the current position of the src endpoint
+ * to the current position of the dst endpoint.
+ * ff_arch_endpoint_can_transfer() must return non-zero for the given endpoints.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error or if the end of the src is reached.
+ */
+enum ff_result ff_arch_endpoint_transfer(struct ff_arch_endpoint *src, struct ff_arch_endpoint *dst, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,7 +19,8 @@ typedef void (*ff_arch_fiber_func)(void *ctx);
 
 /**
  * @public
- * Converts the thread to fibers
+ * Converts the current thread to fibers.
+ * Must be called on every thread, which is going to run fibers.
  */
 struct ff_arch_fiber *ff_arch_fiber_initialize();
 
@@ -46,9 +47,9 @@ void ff_arch_fiber_delete(struct ff_arch_fiber *fiber);
 
 /**
  * @public
- * Switches to the given fiber
+ * Switches from the current_fiber, which must be executed on the current thread, to the given fiber.
  */
-void ff_arch_fiber_switch(struct ff_arch_fiber *fiber);
+void ff_arch_fiber_switch(struct ff_arch_fiber *current_fiber, struct ff_arch_fiber *fiber);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,7 @@
 #define FF_ARCH_FILE_PRIVATE_H
 
 #include "private/ff_common.h"
+#include "private/arch/ff_arch_endpoint.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -9,12 +10,22 @@ extern "C" {
 
 struct ff_arch_file;
 
+struct ff_arch_file_map;
+
 enum ff_arch_file_access_mode
 {
 	FF_ARCH_FILE_READ,
 	FF_ARCH_FILE_WRITE
 };
 
+enum ff_arch_file_map_advice
+{
+	FF_ARCH_FILE_MAP_ADVICE_NORMAL,
+	FF_ARCH_FILE_MAP_ADVICE_SEQUENTIAL,
+	FF_ARCH_FILE_MAP_ADVICE_RANDOM,
+	FF_ARCH_FILE_MAP_ADVICE_WILLNEED
+};
+
 struct ff_arch_file *ff_arch_file_open(const wchar_t *path, enum ff_arch_file_access_mode access_mode);
 
 void ff_arch_file_close(struct ff_arch_file *file);
@@ -23,6 +34,36 @@ int ff_arch_file_read(struct ff_arch_file *file, void *buf, int len);
 
 int ff_arch_file_write(struct ff_arch_file *file, const void *buf, int len);
 
+/**
+ * Reads data from the current position of the file into up to iov_cnt buffers from the iov.
+ * Returns the number of bytes read, which can be smaller than the total length of buffers,
+ * 0 if the end of file is reached or -1 on error.
+ */
+int ff_arch_file_readv(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Writes data from up to iov_cnt buffers from the iov at the current position of the file.
+ * Returns the number of bytes written, which can be smaller than the total length of buffers,
+ * or -1 on error.
+ */
+int ff_arch_file_writev(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Reads data from the file at the given offset into up to iov_cnt buffers from the iov
+ * without changing the current position of the file.
+ * Returns the number of bytes read, which can be smaller than the total length of buffers,
+ * 0 if the end of file is reached or -1 on error.
+ */
+int ff_arch_file_preadv(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset);
+
+/**
+ * Writes data from up to iov_cnt buffers from the iov into the file at the given offset
+ * without changing the current position of the file.
+ * Returns the number of bytes written, which can be smaller than the total length of buffers,
+ * or -1 on error.
+ */
+int ff_arch_file_pwritev(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset);
+
 enum ff_result ff_arch_file_erase(const wchar_t *path);
 
 enum ff_result ff_arch_file_copy(const wchar_t *src_path, const wchar_t *dst_path);
@@ -31,6 +72,34 @@ enum ff_result ff_arch_file_move(const wchar_t *src_path, const wchar_t *dst_pat
 
 int64_t ff_arch_file_get_size(struct ff_arch_file *file);
 
+/**
+ * Returns the endpoint for kernel-side transfers of data to and from the file
+ * or NULL if such transfers aren't supported.
+ */
+struct ff_arch_endpoint *ff_arch_file_get_endpoint(struct ff_arch_file *file);
+
+/**
+ * Maps len bytes of the file opened for reading starting from the given offset into memory for reading.
+ * The offset doesn't need to be aligned to the page size.
+ * Returns NULL on error.
+ */
+struct ff_arch_file_map *ff_arch_file_map_create(struct ff_arch_file *file, int64_t offset, int64_t len);
+
+void ff_arch_file_map_delete(struct ff_arch_file_map *map);
+
+const void *ff_arch_file_map_get_data(struct ff_arch_file_map *map);
+
+/**
+ * Applies the advice to len bytes of the map starting from the given offset.
+ * Errors are ignored, since advices are only hints.
+ */
+void ff_arch_file_map_advise(struct ff_arch_file_map *map, int64_t offset, int64_t len, enum ff_arch_file_map_advice advice);
+
+/**
+ * Loads len bytes of the map starting from the given offset into memory using the threadpool.
+ */
+void ff_arch_file_map_prefault(struct ff_arch_file_map *map, int64_t offset, int64_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,10 +22,19 @@ void ff_arch_misc_shutdown();
 
 /**
  * @public
- * Returns the current time in milliseconds
+ * Returns the monotonic time in milliseconds.
+ * It isn't affected by wall-clock adjustments, so it is used for timeouts.
  */
 int64_t ff_arch_misc_get_current_time();
 
+/**
+ * @public
+ * Returns the monotonic time in nanoseconds.
+ * This function is cheap enough for measuring intervals on hot paths,
+ * but the returned value has no relation to the wall-clock time.
+ */
+int64_t ff_arch_misc_get_precise_time();
+
 /**
  * @public
  * sleeps for the given interval
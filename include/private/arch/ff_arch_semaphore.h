@@ -0,0 +1,41 @@
+#ifndef FF_ARCH_SEMAPHORE_PRIVATE_H
+#define FF_ARCH_SEMAPHORE_PRIVATE_H
+
+#include "private/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Counting semaphore, which blocks threads instead of fibers.
+ * It is intended for parking idle threads outside the scheduler,
+ * so it mustn't be used from fibers.
+ */
+struct ff_arch_semaphore;
+
+struct ff_arch_semaphore *ff_arch_semaphore_create(int value);
+
+void ff_arch_semaphore_delete(struct ff_arch_semaphore *semaphore);
+
+/**
+ * Increments the semaphore value and wakes up a thread blocked in ff_arch_semaphore_down() if any.
+ */
+void ff_arch_semaphore_up(struct ff_arch_semaphore *semaphore);
+
+/**
+ * Blocks the current thread until the semaphore value becomes positive, then decrements it.
+ */
+void ff_arch_semaphore_down(struct ff_arch_semaphore *semaphore);
+
+/**
+ * Blocks the current thread until the semaphore value becomes positive or the timeout in milliseconds expires.
+ * Returns FF_FAILURE on timeout. Otherwise decrements the value and returns FF_SUCCESS.
+ */
+enum ff_result ff_arch_semaphore_down_with_timeout(struct ff_arch_semaphore *semaphore, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
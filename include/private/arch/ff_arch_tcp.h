@@ -2,6 +2,7 @@
 #define FF_ARCH_TCP_PRIVATE_H
 
 #include "private/arch/ff_arch_net_addr.h"
+#include "private/arch/ff_arch_endpoint.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,8 +24,28 @@ int ff_arch_tcp_read(struct ff_arch_tcp *tcp, void *buf, int len);
 
 int ff_arch_tcp_write(struct ff_arch_tcp *tcp, const void *buf, int len);
 
+/**
+ * Reads data from the tcp into up to iov_cnt buffers from the iov.
+ * Returns the number of bytes read, which can be smaller than the total length of buffers,
+ * 0 if the connection is closed by the peer or -1 on error.
+ */
+int ff_arch_tcp_readv(struct ff_arch_tcp *tcp, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Writes data from up to iov_cnt buffers from the iov into the tcp.
+ * Returns the number of bytes written, which can be smaller than the total length of buffers,
+ * or -1 on error.
+ */
+int ff_arch_tcp_writev(struct ff_arch_tcp *tcp, const struct ff_iovec *iov, int iov_cnt);
+
 void ff_arch_tcp_disconnect(struct ff_arch_tcp *tcp);
 
+/**
+ * Returns the endpoint for kernel-side transfers of data to and from the tcp
+ * or NULL if such transfers aren't supported.
+ */
+struct ff_arch_endpoint *ff_arch_tcp_get_endpoint(struct ff_arch_tcp *tcp);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,21 @@ struct ff_arch_thread;
 
 typedef void (*ff_arch_thread_func)(void *ctx);
 
+/**
+ * slots for per-thread data.
+ * Values stored in these slots are visible only to the thread, which stored them.
+ */
+enum ff_arch_thread_local_slot
+{
+	/* per-thread data of the ff_fiber */
+	FF_ARCH_THREAD_LOCAL_FIBER,
+
+	/* scheduler, which runs fibers on the current thread */
+	FF_ARCH_THREAD_LOCAL_SCHEDULER,
+
+	FF_ARCH_THREAD_LOCAL_SLOTS_CNT
+};
+
 struct ff_arch_thread *ff_arch_thread_create(ff_arch_thread_func func, int stack_size);
 
 void ff_arch_thread_delete(struct ff_arch_thread *thread);
@@ -17,6 +32,19 @@ void ff_arch_thread_start(struct ff_arch_thread *thread, void *ctx);
 
 void ff_arch_thread_join(struct ff_arch_thread *thread);
 
+/**
+ * Returns the value stored in the given slot by the current thread.
+ * Returns NULL if the current thread didn't store anything in the slot.
+ * This is a real function call, so the result isn't cached by the compiler
+ * when the fiber calling it migrates between threads.
+ */
+void *ff_arch_thread_get_local(enum ff_arch_thread_local_slot slot);
+
+/**
+ * Stores the value in the given slot for the current thread.
+ */
+void ff_arch_thread_set_local(enum ff_arch_thread_local_slot slot, void *value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,42 @@
+#ifndef FF_ARCH_TIMER_PRIVATE_H
+#define FF_ARCH_TIMER_PRIVATE_H
+
+#include "private/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Timer, which wakes up the waiting fiber at the given time.
+ * The time uses the same clock as ff_arch_misc_get_current_time().
+ */
+struct ff_arch_timer;
+
+struct ff_arch_timer *ff_arch_timer_create();
+
+void ff_arch_timer_delete(struct ff_arch_timer *timer);
+
+/**
+ * Arms the timer, so it fires at the given expiration_time in milliseconds.
+ * The timer fires immediately if the expiration_time is in the past.
+ * This function can be called from any thread.
+ */
+void ff_arch_timer_set(struct ff_arch_timer *timer, int64_t expiration_time);
+
+/**
+ * Disarms the timer, so it won't fire until the next ff_arch_timer_set() call.
+ */
+void ff_arch_timer_reset(struct ff_arch_timer *timer);
+
+/**
+ * Blocks the current fiber until the timer fires.
+ * Only one fiber can wait for the timer at a time.
+ */
+void ff_arch_timer_wait(struct ff_arch_timer *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
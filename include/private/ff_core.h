@@ -3,6 +3,7 @@
 
 #include "ff/ff_core.h"
 #include "private/ff_fiber.h"
+#include "private/ff_timer_wheel.h"
 #include "private/arch/ff_arch_completion_port.h"
 
 #ifdef __cplusplus
@@ -23,6 +24,13 @@ void ff_core_schedule_fiber(struct ff_fiber *fiber);
  */
 void ff_core_yield_fiber();
 
+/**
+ * @public
+ * Returns the completion port of the scheduler, which runs the current fiber.
+ * I/O operations of the current fiber should be registered in this completion port.
+ */
+struct ff_arch_completion_port *ff_core_get_completion_port();
+
 /**
  * @public
  * the function, which is called when cancelling the timed out operation.
@@ -34,22 +42,33 @@ typedef void (*ff_core_cancel_timeout_func)(struct ff_fiber *fiber, void *ctx);
 
 /**
  * @public
- * Represents opaque data, associated with current timeout operation
+ * Represents data, associated with the timeout operation.
+ * Callers embed this structure into their own structures or allocate it on the stack,
+ * so registering timeout operations doesn't allocate memory.
+ * Fields of this structure are private to the ff_core.
  */
-struct ff_core_timeout_operation_data;
+struct ff_core_timeout_operation_data
+{
+	/* the node must be the first member, because ff_core casts nodes to this structure */
+	struct ff_timer_wheel_node node;
+	ff_core_cancel_timeout_func cancel_timeout_func;
+	struct ff_fiber *fiber;
+	void *ctx;
+	int is_expired;
+};
 
 /**
  * @public
- * Registers the timeout operation.
- * Returns the data, which should be passed to ff_core_deregister_timeout_operation()
- * after operation completion.
+ * Registers the timeout operation using the given timeout_operation_data.
+ * The timeout_operation_data must be passed to ff_core_deregister_timeout_operation()
+ * after operation completion and it must remain valid until then.
  */
-struct ff_core_timeout_operation_data *ff_core_register_timeout_operation(int timeout, ff_core_cancel_timeout_func cancel_timeout_func, void *ctx);
+void ff_core_register_timeout_operation(struct ff_core_timeout_operation_data *timeout_operation_data, int timeout, ff_core_cancel_timeout_func cancel_timeout_func, void *ctx);
 
 /**
  * @public
  * Deregisters the timeout operation, which was registered using ff_core_register_timeout_operation()
- * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ * Returns FF_SUCCESS on success, FF_FAILURE if the operation has been timed out.
  * Usually this function is called in the same function as the ff_core_register_timeout_operation()
  * after completing the given operation.
  */
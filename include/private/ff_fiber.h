@@ -25,6 +25,77 @@ void ff_fiber_shutdown();
  */
 void ff_fiber_switch(struct ff_fiber *fiber);
 
+/**
+ * @public
+ * Returns non-zero if some thread executes the given fiber at the moment.
+ * ff_fiber_switch() to such fiber will spin until the thread switches from it.
+ */
+int ff_fiber_is_running(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * the number of fiber priority classes defined in the enum ff_fiber_priority
+ */
+#define FF_FIBER_PRIORITIES_CNT 3
+
+/**
+ * @public
+ * Returns the priority class of the given fiber
+ */
+enum ff_fiber_priority ff_fiber_get_priority(struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Intrusive doubly-linked list of fibers.
+ * Fibers are linked via hooks embedded into the struct ff_fiber, so adding fibers
+ * to the list doesn't allocate memory. Each fiber can be in at most one list at a time.
+ * Run queues and wait queues of synchronization primitives are built on top of this list.
+ * The list isn't thread-safe. Fields of the list are private to the ff_fiber.
+ */
+struct ff_fiber_list
+{
+	struct ff_fiber *head;
+	struct ff_fiber *tail;
+};
+
+/**
+ * @public
+ * Initializes the empty list.
+ */
+void ff_fiber_list_initialize(struct ff_fiber_list *list);
+
+/**
+ * @public
+ * Returns non-zero if the list doesn't contain fibers.
+ */
+int ff_fiber_list_is_empty(struct ff_fiber_list *list);
+
+/**
+ * @public
+ * Inserts the fiber at the head of the list. The fiber mustn't be in any list.
+ */
+void ff_fiber_list_push_front(struct ff_fiber_list *list, struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Inserts the fiber at the tail of the list. The fiber mustn't be in any list.
+ */
+void ff_fiber_list_push_back(struct ff_fiber_list *list, struct ff_fiber *fiber);
+
+/**
+ * @public
+ * Removes the fiber from the head of the list and returns it.
+ * Returns NULL if the list is empty.
+ */
+struct ff_fiber *ff_fiber_list_pop_front(struct ff_fiber_list *list);
+
+/**
+ * @public
+ * Removes the given fiber from the list in O(1) time.
+ * Returns FF_FAILURE if the fiber isn't in the list.
+ */
+enum ff_result ff_fiber_list_remove(struct ff_fiber_list *list, struct ff_fiber *fiber);
+
 #ifdef __cplusplus
 }
 #endif
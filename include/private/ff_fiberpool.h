@@ -7,14 +7,39 @@ extern "C" {
 
 struct ff_fiberpool;
 
-struct ff_fiberpool *ff_fiberpool_create(int max_fibers_cnt);
+/**
+ * Creates the fiberpool, which starts up to max_fibers_cnt worker fibers on demand.
+ * Worker fibers, which stay idle for longer than idle_timeout milliseconds, exit,
+ * so their stacks are freed after bursts of tasks. Idle fibers never exit if idle_timeout is 0.
+ */
+struct ff_fiberpool *ff_fiberpool_create(int max_fibers_cnt, int idle_timeout);
 
 void ff_fiberpool_delete(struct ff_fiberpool *fiberpool);
 
 typedef void (*ff_fiberpool_func)(void *ctx);
 
+/**
+ * Schedules the func for execution in the fiberpool.
+ * Tasks are picked up by worker fibers in FIFO order.
+ */
 void ff_fiberpool_execute_async(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx);
 
+/**
+ * Schedules the func for execution in the fiberpool with each of ctxs_cnt contexts.
+ * This is cheaper than ctxs_cnt calls to ff_fiberpool_execute_async().
+ */
+void ff_fiberpool_execute_batch_async(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void **ctxs, int ctxs_cnt);
+
+/**
+ * Sets the idle timeout for worker fibers. See ff_fiberpool_create().
+ */
+void ff_fiberpool_set_idle_timeout(struct ff_fiberpool *fiberpool, int idle_timeout);
+
+/**
+ * Returns the number of running worker fibers.
+ */
+int ff_fiberpool_get_fibers_cnt(struct ff_fiberpool *fiberpool);
+
 #ifdef __cplusplus
 }
 #endif
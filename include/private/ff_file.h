@@ -2,11 +2,22 @@
 #define FF_FILE_PRIVATE_H
 
 #include "ff/ff_file.h"
+#include "private/ff_stream_endpoint.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Returns the access mode, which has been used for opening the file.
+ */
+enum ff_file_access_mode ff_file_get_access_mode(struct ff_file *file);
+
+/**
+ * Returns the endpoint for kernel-side transfers of data to and from the file
+ * or NULL if such transfers aren't possible.
+ */
+struct ff_stream_endpoint *ff_file_get_stream_endpoint(struct ff_file *file);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,27 @@
+#ifndef FF_FUTURE_PRIVATE_H
+#define FF_FUTURE_PRIVATE_H
+
+#include "ff/ff_future.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * Initializes the free list of futures. It is called by ff_core_initialize().
+ */
+void ff_future_initialize();
+
+/**
+ * @public
+ * Deletes futures from the free list. It is called by ff_core_shutdown()
+ * after fibers, which execute futures, are finished.
+ */
+void ff_future_shutdown();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
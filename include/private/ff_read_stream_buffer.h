@@ -7,17 +7,22 @@ extern "C" {
 
 typedef int (*ff_read_stream_func)(void *ctx, void *buf, int len);
 
+typedef int (*ff_readv_stream_func)(void *ctx, const struct ff_iovec *iov, int iov_cnt);
+
 struct ff_read_stream_buffer;
 
 /**
  * Creates a buffer for reading.
  * read_func is the function, which will be called for reading the next chunk of data
  * in the case if the buffer become empty.
- * read_func_ctx is the context parameter, which will be passed to the read_func. Usually this parameter
- * points to the underlying stream, from which the read_func will read data.
+ * readv_func is the optional function for reading the next chunk of data into multiple buffers
+ * by a single call. It should return the number of bytes read like the read_func does.
+ * If it is NULL, then ff_read_stream_buffer_readv() reads buffers one by one.
+ * read_func_ctx is the context parameter, which will be passed to the read_func and to the readv_func.
+ * Usually this parameter points to the underlying stream, from which the read_func will read data.
  * capacity is size of the buffer in bytes.
  */
-struct ff_read_stream_buffer *ff_read_stream_buffer_create(ff_read_stream_func read_func, void *read_func_ctx, int capacity);
+struct ff_read_stream_buffer *ff_read_stream_buffer_create(ff_read_stream_func read_func, ff_readv_stream_func readv_func, void *read_func_ctx, int capacity);
 
 /**
  * Deletes the buffer.
@@ -30,6 +35,21 @@ void ff_read_stream_buffer_delete(struct ff_read_stream_buffer *buffer);
  */
 enum ff_result ff_read_stream_buffer_read(struct ff_read_stream_buffer *buffer, void *buf, int len);
 
+/**
+ * Fills exactly iov_cnt buffers from the iov in order.
+ * Buffers, which cannot be filled by data from the buffer, are filled directly from the underlying stream
+ * by the readv_func, which reads ahead the next chunk of data into the buffer at the same time.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+enum ff_result ff_read_stream_buffer_readv(struct ff_read_stream_buffer *buffer, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Consumes up to len bytes, which are already in the buffer, without reading the underlying stream.
+ * Stores the pointer to consumed bytes in the data. The pointer is valid until the next operation on the buffer.
+ * Returns the number of consumed bytes. Returns 0 if the buffer is empty.
+ */
+int ff_read_stream_buffer_read_buffered(struct ff_read_stream_buffer *buffer, const void **data, int len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,30 @@
+#ifndef FF_STREAM_ENDPOINT_PRIVATE_H
+#define FF_STREAM_ENDPOINT_PRIVATE_H
+
+#include "ff/ff_stream.h"
+#include "private/arch/ff_arch_endpoint.h"
+#include "private/ff_read_stream_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The kernel object backing the stream, which is returned by the ff_stream_vtable::get_endpoint() callback.
+ */
+struct ff_stream_endpoint
+{
+	struct ff_arch_endpoint *arch_endpoint;
+
+	/* the buffer with data, which has been already read from the arch_endpoint, but hasn't been consumed yet.
+	 * It must be drained before transferring data from the arch_endpoint.
+	 * It is NULL if the stream isn't readable
+	 */
+	struct ff_read_stream_buffer *read_buffer;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
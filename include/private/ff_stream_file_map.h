@@ -0,0 +1,14 @@
+#ifndef FF_STREAM_FILE_MAP_PRIVATE_H
+#define FF_STREAM_FILE_MAP_PRIVATE_H
+
+#include "ff/ff_stream_file_map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,11 +2,17 @@
 #define FF_TCP_PRIVATE_H
 
 #include "ff/ff_tcp.h"
+#include "private/ff_stream_endpoint.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Returns the endpoint for kernel-side transfers of data to and from the tcp
+ * or NULL if such transfers aren't possible.
+ */
+struct ff_stream_endpoint *ff_tcp_get_stream_endpoint(struct ff_tcp *tcp);
 
 #ifdef __cplusplus
 }
@@ -1,19 +1,73 @@
 #ifndef FF_THREADPOOL_PRIVATE_H
 #define FF_THREADPOOL_PRIVATE_H
 
+#include "private/ff_common.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct ff_threadpool;
 
-struct ff_threadpool *ff_threadpool_create(int max_threads_cnt);
+/**
+ * Counters collected by the threadpool
+ */
+struct ff_threadpool_stats
+{
+	/* the number of tasks, which were picked up by worker threads */
+	int64_t tasks_cnt;
+
+	/* the total and the maximum time in nanoseconds, which tasks spent in the queue
+	 * before worker threads picked them up
+	 */
+	int64_t total_queue_latency;
+	int64_t max_queue_latency;
+
+	/* the number of running worker threads */
+	int threads_cnt;
+};
+
+/**
+ * Creates the threadpool, which starts worker threads on demand up to max_threads_cnt.
+ * Worker threads exit after they stay idle for idle_timeout milliseconds.
+ */
+struct ff_threadpool *ff_threadpool_create(int max_threads_cnt, int idle_timeout);
 
 void ff_threadpool_delete(struct ff_threadpool *threadpool);
 
 typedef void (*ff_threadpool_func)(void *ctx);
 
-void ff_threadpool_execute_async(struct ff_threadpool *threadpool, ff_threadpool_func func, void *ctx);
+/**
+ * The task, which is queued by ff_threadpool_execute_async().
+ * The threadpool doesn't allocate tasks, so the caller provides the memory for them.
+ * Members of the structure are private to the threadpool.
+ */
+struct ff_threadpool_task
+{
+	/* the link in the overflow list, which holds tasks while the queue is full */
+	struct ff_threadpool_task *next;
+
+	ff_threadpool_func func;
+	void *ctx;
+
+	/* the time in nanoseconds, when the task has been put into the queue */
+	int64_t enqueue_time;
+};
+
+/**
+ * Schedules the func(ctx) for execution on a worker thread.
+ * The task must remain valid until the func is called,
+ * so callers usually embed it into the structure, which is passed as ctx.
+ */
+void ff_threadpool_execute_async(struct ff_threadpool *threadpool, struct ff_threadpool_task *task, ff_threadpool_func func, void *ctx);
+
+/**
+ * Sets the idle timeout in milliseconds for worker threads.
+ * Threads, which are already waiting for tasks, apply it on their next wait.
+ */
+void ff_threadpool_set_idle_timeout(struct ff_threadpool *threadpool, int idle_timeout);
+
+void ff_threadpool_get_stats(struct ff_threadpool *threadpool, struct ff_threadpool_stats *stats);
 
 #ifdef __cplusplus
 }
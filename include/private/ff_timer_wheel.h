@@ -0,0 +1,92 @@
+#ifndef FF_TIMER_WHEEL_PRIVATE_H
+#define FF_TIMER_WHEEL_PRIVATE_H
+
+#include "private/ff_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @public
+ * The node of the timer wheel.
+ * Callers embed this node into their own structures, so adding timers
+ * to the wheel doesn't allocate memory.
+ * Fields of the node are private to the ff_timer_wheel.
+ */
+struct ff_timer_wheel_node
+{
+	struct ff_timer_wheel_node *prev;
+	struct ff_timer_wheel_node *next;
+	int64_t expiration_time;
+};
+
+/**
+ * @public
+ * Hierarchical timer wheel with 1 millisecond resolution.
+ * Adding and removing nodes takes O(1) time. Expiration takes time proportional
+ * to the number of expired nodes plus the number of elapsed milliseconds.
+ * The timer wheel isn't thread-safe.
+ */
+struct ff_timer_wheel;
+
+/**
+ * @public
+ * the function, which is called for each expired node.
+ * The node is already removed from the wheel when this function is called,
+ * so it can be added to the wheel again.
+ */
+typedef void (*ff_timer_wheel_expire_func)(struct ff_timer_wheel_node *node, void *ctx);
+
+/**
+ * @public
+ * Creates the timer wheel, which starts counting time from the given current_time in milliseconds.
+ */
+struct ff_timer_wheel *ff_timer_wheel_create(int64_t current_time);
+
+/**
+ * @public
+ * Deletes the timer wheel. The wheel must be empty.
+ */
+void ff_timer_wheel_delete(struct ff_timer_wheel *timer_wheel);
+
+/**
+ * @public
+ * Adds the node to the wheel. The node will expire at the given expiration_time in milliseconds.
+ */
+void ff_timer_wheel_add(struct ff_timer_wheel *timer_wheel, struct ff_timer_wheel_node *node, int64_t expiration_time);
+
+/**
+ * @public
+ * Removes the node from the wheel.
+ * Does nothing if the node has been already expired.
+ */
+void ff_timer_wheel_remove(struct ff_timer_wheel *timer_wheel, struct ff_timer_wheel_node *node);
+
+/**
+ * @public
+ * Expires all nodes with expiration_time less or equal to the given current_time
+ * by calling the expire_func for each of them.
+ */
+void ff_timer_wheel_expire(struct ff_timer_wheel *timer_wheel, int64_t current_time, ff_timer_wheel_expire_func expire_func, void *ctx);
+
+/**
+ * @public
+ * Returns the time in milliseconds, when ff_timer_wheel_expire() should be called next time.
+ * This time is never later than the earliest expiration_time of nodes in the wheel,
+ * but it can be earlier, when nodes must be moved between levels of the wheel.
+ * The wheel must be non-empty.
+ */
+int64_t ff_timer_wheel_get_next_expiration_time(struct ff_timer_wheel *timer_wheel);
+
+/**
+ * @public
+ * Returns non-zero if the wheel doesn't contain nodes.
+ */
+int ff_timer_wheel_is_empty(struct ff_timer_wheel *timer_wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,17 +7,22 @@ extern "C" {
 
 typedef int (*ff_write_stream_func)(void *ctx, const void *buf, int len);
 
+typedef int (*ff_writev_stream_func)(void *ctx, const struct ff_iovec *iov, int iov_cnt);
+
 struct ff_write_stream_buffer;
 
 /**
  * Creates the buffer for writing.
  * write_func will be used for writing data into underlying stream in the case
  * when the buffer will be full.
- * write_func_ctx is the context parameter, which is passed to the write_func. Usually it points to
- * the underlying stream, to which the write_func will write data.
+ * writev_func is the optional function for writing data from multiple buffers into underlying stream
+ * by a single call. It should return the number of bytes written like the write_func does.
+ * If it is NULL, then ff_write_stream_buffer_writev() writes buffers one by one.
+ * write_func_ctx is the context parameter, which is passed to the write_func and to the writev_func.
+ * Usually it points to the underlying stream, to which the write_func will write data.
  * capacity is the size of the buffer in bytes.
  */
-struct ff_write_stream_buffer *ff_write_stream_buffer_create(ff_write_stream_func write_func, void *write_func_ctx, int capacity);
+struct ff_write_stream_buffer *ff_write_stream_buffer_create(ff_write_stream_func write_func, ff_writev_stream_func writev_func, void *write_func_ctx, int capacity);
 
 /**
  * Deletes the buffer.
@@ -30,6 +35,14 @@ void ff_write_stream_buffer_delete(struct ff_write_stream_buffer *buffer);
  */
 enum ff_result ff_write_stream_buffer_write(struct ff_write_stream_buffer *buffer, const void *buf, int len);
 
+/**
+ * Writes exactly iov_cnt buffers from the iov in order.
+ * Buffers, which fit into the buffer, are coalesced in it. Other buffers are written directly
+ * to the underlying stream by the writev_func together with the buffered data.
+ * Returns FF_SUCCESS on success, FF_FAILURE on error.
+ */
+enum ff_result ff_write_stream_buffer_writev(struct ff_write_stream_buffer *buffer, const struct ff_iovec *iov, int iov_cnt);
+
 /**
  * Flushes the buffer.
  * Returns FF_SUCCESS on success, FF_FAILURE on error.
@@ -0,0 +1,38 @@
+#include "private/ff_common.h"
+
+#include "private/arch/ff_arch_atomic.h"
+
+int ff_arch_atomic_get(int *value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+void ff_arch_atomic_set(int *value, int new_value)
+{
+	__atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+
+int ff_arch_atomic_exchange(int *value, int new_value)
+{
+	return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+
+int ff_arch_atomic_add(int *value, int delta)
+{
+	return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+}
+
+int ff_arch_atomic_compare_exchange(int *value, int expected_value, int new_value)
+{
+	__atomic_compare_exchange_n(value, &expected_value, new_value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return expected_value;
+}
+
+void ff_arch_atomic_pause()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__ ("pause");
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__ ("yield");
+#endif
+}
@@ -1,53 +1,498 @@
 #include "private/ff_common.h"
 
 #include "private/arch/ff_arch_completion_port.h"
-#include "private/ff_stack.h"
 #include "private/arch/ff_arch_mutex.h"
+#include "private/arch/ff_arch_misc.h"
+#include "private/arch/ff_arch_atomic.h"
 #include "ff_linux_completion_port.h"
+#include "ff_linux_uring.h"
 #include "ff_linux_error_check.h"
 
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 
-/* workaround of debian bug #261541 (missing EPOLLONESHOT declaration in sys/epoll.h) */
-#ifndef EPOLLONESHOT
-#	define EPOLLONESHOT (1 << 30)
+/* EPOLLRDHUP is missing in headers of old glibc versions */
+#ifndef EPOLLRDHUP
+#	define EPOLLRDHUP 0x2000
 #endif
 
-static const int EPOLL_CAPACITY = 10;
+#define EPOLL_CAPACITY 10
+
+/**
+ * the number of submission queue entries in the io_uring of the completion port.
+ */
+#define URING_ENTRIES 256
+
+/**
+ * tags in low bits of user_data of io_uring submissions.
+ * user_data without a tag points to struct ff_linux_completion_port_io.
+ * user_data of the event_fd poll and of cancel requests has no pointer.
+ */
+#define URING_TAG_MASK ((uint64_t) 3)
+#define URING_TAG_READ_POLL ((uint64_t) 1)
+#define URING_TAG_WRITE_POLL ((uint64_t) 2)
+#define URING_EVENT_FD_POLL ((uint64_t) 3)
+#define URING_CANCEL ((uint64_t) 0)
+
+/**
+ * the minimum busy-poll budget in nanoseconds.
+ * The budget never drops to zero, so the completion port keeps probing
+ * whether spinning pays off again.
+ */
+#define MIN_BUSY_POLL_BUDGET 1000
+
+/**
+ * the completion port, which completions are harvested by the current thread.
+ * Submissions to this port from the current thread are deferred until the thread harvests completions again.
+ */
+static __thread struct ff_arch_completion_port *harvesting_completion_port = NULL;
+
+struct ff_linux_completion_port_fd
+{
+	/* the completion port, where the fd is registered */
+	struct ff_arch_completion_port *completion_port;
+
+	int fd;
+
+	/* the following fields are guarded by pending_events_mutex of the completion_port */
+
+	/* the data of operations waiting for the fd readiness or NULL if there is no waiting operation */
+	const void *reader_data;
+	const void *writer_data;
+
+	/* non-zero if the fd became ready since the last registered operation of the given type */
+	int is_read_ready;
+	int is_write_ready;
+
+	/* the number of io_uring polls on the fd, which haven't completed yet */
+	int pending_polls_cnt;
+
+	/* the next deregistered fd in the list of retired fds of the completion_port */
+	struct ff_linux_completion_port_fd *next_retired;
+};
 
 struct ff_arch_completion_port
 {
+	/* the io_uring, which is used instead of the epoll_fd, or NULL if the port uses epoll.
+	 * The ring is guarded by pending_events_mutex
+	 */
+	struct ff_linux_uring *uring;
+
 	int epoll_fd;
-	int rd_pipe;
-	int wr_pipe;
-	struct ff_stack *pending_events;
+
+	/* the eventfd, which is signalled when the queue becomes non-empty */
+	int event_fd;
+
+	/* lock-free LIFO list of entries put by ff_arch_completion_port_put() */
+	struct ff_arch_completion_port_entry *queue_head;
+
+	/* the number of NULL entries put by ff_arch_completion_port_put() */
+	int queued_wakeups_cnt;
+
+	/* non-zero if the event_fd has been signalled and the queue hasn't been drained yet */
+	int is_signalled;
+
+	/* the maximum busy-poll time in microseconds. Busy polling is disabled if it is 0 */
+	int busy_poll_interval;
+
+	/* non-zero if SO_BUSY_POLL should be set on new sockets */
+	int is_socket_busy_poll;
+
+	/* the buffer for epoll events harvested by ff_arch_completion_port_get_many().
+	 * Only the thread, which calls ff_arch_completion_port_get_many(), uses it
+	 */
+	struct epoll_event *batch_events;
+	int batch_events_capacity;
+
+	/* the following fields are guarded by pending_events_mutex */
+	struct ff_arch_completion_port_entry *ready_entries_head;
+	struct ff_arch_completion_port_entry *ready_entries_tail;
+	int ready_wakeups_cnt;
+
+	/* the number of threads blocked in epoll_wait() */
+	int waiting_threads_cnt;
+
+	/* deregistered fds, which can be still referred by events harvested by threads waiting in epoll_wait().
+	 * They are freed when no threads wait in epoll_wait()
+	 */
+	struct ff_linux_completion_port_fd *retired_fds;
+
+	/* the current busy-poll budget in nanoseconds. It adapts to the success rate of spinning */
+	int64_t busy_poll_budget;
+
+	struct ff_arch_completion_port_stats stats;
 	struct ff_arch_mutex *pending_events_mutex;
 };
 
+/**
+ * @private
+ * Appends the entry to the tail of the ready list.
+ * pending_events_mutex must be locked.
+ */
+static void append_ready_entry(struct ff_arch_completion_port *completion_port, struct ff_arch_completion_port_entry *entry)
+{
+	entry->next = NULL;
+	if (completion_port->ready_entries_tail != NULL)
+	{
+		completion_port->ready_entries_tail->next = entry;
+	}
+	else
+	{
+		completion_port->ready_entries_head = entry;
+	}
+	completion_port->ready_entries_tail = entry;
+}
+
+/**
+ * @private
+ * Moves all queued entries into the ready list in FIFO order.
+ * pending_events_mutex must be locked.
+ */
+static void drain_queue(struct ff_arch_completion_port *completion_port)
+{
+	struct ff_arch_completion_port_entry *entry;
+	struct ff_arch_completion_port_entry *reversed_entries = NULL;
+	uint64_t value;
+	ssize_t bytes_read;
+	int wakeups_cnt;
+
+	/* reset the event_fd before resetting the is_signalled flag. Otherwise the signal
+	 * from the producer, which put the entry after draining the queue, can be lost
+	 */
+	bytes_read = read(completion_port->event_fd, &value, sizeof(value));
+	ff_linux_fatal_error_check(bytes_read == sizeof(value) || errno == EAGAIN || errno == EINTR, L"cannot read from the eventfd");
+	__atomic_store_n(&completion_port->is_signalled, 0, __ATOMIC_SEQ_CST);
+
+	entry = __atomic_exchange_n(&completion_port->queue_head, NULL, __ATOMIC_SEQ_CST);
+	while (entry != NULL)
+	{
+		struct ff_arch_completion_port_entry *next;
+
+		next = entry->next;
+		entry->next = reversed_entries;
+		reversed_entries = entry;
+		entry = next;
+	}
+	while (reversed_entries != NULL)
+	{
+		entry = reversed_entries;
+		reversed_entries = entry->next;
+		append_ready_entry(completion_port, entry);
+	}
+
+	wakeups_cnt = __atomic_exchange_n(&completion_port->queued_wakeups_cnt, 0, __ATOMIC_SEQ_CST);
+	completion_port->ready_wakeups_cnt += wakeups_cnt;
+}
+
+/**
+ * @private
+ * Pops ready data. Returns 0 if there is no ready data.
+ * pending_events_mutex must be locked.
+ */
+static int pop_ready_data(struct ff_arch_completion_port *completion_port, const void **data)
+{
+	struct ff_arch_completion_port_entry *entry;
+
+	entry = completion_port->ready_entries_head;
+	if (entry != NULL)
+	{
+		completion_port->ready_entries_head = entry->next;
+		if (completion_port->ready_entries_head == NULL)
+		{
+			completion_port->ready_entries_tail = NULL;
+		}
+		entry->next = NULL;
+		*data = entry;
+		return 1;
+	}
+	if (completion_port->ready_wakeups_cnt > 0)
+	{
+		completion_port->ready_wakeups_cnt--;
+		*data = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+static int has_ready_data(struct ff_arch_completion_port *completion_port)
+{
+	int has_data;
+
+	has_data = (completion_port->ready_entries_head != NULL || completion_port->ready_wakeups_cnt > 0);
+	return has_data;
+}
+
+static void write_event_fd(struct ff_arch_completion_port *completion_port)
+{
+	uint64_t value = 1;
+	ssize_t bytes_written;
+
+	for (;;)
+	{
+		bytes_written = write(completion_port->event_fd, &value, sizeof(value));
+		if (bytes_written != -1)
+		{
+			break;
+		}
+		ff_linux_fatal_error_check(errno == EINTR, L"write(event_fd) failed");
+	}
+	ff_linux_fatal_error_check(bytes_written == sizeof(value), L"error when writing to the event_fd");
+}
+
+/**
+ * @private
+ * Wakes up another thread waiting in epoll_wait() if the ready list still contains data.
+ * This is required, because this thread could drain the whole queue.
+ * pending_events_mutex must be locked.
+ */
+static void pass_ready_data(struct ff_arch_completion_port *completion_port)
+{
+	if (completion_port->waiting_threads_cnt > 0 && has_ready_data(completion_port))
+	{
+		write_event_fd(completion_port);
+	}
+}
+
+static void signal_queue(struct ff_arch_completion_port *completion_port)
+{
+	int is_signalled;
+
+	/* signal the event_fd only on the transition from empty to non-empty queue */
+	is_signalled = __atomic_exchange_n(&completion_port->is_signalled, 1, __ATOMIC_SEQ_CST);
+	if (!is_signalled)
+	{
+		write_event_fd(completion_port);
+	}
+}
+
+/**
+ * @private
+ * Spins for up to the given budget in nanoseconds, polling the epoll_fd with zero timeout
+ * and checking the queue of put entries.
+ * Returns the number of harvested events or 0 if spinning didn't find anything.
+ */
+static int busy_poll(struct ff_arch_completion_port *completion_port, struct epoll_event *events, int events_capacity, int64_t budget)
+{
+	int64_t deadline;
+
+	deadline = ff_arch_misc_get_precise_time() + budget;
+	for (;;)
+	{
+		int events_cnt;
+
+		if (__atomic_load_n(&completion_port->queue_head, __ATOMIC_SEQ_CST) != NULL ||
+			__atomic_load_n(&completion_port->queued_wakeups_cnt, __ATOMIC_SEQ_CST) > 0)
+		{
+			/* the producer may not signal the event_fd yet. Pretend it has been signalled,
+			 * so the caller will drain the queue
+			 */
+			events[0].data.ptr = completion_port;
+			return 1;
+		}
+		events_cnt = epoll_wait(completion_port->epoll_fd, events, events_capacity, 0);
+		if (events_cnt > 0)
+		{
+			return events_cnt;
+		}
+		ff_linux_fatal_error_check(events_cnt == 0 || errno == EINTR, L"epoll_wait() failed");
+		if (ff_arch_misc_get_precise_time() >= deadline)
+		{
+			return 0;
+		}
+		ff_arch_atomic_pause();
+	}
+}
+
+/**
+ * @private
+ * Adapts the busy-poll budget: it grows while spinning finds work
+ * and shrinks while spinning is fruitless.
+ * pending_events_mutex must be locked.
+ */
+static void adapt_busy_poll_budget(struct ff_arch_completion_port *completion_port, int64_t max_budget, int is_spin_successful)
+{
+	int64_t budget;
+
+	budget = completion_port->busy_poll_budget;
+	if (is_spin_successful)
+	{
+		budget *= 2;
+	}
+	else
+	{
+		budget /= 2;
+	}
+	if (budget > max_budget)
+	{
+		budget = max_budget;
+	}
+	if (budget < MIN_BUSY_POLL_BUDGET)
+	{
+		budget = MIN_BUSY_POLL_BUDGET;
+	}
+	completion_port->busy_poll_budget = budget;
+}
+
+/**
+ * @private
+ * Frees deregistered fds, which don't have pending io_uring polls.
+ * pending_events_mutex must be locked and no threads must wait in epoll_wait(),
+ * so harvested events cannot refer to these fds.
+ */
+static void free_retired_fds(struct ff_arch_completion_port *completion_port)
+{
+	struct ff_linux_completion_port_fd **prev_next;
+
+	prev_next = &completion_port->retired_fds;
+	while (*prev_next != NULL)
+	{
+		struct ff_linux_completion_port_fd *port_fd;
+
+		port_fd = *prev_next;
+		if (port_fd->pending_polls_cnt == 0)
+		{
+			*prev_next = port_fd->next_retired;
+			ff_free(port_fd);
+		}
+		else
+		{
+			prev_next = &port_fd->next_retired;
+		}
+	}
+}
+
+/* get_uring_sqe() reaps completions, which can re-arm the event_fd poll */
+static struct io_uring_sqe *get_uring_sqe(struct ff_arch_completion_port *completion_port);
+
+/**
+ * @private
+ * Queues the io_uring poll of the event_fd, which completes when the queue becomes non-empty.
+ * pending_events_mutex must be locked.
+ */
+static void arm_event_fd_poll(struct ff_arch_completion_port *completion_port)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = get_uring_sqe(completion_port);
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = completion_port->event_fd;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = URING_EVENT_FD_POLL;
+}
+
+/**
+ * @private
+ * Returns non-zero if the port should use io_uring.
+ * io_uring is used only by single-consumer ports, i.e. by ports of schedulers, which perform I/O.
+ * Setting FF_IO_URING environment variable to 0 forces epoll.
+ */
+static int should_use_uring(int concurrency)
+{
+	const char *env_value;
+
+	if (concurrency != 1)
+	{
+		return 0;
+	}
+	env_value = getenv("FF_IO_URING");
+	if (env_value != NULL && strcmp(env_value, "0") == 0)
+	{
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * @private
+ * Completes the operation waiting for the fd readiness or remembers the readiness
+ * if there is no waiting operation.
+ * pending_events_mutex must be locked.
+ */
+static void signal_fd_readiness(struct ff_arch_completion_port *completion_port, const void **data, int *is_ready)
+{
+	if (*data != NULL)
+	{
+		append_ready_entry(completion_port, (struct ff_arch_completion_port_entry *) *data);
+		*data = NULL;
+	}
+	else
+	{
+		*is_ready = 1;
+	}
+}
+
+/**
+ * @private
+ * Dispatches the edge-triggered epoll event to operations waiting for the fd readiness.
+ * pending_events_mutex must be locked.
+ */
+static void dispatch_fd_event(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd *port_fd, uint32_t events)
+{
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+	{
+		signal_fd_readiness(completion_port, &port_fd->reader_data, &port_fd->is_read_ready);
+	}
+	if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+	{
+		signal_fd_readiness(completion_port, &port_fd->writer_data, &port_fd->is_write_ready);
+	}
+}
+
 struct ff_arch_completion_port *ff_arch_completion_port_create(int concurrency)
 {
 	struct ff_arch_completion_port *completion_port;
-	int pipe_fds[2];
 	int rv;
 	struct epoll_event event;
 
-	(void)concurrency;
-	rv = pipe(pipe_fds);
-	ff_linux_fatal_error_check(rv != -1, L"cannot create pipe");
-
 	completion_port = (struct ff_arch_completion_port *) ff_malloc(sizeof(*completion_port));
-	completion_port->epoll_fd = epoll_create(EPOLL_CAPACITY);
-	ff_linux_fatal_error_check(completion_port->epoll_fd != -1, L"cannot create epoll file descriptor");
-	completion_port->rd_pipe = pipe_fds[0];
-	completion_port->wr_pipe = pipe_fds[1];
-	completion_port->pending_events = ff_stack_create();
+	completion_port->uring = NULL;
+	if (should_use_uring(concurrency))
+	{
+		completion_port->uring = ff_linux_uring_create(URING_ENTRIES);
+	}
+	completion_port->epoll_fd = -1;
+	if (completion_port->uring == NULL)
+	{
+		completion_port->epoll_fd = epoll_create(EPOLL_CAPACITY);
+		ff_linux_fatal_error_check(completion_port->epoll_fd != -1, L"cannot create epoll file descriptor");
+	}
+	completion_port->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	ff_linux_fatal_error_check(completion_port->event_fd != -1, L"cannot create eventfd");
+	completion_port->queue_head = NULL;
+	completion_port->queued_wakeups_cnt = 0;
+	completion_port->is_signalled = 0;
+	completion_port->ready_entries_head = NULL;
+	completion_port->ready_entries_tail = NULL;
+	completion_port->ready_wakeups_cnt = 0;
+	completion_port->waiting_threads_cnt = 0;
+	completion_port->retired_fds = NULL;
+	completion_port->batch_events = NULL;
+	completion_port->batch_events_capacity = 0;
+	completion_port->stats.waits_cnt = 0;
+	completion_port->stats.events_cnt = 0;
+	completion_port->stats.busy_poll_hits_cnt = 0;
+	completion_port->stats.busy_poll_misses_cnt = 0;
+	completion_port->busy_poll_budget = 0;
+	completion_port->busy_poll_interval = 0;
+	completion_port->is_socket_busy_poll = 0;
 	completion_port->pending_events_mutex = ff_arch_mutex_create();
 
-	event.data.ptr = completion_port;
-	event.events = EPOLLIN;
-	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, completion_port->rd_pipe, &event);
-	ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(rd_pipe) failed");
+	if (completion_port->uring != NULL)
+	{
+		arm_event_fd_poll(completion_port);
+	}
+	else
+	{
+		event.data.ptr = completion_port;
+		event.events = EPOLLIN;
+		rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, completion_port->event_fd, &event);
+		ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(event_fd) failed");
+	}
 
 	return completion_port;
 }
@@ -57,103 +502,691 @@ void ff_arch_completion_port_delete(struct ff_arch_completion_port *completion_p
 	int rv;
 
 	ff_arch_mutex_delete(completion_port->pending_events_mutex);
-	ff_stack_delete(completion_port->pending_events);
-	rv = close(completion_port->wr_pipe);
-	ff_assert(rv == 0);
-	rv = close(completion_port->rd_pipe);
-	ff_assert(rv == 0);
-	rv = close(completion_port->epoll_fd);
+	ff_assert(completion_port->ready_entries_head == NULL);
+	if (completion_port->batch_events != NULL)
+	{
+		ff_free(completion_port->batch_events);
+	}
+	if (completion_port->uring != NULL)
+	{
+		/* closing the ring cancels pending polls, so retired fds can be freed */
+		ff_linux_uring_delete(completion_port->uring);
+	}
+	else
+	{
+		rv = close(completion_port->epoll_fd);
+		ff_assert(rv == 0);
+	}
+	while (completion_port->retired_fds != NULL)
+	{
+		struct ff_linux_completion_port_fd *port_fd;
+
+		port_fd = completion_port->retired_fds;
+		completion_port->retired_fds = port_fd->next_retired;
+		ff_free(port_fd);
+	}
+	rv = close(completion_port->event_fd);
 	ff_assert(rv == 0);
 	ff_free(completion_port);
 }
 
+/**
+ * @private
+ * Waits for epoll events and moves them into the ready list.
+ * pending_events_mutex must be locked. It is unlocked while waiting.
+ */
+static void harvest_epoll_events(struct ff_arch_completion_port *completion_port, struct epoll_event *events, int events_capacity)
+{
+	int events_cnt;
+	int i;
+	int busy_poll_interval;
+	int is_spin_successful;
+	int64_t max_busy_poll_budget;
+	int64_t busy_poll_budget;
+
+	busy_poll_interval = ff_arch_atomic_get(&completion_port->busy_poll_interval);
+	max_busy_poll_budget = ((int64_t) busy_poll_interval) * 1000;
+	busy_poll_budget = completion_port->busy_poll_budget;
+	if (completion_port->waiting_threads_cnt == 0)
+	{
+		free_retired_fds(completion_port);
+	}
+	completion_port->waiting_threads_cnt++;
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+	events_cnt = 0;
+	if (max_busy_poll_budget > 0)
+	{
+		if (busy_poll_budget == 0 || busy_poll_budget > max_busy_poll_budget)
+		{
+			busy_poll_budget = max_busy_poll_budget;
+		}
+		events_cnt = busy_poll(completion_port, events, events_capacity, busy_poll_budget);
+	}
+	is_spin_successful = (events_cnt > 0);
+	while (events_cnt == 0)
+	{
+		events_cnt = epoll_wait(completion_port->epoll_fd, events, events_capacity, -1);
+		if (events_cnt == -1)
+		{
+			ff_linux_fatal_error_check(errno == EINTR, L"epoll_wait() failed");
+			events_cnt = 0;
+			continue;
+		}
+		ff_linux_fatal_error_check(events_cnt > 0, L"epoll_wait() unexpectedly returned 0");
+	}
+
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	completion_port->waiting_threads_cnt--;
+	ff_assert(completion_port->waiting_threads_cnt >= 0);
+	if (max_busy_poll_budget > 0)
+	{
+		completion_port->busy_poll_budget = busy_poll_budget;
+		adapt_busy_poll_budget(completion_port, max_busy_poll_budget, is_spin_successful);
+		if (is_spin_successful)
+		{
+			completion_port->stats.busy_poll_hits_cnt++;
+		}
+		else
+		{
+			completion_port->stats.busy_poll_misses_cnt++;
+		}
+	}
+	completion_port->stats.waits_cnt++;
+	completion_port->stats.events_cnt += events_cnt;
+	for (i = 0; i < events_cnt; i++)
+	{
+		void *tmp;
+
+		tmp = events[i].data.ptr;
+		if (tmp == (void *) completion_port)
+		{
+			/* other threads can drain the queue concurrently,
+			 * so the queue can be already empty at this point
+			 */
+			drain_queue(completion_port);
+		}
+		else
+		{
+			dispatch_fd_event(completion_port, (struct ff_linux_completion_port_fd *) tmp, events[i].events);
+		}
+	}
+}
+
+/**
+ * @private
+ * Spins for up to the given budget in nanoseconds, waiting for io_uring completions
+ * or for entries in the queue of put entries.
+ * Returns non-zero if spinning found something.
+ */
+static int busy_poll_uring(struct ff_arch_completion_port *completion_port, int64_t budget)
+{
+	int64_t deadline;
+
+	deadline = ff_arch_misc_get_precise_time() + budget;
+	for (;;)
+	{
+		if (ff_linux_uring_has_cqes(completion_port->uring) ||
+			__atomic_load_n(&completion_port->queue_head, __ATOMIC_SEQ_CST) != NULL ||
+			__atomic_load_n(&completion_port->queued_wakeups_cnt, __ATOMIC_SEQ_CST) > 0)
+		{
+			return 1;
+		}
+		if (ff_arch_misc_get_precise_time() >= deadline)
+		{
+			return 0;
+		}
+		ff_arch_atomic_pause();
+	}
+}
+
+/**
+ * @private
+ * Dispatches the io_uring completion.
+ * pending_events_mutex must be locked.
+ */
+static void dispatch_uring_completion(struct ff_arch_completion_port *completion_port, const struct io_uring_cqe *cqe)
+{
+	uint64_t tag;
+
+	if (cqe->user_data == URING_EVENT_FD_POLL)
+	{
+		drain_queue(completion_port);
+		arm_event_fd_poll(completion_port);
+		return;
+	}
+	if (cqe->user_data == URING_CANCEL)
+	{
+		return;
+	}
+
+	tag = cqe->user_data & URING_TAG_MASK;
+	if (tag == URING_TAG_READ_POLL || tag == URING_TAG_WRITE_POLL)
+	{
+		struct ff_linux_completion_port_fd *port_fd;
+		const void **data;
+
+		port_fd = (struct ff_linux_completion_port_fd *) (uintptr_t) (cqe->user_data & ~URING_TAG_MASK);
+		data = (tag == URING_TAG_READ_POLL) ? &port_fd->reader_data : &port_fd->writer_data;
+		port_fd->pending_polls_cnt--;
+		ff_assert(port_fd->pending_polls_cnt >= 0);
+		/* the waiting operation retries after the completion, so canceled polls complete it too */
+		if (*data != NULL)
+		{
+			append_ready_entry(completion_port, (struct ff_arch_completion_port_entry *) *data);
+			*data = NULL;
+		}
+	}
+	else
+	{
+		struct ff_linux_completion_port_io *io;
+
+		io = (struct ff_linux_completion_port_io *) (uintptr_t) cqe->user_data;
+		io->result = cqe->res;
+		append_ready_entry(completion_port, (struct ff_arch_completion_port_entry *) io->data);
+	}
+}
+
+/**
+ * @private
+ * Moves available io_uring completions into the ready list without waiting.
+ * Returns the number of reaped completions.
+ * pending_events_mutex must be locked.
+ */
+static int reap_uring_completions(struct ff_arch_completion_port *completion_port)
+{
+	struct io_uring_cqe cqe;
+	int cqes_cnt = 0;
+
+	while (ff_linux_uring_pop_cqe(completion_port->uring, &cqe))
+	{
+		completion_port->stats.events_cnt++;
+		dispatch_uring_completion(completion_port, &cqe);
+		cqes_cnt++;
+	}
+	return cqes_cnt;
+}
+
+/**
+ * @private
+ * Returns the zeroed io_uring submission queue entry.
+ * If the submission queue is full and the kernel doesn't accept submissions until completions are reaped,
+ * then reaps completions here instead of waiting for the harvesting thread, since the harvesting thread
+ * cannot lock pending_events_mutex held by the caller.
+ * pending_events_mutex must be locked.
+ */
+static struct io_uring_sqe *get_uring_sqe(struct ff_arch_completion_port *completion_port)
+{
+	struct io_uring_sqe *sqe;
+
+	for (;;)
+	{
+		sqe = ff_linux_uring_get_sqe(completion_port->uring);
+		if (sqe != NULL)
+		{
+			break;
+		}
+		if (reap_uring_completions(completion_port) > 0)
+		{
+			/* the harvesting thread can wait for completions, which have been reaped here */
+			pass_ready_data(completion_port);
+		}
+	}
+	return sqe;
+}
+
+/**
+ * @private
+ * Submits pending io_uring submissions, waits for completions and moves them into the ready list.
+ * pending_events_mutex must be locked. It is unlocked while waiting.
+ */
+static void harvest_uring_completions(struct ff_arch_completion_port *completion_port)
+{
+	int sqes_cnt;
+	int busy_poll_interval;
+	int is_spin_successful = 0;
+	int64_t max_busy_poll_budget;
+	int64_t busy_poll_budget;
+
+	busy_poll_interval = ff_arch_atomic_get(&completion_port->busy_poll_interval);
+	max_busy_poll_budget = ((int64_t) busy_poll_interval) * 1000;
+	busy_poll_budget = completion_port->busy_poll_budget;
+	harvesting_completion_port = completion_port;
+	free_retired_fds(completion_port);
+	sqes_cnt = ff_linux_uring_publish(completion_port->uring);
+	completion_port->waiting_threads_cnt++;
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+	if (max_busy_poll_budget > 0)
+	{
+		if (busy_poll_budget == 0 || busy_poll_budget > max_busy_poll_budget)
+		{
+			busy_poll_budget = max_busy_poll_budget;
+		}
+		if (sqes_cnt > 0)
+		{
+			ff_linux_uring_enter(completion_port->uring, sqes_cnt, 0);
+			sqes_cnt = 0;
+		}
+		is_spin_successful = busy_poll_uring(completion_port, busy_poll_budget);
+	}
+	if (!is_spin_successful)
+	{
+		/* submit new operations and wait for completions using a single syscall */
+		ff_linux_uring_enter(completion_port->uring, sqes_cnt, 1);
+	}
+
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	completion_port->waiting_threads_cnt--;
+	ff_assert(completion_port->waiting_threads_cnt >= 0);
+	if (max_busy_poll_budget > 0)
+	{
+		completion_port->busy_poll_budget = busy_poll_budget;
+		adapt_busy_poll_budget(completion_port, max_busy_poll_budget, is_spin_successful);
+		if (is_spin_successful)
+		{
+			completion_port->stats.busy_poll_hits_cnt++;
+		}
+		else
+		{
+			completion_port->stats.busy_poll_misses_cnt++;
+		}
+		if (is_spin_successful)
+		{
+			/* the producer may not signal the event_fd yet */
+			drain_queue(completion_port);
+		}
+	}
+	completion_port->stats.waits_cnt++;
+	reap_uring_completions(completion_port);
+}
+
+/**
+ * @private
+ * Waits for events and moves them into the ready list.
+ * pending_events_mutex must be locked. It is unlocked while waiting.
+ */
+static void harvest_events(struct ff_arch_completion_port *completion_port, struct epoll_event *events, int events_capacity)
+{
+	if (completion_port->uring != NULL)
+	{
+		harvest_uring_completions(completion_port);
+	}
+	else
+	{
+		harvest_epoll_events(completion_port, events, events_capacity);
+	}
+}
+
+/**
+ * @private
+ * Submits io_uring operations, which have been deferred by the current thread.
+ * The thread returns ready data without harvesting, so these operations would wait until the next harvest otherwise.
+ * It doesn't enter the kernel if there are no deferred operations.
+ * pending_events_mutex must be locked.
+ */
+static void flush_uring_submissions(struct ff_arch_completion_port *completion_port)
+{
+	if (completion_port->uring != NULL)
+	{
+		ff_linux_uring_submit(completion_port->uring);
+	}
+}
+
 void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port, const void **data)
 {
-	int is_empty;
+	struct epoll_event events[EPOLL_CAPACITY];
 
 	ff_arch_mutex_lock(completion_port->pending_events_mutex);
-	is_empty = ff_stack_is_empty(completion_port->pending_events);
-	if (is_empty)
+	for (;;)
 	{
-		int events_cnt;
-		int i;
-		struct epoll_event events[EPOLL_CAPACITY];
+		int is_ready;
 
-		ff_arch_mutex_unlock(completion_port->pending_events_mutex);
-		for (;;)
+		is_ready = pop_ready_data(completion_port, data);
+		if (is_ready)
 		{
-	    	events_cnt = epoll_wait(completion_port->epoll_fd, events, EPOLL_CAPACITY, -1);
-	    	if (events_cnt != -1)
-	    	{
-	    		break;
-	    	}
-    		ff_linux_fatal_error_check(errno == EINTR, L"epoll_wait() failed");
-    	}
-    	ff_linux_fatal_error_check(events_cnt > 0, L"epoll_wait() unexpectedly returned 0");
-
-    	ff_arch_mutex_lock(completion_port->pending_events_mutex);
-    	for (i = 0; i < events_cnt; i++)
-    	{
-    		const void *tmp;
-
-    		tmp = events[i].data.ptr;
-    		if (tmp == completion_port)
-    		{
-    			/* read data from pipe */
-				ssize_t bytes_read;
-
-				for (;;)
-				{
-					bytes_read = read(completion_port->rd_pipe, &tmp, sizeof(tmp));
-					if (bytes_read != -1)
-					{
-						break;
-					}
-					ff_linux_fatal_error_check(errno == EINTR, L"read(rd_pipe) failed");
-				}
-				ff_linux_fatal_error_check(bytes_read == sizeof(tmp), L"error when reading from the pipe");
-    		}
-    		ff_stack_push(completion_port->pending_events, tmp);
-    	}
-    }
-
-	ff_stack_top(completion_port->pending_events, data);
-	ff_stack_pop(completion_port->pending_events);
+			flush_uring_submissions(completion_port);
+			pass_ready_data(completion_port);
+			break;
+		}
+		harvest_events(completion_port, events, EPOLL_CAPACITY);
+	}
 	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
 }
 
-void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data)
+int ff_arch_completion_port_get_many(struct ff_arch_completion_port *completion_port, const void **data, int max_cnt)
 {
-	ssize_t bytes_written;
+	int cnt = 0;
+
+	ff_assert(max_cnt > 0);
 
+	if (completion_port->uring == NULL && completion_port->batch_events_capacity < max_cnt)
+	{
+		if (completion_port->batch_events != NULL)
+		{
+			ff_free(completion_port->batch_events);
+		}
+		completion_port->batch_events = (struct epoll_event *) ff_calloc(max_cnt, sizeof(completion_port->batch_events[0]));
+		completion_port->batch_events_capacity = max_cnt;
+	}
+
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
 	for (;;)
 	{
-		bytes_written = write(completion_port->wr_pipe, &data, sizeof(data));
-		if (bytes_written != -1)
+		for (;;)
+		{
+			int is_ready;
+
+			if (cnt == max_cnt)
+			{
+				break;
+			}
+			is_ready = pop_ready_data(completion_port, &data[cnt]);
+			if (!is_ready)
+			{
+				break;
+			}
+			cnt++;
+		}
+		if (cnt > 0)
 		{
+			flush_uring_submissions(completion_port);
+			pass_ready_data(completion_port);
 			break;
 		}
-		ff_linux_fatal_error_check(errno == EINTR, L"write(wr_pipe) failed");
+		harvest_events(completion_port, completion_port->batch_events, max_cnt);
 	}
-	ff_linux_fatal_error_check(bytes_written == sizeof(data), L"error when writing to wr_pipe");
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+
+	return cnt;
 }
 
-void ff_linux_completion_port_register_operation(struct ff_arch_completion_port *completion_port, int fd, enum ff_linux_completion_port_operation_type operation_type, const void *data)
+void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data)
 {
-	int rv;
+	if (data != NULL)
+	{
+		struct ff_arch_completion_port_entry *entry;
+		struct ff_arch_completion_port_entry *head;
+
+		entry = (struct ff_arch_completion_port_entry *) data;
+		head = __atomic_load_n(&completion_port->queue_head, __ATOMIC_SEQ_CST);
+		do
+		{
+			entry->next = head;
+		}
+		while (!__atomic_compare_exchange_n(&completion_port->queue_head, &head, entry, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+	}
+	else
+	{
+		__atomic_add_fetch(&completion_port->queued_wakeups_cnt, 1, __ATOMIC_SEQ_CST);
+	}
+	signal_queue(completion_port);
+}
+
+void ff_arch_completion_port_get_stats(struct ff_arch_completion_port *completion_port, struct ff_arch_completion_port_stats *stats)
+{
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	memcpy(stats, &completion_port->stats, sizeof(*stats));
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+}
+
+void ff_arch_completion_port_set_busy_poll(struct ff_arch_completion_port *completion_port, int interval, int is_socket_busy_poll)
+{
+	ff_assert(interval >= 0);
+
+	ff_arch_atomic_set(&completion_port->busy_poll_interval, interval);
+	ff_arch_atomic_set(&completion_port->is_socket_busy_poll, is_socket_busy_poll ? 1 : 0);
+}
+
+int ff_linux_completion_port_get_socket_busy_poll_interval(struct ff_arch_completion_port *completion_port)
+{
+	int is_socket_busy_poll;
+	int interval = 0;
+
+	is_socket_busy_poll = ff_arch_atomic_get(&completion_port->is_socket_busy_poll);
+	if (is_socket_busy_poll)
+	{
+		interval = ff_arch_atomic_get(&completion_port->busy_poll_interval);
+	}
+	return interval;
+}
+
+/**
+ * @private
+ * Queues the one-shot io_uring poll, which waits for the fd readiness for the given operation type.
+ * pending_events_mutex must be locked.
+ */
+static void add_uring_poll(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd *port_fd, enum ff_linux_completion_port_operation_type operation_type)
+{
+	struct io_uring_sqe *sqe;
+	uint64_t tag;
+
+	if (operation_type == FF_COMPLETION_PORT_OPERATION_READ)
+	{
+		sqe = get_uring_sqe(completion_port);
+		sqe->poll32_events = POLLIN | POLLRDHUP;
+		tag = URING_TAG_READ_POLL;
+	}
+	else
+	{
+		sqe = get_uring_sqe(completion_port);
+		sqe->poll32_events = POLLOUT;
+		tag = URING_TAG_WRITE_POLL;
+	}
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = port_fd->fd;
+	sqe->user_data = ((uint64_t) (uintptr_t) port_fd) | tag;
+	port_fd->pending_polls_cnt++;
+}
+
+/**
+ * @private
+ * Cancels pending io_uring polls of the port_fd. Canceled polls complete with -ECANCELED.
+ * pending_events_mutex must be locked.
+ */
+static void cancel_uring_polls(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_fd *port_fd)
+{
+	uint64_t tags[2] = {URING_TAG_READ_POLL, URING_TAG_WRITE_POLL};
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		struct io_uring_sqe *sqe;
+
+		sqe = get_uring_sqe(completion_port);
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = ((uint64_t) (uintptr_t) port_fd) | tags[i];
+		sqe->user_data = URING_CANCEL;
+	}
+	ff_linux_uring_submit(completion_port->uring);
+}
+
+struct ff_linux_completion_port_fd *ff_linux_completion_port_register_fd(struct ff_arch_completion_port *completion_port, int fd)
+{
+	struct ff_linux_completion_port_fd *port_fd;
 	struct epoll_event event;
-	__uint32_t epoll_operation;
+	int rv;
 
-	epoll_operation = (operation_type == FF_COMPLETION_PORT_OPERATION_READ) ? EPOLLIN : EPOLLOUT;
-	event.events = EPOLLET | EPOLLONESHOT | epoll_operation;
-	event.data.ptr = (void *) data;
+	port_fd = (struct ff_linux_completion_port_fd *) ff_malloc(sizeof(*port_fd));
+	port_fd->completion_port = completion_port;
+	port_fd->fd = fd;
+	port_fd->reader_data = NULL;
+	port_fd->writer_data = NULL;
+	port_fd->is_read_ready = 0;
+	port_fd->is_write_ready = 0;
+	port_fd->pending_polls_cnt = 0;
+	port_fd->next_retired = NULL;
 
-	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_MOD, fd, &event);
-	if (rv == -1)
+	if (completion_port->uring != NULL)
 	{
-		ff_linux_fatal_error_check(errno == ENOENT, L"epoll_ctl(EPOLL_CTL_MOD) failed");
-		/* the file descriptor isn't in the epoll_fd. Try to add it */
-		rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, fd, &event);
-		ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(EPOLL_CTL_ADD) failed");
+		/* io_uring polls the fd on demand in ff_linux_completion_port_register_operation() */
+		return port_fd;
 	}
+
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.ptr = port_fd;
+	rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(EPOLL_CTL_ADD) failed");
+
+	return port_fd;
+}
+
+void ff_linux_completion_port_deregister_fd(struct ff_linux_completion_port_fd *port_fd)
+{
+	struct ff_arch_completion_port *completion_port;
+	const void *reader_data;
+	const void *writer_data;
+	int rv;
+
+	completion_port = port_fd->completion_port;
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	if (completion_port->uring != NULL)
+	{
+		if (port_fd->pending_polls_cnt > 0)
+		{
+			/* the port_fd is freed after completions of canceled polls are harvested */
+			cancel_uring_polls(completion_port, port_fd);
+		}
+	}
+	else
+	{
+		rv = epoll_ctl(completion_port->epoll_fd, EPOLL_CTL_DEL, port_fd->fd, NULL);
+		ff_linux_fatal_error_check(rv != -1, L"epoll_ctl(EPOLL_CTL_DEL) failed");
+	}
+	reader_data = port_fd->reader_data;
+	writer_data = port_fd->writer_data;
+	port_fd->reader_data = NULL;
+	port_fd->writer_data = NULL;
+	port_fd->next_retired = completion_port->retired_fds;
+	completion_port->retired_fds = port_fd;
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+
+	/* complete operations, which are still waiting for the fd readiness */
+	if (reader_data != NULL)
+	{
+		ff_arch_completion_port_put(completion_port, reader_data);
+	}
+	if (writer_data != NULL)
+	{
+		ff_arch_completion_port_put(completion_port, writer_data);
+	}
+}
+
+int ff_linux_completion_port_register_operation(struct ff_linux_completion_port_fd *port_fd, enum ff_linux_completion_port_operation_type operation_type, const void *data)
+{
+	struct ff_arch_completion_port *completion_port;
+	const void **waiting_data;
+	int *is_ready;
+	int is_registered;
+
+	ff_assert(data != NULL);
+
+	if (operation_type == FF_COMPLETION_PORT_OPERATION_READ)
+	{
+		waiting_data = &port_fd->reader_data;
+		is_ready = &port_fd->is_read_ready;
+	}
+	else
+	{
+		waiting_data = &port_fd->writer_data;
+		is_ready = &port_fd->is_write_ready;
+	}
+
+	completion_port = port_fd->completion_port;
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	ff_assert(*waiting_data == NULL);
+	if (completion_port->uring != NULL)
+	{
+		*waiting_data = data;
+		add_uring_poll(completion_port, port_fd, operation_type);
+		if (harvesting_completion_port != completion_port)
+		{
+			/* the caller runs on a thread of another scheduler, which doesn't harvest
+			 * completions of this port, so the poll is submitted immediately.
+			 * Otherwise the next harvest submits it together with other operations without an extra syscall
+			 */
+			ff_linux_uring_submit(completion_port->uring);
+		}
+		is_registered = 1;
+	}
+	else if (*is_ready)
+	{
+		/* the fd became ready after the caller's operation failed with EAGAIN
+		 * or before it started, so the operation should be retried immediately
+		 */
+		*is_ready = 0;
+		is_registered = 0;
+	}
+	else
+	{
+		*waiting_data = data;
+		is_registered = 1;
+	}
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+
+	return is_registered;
+}
+
+int ff_linux_completion_port_submit_io(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_io *io)
+{
+	struct io_uring_sqe *sqe;
+
+	ff_assert(io->data != NULL);
+
+	if (completion_port->uring == NULL)
+	{
+		return 0;
+	}
+
+	ff_arch_mutex_lock(completion_port->pending_events_mutex);
+	sqe = get_uring_sqe(completion_port);
+	sqe->fd = io->fd;
+	sqe->addr = (uint64_t) (uintptr_t) io->buf;
+	sqe->len = (uint32_t) io->len;
+	sqe->user_data = (uint64_t) (uintptr_t) io;
+	switch (io->type)
+	{
+	case FF_COMPLETION_PORT_IO_RECV:
+		sqe->opcode = IORING_OP_RECV;
+		break;
+	case FF_COMPLETION_PORT_IO_SEND:
+		sqe->opcode = IORING_OP_SEND;
+		break;
+	case FF_COMPLETION_PORT_IO_ACCEPT:
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->addr = (uint64_t) (uintptr_t) io->addr;
+		sqe->addr2 = (uint64_t) (uintptr_t) &io->addrlen;
+		sqe->len = 0;
+		sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+		break;
+	case FF_COMPLETION_PORT_IO_CONNECT:
+		sqe->opcode = IORING_OP_CONNECT;
+		sqe->addr = (uint64_t) (uintptr_t) io->addr;
+		sqe->off = (uint64_t) io->addrlen;
+		sqe->len = 0;
+		break;
+	case FF_COMPLETION_PORT_IO_READ:
+		sqe->opcode = IORING_OP_READ;
+		sqe->off = (uint64_t) io->offset;
+		break;
+	case FF_COMPLETION_PORT_IO_WRITE:
+		sqe->opcode = IORING_OP_WRITE;
+		sqe->off = (uint64_t) io->offset;
+		break;
+	case FF_COMPLETION_PORT_IO_READV:
+		sqe->opcode = IORING_OP_READV;
+		sqe->off = (uint64_t) io->offset;
+		break;
+	case FF_COMPLETION_PORT_IO_WRITEV:
+		sqe->opcode = IORING_OP_WRITEV;
+		sqe->off = (uint64_t) io->offset;
+		break;
+	default:
+		ff_assert(0);
+	}
+	/* the submission is deferred until the next harvesting of completions,
+	 * which submits all queued operations and waits for completions using a single syscall
+	 */
+	ff_arch_mutex_unlock(completion_port->pending_events_mutex);
+
+	return 1;
 }
@@ -0,0 +1,216 @@
+#include "private/ff_common.h"
+
+#include "private/arch/ff_arch_endpoint.h"
+#include "private/ff_core.h"
+#include "ff_linux_endpoint.h"
+#include "ff_linux_net.h"
+
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+struct threadpool_transfer_data
+{
+	int in_fd;
+	int out_fd;
+	size_t len;
+	int is_sendfile;
+	ssize_t result;
+	int err;
+};
+
+static void threadpool_transfer_func(void *ctx)
+{
+	struct threadpool_transfer_data *data;
+
+	data = (struct threadpool_transfer_data *) ctx;
+	for (;;)
+	{
+		if (data->is_sendfile)
+		{
+			data->result = sendfile(data->out_fd, data->in_fd, NULL, data->len);
+		}
+		else
+		{
+			data->result = splice(data->in_fd, NULL, data->out_fd, NULL, data->len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		}
+		if (data->result != -1 || errno != EINTR)
+		{
+			break;
+		}
+	}
+	data->err = (data->result == -1) ? errno : 0;
+}
+
+/**
+ * @private
+ * Moves up to len bytes from the in_fd to the out_fd by sendfile() or splice().
+ * Operations touching regular files can block on the disk I/O, so they are executed by the threadpool.
+ * Returns the result like sendfile() and splice() do.
+ */
+static ssize_t move_data(int in_fd, int out_fd, size_t len, int is_sendfile, int is_blocking)
+{
+	struct threadpool_transfer_data data;
+
+	data.in_fd = in_fd;
+	data.out_fd = out_fd;
+	data.len = len;
+	data.is_sendfile = is_sendfile;
+	data.result = -1;
+	data.err = 0;
+	if (is_blocking)
+	{
+		ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_transfer_func, &data);
+	}
+	else
+	{
+		threadpool_transfer_func(&data);
+	}
+	errno = data.err;
+	return data.result;
+}
+
+/**
+ * @private
+ * Sends len bytes from the regular file to the dst using sendfile().
+ */
+static enum ff_result transfer_from_file(struct ff_arch_endpoint *src, struct ff_arch_endpoint *dst, int len)
+{
+	while (len > 0)
+	{
+		ssize_t bytes_sent;
+
+		bytes_sent = move_data(src->fd, dst->fd, (size_t) len, 1, 1);
+		if (bytes_sent == -1)
+		{
+			if (errno == EAGAIN && dst->type == FF_LINUX_ENDPOINT_SOCKET)
+			{
+				ff_linux_net_wait_for_io(dst->port_fd, FF_LINUX_NET_IO_WRITE);
+				continue;
+			}
+			ff_log_debug(L"error while sending %d bytes from the fd=%d to the fd=%d. errno=%d", len, src->fd, dst->fd, errno);
+			return FF_FAILURE;
+		}
+		if (bytes_sent == 0)
+		{
+			ff_log_debug(L"end of the fd=%d reached, but %d bytes must be sent to the fd=%d", src->fd, len, dst->fd);
+			return FF_FAILURE;
+		}
+		ff_assert(bytes_sent <= len);
+		len -= (int) bytes_sent;
+	}
+	return FF_SUCCESS;
+}
+
+/**
+ * @private
+ * Moves len bytes from the socket to the dst through the pipe using splice(),
+ * so the data never leaves the kernel.
+ */
+static enum ff_result transfer_from_socket(struct ff_arch_endpoint *src, struct ff_arch_endpoint *dst, int len)
+{
+	int pipe_fds[2];
+	int bytes_in_pipe = 0;
+	int is_dst_blocking;
+	int rv;
+	enum ff_result result = FF_FAILURE;
+
+	rv = pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC);
+	if (rv == -1)
+	{
+		ff_log_debug(L"cannot create the pipe for splicing data from the fd=%d to the fd=%d. errno=%d", src->fd, dst->fd, errno);
+		return FF_FAILURE;
+	}
+
+	is_dst_blocking = (dst->type == FF_LINUX_ENDPOINT_REGULAR_FILE);
+	while (len > 0 || bytes_in_pipe > 0)
+	{
+		ssize_t bytes_moved;
+
+		if (len > 0)
+		{
+			/* the pipe is non-blocking, so the splice fails with EAGAIN if the pipe is full */
+			bytes_moved = move_data(src->fd, pipe_fds[1], (size_t) len, 0, 0);
+			if (bytes_moved == 0)
+			{
+				ff_log_debug(L"end of the fd=%d reached, but %d bytes must be spliced to the fd=%d", src->fd, len, dst->fd);
+				goto end;
+			}
+			if (bytes_moved == -1)
+			{
+				if (errno != EAGAIN)
+				{
+					ff_log_debug(L"error while splicing %d bytes from the fd=%d. errno=%d", len, src->fd, errno);
+					goto end;
+				}
+				if (bytes_in_pipe == 0)
+				{
+					ff_linux_net_wait_for_io(src->port_fd, FF_LINUX_NET_IO_READ);
+					continue;
+				}
+			}
+			else
+			{
+				ff_assert(bytes_moved <= len);
+				len -= (int) bytes_moved;
+				bytes_in_pipe += (int) bytes_moved;
+			}
+		}
+
+		ff_assert(bytes_in_pipe > 0);
+		bytes_moved = move_data(pipe_fds[0], dst->fd, (size_t) bytes_in_pipe, 0, is_dst_blocking);
+		if (bytes_moved == -1)
+		{
+			if (errno == EAGAIN && dst->type == FF_LINUX_ENDPOINT_SOCKET)
+			{
+				ff_linux_net_wait_for_io(dst->port_fd, FF_LINUX_NET_IO_WRITE);
+				continue;
+			}
+			ff_log_debug(L"error while splicing %d bytes to the fd=%d. errno=%d", bytes_in_pipe, dst->fd, errno);
+			goto end;
+		}
+		ff_assert(bytes_moved > 0 && bytes_moved <= bytes_in_pipe);
+		bytes_in_pipe -= (int) bytes_moved;
+	}
+	result = FF_SUCCESS;
+
+end:
+	rv = close(pipe_fds[0]);
+	ff_assert(rv != -1);
+	rv = close(pipe_fds[1]);
+	ff_assert(rv != -1);
+	return result;
+}
+
+int ff_arch_endpoint_can_transfer(const struct ff_arch_endpoint *src, const struct ff_arch_endpoint *dst)
+{
+	int can_transfer;
+
+	can_transfer = (src->type != FF_LINUX_ENDPOINT_OTHER && dst->type != FF_LINUX_ENDPOINT_OTHER);
+	return can_transfer;
+}
+
+enum ff_result ff_arch_endpoint_transfer(struct ff_arch_endpoint *src, struct ff_arch_endpoint *dst, int len)
+{
+	enum ff_result result;
+
+	ff_assert(ff_arch_endpoint_can_transfer(src, dst));
+	ff_assert(len >= 0);
+
+	if (src->type == FF_LINUX_ENDPOINT_REGULAR_FILE)
+	{
+		result = transfer_from_file(src, dst, len);
+	}
+	else
+	{
+		ff_assert(src->type == FF_LINUX_ENDPOINT_SOCKET);
+		result = transfer_from_socket(src, dst, len);
+	}
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot transfer %d bytes from the endpoint=%p to the endpoint=%p. See previous messages for more info", len, src, dst);
+	}
+	return result;
+}
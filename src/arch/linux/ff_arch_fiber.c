@@ -1,6 +1,62 @@
 #include "private/ff_common.h"
 
 #include "private/arch/ff_arch_fiber.h"
+#include "ff_linux_error_check.h"
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+ * Fibers switch contexts using hand-written assembly routines, which save
+ * only callee-saved registers. This avoids rt_sigprocmask() syscall
+ * and saving of the full FPU state made by the swapcontext().
+ * Define FF_ARCH_FIBER_UCONTEXT in order to use makecontext()/swapcontext()
+ * on all architectures. They are also used on architectures
+ * without assembly routines.
+ */
+#if !defined(FF_ARCH_FIBER_UCONTEXT) && !defined(__x86_64__) && !defined(__aarch64__)
+#	define FF_ARCH_FIBER_UCONTEXT
+#endif
+
+/**
+ * the smallest stack size class is (1 << MIN_STACK_SIZE_CLASS_BITS) bytes.
+ * Each next class is two times larger than the previous one.
+ */
+#define MIN_STACK_SIZE_CLASS_BITS 14
+
+#define STACK_SIZE_CLASSES_CNT 10
+
+/**
+ * the maximum number of free stacks kept in each size class.
+ * Stacks above this limit are unmapped.
+ */
+#define MAX_FREE_STACKS_CNT 1024
+
+struct free_stack
+{
+	struct free_stack *next;
+};
+
+/**
+ * @private
+ * Stacks are allocated with mmap(), so physical memory is committed lazily,
+ * and are protected from overflow by a guard page below the stack.
+ * Stacks of deleted fibers are kept in per-size-class free lists,
+ * so they can be reused without syscalls.
+ */
+struct stack_pool
+{
+	pthread_mutex_t mutex;
+	struct free_stack *free_stacks[STACK_SIZE_CLASSES_CNT];
+	int free_stacks_cnt[STACK_SIZE_CLASSES_CNT];
+	int threads_cnt;
+	int page_size;
+};
+
+static struct stack_pool stack_pool = { PTHREAD_MUTEX_INITIALIZER, { NULL }, { 0 }, 0, 0 };
+
+#ifdef FF_ARCH_FIBER_UCONTEXT
 
 #include <ucontext.h>
 
@@ -8,28 +64,361 @@ struct ff_arch_fiber
 {
 	ucontext_t context;
 	void *stack;
+	int stack_size;
 };
 
-static struct ff_arch_fiber *current_fiber = NULL;
-static struct ff_arch_fiber main_fiber;
+static void initialize_context(struct ff_arch_fiber *fiber, ff_arch_fiber_func arch_fiber_func, void *ctx, int stack_size)
+{
+	getcontext(&fiber->context);
+	fiber->context.uc_stack.ss_sp = fiber->stack;
+	fiber->context.uc_stack.ss_size = stack_size;
+	fiber->context.uc_link = NULL;
+	makecontext(&fiber->context, (void (*)()) arch_fiber_func, 1, ctx);
+}
+
+static void switch_context(struct ff_arch_fiber *current_fiber, struct ff_arch_fiber *fiber)
+{
+	swapcontext(&current_fiber->context, &fiber->context);
+}
+
+#else
+
+struct ff_arch_fiber
+{
+	/* the stack pointer of the suspended fiber. Callee-saved registers are stored on the stack */
+	void *sp;
+	void *stack;
+	int stack_size;
+};
+
+/**
+ * @private
+ * Saves callee-saved registers on the current stack, stores the stack pointer into the current_sp,
+ * then restores callee-saved registers from the new_sp stack and returns to the new context.
+ */
+void ff_linux_fiber_switch_context(void **current_sp, void *new_sp);
+
+/**
+ * @private
+ * The entry point of new fibers. The initial frame built by initialize_context()
+ * returns into this function, which calls arch_fiber_func(ctx).
+ */
+void ff_linux_fiber_entry();
+
+#if defined(__x86_64__)
+
+/*
+ * frame layout (from lower addresses): MXCSR and x87 control word, r15, r14, r13, r12, rbx, rbp, return address.
+ * New fibers keep arch_fiber_func in r12 and ctx in r13.
+ */
+__asm__ (
+	".text\n"
+	".globl ff_linux_fiber_switch_context\n"
+	".hidden ff_linux_fiber_switch_context\n"
+	".type ff_linux_fiber_switch_context, @function\n"
+	"ff_linux_fiber_switch_context:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size ff_linux_fiber_switch_context, .-ff_linux_fiber_switch_context\n"
+	".globl ff_linux_fiber_entry\n"
+	".hidden ff_linux_fiber_entry\n"
+	".type ff_linux_fiber_entry, @function\n"
+	"ff_linux_fiber_entry:\n"
+	"	movq %r13, %rdi\n"
+	"	callq *%r12\n"
+	"	ud2\n"
+	".size ff_linux_fiber_entry, .-ff_linux_fiber_entry\n"
+);
+
+enum
+{
+	FRAME_MXCSR_FPUCW = 0,
+	FRAME_R15,
+	FRAME_R14,
+	FRAME_R13,
+	FRAME_R12,
+	FRAME_RBX,
+	FRAME_RBP,
+	FRAME_RETURN_ADDRESS,
+	FRAME_SIZE
+};
+
+#define FRAME_FUNC FRAME_R12
+#define FRAME_CTX FRAME_R13
+
+/* default values of MXCSR (0x1f80) and x87 control word (0x037f) */
+#define FRAME_INITIAL_MXCSR_FPUCW ((((uint64_t) 0x037f) << 32) | 0x1f80)
+
+#elif defined(__aarch64__)
+
+/*
+ * frame layout (from lower addresses): x19-x28, x29 (fp), x30 (lr), d8-d15.
+ * New fibers keep arch_fiber_func in x19 and ctx in x20.
+ */
+__asm__ (
+	".text\n"
+	".globl ff_linux_fiber_switch_context\n"
+	".hidden ff_linux_fiber_switch_context\n"
+	".type ff_linux_fiber_switch_context, %function\n"
+	"ff_linux_fiber_switch_context:\n"
+	"	sub sp, sp, #160\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x2, sp\n"
+	"	str x2, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #160\n"
+	"	ret\n"
+	".size ff_linux_fiber_switch_context, .-ff_linux_fiber_switch_context\n"
+	".globl ff_linux_fiber_entry\n"
+	".hidden ff_linux_fiber_entry\n"
+	".type ff_linux_fiber_entry, %function\n"
+	"ff_linux_fiber_entry:\n"
+	"	mov x0, x20\n"
+	"	blr x19\n"
+	"	brk #0\n"
+	".size ff_linux_fiber_entry, .-ff_linux_fiber_entry\n"
+);
+
+enum
+{
+	FRAME_X19 = 0,
+	FRAME_X20,
+	FRAME_X29 = 10,
+	FRAME_X30,
+	FRAME_SIZE = 20
+};
+
+#define FRAME_FUNC FRAME_X19
+#define FRAME_CTX FRAME_X20
+#define FRAME_RETURN_ADDRESS FRAME_X30
+
+#endif
+
+static void initialize_context(struct ff_arch_fiber *fiber, ff_arch_fiber_func arch_fiber_func, void *ctx, int stack_size)
+{
+	uintptr_t stack_top;
+	uint64_t *frame;
+
+	/* the stack pointer must be aligned to 16 bytes after the initial frame is popped */
+	stack_top = ((uintptr_t) fiber->stack + stack_size) & ~((uintptr_t) 15);
+	frame = ((uint64_t *) stack_top) - FRAME_SIZE;
+	memset(frame, 0, FRAME_SIZE * sizeof(frame[0]));
+	frame[FRAME_FUNC] = (uint64_t) (uintptr_t) arch_fiber_func;
+	frame[FRAME_CTX] = (uint64_t) (uintptr_t) ctx;
+	frame[FRAME_RETURN_ADDRESS] = (uint64_t) (uintptr_t) ff_linux_fiber_entry;
+#if defined(__x86_64__)
+	frame[FRAME_MXCSR_FPUCW] = FRAME_INITIAL_MXCSR_FPUCW;
+#endif
+	fiber->sp = frame;
+}
+
+static void switch_context(struct ff_arch_fiber *current_fiber, struct ff_arch_fiber *fiber)
+{
+	ff_linux_fiber_switch_context(&current_fiber->sp, fiber->sp);
+}
+
+#endif
+
+/**
+ * @private
+ * Returns the index of the smallest size class, which can hold the stack of the given size.
+ * Returns -1 if the stack is too large for size classes.
+ */
+static int get_stack_size_class(int stack_size)
+{
+	int size_class;
+
+	for (size_class = 0; size_class < STACK_SIZE_CLASSES_CNT; size_class++)
+	{
+		if (stack_size <= (1 << (MIN_STACK_SIZE_CLASS_BITS + size_class)))
+		{
+			return size_class;
+		}
+	}
+	return -1;
+}
+
+static void unmap_stack(void *stack, int stack_size)
+{
+	int rv;
+
+	rv = munmap((char *) stack - stack_pool.page_size, stack_size + stack_pool.page_size);
+	ff_assert(rv != -1);
+}
+
+/**
+ * @private
+ * Allocates the stack, which is at least stack_size bytes long.
+ * The stack_size is updated to the real size of the stack.
+ */
+static void *allocate_stack(int *stack_size)
+{
+	struct free_stack *free_stack = NULL;
+	void *stack;
+	int size_class;
+	int rv;
+
+	size_class = get_stack_size_class(*stack_size);
+	if (size_class != -1)
+	{
+		*stack_size = 1 << (MIN_STACK_SIZE_CLASS_BITS + size_class);
+		pthread_mutex_lock(&stack_pool.mutex);
+		free_stack = stack_pool.free_stacks[size_class];
+		if (free_stack != NULL)
+		{
+			stack_pool.free_stacks[size_class] = free_stack->next;
+			stack_pool.free_stacks_cnt[size_class]--;
+		}
+		pthread_mutex_unlock(&stack_pool.mutex);
+	}
+	else
+	{
+		*stack_size = (*stack_size + stack_pool.page_size - 1) & ~(stack_pool.page_size - 1);
+	}
+
+	if (free_stack != NULL)
+	{
+		/* the free_stack header is located at the top of the stack */
+		stack = (char *) (free_stack + 1) - *stack_size;
+	}
+	else
+	{
+		char *mem;
+
+		mem = (char *) mmap(NULL, *stack_size + stack_pool.page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		ff_linux_fatal_error_check(mem != MAP_FAILED, L"cannot allocate fiber stack with size=%d", *stack_size);
+		rv = mprotect(mem, stack_pool.page_size, PROT_NONE);
+		ff_linux_fatal_error_check(rv != -1, L"cannot create guard page for the fiber stack");
+		stack = mem + stack_pool.page_size;
+	}
+
+	return stack;
+}
+
+static void release_stack(void *stack, int stack_size)
+{
+	int size_class;
+
+	size_class = get_stack_size_class(stack_size);
+	if (size_class != -1)
+	{
+		pthread_mutex_lock(&stack_pool.mutex);
+		if (stack_pool.free_stacks_cnt[size_class] < MAX_FREE_STACKS_CNT)
+		{
+			struct free_stack *free_stack;
+
+			free_stack = ((struct free_stack *) ((char *) stack + stack_size)) - 1;
+			free_stack->next = stack_pool.free_stacks[size_class];
+			stack_pool.free_stacks[size_class] = free_stack;
+			stack_pool.free_stacks_cnt[size_class]++;
+			stack = NULL;
+		}
+		pthread_mutex_unlock(&stack_pool.mutex);
+	}
+
+	if (stack != NULL)
+	{
+		unmap_stack(stack, stack_size);
+	}
+}
+
+/**
+ * @private
+ * Unmaps all free stacks. stack_pool.mutex must be locked.
+ */
+static void unmap_free_stacks()
+{
+	int size_class;
+
+	for (size_class = 0; size_class < STACK_SIZE_CLASSES_CNT; size_class++)
+	{
+		int stack_size;
+
+		stack_size = 1 << (MIN_STACK_SIZE_CLASS_BITS + size_class);
+		while (stack_pool.free_stacks[size_class] != NULL)
+		{
+			struct free_stack *free_stack;
+
+			free_stack = stack_pool.free_stacks[size_class];
+			stack_pool.free_stacks[size_class] = free_stack->next;
+			unmap_stack((char *) (free_stack + 1) - stack_size, stack_size);
+		}
+		stack_pool.free_stacks_cnt[size_class] = 0;
+	}
+}
 
 struct ff_arch_fiber *ff_arch_fiber_initialize()
 {
 	struct ff_arch_fiber *fiber;
 
-	fiber = &main_fiber;
-	current_fiber = fiber;
+	pthread_mutex_lock(&stack_pool.mutex);
+	if (stack_pool.threads_cnt == 0)
+	{
+		stack_pool.page_size = (int) sysconf(_SC_PAGESIZE);
+		ff_assert(stack_pool.page_size > 0);
+	}
+	stack_pool.threads_cnt++;
+	pthread_mutex_unlock(&stack_pool.mutex);
+
+	/* the context of the main fiber will be filled by the first switch_context() call */
+	fiber = (struct ff_arch_fiber *) ff_calloc(1, sizeof(*fiber));
+	fiber->stack = NULL;
 
 	return fiber;
 }
 
 void ff_arch_fiber_shutdown(struct ff_arch_fiber *fiber)
 {
-	ff_assert(fiber == current_fiber);
-	ff_assert(fiber == &main_fiber);
+	ff_assert(fiber->stack == NULL);
+
+	ff_free(fiber);
 
-	memset(&main_fiber, 0, sizeof(main_fiber));
-	current_fiber = NULL;
+	pthread_mutex_lock(&stack_pool.mutex);
+	ff_assert(stack_pool.threads_cnt > 0);
+	stack_pool.threads_cnt--;
+	if (stack_pool.threads_cnt == 0)
+	{
+		unmap_free_stacks();
+	}
+	pthread_mutex_unlock(&stack_pool.mutex);
 }
 
 struct ff_arch_fiber *ff_arch_fiber_create(ff_arch_fiber_func arch_fiber_func, void *ctx, int stack_size)
@@ -39,30 +428,24 @@ struct ff_arch_fiber *ff_arch_fiber_create(ff_arch_fiber_func arch_fiber_func, v
 	ff_assert(stack_size > 0);
 
 	fiber = (struct ff_arch_fiber *) ff_malloc(sizeof(*fiber));
-	fiber->stack = ff_calloc(stack_size, sizeof(char));
-	getcontext(&fiber->context);
-	fiber->context.uc_stack.ss_sp = fiber->stack;
-	fiber->context.uc_stack.ss_size = stack_size;
-	fiber->context.uc_link = NULL;
-	makecontext(&fiber->context, (void (*)()) arch_fiber_func, 1, ctx);
+	fiber->stack = allocate_stack(&stack_size);
+	fiber->stack_size = stack_size;
+	initialize_context(fiber, arch_fiber_func, ctx, stack_size);
 
 	return fiber;
 }
 
 void ff_arch_fiber_delete(struct ff_arch_fiber *fiber)
 {
-	ff_assert(fiber != current_fiber);
-	ff_assert(fiber != &main_fiber);
+	ff_assert(fiber->stack != NULL);
 
-	ff_free(fiber->stack);
+	release_stack(fiber->stack, fiber->stack_size);
 	ff_free(fiber);
 }
 
-void ff_arch_fiber_switch(struct ff_arch_fiber *fiber)
+void ff_arch_fiber_switch(struct ff_arch_fiber *current_fiber, struct ff_arch_fiber *fiber)
 {
-	ucontext_t *current_context;
+	ff_assert(current_fiber != fiber);
 
-	current_context = &current_fiber->context;
-	current_fiber = fiber;
-	swapcontext(current_context, &fiber->context);
+	switch_context(current_fiber, fiber);
 }
@@ -5,20 +5,56 @@
 #include "private/ff_fiber.h"
 #include "ff_linux_file.h"
 #include "ff_linux_completion_port.h"
+#include "ff_linux_endpoint.h"
 #include "ff_linux_error_check.h"
 #include "ff_linux_misc.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
 #include <fcntl.h>
 #include <unistd.h>
 
 #define FILE_COPY_BUF_SIZE 0x10000
 
+/**
+ * the maximum number of bytes copied by a single kernel-side copy call
+ */
+#define KERNEL_COPY_CHUNK_SIZE 0x40000000
+
 struct ff_arch_file
 {
+	/* the fd registered in the completion port or NULL if the fd hasn't been waited for yet.
+	 * Regular files never block, so only special files such as pipes are registered
+	 */
+	struct ff_linux_completion_port_fd *port_fd;
 	int fd;
 	enum ff_arch_file_access_mode access_mode;
+
+	/* non-zero for regular files. Reads and writes, which can block on regular files,
+	 * are offloaded to io_uring or to the threadpool
+	 */
+	int is_regular;
+
+	/* non-zero if the fd supports RWF_NOWAIT flag for preadv2() and pwritev2() */
+	int is_nowait_supported;
+
+	struct ff_arch_endpoint endpoint;
+};
+
+struct ff_arch_file_map
+{
+	/* the start of the mapping, which is aligned to the page size */
+	void *base;
+	size_t mapped_len;
+
+	/* the first byte of the view at the requested offset */
+	const uint8_t *data;
 };
 
 struct threadpool_open_file_data
@@ -26,6 +62,31 @@ struct threadpool_open_file_data
 	const char *path;
 	enum ff_arch_file_access_mode access_mode;
 	int fd;
+	int is_regular;
+};
+
+struct threadpool_file_io_data
+{
+	int fd;
+	enum ff_linux_completion_port_io_type io_type;
+	void *buf;
+	int len;
+	int64_t offset;
+	ssize_t result;
+	int err;
+};
+
+struct threadpool_map_advise_data
+{
+	void *addr;
+	size_t len;
+	int advice;
+};
+
+struct threadpool_map_prefault_data
+{
+	const uint8_t *addr;
+	size_t len;
 };
 
 struct threadpool_erase_file_data
@@ -48,13 +109,6 @@ struct threadpool_move_file_data
 	enum ff_result result;
 };
 
-struct file_data
-{
-	struct ff_arch_completion_port *completion_port;
-};
-
-static struct file_data file_ctx;
-
 static void threadpool_open_file_func(void *ctx)
 {
 	struct threadpool_open_file_data *data;
@@ -67,8 +121,19 @@ static void threadpool_open_file_func(void *ctx)
 	data->fd = open(data->path, flags, S_IREAD | S_IWRITE);
 	if (data->fd != -1)
 	{
-		rv = fcntl(data->fd, F_SETFL, O_NONBLOCK);
-		ff_linux_fatal_error_check(rv != -1, L"cannot set nonblocking mode for the file descriptor");
+		struct stat stat;
+
+		rv = fstat(data->fd, &stat);
+		ff_linux_fatal_error_check(rv != -1, L"error in the stat() function");
+		data->is_regular = S_ISREG(stat.st_mode);
+		if (!data->is_regular)
+		{
+			/* io_uring fails operations on non-blocking regular files with EAGAIN instead of reading
+			 * them asynchronously, so only special files are switched to non-blocking mode
+			 */
+			rv = fcntl(data->fd, F_SETFL, O_NONBLOCK);
+			ff_linux_fatal_error_check(rv != -1, L"cannot set nonblocking mode for the file descriptor");
+		}
 	}
 	else
 	{
@@ -79,6 +144,107 @@ static void threadpool_open_file_func(void *ctx)
 	}
 }
 
+static void threadpool_file_io_func(void *ctx)
+{
+	struct threadpool_file_io_data *data;
+
+	data = (struct threadpool_file_io_data *) ctx;
+	for (;;)
+	{
+		switch (data->io_type)
+		{
+		case FF_COMPLETION_PORT_IO_READ:
+			data->result = read(data->fd, data->buf, data->len);
+			break;
+		case FF_COMPLETION_PORT_IO_WRITE:
+			data->result = write(data->fd, data->buf, data->len);
+			break;
+		case FF_COMPLETION_PORT_IO_READV:
+			if (data->offset == -1)
+			{
+				data->result = readv(data->fd, (const struct iovec *) data->buf, data->len);
+			}
+			else
+			{
+				data->result = preadv(data->fd, (const struct iovec *) data->buf, data->len, (off_t) data->offset);
+			}
+			break;
+		case FF_COMPLETION_PORT_IO_WRITEV:
+			if (data->offset == -1)
+			{
+				data->result = writev(data->fd, (const struct iovec *) data->buf, data->len);
+			}
+			else
+			{
+				data->result = pwritev(data->fd, (const struct iovec *) data->buf, data->len, (off_t) data->offset);
+			}
+			break;
+		default:
+			ff_assert(0);
+		}
+		if (data->result != -1 || errno != EINTR)
+		{
+			break;
+		}
+	}
+	data->err = (data->result == -1) ? errno : 0;
+}
+
+static void threadpool_map_advise_func(void *ctx)
+{
+	struct threadpool_map_advise_data *data;
+	int rv;
+
+	data = (struct threadpool_map_advise_data *) ctx;
+	rv = madvise(data->addr, data->len, data->advice);
+	if (rv == -1)
+	{
+		ff_log_debug(L"cannot apply the advice=%d to the addr=%p, len=%llu. errno=%d", data->advice, data->addr, (uint64_t) data->len, errno);
+	}
+}
+
+static void threadpool_map_prefault_func(void *ctx)
+{
+	struct threadpool_map_prefault_data *data;
+	size_t page_size;
+	size_t i;
+	volatile uint8_t sink;
+
+	data = (struct threadpool_map_prefault_data *) ctx;
+#ifdef MADV_POPULATE_READ
+	{
+		uintptr_t start;
+		uintptr_t end;
+		int rv;
+
+		/* populates page tables without touching pages one by one. It is available since linux 5.14 */
+		page_size = (size_t) sysconf(_SC_PAGESIZE);
+		start = ((uintptr_t) data->addr) & ~((uintptr_t) page_size - 1);
+		end = ((uintptr_t) data->addr) + data->len;
+		rv = madvise((void *) start, end - start, MADV_POPULATE_READ);
+		if (rv != -1)
+		{
+			return;
+		}
+		if (errno == EFAULT)
+		{
+			/* the file has been truncated after the view creation, so reading pages past its end would raise SIGBUS */
+			ff_log_debug(L"cannot populate the addr=%p, len=%llu past the end of the file", data->addr, (uint64_t) data->len);
+			return;
+		}
+		ff_log_debug(L"cannot populate the addr=%p, len=%llu. Falling back to reading pages. errno=%d", data->addr, (uint64_t) data->len, errno);
+	}
+#endif
+
+	page_size = (size_t) sysconf(_SC_PAGESIZE);
+	for (i = 0; i < data->len; i += page_size)
+	{
+		sink = data->addr[i];
+	}
+	sink = data->addr[data->len - 1];
+	(void)sink;
+}
+
 static void threadpool_erase_file_func(void *ctx)
 {
 	struct threadpool_erase_file_data *data;
@@ -93,29 +259,138 @@ static void threadpool_erase_file_func(void *ctx)
 	data->result = (rv == -1) ? FF_FAILURE : FF_SUCCESS;
 }
 
-static void threadpool_copy_file_func(void *ctx)
+/**
+ * @private
+ * Returns non-zero if the kernel-side copy method failed with the given errno,
+ * because it isn't supported for the given pair of files, so the next method should be tried.
+ */
+static int is_copy_method_unsupported(int err)
 {
-	struct threadpool_copy_file_data *data;
+	int is_unsupported;
+
+	is_unsupported = (err == ENOSYS || err == EOPNOTSUPP || err == ENOTTY || err == EXDEV || err == EINVAL);
+	return is_unsupported;
+}
+
+/**
+ * @private
+ * Copies the rest of the src_fd to the dst_fd by copy_file_range(), which doesn't copy data
+ * through the user space and can share extents on copy-on-write filesystems.
+ * Returns 1 on success, 0 if the method isn't supported or -1 on error.
+ */
+static int copy_file_by_range(int src_fd, int dst_fd)
+{
+#ifdef __NR_copy_file_range
+	for (;;)
+	{
+		ssize_t bytes_copied;
+
+		bytes_copied = (ssize_t) syscall(__NR_copy_file_range, src_fd, NULL, dst_fd, NULL, (size_t) KERNEL_COPY_CHUNK_SIZE, 0);
+		if (bytes_copied == 0)
+		{
+			return 1;
+		}
+		if (bytes_copied == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (is_copy_method_unsupported(errno))
+			{
+				/* file positions reflect the copied data, so the next method continues from them */
+				ff_log_debug(L"copy_file_range() isn't supported for the src_fd=%d, dst_fd=%d. errno=%d", src_fd, dst_fd, errno);
+				return 0;
+			}
+			ff_log_debug(L"error while copying data from the src_fd=%d to the dst_fd=%d by copy_file_range(). errno=%d", src_fd, dst_fd, errno);
+			return -1;
+		}
+	}
+#else
+	(void)src_fd;
+	(void)dst_fd;
+	return 0;
+#endif
+}
+
+/**
+ * @private
+ * Makes the dst_fd a copy-on-write clone of the whole src_fd.
+ * Returns 1 on success, 0 if the method isn't supported or -1 on error.
+ */
+static int copy_file_by_clone(int src_fd, int dst_fd)
+{
+#ifdef FICLONE
+	off_t src_pos;
 	int rv;
-	int src_fd, dst_fd;
-	char *buf;
 
-	data = (struct threadpool_copy_file_data *) ctx;
-	data->result = FF_FAILURE;
-	src_fd = open(data->src_path, O_RDONLY | O_LARGEFILE);
-	if (src_fd == -1)
+	/* the clone replaces the whole contents of the dst_fd, so it cannot continue a partial copy */
+	src_pos = lseek(src_fd, 0, SEEK_CUR);
+	if (src_pos != 0)
 	{
-		ff_log_debug(L"cannot open the file=[%hs] for reading. errno=%d", data->src_path, errno);
-		return;
+		return 0;
 	}
-	dst_fd = open(data->dst_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
-	if (dst_fd == -1)
+	rv = ioctl(dst_fd, FICLONE, src_fd);
+	if (rv == -1)
 	{
-		ff_log_debug(L"cannot create the file=[%hs]. errno=%d", data->dst_path, errno);
-		rv = close(src_fd);
-		ff_assert(rv != -1);
-		return;
+		if (is_copy_method_unsupported(errno))
+		{
+			ff_log_debug(L"FICLONE isn't supported for the src_fd=%d, dst_fd=%d. errno=%d", src_fd, dst_fd, errno);
+			return 0;
+		}
+		ff_log_debug(L"cannot clone the src_fd=%d to the dst_fd=%d. errno=%d", src_fd, dst_fd, errno);
+		return -1;
+	}
+	return 1;
+#else
+	(void)src_fd;
+	(void)dst_fd;
+	return 0;
+#endif
+}
+
+/**
+ * @private
+ * Copies the rest of the src_fd to the dst_fd by sendfile(), which doesn't copy data through the user space.
+ * Returns 1 on success, 0 if the method isn't supported or -1 on error.
+ */
+static int copy_file_by_sendfile(int src_fd, int dst_fd)
+{
+	for (;;)
+	{
+		ssize_t bytes_copied;
+
+		bytes_copied = sendfile(dst_fd, src_fd, NULL, (size_t) KERNEL_COPY_CHUNK_SIZE);
+		if (bytes_copied == 0)
+		{
+			return 1;
+		}
+		if (bytes_copied == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (is_copy_method_unsupported(errno))
+			{
+				ff_log_debug(L"sendfile() isn't supported for the src_fd=%d, dst_fd=%d. errno=%d", src_fd, dst_fd, errno);
+				return 0;
+			}
+			ff_log_debug(L"error while copying data from the src_fd=%d to the dst_fd=%d by sendfile(). errno=%d", src_fd, dst_fd, errno);
+			return -1;
+		}
 	}
+}
+
+/**
+ * @private
+ * Copies the rest of the src_fd to the dst_fd through the user-space buffer.
+ * Returns 1 on success or -1 on error.
+ */
+static int copy_file_by_buffer(int src_fd, int dst_fd)
+{
+	char *buf;
+	int rv = -1;
 
 	buf = (char *) ff_calloc(FILE_COPY_BUF_SIZE, sizeof(buf[0]));
 	for (;;)
@@ -132,13 +407,13 @@ static void threadpool_copy_file_func(void *ctx)
 		}
 		if (bytes_read == 0)
 		{
-			data->result = FF_SUCCESS;
+			rv = 1;
 			break;
 		}
 		if (bytes_read == -1)
 		{
 			ff_log_debug(L"error while reading data from the src_fd=%d to the buf=%p, len=%d. errno=%d", src_fd, buf, FILE_COPY_BUF_SIZE, errno);
-			goto error;
+			break;
 		}
 		ff_assert(bytes_read > 0);
 		while (bytes_read > 0)
@@ -156,19 +431,66 @@ static void threadpool_copy_file_func(void *ctx)
 			if (bytes_written == -1)
 			{
 				ff_log_debug(L"error while writing data to the dst_fd=%d from the buf=%p, len=%llu. errno=%d", dst_fd, buf, (uint64_t) bytes_read, errno);
-				goto error;
+				goto end;
 			}
 			ff_assert(bytes_written > 0);
 			bytes_read -= bytes_written;
 		}
 		ff_assert(bytes_read == 0);
 	}
-error:
+
+end:
 	ff_free(buf);
+	return rv;
+}
+
+static void threadpool_copy_file_func(void *ctx)
+{
+	struct threadpool_copy_file_data *data;
+	int rv;
+	int src_fd, dst_fd;
+
+	data = (struct threadpool_copy_file_data *) ctx;
+	data->result = FF_FAILURE;
+	src_fd = open(data->src_path, O_RDONLY | O_LARGEFILE);
+	if (src_fd == -1)
+	{
+		ff_log_debug(L"cannot open the file=[%hs] for reading. errno=%d", data->src_path, errno);
+		return;
+	}
+	dst_fd = open(data->dst_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (dst_fd == -1)
+	{
+		ff_log_debug(L"cannot create the file=[%hs]. errno=%d", data->dst_path, errno);
+		rv = close(src_fd);
+		ff_assert(rv != -1);
+		return;
+	}
+
+	/* kernel-side methods are tried first, so the data isn't copied through the user space.
+	 * Each method continues from the file positions, where the previous one stopped
+	 */
+	rv = copy_file_by_range(src_fd, dst_fd);
+	if (rv == 0)
+	{
+		rv = copy_file_by_clone(src_fd, dst_fd);
+	}
+	if (rv == 0)
+	{
+		rv = copy_file_by_sendfile(src_fd, dst_fd);
+	}
+	if (rv == 0)
+	{
+		rv = copy_file_by_buffer(src_fd, dst_fd);
+	}
+	if (rv == 1)
+	{
+		data->result = FF_SUCCESS;
+	}
 
 	rv = close(dst_fd);
 	ff_assert(rv != -1);
-	close(src_fd);
+	rv = close(src_fd);
 	ff_assert(rv != -1);
 }
 
@@ -190,16 +512,194 @@ static void wait_for_file_io(struct ff_arch_file *file)
 {
 	struct ff_fiber *current_fiber;
 	enum ff_linux_completion_port_operation_type operation_type;
+	int is_registered;
 
+	if (file->port_fd == NULL)
+	{
+		file->port_fd = ff_linux_completion_port_register_fd(ff_core_get_completion_port(), file->fd);
+	}
 	current_fiber = ff_fiber_get_current();
 	operation_type = (file->access_mode == FF_ARCH_FILE_READ) ? FF_COMPLETION_PORT_OPERATION_READ : FF_COMPLETION_PORT_OPERATION_WRITE;
-	ff_linux_completion_port_register_operation(file_ctx.completion_port, file->fd, operation_type, current_fiber);
-	ff_core_yield_fiber();
+	is_registered = ff_linux_completion_port_register_operation(file->port_fd, operation_type, current_fiber);
+	if (is_registered)
+	{
+		ff_core_yield_fiber();
+	}
+}
+
+/**
+ * @private
+ * Reads or writes the regular file at the given offset without blocking,
+ * so reads served from the page cache don't pay for the offload round-trip.
+ * The offset -1 means the current file position.
+ * Returns -1 with errno=EAGAIN if the operation would block.
+ */
+static ssize_t try_file_io_nowait(struct ff_arch_file *file, int is_read, const struct iovec *iov, int iov_cnt, int64_t offset)
+{
+	ssize_t result = -1;
+
+	errno = EAGAIN;
+#ifdef RWF_NOWAIT
+	if (file->is_nowait_supported)
+	{
+		for (;;)
+		{
+			if (is_read)
+			{
+				result = preadv2(file->fd, iov, iov_cnt, (off_t) offset, RWF_NOWAIT);
+			}
+			else
+			{
+				result = pwritev2(file->fd, iov, iov_cnt, (off_t) offset, RWF_NOWAIT);
+			}
+			if (result != -1 || errno != EINTR)
+			{
+				break;
+			}
+		}
+		if (result == -1 && (errno == EOPNOTSUPP || errno == ENOSYS || errno == EINVAL))
+		{
+			/* old kernels and some filesystems don't support RWF_NOWAIT */
+			ff_log_debug(L"RWF_NOWAIT isn't supported for the fd=%d. errno=%d", file->fd, errno);
+			file->is_nowait_supported = 0;
+			errno = EAGAIN;
+		}
+	}
+#else
+	(void)file;
+	(void)is_read;
+	(void)iov;
+	(void)iov_cnt;
+	(void)offset;
+#endif
+
+	return result;
+}
+
+/**
+ * @private
+ * Reads or writes the regular file by the io_uring of the current scheduler
+ * or by the threadpool if io_uring isn't available, so the scheduler thread isn't blocked by disk I/O.
+ * See struct ff_linux_completion_port_io for the meaning of buf, len and offset.
+ * Returns the result of the operation like read() and write() do.
+ */
+static ssize_t offload_file_io(struct ff_arch_file *file, enum ff_linux_completion_port_io_type io_type, void *buf, int len, int64_t offset)
+{
+	struct ff_linux_completion_port_io io;
+	struct threadpool_file_io_data data;
+	int is_executed;
+
+	io.type = io_type;
+	io.fd = file->fd;
+	io.buf = buf;
+	io.len = len;
+	io.addr = NULL;
+	io.addrlen = 0;
+	io.offset = offset;
+	is_executed = ff_linux_misc_execute_io(&io);
+	if (is_executed)
+	{
+		if (io.result < 0)
+		{
+			errno = -io.result;
+			return -1;
+		}
+		return io.result;
+	}
+
+	data.fd = file->fd;
+	data.io_type = io_type;
+	data.buf = buf;
+	data.len = len;
+	data.offset = offset;
+	data.result = -1;
+	data.err = 0;
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_file_io_func, &data);
+	errno = data.err;
+	return data.result;
+}
+
+/**
+ * @private
+ * Reads or writes the regular file at the current position.
+ */
+static ssize_t execute_regular_file_io(struct ff_arch_file *file, enum ff_linux_completion_port_io_type io_type, void *buf, int len)
+{
+	struct iovec iov;
+	ssize_t result;
+
+	iov.iov_base = buf;
+	iov.iov_len = (size_t) len;
+	result = try_file_io_nowait(file, io_type == FF_COMPLETION_PORT_IO_READ, &iov, 1, -1);
+	if (result == -1 && errno == EAGAIN)
+	{
+		result = offload_file_io(file, io_type, buf, len, -1);
+	}
+	return result;
+}
+
+/**
+ * @private
+ * Reads or writes the file at the given offset using up to FF_LINUX_MISC_MAX_IOVECS_CNT buffers from the iov.
+ * The io_type must be either FF_COMPLETION_PORT_IO_READV or FF_COMPLETION_PORT_IO_WRITEV.
+ * The offset -1 means the current file position. Otherwise the file position isn't used,
+ * so concurrent operations on the same file don't interfere.
+ * Returns the number of transferred bytes or -1 on error.
+ */
+static int execute_vectored_file_io(struct ff_arch_file *file, enum ff_linux_completion_port_io_type io_type, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	struct iovec vecs[FF_LINUX_MISC_MAX_IOVECS_CNT];
+	int vecs_cnt;
+	int is_read;
+	ssize_t result;
+
+	ff_assert(iov_cnt > 0);
+	ff_assert(offset >= -1);
+
+	if (offset != -1 && !file->is_regular)
+	{
+		ff_log_debug(L"positional I/O isn't supported by the special file=%p with fd=%d", file, file->fd);
+		return -1;
+	}
+
+	vecs_cnt = ff_linux_misc_convert_iovecs(vecs, iov, iov_cnt);
+	is_read = (io_type == FF_COMPLETION_PORT_IO_READV);
+	for (;;)
+	{
+		if (file->is_regular)
+		{
+			result = try_file_io_nowait(file, is_read, vecs, vecs_cnt, offset);
+			if (result == -1 && errno == EAGAIN)
+			{
+				result = offload_file_io(file, io_type, vecs, vecs_cnt, offset);
+			}
+		}
+		else
+		{
+			result = is_read ? readv(file->fd, vecs, vecs_cnt) : writev(file->fd, vecs, vecs_cnt);
+			if (result == -1 && errno == EAGAIN)
+			{
+				wait_for_file_io(file);
+				continue;
+			}
+		}
+		if (result != -1 || errno != EINTR)
+		{
+			break;
+		}
+	}
+	if (result == -1)
+	{
+		ff_log_debug(L"error while transferring data at the offset=%lld of the fd=%d using the iov=%p, iov_cnt=%d. errno=%d", (long long) offset, file->fd, iov, vecs_cnt, errno);
+	}
+
+	return (int) result;
 }
 
 void ff_linux_file_initialize(struct ff_arch_completion_port *completion_port)
 {
-	file_ctx.completion_port = completion_port;
+	/* file I/O operations are registered in the completion port of the current scheduler */
+	(void)completion_port;
 }
 
 void ff_linux_file_shutdown()
@@ -217,13 +717,24 @@ struct ff_arch_file *ff_arch_file_open(const wchar_t *path, enum ff_arch_file_ac
 	data.path = mb_path;
 	data.access_mode = access_mode;
 	data.fd = -1;
-	ff_core_threadpool_execute(threadpool_open_file_func, &data);
+	data.is_regular = 0;
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_open_file_func, &data);
 	ff_free(mb_path);
 	if (data.fd != -1)
 	{
 		file = (struct ff_arch_file *) ff_malloc(sizeof(*file));
+		file->port_fd = NULL;
 		file->fd = data.fd;
 		file->access_mode = access_mode;
+		file->is_regular = data.is_regular;
+		file->is_nowait_supported = 1;
+
+		/* special files such as pipes may be non-blocking without being registered in the completion port,
+		 * so only regular files support kernel-side transfers
+		 */
+		file->endpoint.type = data.is_regular ? FF_LINUX_ENDPOINT_REGULAR_FILE : FF_LINUX_ENDPOINT_OTHER;
+		file->endpoint.fd = data.fd;
+		file->endpoint.port_fd = NULL;
 	}
 	else
 	{
@@ -240,6 +751,10 @@ void ff_arch_file_close(struct ff_arch_file *file)
 {
 	int rv;
 
+	if (file->port_fd != NULL)
+	{
+		ff_linux_completion_port_deregister_fd(file->port_fd);
+	}
 	rv = close(file->fd);
 	ff_assert(rv != -1);
 	ff_free(file);
@@ -254,7 +769,14 @@ int ff_arch_file_read(struct ff_arch_file *file, void *buf, int len)
 	ff_assert(file->access_mode == FF_ARCH_FILE_READ);
 
 again:
-	bytes_read = read(file->fd, buf, len);
+	if (file->is_regular)
+	{
+		bytes_read = execute_regular_file_io(file, FF_COMPLETION_PORT_IO_READ, buf, len);
+	}
+	else
+	{
+		bytes_read = read(file->fd, buf, len);
+	}
 	if (bytes_read == -1)
 	{
 		if (errno == EINTR)
@@ -282,7 +804,14 @@ int ff_arch_file_write(struct ff_arch_file *file, const void *buf, int len)
 	ff_assert(file->access_mode == FF_ARCH_FILE_WRITE);
 
 again:
-	bytes_written = write(file->fd, buf, len);
+	if (file->is_regular)
+	{
+		bytes_written = execute_regular_file_io(file, FF_COMPLETION_PORT_IO_WRITE, (void *) buf, len);
+	}
+	else
+	{
+		bytes_written = write(file->fd, buf, len);
+	}
 	if (bytes_written == -1)
 	{
 		if (errno == EINTR)
@@ -301,6 +830,163 @@ again:
 	return bytes_written_int;
 }
 
+int ff_arch_file_readv(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt)
+{
+	int bytes_read;
+
+	ff_assert(file->access_mode == FF_ARCH_FILE_READ);
+
+	bytes_read = execute_vectored_file_io(file, FF_COMPLETION_PORT_IO_READV, iov, iov_cnt, -1);
+	return bytes_read;
+}
+
+int ff_arch_file_writev(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt)
+{
+	int bytes_written;
+
+	ff_assert(file->access_mode == FF_ARCH_FILE_WRITE);
+
+	bytes_written = execute_vectored_file_io(file, FF_COMPLETION_PORT_IO_WRITEV, iov, iov_cnt, -1);
+	return bytes_written;
+}
+
+int ff_arch_file_preadv(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	int bytes_read;
+
+	ff_assert(file->access_mode == FF_ARCH_FILE_READ);
+	ff_assert(offset >= 0);
+
+	bytes_read = execute_vectored_file_io(file, FF_COMPLETION_PORT_IO_READV, iov, iov_cnt, offset);
+	return bytes_read;
+}
+
+int ff_arch_file_pwritev(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	int bytes_written;
+
+	ff_assert(file->access_mode == FF_ARCH_FILE_WRITE);
+	ff_assert(offset >= 0);
+
+	bytes_written = execute_vectored_file_io(file, FF_COMPLETION_PORT_IO_WRITEV, iov, iov_cnt, offset);
+	return bytes_written;
+}
+
+struct ff_arch_endpoint *ff_arch_file_get_endpoint(struct ff_arch_file *file)
+{
+	return &file->endpoint;
+}
+
+struct ff_arch_file_map *ff_arch_file_map_create(struct ff_arch_file *file, int64_t offset, int64_t len)
+{
+	struct ff_arch_file_map *map;
+	int64_t page_size;
+	int64_t aligned_offset;
+	int64_t mapped_len;
+	void *base;
+
+	ff_assert(file->access_mode == FF_ARCH_FILE_READ);
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	/* mmap() requires the offset aligned to the page size */
+	page_size = (int64_t) sysconf(_SC_PAGESIZE);
+	aligned_offset = offset & ~(page_size - 1);
+	mapped_len = len + (offset - aligned_offset);
+	if ((uint64_t) mapped_len > (uint64_t) SIZE_MAX)
+	{
+		ff_log_debug(L"the len=%lld is too big for mapping the fd=%d into memory", (long long) len, file->fd);
+		return NULL;
+	}
+
+	/* the mapping itself doesn't read the file, so it doesn't block on the disk I/O */
+	base = mmap(NULL, (size_t) mapped_len, PROT_READ, MAP_SHARED, file->fd, (off_t) aligned_offset);
+	if (base == MAP_FAILED)
+	{
+		ff_log_debug(L"cannot map %lld bytes of the fd=%d at the offset=%lld. errno=%d", (long long) len, file->fd, (long long) offset, errno);
+		return NULL;
+	}
+
+	map = (struct ff_arch_file_map *) ff_malloc(sizeof(*map));
+	map->base = base;
+	map->mapped_len = (size_t) mapped_len;
+	map->data = ((const uint8_t *) base) + (offset - aligned_offset);
+
+	return map;
+}
+
+void ff_arch_file_map_delete(struct ff_arch_file_map *map)
+{
+	int rv;
+
+	rv = munmap(map->base, map->mapped_len);
+	ff_assert(rv != -1);
+	ff_free(map);
+}
+
+const void *ff_arch_file_map_get_data(struct ff_arch_file_map *map)
+{
+	return map->data;
+}
+
+void ff_arch_file_map_advise(struct ff_arch_file_map *map, int64_t offset, int64_t len, enum ff_arch_file_map_advice advice)
+{
+	struct threadpool_map_advise_data data;
+	uintptr_t page_size;
+	uintptr_t start;
+	uintptr_t end;
+
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	/* madvise() requires the address aligned to the page size */
+	page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+	start = ((uintptr_t) (map->data + offset)) & ~(page_size - 1);
+	end = (uintptr_t) (map->data + offset + len);
+	data.addr = (void *) start;
+	data.len = (size_t) (end - start);
+	switch (advice)
+	{
+	case FF_ARCH_FILE_MAP_ADVICE_NORMAL:
+		data.advice = MADV_NORMAL;
+		break;
+	case FF_ARCH_FILE_MAP_ADVICE_SEQUENTIAL:
+		data.advice = MADV_SEQUENTIAL;
+		break;
+	case FF_ARCH_FILE_MAP_ADVICE_RANDOM:
+		data.advice = MADV_RANDOM;
+		break;
+	case FF_ARCH_FILE_MAP_ADVICE_WILLNEED:
+		data.advice = MADV_WILLNEED;
+		break;
+	default:
+		ff_assert(0);
+		return;
+	}
+
+	if (advice == FF_ARCH_FILE_MAP_ADVICE_WILLNEED)
+	{
+		/* MADV_WILLNEED submits the read-ahead synchronously, which can block on the disk I/O */
+		ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_map_advise_func, &data);
+	}
+	else
+	{
+		threadpool_map_advise_func(&data);
+	}
+}
+
+void ff_arch_file_map_prefault(struct ff_arch_file_map *map, int64_t offset, int64_t len)
+{
+	struct threadpool_map_prefault_data data;
+
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	data.addr = map->data + offset;
+	data.len = (size_t) len;
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_map_prefault_func, &data);
+}
+
 enum ff_result ff_arch_file_erase(const wchar_t *path)
 {
 	char *mb_path;
@@ -309,7 +995,7 @@ enum ff_result ff_arch_file_erase(const wchar_t *path)
 	mb_path = ff_linux_misc_wide_to_multibyte_string(path);
 	data.path = mb_path;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_erase_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_erase_file_func, &data);
 	ff_free(mb_path);
 	if (data.result != FF_SUCCESS)
 	{
@@ -330,7 +1016,7 @@ enum ff_result ff_arch_file_copy(const wchar_t *src_path, const wchar_t *dst_pat
 	data.src_path = mb_src_path;
 	data.dst_path = mb_dst_path;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_copy_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_copy_file_func, &data);
 	ff_free(mb_src_path);
 	ff_free(mb_dst_path);
 	if (data.result != FF_SUCCESS)
@@ -352,7 +1038,7 @@ enum ff_result ff_arch_file_move(const wchar_t *src_path, const wchar_t *dst_pat
 	data.src_path = mb_src_path;
 	data.dst_path = mb_dst_path;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_move_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_move_file_func, &data);
 	ff_free(mb_src_path);
 	ff_free(mb_dst_path);
 	if (data.result != FF_SUCCESS)
@@ -1,5 +1,7 @@
 #include "private/arch/ff_arch_misc.h"
 #include "private/arch/ff_arch_completion_port.h"
+#include "private/ff_core.h"
+#include "private/ff_fiber.h"
 #include "ff_linux_file.h"
 #include "ff_linux_net.h"
 #include "ff_linux_error_check.h"
@@ -9,6 +11,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 
 struct misc_data
 {
@@ -60,16 +63,26 @@ void ff_arch_misc_shutdown()
 }
 
 int64_t ff_arch_misc_get_current_time()
+{
+	int64_t current_time;
+
+	/* timeouts must not be affected by wall-clock adjustments, so the monotonic clock is used */
+	current_time = ff_arch_misc_get_precise_time() / (1000 * 1000);
+	return current_time;
+}
+
+int64_t ff_arch_misc_get_precise_time()
 {
 	struct timespec ts;
 	int rv;
-	int64_t current_time;
+	int64_t precise_time;
 
-	rv = clock_gettime(CLOCK_REALTIME, &ts);
+	/* clock_gettime(CLOCK_MONOTONIC) is served by vDSO without entering the kernel */
+	rv = clock_gettime(CLOCK_MONOTONIC, &ts);
 	assert(rv == 0);
 	(void)rv;
-	current_time = (((int64_t) ts.tv_sec) * 1000) + (ts.tv_nsec / (1000 * 1000));
-	return current_time;
+	precise_time = (((int64_t) ts.tv_sec) * 1000 * 1000 * 1000) + ts.tv_nsec;
+	return precise_time;
 }
 
 void ff_arch_misc_sleep(int interval)
@@ -154,6 +167,44 @@ char *ff_linux_misc_wide_to_multibyte_string(const wchar_t *wide_str)
 	return mb_str;
 }
 
+int ff_linux_misc_convert_iovecs(struct iovec *vecs, const struct ff_iovec *iov, int iov_cnt)
+{
+	int vecs_cnt;
+	int total_len;
+
+	ff_assert(iov_cnt > 0);
+
+	/* the number of transferred bytes must fit into int */
+	total_len = 0;
+	for (vecs_cnt = 0; vecs_cnt < iov_cnt && vecs_cnt < FF_LINUX_MISC_MAX_IOVECS_CNT; vecs_cnt++)
+	{
+		ff_assert(iov[vecs_cnt].len >= 0);
+		if (iov[vecs_cnt].len > INT_MAX - total_len)
+		{
+			break;
+		}
+		vecs[vecs_cnt].iov_base = iov[vecs_cnt].buf;
+		vecs[vecs_cnt].iov_len = (size_t) iov[vecs_cnt].len;
+		total_len += iov[vecs_cnt].len;
+	}
+	ff_assert(vecs_cnt > 0);
+
+	return vecs_cnt;
+}
+
+int ff_linux_misc_execute_io(struct ff_linux_completion_port_io *io)
+{
+	int is_submitted;
+
+	io->data = ff_fiber_get_current();
+	is_submitted = ff_linux_completion_port_submit_io(ff_core_get_completion_port(), io);
+	if (is_submitted)
+	{
+		ff_core_yield_fiber();
+	}
+	return is_submitted;
+}
+
 FILE *ff_arch_misc_open_log_file_utf8(const wchar_t *filename)
 {
 	FILE *stream;
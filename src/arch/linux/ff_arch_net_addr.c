@@ -90,7 +90,7 @@ enum ff_result ff_arch_net_addr_resolve(struct ff_arch_net_addr *addr, const wch
 	data.host = mb_host;
 	data.port = port;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_addr_resolve_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_addr_resolve_func, &data);
 	if (data.result != FF_SUCCESS)
 	{
 		ff_log_debug(L"cannot resolve the address [%ls:%d]. See previous error messages for more info", host, port);
@@ -0,0 +1,130 @@
+#include "private/ff_common.h"
+
+#include "private/arch/ff_arch_semaphore.h"
+#include "ff_linux_error_check.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+
+struct ff_arch_semaphore
+{
+	/* the futex word. It is modified only by atomic operations */
+	int value;
+
+	/* the number of threads, which are blocked or are about to block on the value */
+	int waiters_cnt;
+};
+
+static int futex(int *addr, int op, int value, const struct timespec *timeout)
+{
+	int rv;
+
+	rv = (int) syscall(SYS_futex, addr, op, value, timeout, NULL, FUTEX_BITSET_MATCH_ANY);
+	return rv;
+}
+
+/**
+ * @private
+ * Waits until the value becomes positive and decrements it.
+ * The deadline is the absolute CLOCK_MONOTONIC time. The wait is infinite if the deadline is NULL.
+ */
+static enum ff_result down_until(struct ff_arch_semaphore *semaphore, const struct timespec *deadline)
+{
+	enum ff_result result = FF_FAILURE;
+
+	for (;;)
+	{
+		int value;
+		int rv;
+
+		value = __atomic_load_n(&semaphore->value, __ATOMIC_SEQ_CST);
+		while (value > 0)
+		{
+			if (__atomic_compare_exchange_n(&semaphore->value, &value, value - 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			{
+				result = FF_SUCCESS;
+				goto end;
+			}
+		}
+
+		/* the kernel re-checks the value before blocking, so a concurrent ff_arch_semaphore_up() cannot be missed */
+		__atomic_add_fetch(&semaphore->waiters_cnt, 1, __ATOMIC_SEQ_CST);
+		rv = futex(&semaphore->value, FUTEX_WAIT_BITSET_PRIVATE, 0, deadline);
+		__atomic_sub_fetch(&semaphore->waiters_cnt, 1, __ATOMIC_SEQ_CST);
+		if (rv == -1)
+		{
+			ff_linux_fatal_error_check(errno == EAGAIN || errno == EINTR || errno == ETIMEDOUT, L"cannot block on the semaphore");
+			if (errno == ETIMEDOUT)
+			{
+				break;
+			}
+		}
+	}
+
+end:
+	return result;
+}
+
+struct ff_arch_semaphore *ff_arch_semaphore_create(int value)
+{
+	struct ff_arch_semaphore *semaphore;
+
+	ff_assert(value >= 0);
+
+	semaphore = (struct ff_arch_semaphore *) ff_malloc(sizeof(*semaphore));
+	semaphore->value = value;
+	semaphore->waiters_cnt = 0;
+
+	return semaphore;
+}
+
+void ff_arch_semaphore_delete(struct ff_arch_semaphore *semaphore)
+{
+	ff_assert(semaphore->waiters_cnt == 0);
+
+	ff_free(semaphore);
+}
+
+void ff_arch_semaphore_up(struct ff_arch_semaphore *semaphore)
+{
+	int rv;
+
+	__atomic_add_fetch(&semaphore->value, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&semaphore->waiters_cnt, __ATOMIC_SEQ_CST) > 0)
+	{
+		/* the syscall is skipped while nobody waits, so uncontended posts stay in user space */
+		rv = futex(&semaphore->value, FUTEX_WAKE_PRIVATE, 1, NULL);
+		ff_linux_fatal_error_check(rv != -1, L"cannot wake up a thread blocked on the semaphore");
+	}
+}
+
+void ff_arch_semaphore_down(struct ff_arch_semaphore *semaphore)
+{
+	enum ff_result result;
+
+	result = down_until(semaphore, NULL);
+	ff_assert(result == FF_SUCCESS);
+}
+
+enum ff_result ff_arch_semaphore_down_with_timeout(struct ff_arch_semaphore *semaphore, int timeout)
+{
+	struct timespec deadline;
+	enum ff_result result;
+	int rv;
+
+	ff_assert(timeout > 0);
+
+	rv = clock_gettime(CLOCK_MONOTONIC, &deadline);
+	ff_assert(rv == 0);
+	deadline.tv_sec += timeout / 1000;
+	deadline.tv_nsec += (long) (timeout % 1000) * 1000 * 1000;
+	if (deadline.tv_nsec >= 1000 * 1000 * 1000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000 * 1000 * 1000;
+	}
+	result = down_until(semaphore, &deadline);
+	return result;
+}
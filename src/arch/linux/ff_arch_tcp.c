@@ -3,35 +3,42 @@
 #include "private/arch/ff_arch_tcp.h"
 #include "ff_linux_net_addr.h"
 #include "ff_linux_net.h"
+#include "ff_linux_endpoint.h"
+#include "ff_linux_misc.h"
 #include "ff_linux_error_check.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
-#include <fcntl.h>
 
 struct ff_arch_tcp
 {
-	int sd_rd;
-	int sd_wr;
+	/* the socket registered in the completion port. The completion port tracks
+	 * the reader and the writer waiting for the socket separately, so they can share the socket
+	 */
+	struct ff_linux_completion_port_fd *port_fd;
+	int sd;
+
+	struct ff_arch_endpoint endpoint;
 };
 
+/**
+ * @private
+ * Creates the tcp from the non-blocking socket.
+ */
 static struct ff_arch_tcp *create_tcp(int sd)
 {
 	struct ff_arch_tcp *tcp;
-	int rv;
-	int sd_rd, sd_wr;
-
-	sd_rd = sd;
-	rv = fcntl(sd_rd, F_SETFL, O_NONBLOCK);
-	ff_linux_fatal_error_check(rv != -1, L"cannot set nonblocking mode for the TCP socket");
 
-	sd_wr = dup(sd_rd);
-	ff_linux_fatal_error_check(sd_wr != -1, L"cannot duplicate TCP socket");
+	ff_linux_net_setup_busy_poll(sd);
 
 	tcp = (struct ff_arch_tcp *) ff_malloc(sizeof(*tcp));
-	tcp->sd_rd = sd_rd;
-	tcp->sd_wr = sd_wr;
+	tcp->port_fd = ff_linux_net_register_socket(sd);
+	tcp->sd = sd;
+	tcp->endpoint.type = FF_LINUX_ENDPOINT_SOCKET;
+	tcp->endpoint.fd = sd;
+	tcp->endpoint.port_fd = tcp->port_fd;
 
 	return tcp;
 }
@@ -41,7 +48,7 @@ struct ff_arch_tcp *ff_arch_tcp_create()
 	struct ff_arch_tcp *tcp;
 	int sd;
 
-	sd = socket(PF_INET, SOCK_STREAM, 0);
+	sd = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 	ff_linux_fatal_error_check(sd != -1, L"cannot create TCP socket");
 	tcp = create_tcp(sd);
 
@@ -52,9 +59,8 @@ void ff_arch_tcp_delete(struct ff_arch_tcp *tcp)
 {
 	int rv;
 
-	rv = close(tcp->sd_rd);
-	ff_assert(rv != -1);
-	rv = close(tcp->sd_wr);
+	ff_linux_completion_port_deregister_fd(tcp->port_fd);
+	rv = close(tcp->sd);
 	ff_assert(rv != -1);
 	ff_free(tcp);
 }
@@ -73,35 +79,132 @@ enum ff_result ff_arch_tcp_bind(struct ff_arch_tcp *tcp, const struct ff_arch_ne
 	{
 		int one = 1;
 
-		rv = setsockopt(tcp->sd_rd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		rv = setsockopt(tcp->sd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
 		ff_assert(rv != -1);
 	}
 
-	rv = bind(tcp->sd_rd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	rv = bind(tcp->sd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
 	if (rv != -1)
 	{
 		if (is_listening)
 		{
-			rv = listen(tcp->sd_rd, SOMAXCONN);
+			rv = listen(tcp->sd, SOMAXCONN);
 			ff_linux_fatal_error_check(rv != -1, L"error in the listen()");
 		}
 		result = FF_SUCCESS;
 	}
 	else
 	{
-		ff_log_debug(L"cannot bind the sd_rd=%d to the addr=%p. errno=%d", tcp->sd_rd, addr, errno);
+		ff_log_debug(L"cannot bind the sd=%d to the addr=%p. errno=%d", tcp->sd, addr, errno);
 	}
 
 	return result;
 }
 
+/**
+ * @private
+ * Executes the operation, which failed with EAGAIN, by the io_uring of the current scheduler,
+ * so the operation completes without additional syscalls after the socket becomes ready.
+ * Waits for the socket readiness if io_uring isn't available.
+ * Returns the result of the operation like recv(), send(), readv(), writev() and accept4() do.
+ * Returns -1 with errno=EAGAIN if the operation should be retried.
+ */
+static int execute_tcp_io(struct ff_arch_tcp *tcp, enum ff_linux_completion_port_io_type io_type, void *buf, int len, struct ff_arch_net_addr *addr)
+{
+	struct ff_linux_completion_port_io io;
+	int is_executed;
+	int is_write;
+
+	io.type = io_type;
+	io.fd = tcp->sd;
+	io.buf = buf;
+	io.len = len;
+	io.addr = (addr != NULL) ? (struct sockaddr *) &addr->addr : NULL;
+	io.addrlen = (addr != NULL) ? sizeof(addr->addr) : 0;
+	io.offset = 0;
+	is_executed = ff_linux_misc_execute_io(&io);
+	is_write = (io_type == FF_COMPLETION_PORT_IO_SEND || io_type == FF_COMPLETION_PORT_IO_WRITEV);
+	if (!is_executed)
+	{
+		ff_linux_net_wait_for_io(tcp->port_fd, is_write ? FF_LINUX_NET_IO_WRITE : FF_LINUX_NET_IO_READ);
+		errno = EAGAIN;
+		return -1;
+	}
+	if (io.result < 0)
+	{
+		if (io.result == -EAGAIN)
+		{
+			/* don't spin in the io_uring if it refuses to wait for the socket */
+			ff_linux_net_wait_for_io(tcp->port_fd, is_write ? FF_LINUX_NET_IO_WRITE : FF_LINUX_NET_IO_READ);
+		}
+		errno = -io.result;
+		return -1;
+	}
+	return io.result;
+}
+
+/**
+ * @private
+ * Waits for completion of the connection, which is in progress.
+ */
+static enum ff_result wait_for_connection(struct ff_arch_tcp *tcp, const struct ff_arch_net_addr *addr)
+{
+	for (;;)
+	{
+		struct sockaddr_storage peer_addr;
+		socklen_t addrlen;
+		int err;
+		socklen_t optlen = sizeof(err);
+		int rv;
+
+		ff_linux_net_wait_for_io(tcp->port_fd, FF_LINUX_NET_IO_WRITE);
+		rv = getsockopt(tcp->sd, SOL_SOCKET, SO_ERROR, &err, &optlen);
+		ff_assert(rv != -1);
+		ff_assert(optlen == sizeof(err));
+		if (err != 0)
+		{
+			ff_log_debug(L"error while connecting sd=%d to the addr=%p. err=%d", tcp->sd, addr, err);
+			return FF_FAILURE;
+		}
+
+		/* the wait can complete spuriously, so make sure the connection has been established */
+		addrlen = sizeof(peer_addr);
+		rv = getpeername(tcp->sd, (struct sockaddr *) &peer_addr, &addrlen);
+		if (rv != -1)
+		{
+			return FF_SUCCESS;
+		}
+		ff_assert(errno == ENOTCONN);
+	}
+}
+
 enum ff_result ff_arch_tcp_connect(struct ff_arch_tcp *tcp, const struct ff_arch_net_addr *addr)
 {
+	struct ff_linux_completion_port_io io;
+	int is_executed;
 	int rv;
 	enum ff_result result = FF_SUCCESS;
 
+	io.type = FF_COMPLETION_PORT_IO_CONNECT;
+	io.fd = tcp->sd;
+	io.buf = NULL;
+	io.len = 0;
+	io.addr = (struct sockaddr *) &addr->addr;
+	io.addrlen = sizeof(addr->addr);
+	io.offset = 0;
+	is_executed = ff_linux_misc_execute_io(&io);
+	if (is_executed && io.result != -EAGAIN && io.result != -EINTR)
+	{
+		if (io.result < 0)
+		{
+			ff_log_debug(L"cannot connect the sd=%d to the addr=%p. errno=%d", tcp->sd, addr, -io.result);
+			result = FF_FAILURE;
+		}
+		return result;
+	}
+
 again:
-	rv = connect(tcp->sd_wr, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	rv = connect(tcp->sd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
 	if (rv == -1)
 	{
 		if (errno == EINTR)
@@ -112,25 +215,11 @@ again:
 		result = FF_FAILURE;
 		if (errno == EINPROGRESS)
 		{
-			int err;
-			socklen_t optlen = sizeof(err);
-
-			ff_linux_net_wait_for_io(tcp->sd_wr, FF_LINUX_NET_IO_WRITE);
-			rv = getsockopt(tcp->sd_wr, SOL_SOCKET, SO_ERROR, &err, &optlen);
-			ff_assert(rv != -1);
-			ff_assert(optlen == sizeof(err));
-			if (err == 0)
-			{
-				result = FF_SUCCESS;
-			}
-			else
-			{
-				ff_log_debug(L"error while connecting sd_wr=%d to the addr=%p. err=%d", tcp->sd_wr, addr, err);
-			}
+			result = wait_for_connection(tcp, addr);
 		}
 		else
 		{
-			ff_log_debug(L"cannot connect the sd_wr=%d to the addr=%p. errno=%d", tcp->sd_wr, addr, errno);
+			ff_log_debug(L"cannot connect the sd=%d to the addr=%p. errno=%d", tcp->sd, addr, errno);
 		}
 	}
 
@@ -144,19 +233,18 @@ struct ff_arch_tcp *ff_arch_tcp_accept(struct ff_arch_tcp *tcp, struct ff_arch_n
 	struct ff_arch_tcp *accepted_tcp = NULL;
 
 again:
-	accepted_sd = accept(tcp->sd_rd, (struct sockaddr *) &remote_addr->addr, &addrlen);
+	accepted_sd = accept4(tcp->sd, (struct sockaddr *) &remote_addr->addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (accepted_sd == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		accepted_sd = execute_tcp_io(tcp, FF_COMPLETION_PORT_IO_ACCEPT, NULL, 0, remote_addr);
+	}
 	if (accepted_sd == -1)
 	{
-		if (errno == EINTR)
-		{
-			goto again;
-		}
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
 		{
-			ff_linux_net_wait_for_io(tcp->sd_rd, FF_LINUX_NET_IO_READ);
 			goto again;
 		}
-		ff_log_debug(L"cannot accept connection to the sd_rd=%d, remote_addr=%p. errno=%d", tcp->sd_rd, remote_addr, errno);
+		ff_log_debug(L"cannot accept connection to the sd=%d, remote_addr=%p. errno=%d", tcp->sd, remote_addr, errno);
 	}
 	else
 	{
@@ -173,19 +261,18 @@ int ff_arch_tcp_read(struct ff_arch_tcp *tcp, void *buf, int len)
 	int bytes_read_int;
 
 again:
-	bytes_read = recv(tcp->sd_rd, buf, len, 0);
+	bytes_read = recv(tcp->sd, buf, len, 0);
+	if (bytes_read == -1 && errno == EAGAIN)
+	{
+		bytes_read = execute_tcp_io(tcp, FF_COMPLETION_PORT_IO_RECV, buf, len, NULL);
+	}
 	if (bytes_read == -1)
 	{
-		if (errno == EINTR)
+		if (errno == EINTR || errno == EAGAIN)
 		{
 			goto again;
 		}
-		if (errno == EAGAIN)
-		{
-			ff_linux_net_wait_for_io(tcp->sd_rd, FF_LINUX_NET_IO_READ);
-			goto again;
-		}
-		ff_log_debug(L"cannot read from the sd_rd=%d to the buf=%p, len=%d. errno=%d", tcp->sd_rd, buf, len, errno);
+		ff_log_debug(L"cannot read from the sd=%d to the buf=%p, len=%d. errno=%d", tcp->sd, buf, len, errno);
 	}
 
 	bytes_read_int = (int) bytes_read;
@@ -198,19 +285,72 @@ int ff_arch_tcp_write(struct ff_arch_tcp *tcp, const void *buf, int len)
 	int bytes_written_int;
 
 again:
-	bytes_written = send(tcp->sd_wr, buf, len, 0);
+	bytes_written = send(tcp->sd, buf, len, 0);
+	if (bytes_written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		bytes_written = execute_tcp_io(tcp, FF_COMPLETION_PORT_IO_SEND, (void *) buf, len, NULL);
+	}
 	if (bytes_written == -1)
 	{
-		if (errno == EINTR)
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
 		{
 			goto again;
 		}
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		ff_log_debug(L"cannot write to the sd=%d from the buf=%p, len=%d. errno=%d", tcp->sd, buf, len, errno);
+	}
+
+	bytes_written_int = (int) bytes_written;
+	return bytes_written_int;
+}
+
+int ff_arch_tcp_readv(struct ff_arch_tcp *tcp, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct iovec vecs[FF_LINUX_MISC_MAX_IOVECS_CNT];
+	int vecs_cnt;
+	ssize_t bytes_read;
+	int bytes_read_int;
+
+	vecs_cnt = ff_linux_misc_convert_iovecs(vecs, iov, iov_cnt);
+again:
+	bytes_read = readv(tcp->sd, vecs, vecs_cnt);
+	if (bytes_read == -1 && errno == EAGAIN)
+	{
+		bytes_read = execute_tcp_io(tcp, FF_COMPLETION_PORT_IO_READV, vecs, vecs_cnt, NULL);
+	}
+	if (bytes_read == -1)
+	{
+		if (errno == EINTR || errno == EAGAIN)
 		{
-			ff_linux_net_wait_for_io(tcp->sd_wr, FF_LINUX_NET_IO_WRITE);
 			goto again;
 		}
-		ff_log_debug(L"cannot write to the sd_wr=%d from the buf=%p, len=%d. errno=%d", tcp->sd_wr, buf, len, errno);
+		ff_log_debug(L"cannot read from the sd=%d to the iov=%p, iov_cnt=%d. errno=%d", tcp->sd, iov, vecs_cnt, errno);
+	}
+
+	bytes_read_int = (int) bytes_read;
+	return bytes_read_int;
+}
+
+int ff_arch_tcp_writev(struct ff_arch_tcp *tcp, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct iovec vecs[FF_LINUX_MISC_MAX_IOVECS_CNT];
+	int vecs_cnt;
+	ssize_t bytes_written;
+	int bytes_written_int;
+
+	vecs_cnt = ff_linux_misc_convert_iovecs(vecs, iov, iov_cnt);
+again:
+	bytes_written = writev(tcp->sd, vecs, vecs_cnt);
+	if (bytes_written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		bytes_written = execute_tcp_io(tcp, FF_COMPLETION_PORT_IO_WRITEV, vecs, vecs_cnt, NULL);
+	}
+	if (bytes_written == -1)
+	{
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			goto again;
+		}
+		ff_log_debug(L"cannot write to the sd=%d from the iov=%p, iov_cnt=%d. errno=%d", tcp->sd, iov, vecs_cnt, errno);
 	}
 
 	bytes_written_int = (int) bytes_written;
@@ -221,13 +361,13 @@ void ff_arch_tcp_disconnect(struct ff_arch_tcp *tcp)
 {
 	int rv;
 
-	rv = shutdown(tcp->sd_rd, SHUT_RD);
+	rv = shutdown(tcp->sd, SHUT_RD);
 	if (rv != -1)
 	{
-		rv = shutdown(tcp->sd_wr, SHUT_WR);
+		rv = shutdown(tcp->sd, SHUT_WR);
 		if (rv == -1)
 		{
-			/* server socket returns ENOTCONN error when shutting down the tcp->sd_wr */
+			/* server socket returns ENOTCONN error when shutting down writing */
 			ff_assert(errno == ENOTCONN);
 		}
 	}
@@ -238,3 +378,8 @@ void ff_arch_tcp_disconnect(struct ff_arch_tcp *tcp)
 		ff_log_debug(L"the tcp=%p was already shutdowned", tcp);
 	}
 }
+
+struct ff_arch_endpoint *ff_arch_tcp_get_endpoint(struct ff_arch_tcp *tcp)
+{
+	return &tcp->endpoint;
+}
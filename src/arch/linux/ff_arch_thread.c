@@ -7,6 +7,8 @@
 #	define PTHREAD_STACK_MIN 0x10000
 #endif
 
+static __thread void *thread_locals[FF_ARCH_THREAD_LOCAL_SLOTS_CNT];
+
 struct ff_arch_thread
 {
 	pthread_t tid;
@@ -78,3 +80,17 @@ void ff_arch_thread_join(struct ff_arch_thread *thread)
 	rv = pthread_join(thread->tid, &data);
 	assert(rv == 0);
 }
+
+void *ff_arch_thread_get_local(enum ff_arch_thread_local_slot slot)
+{
+	ff_assert(slot >= 0 && slot < FF_ARCH_THREAD_LOCAL_SLOTS_CNT);
+
+	return thread_locals[slot];
+}
+
+void ff_arch_thread_set_local(enum ff_arch_thread_local_slot slot, void *value)
+{
+	ff_assert(slot >= 0 && slot < FF_ARCH_THREAD_LOCAL_SLOTS_CNT);
+
+	thread_locals[slot] = value;
+}
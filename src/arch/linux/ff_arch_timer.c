@@ -0,0 +1,105 @@
+#include "private/ff_common.h"
+
+#include "private/arch/ff_arch_timer.h"
+#include "private/ff_core.h"
+#include "private/ff_fiber.h"
+#include "ff_linux_completion_port.h"
+#include "ff_linux_error_check.h"
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+struct ff_arch_timer
+{
+	/* the timerfd registered in the completion port */
+	struct ff_linux_completion_port_fd *port_fd;
+	int fd;
+};
+
+static void set_timerfd(struct ff_arch_timer *timer, const struct itimerspec *value)
+{
+	int rv;
+
+	rv = timerfd_settime(timer->fd, TFD_TIMER_ABSTIME, value, NULL);
+	ff_linux_fatal_error_check(rv != -1, L"timerfd_settime() failed");
+}
+
+struct ff_arch_timer *ff_arch_timer_create()
+{
+	struct ff_arch_timer *timer;
+
+	timer = (struct ff_arch_timer *) ff_malloc(sizeof(*timer));
+	/* the clock must match the clock used by the ff_arch_misc_get_current_time() */
+	timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	ff_linux_fatal_error_check(timer->fd != -1, L"cannot create timerfd");
+	timer->port_fd = ff_linux_completion_port_register_fd(ff_core_get_completion_port(), timer->fd);
+
+	return timer;
+}
+
+void ff_arch_timer_delete(struct ff_arch_timer *timer)
+{
+	int rv;
+
+	ff_linux_completion_port_deregister_fd(timer->port_fd);
+	rv = close(timer->fd);
+	ff_assert(rv != -1);
+	ff_free(timer);
+}
+
+void ff_arch_timer_set(struct ff_arch_timer *timer, int64_t expiration_time)
+{
+	struct itimerspec value;
+
+	if (expiration_time <= 0)
+	{
+		/* zero it_value disarms the timer, so use the earliest possible time instead */
+		expiration_time = 1;
+	}
+	value.it_interval.tv_sec = 0;
+	value.it_interval.tv_nsec = 0;
+	value.it_value.tv_sec = (time_t) (expiration_time / 1000);
+	value.it_value.tv_nsec = (long) ((expiration_time % 1000) * 1000 * 1000);
+	set_timerfd(timer, &value);
+}
+
+void ff_arch_timer_reset(struct ff_arch_timer *timer)
+{
+	struct itimerspec value;
+
+	memset(&value, 0, sizeof(value));
+	set_timerfd(timer, &value);
+}
+
+void ff_arch_timer_wait(struct ff_arch_timer *timer)
+{
+	struct ff_fiber *current_fiber;
+	uint64_t expirations_cnt;
+	ssize_t bytes_read;
+
+	current_fiber = ff_fiber_get_current();
+	for (;;)
+	{
+		bytes_read = read(timer->fd, &expirations_cnt, sizeof(expirations_cnt));
+		if (bytes_read != -1)
+		{
+			ff_assert(bytes_read == sizeof(expirations_cnt));
+			break;
+		}
+		if (errno == EAGAIN)
+		{
+			int is_registered;
+
+			is_registered = ff_linux_completion_port_register_operation(timer->port_fd, FF_COMPLETION_PORT_OPERATION_READ, current_fiber);
+			if (is_registered)
+			{
+				ff_core_yield_fiber();
+			}
+		}
+		else
+		{
+			ff_linux_fatal_error_check(errno == EINTR, L"cannot read from timerfd");
+		}
+	}
+}
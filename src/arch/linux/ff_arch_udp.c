@@ -9,36 +9,29 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
-#include <fcntl.h>
 
 struct ff_arch_udp
 {
-	struct ff_fiber *reader_fiber;
-	struct ff_fiber *writer_fiber;
+	/* the socket registered in the completion port */
+	struct ff_linux_completion_port_fd *port_fd;
 	int is_working;
-	int sd_rd;
-	int sd_wr;
+	int sd;
 };
 
+/**
+ * @private
+ * Creates the udp from the non-blocking socket.
+ */
 static struct ff_arch_udp *create_udp(int sd)
 {
 	struct ff_arch_udp *udp;
-	int rv;
-	int sd_rd, sd_wr;
 
-	sd_rd = sd;
-	rv = fcntl(sd_rd, F_SETFL, O_NONBLOCK);
-	ff_linux_fatal_error_check(rv != -1, L"cannot set nonblocking mode for the UDP socket");
-
-	sd_wr = dup(sd_rd);
-	ff_linux_fatal_error_check(sd_wr != -1, L"cannot duplicate UDP socket");
+	ff_linux_net_setup_busy_poll(sd);
 
 	udp = (struct ff_arch_udp *) ff_malloc(sizeof(*udp));
-	udp->reader_fiber = NULL;
-	udp->writer_fiber = NULL;
+	udp->port_fd = ff_linux_net_register_socket(sd);
 	udp->is_working = 1;
-	udp->sd_rd = sd_rd;
-	udp->sd_wr = sd_wr;
+	udp->sd = sd;
 
 	return udp;
 }
@@ -47,11 +40,9 @@ static void shutdown_udp(struct ff_arch_udp *udp)
 {
 	int rv;
 
-	ff_assert(udp->is_working);
-
-	rv = close(udp->sd_rd);
-	ff_assert(rv != -1);
-	rv = close(udp->sd_wr);
+	/* deregistering completes read and write operations, which wait for the socket */
+	ff_linux_completion_port_deregister_fd(udp->port_fd);
+	rv = close(udp->sd);
 	ff_assert(rv != -1);
 }
 
@@ -60,7 +51,7 @@ struct ff_arch_udp *ff_arch_udp_create(int is_broadcast)
 	struct ff_arch_udp *udp;
 	int sd;
 
-	sd = socket(PF_INET, SOCK_DGRAM, 0);
+	sd = socket(PF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 	ff_linux_fatal_error_check(sd != -1, L"cannot create UDP socket");
 	udp = create_udp(sd);
 
@@ -70,7 +61,7 @@ struct ff_arch_udp *ff_arch_udp_create(int is_broadcast)
 		int rv;
 		
 		opt_val = 1;
-		rv = setsockopt(udp->sd_wr, SOL_SOCKET, SO_BROADCAST, &opt_val, sizeof(opt_val));
+		rv = setsockopt(udp->sd, SOL_SOCKET, SO_BROADCAST, &opt_val, sizeof(opt_val));
 		ff_assert(rv != -1);
 	}
 
@@ -79,11 +70,9 @@ struct ff_arch_udp *ff_arch_udp_create(int is_broadcast)
 
 void ff_arch_udp_delete(struct ff_arch_udp *udp)
 {
-	ff_assert(udp->reader_fiber == NULL);
-	ff_assert(udp->writer_fiber == NULL);
-
 	if (udp->is_working)
 	{
+		udp->is_working = 0;
 		shutdown_udp(udp);
 	}
 	else
@@ -104,14 +93,14 @@ enum ff_result ff_arch_udp_bind(struct ff_arch_udp *udp, const struct ff_arch_ne
 		goto end;
 	}
 
-	rv = bind(udp->sd_rd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	rv = bind(udp->sd, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
 	if (rv != -1)
 	{
 		result = FF_SUCCESS;
 	}
 	else
 	{
-		ff_log_debug(L"cannot bind sr_rd=%d to the addr=%p. errno=%d", udp->sd_rd, addr, errno);
+		ff_log_debug(L"cannot bind sd=%d to the addr=%p. errno=%d", udp->sd, addr, errno);
 	}
 
 end:
@@ -128,13 +117,12 @@ int ff_arch_udp_read(struct ff_arch_udp *udp, struct ff_arch_net_addr *peer_addr
 	current_fiber = ff_fiber_get_current();
 	ff_assert(current_fiber != NULL);
 again:
-	ff_assert(udp->reader_fiber == NULL);
 	if (!udp->is_working)
 	{
 		ff_log_debug(L"udp=%p was already shutdowned, so it cannot be used for reading to the buf=%p, len=%d, peer_addr=%p", udp, buf, len, peer_addr);
 		goto end;
 	}
-	bytes_read = recvfrom(udp->sd_rd, buf, len, 0, (struct sockaddr *) &peer_addr->addr, &addrlen);
+	bytes_read = recvfrom(udp->sd, buf, len, 0, (struct sockaddr *) &peer_addr->addr, &addrlen);
 	if (bytes_read == -1)
 	{
 		if (errno == EINTR)
@@ -143,12 +131,10 @@ again:
 		}
 		if (errno == EAGAIN)
 		{
-			udp->reader_fiber = current_fiber;
-			ff_linux_net_wait_for_io(udp->sd_rd, FF_LINUX_NET_IO_READ);
-			udp->reader_fiber = NULL;
+			ff_linux_net_wait_for_io(udp->port_fd, FF_LINUX_NET_IO_READ);
 			goto again;
 		}
-		ff_log_debug(L"error while reading from the sd_rd=%d to the buf=%p, len=%d, peer_addr=%p. errno=%d", udp->sd_rd, buf, len, peer_addr, errno);
+		ff_log_debug(L"error while reading from the sd=%d to the buf=%p, len=%d, peer_addr=%p. errno=%d", udp->sd, buf, len, peer_addr, errno);
 	}
 	else
 	{
@@ -169,13 +155,12 @@ int ff_arch_udp_write(struct ff_arch_udp *udp, const struct ff_arch_net_addr *ad
 	current_fiber = ff_fiber_get_current();
 	ff_assert(current_fiber != NULL);
 again:
-	ff_assert(udp->writer_fiber == NULL);
 	if (!udp->is_working)
 	{
 		ff_log_debug(L"udp=%p was already shutdowned, so it cannot be used for writing from the buf=%p, len=%d to the addr=%p", udp, buf, len, addr);
 		goto end;
 	}
-	bytes_written = sendto(udp->sd_wr, buf, len, 0, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
+	bytes_written = sendto(udp->sd, buf, len, 0, (struct sockaddr *) &addr->addr, sizeof(addr->addr));
 	if (bytes_written == -1)
 	{
 		if (errno == EINTR)
@@ -184,12 +169,10 @@ again:
 		}
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
 		{
-			udp->writer_fiber = current_fiber;
-			ff_linux_net_wait_for_io(udp->sd_wr, FF_LINUX_NET_IO_WRITE);
-			udp->writer_fiber = NULL;
+			ff_linux_net_wait_for_io(udp->port_fd, FF_LINUX_NET_IO_WRITE);
 			goto again;
 		}
-		ff_log_debug(L"error while writing to the sd_wr=%d from the buf=%p, len=%d to the addr=%p. errno=%d", udp->sd_wr, buf, len, addr, errno);
+		ff_log_debug(L"error while writing to the sd=%d from the buf=%p, len=%d to the addr=%p. errno=%d", udp->sd, buf, len, addr, errno);
 	}
 
 end:
@@ -201,16 +184,9 @@ void ff_arch_udp_disconnect(struct ff_arch_udp *udp)
 {
 	if (udp->is_working)
 	{
-		shutdown_udp(udp);
+		/* fibers waiting for the socket check the is_working flag after they are woken up */
 		udp->is_working = 0;
-		if (udp->reader_fiber != NULL)
-		{
-			ff_linux_net_wakeup_fiber(udp->reader_fiber);
-		}
-		if (udp->writer_fiber != NULL)
-		{
-			ff_linux_net_wakeup_fiber(udp->writer_fiber);
-		}
+		shutdown_udp(udp);
 	}
 	else
 	{
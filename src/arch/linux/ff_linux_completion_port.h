@@ -3,6 +3,8 @@
 
 #include "private/arch/ff_arch_completion_port.h"
 
+#include <sys/socket.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,7 +15,96 @@ enum ff_linux_completion_port_operation_type
 	FF_COMPLETION_PORT_OPERATION_WRITE
 };
 
-void ff_linux_completion_port_register_operation(struct ff_arch_completion_port *completion_port, int fd, enum ff_linux_completion_port_operation_type operation_type, const void *data);
+/**
+ * The fd registered in the completion port.
+ * The fd is registered once with edge-triggered notifications for both reading and writing,
+ * so waiting for the fd readiness doesn't require epoll_ctl() calls.
+ */
+struct ff_linux_completion_port_fd;
+
+/**
+ * Registers the non-blocking fd in the completion_port.
+ * The fd must be deregistered using ff_linux_completion_port_deregister_fd() before closing it.
+ */
+struct ff_linux_completion_port_fd *ff_linux_completion_port_register_fd(struct ff_arch_completion_port *completion_port, int fd);
+
+/**
+ * Deregisters the fd from the completion port. Operations, which still wait for the fd readiness,
+ * are completed, so their data is returned by ff_arch_completion_port_get().
+ * The port_fd cannot be used after this call.
+ */
+void ff_linux_completion_port_deregister_fd(struct ff_linux_completion_port_fd *port_fd);
+
+/**
+ * Registers the operation, which waits for the fd readiness after it failed with EAGAIN.
+ * The data is returned by ff_arch_completion_port_get() of the completion port, where the fd is registered,
+ * when the fd becomes ready. Like the data for ff_arch_completion_port_put(), the data must start
+ * with struct ff_arch_completion_port_entry, so ready operations are queued without memory allocations.
+ * Only one operation of each type can wait for the given fd at a time.
+ * Returns non-zero if the operation has been registered. Returns 0 if the fd became ready
+ * since the previous operation of the given type, so the operation should be retried immediately.
+ * Spurious completions are possible, so the operation must be retried after completion.
+ */
+int ff_linux_completion_port_register_operation(struct ff_linux_completion_port_fd *port_fd, enum ff_linux_completion_port_operation_type operation_type, const void *data);
+
+enum ff_linux_completion_port_io_type
+{
+	FF_COMPLETION_PORT_IO_RECV,
+	FF_COMPLETION_PORT_IO_SEND,
+	FF_COMPLETION_PORT_IO_ACCEPT,
+	FF_COMPLETION_PORT_IO_CONNECT,
+	FF_COMPLETION_PORT_IO_READ,
+	FF_COMPLETION_PORT_IO_WRITE,
+	FF_COMPLETION_PORT_IO_READV,
+	FF_COMPLETION_PORT_IO_WRITEV
+};
+
+/**
+ * The I/O operation, which is executed by the completion port without waiting for the fd readiness.
+ */
+struct ff_linux_completion_port_io
+{
+	enum ff_linux_completion_port_io_type type;
+	int fd;
+
+	/* the buffer for RECV, SEND, READ and WRITE operations.
+	 * READV and WRITEV operations use the array of len struct iovec items instead
+	 */
+	void *buf;
+	int len;
+
+	/* the peer address for ACCEPT and CONNECT operations */
+	struct sockaddr *addr;
+	socklen_t addrlen;
+
+	/* the file offset for READ, WRITE, READV and WRITEV operations or -1 for the current file position */
+	int64_t offset;
+
+	/* the data returned by ff_arch_completion_port_get() on completion of the operation.
+	 * It must start with struct ff_arch_completion_port_entry
+	 */
+	const void *data;
+
+	/* the result of the operation: the number of transferred bytes, the accepted fd
+	 * or the negated errno value on failure
+	 */
+	int result;
+};
+
+/**
+ * Submits the operation into the completion port, which uses io_uring.
+ * The completion port must belong to the current thread, since the submission is deferred
+ * until the thread waits for completions. The io must remain valid until completion.
+ * Returns 0 if the completion port doesn't support such operations, so the caller
+ * must wait for the fd readiness instead.
+ */
+int ff_linux_completion_port_submit_io(struct ff_arch_completion_port *completion_port, struct ff_linux_completion_port_io *io);
+
+/**
+ * Returns the interval in microseconds for SO_BUSY_POLL option of new sockets
+ * or 0 if sockets shouldn't busy-poll.
+ */
+int ff_linux_completion_port_get_socket_busy_poll_interval(struct ff_arch_completion_port *completion_port);
 
 #ifdef __cplusplus
 }
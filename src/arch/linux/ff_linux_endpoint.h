@@ -0,0 +1,36 @@
+#ifndef FF_LINUX_ENDPOINT_H
+#define FF_LINUX_ENDPOINT_H
+
+#include "private/arch/ff_arch_endpoint.h"
+#include "ff_linux_completion_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum ff_linux_endpoint_type
+{
+	/* the non-blocking socket registered in the completion port */
+	FF_LINUX_ENDPOINT_SOCKET,
+
+	/* the regular file, reads and writes of which can block on the disk I/O */
+	FF_LINUX_ENDPOINT_REGULAR_FILE,
+
+	/* the object, which doesn't support kernel-side transfers */
+	FF_LINUX_ENDPOINT_OTHER
+};
+
+struct ff_arch_endpoint
+{
+	enum ff_linux_endpoint_type type;
+	int fd;
+
+	/* the port_fd for waiting for the socket readiness. It is NULL for files */
+	struct ff_linux_completion_port_fd *port_fd;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
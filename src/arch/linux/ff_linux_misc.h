@@ -3,12 +3,37 @@
 
 #include "private/ff_common.h"
 
+#include "ff_linux_completion_port.h"
+
+#include <sys/uio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * the maximum number of buffers passed to the kernel by a single vectored I/O operation.
+ * Callers transfer the remaining buffers by subsequent operations
+ */
+#define FF_LINUX_MISC_MAX_IOVECS_CNT 64
+
 char *ff_linux_misc_wide_to_multibyte_string(const wchar_t *wide_str);
 
+/**
+ * Converts up to FF_LINUX_MISC_MAX_IOVECS_CNT leading buffers from the iov into the vecs,
+ * so the total length of converted buffers fits into int.
+ * Returns the number of converted buffers.
+ */
+int ff_linux_misc_convert_iovecs(struct iovec *vecs, const struct ff_iovec *iov, int iov_cnt);
+
+/**
+ * Executes the io by the completion port of the current scheduler and suspends the current fiber
+ * until the io completes. The io->data is set to the current fiber.
+ * Returns 0 if the completion port cannot execute such operations, so the caller
+ * must wait for the fd readiness instead. Otherwise the io->result contains the result of the io.
+ */
+int ff_linux_misc_execute_io(struct ff_linux_completion_port_io *io);
+
 #ifdef __cplusplus
 }
 #endif
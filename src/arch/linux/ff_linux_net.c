@@ -7,10 +7,16 @@
 #include "ff_linux_completion_port.h"
 
 #include <signal.h>
+#include <sys/socket.h>
+#include <errno.h>
+
+/* SO_BUSY_POLL is missing in headers of old glibc versions */
+#ifndef SO_BUSY_POLL
+#	define SO_BUSY_POLL 46
+#endif
 
 struct net_data
 {
-	struct ff_arch_completion_port *completion_port;
 	sighandler_t old_sigpipe_handler;
 };
 
@@ -18,7 +24,10 @@ static struct net_data net_ctx;
 
 void ff_linux_net_initialize(struct ff_arch_completion_port *completion_port)
 {
-	net_ctx.completion_port = completion_port;
+	/* I/O operations are registered in the completion port of the current scheduler,
+	 * so the given completion_port isn't used.
+	 */
+	(void)completion_port;
 
 	/* ignore SIGPIPE signals, which can occur when writing to the ff_tcp,
  	 * when remote side shutdowned reading from the tcp.
@@ -34,18 +43,43 @@ void ff_linux_net_shutdown()
 	ff_assert(sigpipe_handler == SIG_IGN);
 }
 
-void ff_linux_net_wait_for_io(int sd, enum ff_linux_net_io_type io_type)
+struct ff_linux_completion_port_fd *ff_linux_net_register_socket(int sd)
+{
+	struct ff_linux_completion_port_fd *port_fd;
+
+	port_fd = ff_linux_completion_port_register_fd(ff_core_get_completion_port(), sd);
+	return port_fd;
+}
+
+void ff_linux_net_wait_for_io(struct ff_linux_completion_port_fd *port_fd, enum ff_linux_net_io_type io_type)
 {
 	struct ff_fiber *current_fiber;
 	enum ff_linux_completion_port_operation_type operation_type;
+	int is_registered;
 
 	current_fiber = ff_fiber_get_current();
 	operation_type = (io_type == FF_LINUX_NET_IO_READ) ? FF_COMPLETION_PORT_OPERATION_READ : FF_COMPLETION_PORT_OPERATION_WRITE;
-	ff_linux_completion_port_register_operation(net_ctx.completion_port, sd, operation_type, current_fiber);
-	ff_core_yield_fiber();
+	is_registered = ff_linux_completion_port_register_operation(port_fd, operation_type, current_fiber);
+	if (is_registered)
+	{
+		ff_core_yield_fiber();
+	}
 }
 
-void ff_linux_net_wakeup_fiber(struct ff_fiber *fiber)
+void ff_linux_net_setup_busy_poll(int sd)
 {
-	ff_arch_completion_port_put(net_ctx.completion_port, fiber);
+	int interval;
+
+	interval = ff_linux_completion_port_get_socket_busy_poll_interval(ff_core_get_completion_port());
+	if (interval > 0)
+	{
+		int rv;
+
+		rv = setsockopt(sd, SOL_SOCKET, SO_BUSY_POLL, &interval, sizeof(interval));
+		if (rv == -1)
+		{
+			/* increasing SO_BUSY_POLL above the net.core.busy_read sysctl value requires CAP_NET_ADMIN */
+			ff_log_debug(L"cannot set SO_BUSY_POLL=%d on the socket sd=%d. errno=%d", interval, sd, errno);
+		}
+	}
 }
@@ -3,6 +3,7 @@
 
 #include "private/arch/ff_arch_completion_port.h"
 #include "private/ff_fiber.h"
+#include "ff_linux_completion_port.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,9 +19,23 @@ void ff_linux_net_initialize(struct ff_arch_completion_port *completion_port);
 
 void ff_linux_net_shutdown();
 
-void ff_linux_net_wait_for_io(int sd, enum ff_linux_net_io_type io_type);
-
-void ff_linux_net_wakeup_fiber(struct ff_fiber *fiber);
+/**
+ * Registers the non-blocking socket in the completion port of the current scheduler.
+ * The socket must be deregistered using ff_linux_completion_port_deregister_fd() before closing it.
+ */
+struct ff_linux_completion_port_fd *ff_linux_net_register_socket(int sd);
+
+/**
+ * Waits until the socket becomes ready for the given io_type after the operation failed with EAGAIN.
+ * The wait can complete spuriously, so the operation must be retried after the wait.
+ */
+void ff_linux_net_wait_for_io(struct ff_linux_completion_port_fd *port_fd, enum ff_linux_net_io_type io_type);
+
+/**
+ * Sets SO_BUSY_POLL option on the given socket if socket busy polling
+ * is enabled by ff_core_set_busy_poll().
+ */
+void ff_linux_net_setup_busy_poll(int sd);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,242 @@
+#include "private/ff_common.h"
+
+#include "ff_linux_uring.h"
+#include "ff_linux_error_check.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+struct ff_linux_uring
+{
+	int fd;
+
+	/* the submission queue ring shared with the kernel */
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_array;
+	unsigned int sq_mask;
+	unsigned int sq_entries;
+
+	/* the tail of filled entries, which haven't been published to the kernel yet */
+	unsigned int sqe_tail;
+
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	/* the completion queue ring. It is the same mapping as the sq_ring on kernels with IORING_FEAT_SINGLE_MMAP */
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+static int uring_setup(unsigned int entries, struct io_uring_params *params)
+{
+	int fd;
+
+	fd = (int) syscall(__NR_io_uring_setup, entries, params);
+	return fd;
+}
+
+static int uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+	int rv;
+
+	rv = (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+	return rv;
+}
+
+static void *map_ring(int fd, size_t size, off_t offset)
+{
+	void *ptr;
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+	return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+struct ff_linux_uring *ff_linux_uring_create(int entries)
+{
+	struct ff_linux_uring *uring;
+	struct io_uring_params params;
+	int fd;
+	int rv;
+
+	ff_assert(entries > 0);
+
+	memset(&params, 0, sizeof(params));
+	fd = uring_setup((unsigned int) entries, &params);
+	if (fd == -1)
+	{
+		/* io_uring can be missing in old kernels or disabled by seccomp filters or sysctl */
+		ff_log_debug(L"cannot create io_uring with entries=%d. errno=%d", entries, errno);
+		return NULL;
+	}
+	if ((params.features & IORING_FEAT_NODROP) == 0 || (params.features & IORING_FEAT_RW_CUR_POS) == 0)
+	{
+		/* the required features are available since linux 5.6 */
+		ff_log_debug(L"io_uring features=0x%x are insufficient", params.features);
+		rv = close(fd);
+		ff_assert(rv != -1);
+		return NULL;
+	}
+
+	uring = (struct ff_linux_uring *) ff_malloc(sizeof(*uring));
+	uring->fd = fd;
+	uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (uring->cq_ring_size > uring->sq_ring_size)
+		{
+			uring->sq_ring_size = uring->cq_ring_size;
+		}
+		uring->cq_ring_size = uring->sq_ring_size;
+	}
+	uring->sq_ring = map_ring(fd, uring->sq_ring_size, IORING_OFF_SQ_RING);
+	ff_linux_fatal_error_check(uring->sq_ring != NULL, L"cannot map io_uring submission queue");
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		uring->cq_ring = uring->sq_ring;
+	}
+	else
+	{
+		uring->cq_ring = map_ring(fd, uring->cq_ring_size, IORING_OFF_CQ_RING);
+		ff_linux_fatal_error_check(uring->cq_ring != NULL, L"cannot map io_uring completion queue");
+	}
+	uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	uring->sqes = (struct io_uring_sqe *) map_ring(fd, uring->sqes_size, IORING_OFF_SQES);
+	ff_linux_fatal_error_check(uring->sqes != NULL, L"cannot map io_uring submission queue entries");
+
+	uring->sq_head = (unsigned int *) ((char *) uring->sq_ring + params.sq_off.head);
+	uring->sq_tail = (unsigned int *) ((char *) uring->sq_ring + params.sq_off.tail);
+	uring->sq_array = (unsigned int *) ((char *) uring->sq_ring + params.sq_off.array);
+	uring->sq_mask = *(unsigned int *) ((char *) uring->sq_ring + params.sq_off.ring_mask);
+	uring->sq_entries = params.sq_entries;
+	uring->sqe_tail = *uring->sq_tail;
+	uring->cq_head = (unsigned int *) ((char *) uring->cq_ring + params.cq_off.head);
+	uring->cq_tail = (unsigned int *) ((char *) uring->cq_ring + params.cq_off.tail);
+	uring->cq_mask = *(unsigned int *) ((char *) uring->cq_ring + params.cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe *) ((char *) uring->cq_ring + params.cq_off.cqes);
+
+	return uring;
+}
+
+void ff_linux_uring_delete(struct ff_linux_uring *uring)
+{
+	int rv;
+
+	rv = munmap(uring->sqes, uring->sqes_size);
+	ff_assert(rv != -1);
+	if (uring->cq_ring != uring->sq_ring)
+	{
+		rv = munmap(uring->cq_ring, uring->cq_ring_size);
+		ff_assert(rv != -1);
+	}
+	rv = munmap(uring->sq_ring, uring->sq_ring_size);
+	ff_assert(rv != -1);
+	rv = close(uring->fd);
+	ff_assert(rv != -1);
+	ff_free(uring);
+}
+
+struct io_uring_sqe *ff_linux_uring_get_sqe(struct ff_linux_uring *uring)
+{
+	struct io_uring_sqe *sqe;
+	unsigned int index;
+
+	if (uring->sqe_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >= uring->sq_entries)
+	{
+		/* the submission queue is full */
+		ff_linux_uring_submit(uring);
+		if (uring->sqe_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >= uring->sq_entries)
+		{
+			/* the kernel doesn't accept new submissions until completions are reaped */
+			return NULL;
+		}
+	}
+
+	index = uring->sqe_tail & uring->sq_mask;
+	sqe = &uring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	uring->sq_array[index] = index;
+	uring->sqe_tail++;
+	return sqe;
+}
+
+int ff_linux_uring_publish(struct ff_linux_uring *uring)
+{
+	int pending_sqes_cnt;
+
+	__atomic_store_n(uring->sq_tail, uring->sqe_tail, __ATOMIC_RELEASE);
+	pending_sqes_cnt = (int) (uring->sqe_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE));
+	return pending_sqes_cnt;
+}
+
+void ff_linux_uring_submit(struct ff_linux_uring *uring)
+{
+	int pending_sqes_cnt;
+	int rv;
+
+	pending_sqes_cnt = ff_linux_uring_publish(uring);
+	while (pending_sqes_cnt > 0)
+	{
+		rv = uring_enter(uring->fd, (unsigned int) pending_sqes_cnt, 0, 0);
+		if (rv == -1)
+		{
+			/* EAGAIN and EBUSY mean that the kernel is out of resources until completions are reaped */
+			ff_linux_fatal_error_check(errno == EINTR || errno == EAGAIN || errno == EBUSY, L"io_uring_enter() failed");
+			if (errno != EINTR)
+			{
+				break;
+			}
+			continue;
+		}
+		pending_sqes_cnt -= rv;
+		if (rv == 0)
+		{
+			break;
+		}
+	}
+}
+
+void ff_linux_uring_enter(struct ff_linux_uring *uring, int sqes_cnt, int min_cqes_cnt)
+{
+	unsigned int flags;
+	int rv;
+
+	flags = (min_cqes_cnt > 0) ? IORING_ENTER_GETEVENTS : 0;
+	rv = uring_enter(uring->fd, (unsigned int) sqes_cnt, (unsigned int) min_cqes_cnt, flags);
+	if (rv == -1)
+	{
+		/* the caller re-checks completions and enters again */
+		ff_linux_fatal_error_check(errno == EINTR || errno == EAGAIN || errno == EBUSY, L"io_uring_enter() failed");
+	}
+}
+
+int ff_linux_uring_has_cqes(struct ff_linux_uring *uring)
+{
+	int has_cqes;
+
+	has_cqes = (__atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE) != __atomic_load_n(uring->cq_head, __ATOMIC_RELAXED));
+	return has_cqes;
+}
+
+int ff_linux_uring_pop_cqe(struct ff_linux_uring *uring, struct io_uring_cqe *cqe)
+{
+	unsigned int head;
+
+	head = *uring->cq_head;
+	if (head == __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE))
+	{
+		return 0;
+	}
+	*cqe = uring->cqes[head & uring->cq_mask];
+	__atomic_store_n(uring->cq_head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
@@ -0,0 +1,71 @@
+#ifndef FF_LINUX_URING_H
+#define FF_LINUX_URING_H
+
+#include "private/ff_common.h"
+
+#include <linux/io_uring.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Minimal io_uring wrapper, which uses raw syscalls.
+ * The ring isn't thread-safe, so callers must serialize access to it.
+ * However, submission and waiting for completions can be performed concurrently
+ * by different threads, since the kernel serializes them.
+ */
+struct ff_linux_uring;
+
+/**
+ * Creates the ring with the given number of submission queue entries.
+ * Returns NULL if io_uring isn't supported by the kernel or is disabled.
+ */
+struct ff_linux_uring *ff_linux_uring_create(int entries);
+
+void ff_linux_uring_delete(struct ff_linux_uring *uring);
+
+/**
+ * Returns the zeroed submission queue entry. The entry becomes visible to the kernel
+ * after the next ff_linux_uring_publish() or ff_linux_uring_submit() call.
+ * Flushes the submission queue to the kernel if it is full.
+ * Returns NULL if the queue is still full after the flush. The caller should reap completions
+ * and try again in this case.
+ */
+struct io_uring_sqe *ff_linux_uring_get_sqe(struct ff_linux_uring *uring);
+
+/**
+ * Makes filled submission queue entries visible to the kernel without submitting them.
+ * Returns the number of entries, which haven't been submitted yet.
+ */
+int ff_linux_uring_publish(struct ff_linux_uring *uring);
+
+/**
+ * Submits all filled submission queue entries without waiting for completions.
+ */
+void ff_linux_uring_submit(struct ff_linux_uring *uring);
+
+/**
+ * Submits up to sqes_cnt published entries and waits for at least min_cqes_cnt completions.
+ * This function doesn't access the ring memory, so it can be called without serialization.
+ * It can return without completions if the wait has been interrupted.
+ */
+void ff_linux_uring_enter(struct ff_linux_uring *uring, int sqes_cnt, int min_cqes_cnt);
+
+/**
+ * Returns non-zero if the completion queue isn't empty.
+ * This function can be called without serialization, so it is suitable for spinning.
+ */
+int ff_linux_uring_has_cqes(struct ff_linux_uring *uring);
+
+/**
+ * Copies the next completion queue entry into the cqe and removes it from the completion queue.
+ * Returns 0 if the completion queue is empty.
+ */
+int ff_linux_uring_pop_cqe(struct ff_linux_uring *uring, struct io_uring_cqe *cqe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#include "ff_win_stdafx.h"
+
+#include "private/arch/ff_arch_atomic.h"
+
+int ff_arch_atomic_get(int *value)
+{
+	LONG result;
+
+	result = InterlockedCompareExchange((LONG volatile *) value, 0, 0);
+	return (int) result;
+}
+
+void ff_arch_atomic_set(int *value, int new_value)
+{
+	InterlockedExchange((LONG volatile *) value, (LONG) new_value);
+}
+
+int ff_arch_atomic_exchange(int *value, int new_value)
+{
+	LONG result;
+
+	result = InterlockedExchange((LONG volatile *) value, (LONG) new_value);
+	return (int) result;
+}
+
+int ff_arch_atomic_add(int *value, int delta)
+{
+	LONG result;
+
+	result = InterlockedExchangeAdd((LONG volatile *) value, (LONG) delta);
+	return (int) result + delta;
+}
+
+int ff_arch_atomic_compare_exchange(int *value, int expected_value, int new_value)
+{
+	LONG result;
+
+	result = InterlockedCompareExchange((LONG volatile *) value, (LONG) new_value, (LONG) expected_value);
+	return (int) result;
+}
+
+void ff_arch_atomic_pause()
+{
+	YieldProcessor();
+}
@@ -4,15 +4,38 @@
 #include "ff_win_completion_port.h"
 #include "private/ff_dictionary.h"
 #include "private/ff_hash.h"
+#include "private/arch/ff_arch_misc.h"
+#include "private/arch/ff_arch_atomic.h"
 
 #define OVERLAPPED_DICTIONARY_ORDER 8
 
 #define OVERLAPPED_HASH_START_VALUE 0
 
+/**
+ * the minimum busy-poll budget in nanoseconds.
+ * The budget never drops to zero, so the completion port keeps probing
+ * whether spinning pays off again.
+ */
+#define MIN_BUSY_POLL_BUDGET 1000
+
 struct ff_arch_completion_port
 {
 	HANDLE handle;
 	struct ff_dictionary *overlapped_dictionary;
+
+	/* counters are updated with interlocked operations, because many threads can wait on the completion port */
+	LONGLONG waits_cnt;
+	LONGLONG events_cnt;
+	LONGLONG busy_poll_hits_cnt;
+	LONGLONG busy_poll_misses_cnt;
+
+	/* the maximum busy-poll time in microseconds. Busy polling is disabled if it is 0 */
+	int busy_poll_interval;
+
+	/* the current busy-poll budget in nanoseconds. It is updated without synchronization,
+	 * because it is only a hint
+	 */
+	int64_t busy_poll_budget;
 };
 
 static uint32_t dictionary_get_overlapped_hash(const void *key)
@@ -47,6 +70,12 @@ struct ff_arch_completion_port *ff_arch_completion_port_create(int concurrency)
 	completion_port->handle = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, (ULONG_PTR) NULL, concurrency);
 	ff_winapi_fatal_error_check(completion_port->handle != NULL, L"cannot create completion port");
 	completion_port->overlapped_dictionary = ff_dictionary_create(OVERLAPPED_DICTIONARY_ORDER, dictionary_get_overlapped_hash, dictionary_is_equal_overlapped);
+	completion_port->waits_cnt = 0;
+	completion_port->events_cnt = 0;
+	completion_port->busy_poll_hits_cnt = 0;
+	completion_port->busy_poll_misses_cnt = 0;
+	completion_port->busy_poll_interval = 0;
+	completion_port->busy_poll_budget = 0;
 	return completion_port;
 }
 
@@ -66,14 +95,71 @@ void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port
 	ULONG_PTR key;
 	LPOVERLAPPED overlapped;
 	BOOL rv;
+	int busy_poll_interval;
+	int64_t max_busy_poll_budget;
 	
-	rv = GetQueuedCompletionStatus(
-		completion_port->handle,
-		&bytes_transferred,
-		&key,
-		&overlapped,
-		INFINITE
-	);
+	busy_poll_interval = ff_arch_atomic_get(&completion_port->busy_poll_interval);
+	max_busy_poll_budget = ((int64_t) busy_poll_interval) * 1000;
+	rv = FALSE;
+	overlapped = NULL;
+	if (max_busy_poll_budget > 0)
+	{
+		int64_t busy_poll_budget;
+		int64_t deadline;
+		int is_spin_successful = 0;
+
+		busy_poll_budget = completion_port->busy_poll_budget;
+		if (busy_poll_budget == 0 || busy_poll_budget > max_busy_poll_budget)
+		{
+			busy_poll_budget = max_busy_poll_budget;
+		}
+		deadline = ff_arch_misc_get_precise_time() + busy_poll_budget;
+		for (;;)
+		{
+			rv = GetQueuedCompletionStatus(completion_port->handle, &bytes_transferred, &key, &overlapped, 0);
+			if (rv != FALSE || overlapped != NULL)
+			{
+				is_spin_successful = 1;
+				break;
+			}
+			if (ff_arch_misc_get_precise_time() >= deadline)
+			{
+				break;
+			}
+			ff_arch_atomic_pause();
+		}
+		/* grow the budget while spinning finds completions and shrink it otherwise */
+		busy_poll_budget = is_spin_successful ? busy_poll_budget * 2 : busy_poll_budget / 2;
+		if (busy_poll_budget > max_busy_poll_budget)
+		{
+			busy_poll_budget = max_busy_poll_budget;
+		}
+		if (busy_poll_budget < MIN_BUSY_POLL_BUDGET)
+		{
+			busy_poll_budget = MIN_BUSY_POLL_BUDGET;
+		}
+		completion_port->busy_poll_budget = busy_poll_budget;
+		if (is_spin_successful)
+		{
+			InterlockedIncrement64(&completion_port->busy_poll_hits_cnt);
+		}
+		else
+		{
+			InterlockedIncrement64(&completion_port->busy_poll_misses_cnt);
+		}
+	}
+	if (rv == FALSE && overlapped == NULL)
+	{
+		rv = GetQueuedCompletionStatus(
+			completion_port->handle,
+			&bytes_transferred,
+			&key,
+			&overlapped,
+			INFINITE
+		);
+	}
+	InterlockedIncrement64(&completion_port->waits_cnt);
+	InterlockedIncrement64(&completion_port->events_cnt);
 	if (rv == FALSE)
 	{
 		DWORD last_error;
@@ -95,6 +181,44 @@ void ff_arch_completion_port_get(struct ff_arch_completion_port *completion_port
 	}
 }
 
+int ff_arch_completion_port_get_many(struct ff_arch_completion_port *completion_port, const void **data, int max_cnt)
+{
+	int cnt;
+
+	ff_assert(max_cnt > 0);
+
+	ff_arch_completion_port_get(completion_port, &data[0]);
+	for (cnt = 1; cnt < max_cnt; cnt++)
+	{
+		DWORD bytes_transferred;
+		ULONG_PTR key;
+		LPOVERLAPPED overlapped;
+		BOOL rv;
+
+		/* collect already queued completions without blocking */
+		overlapped = NULL;
+		rv = GetQueuedCompletionStatus(completion_port->handle, &bytes_transferred, &key, &overlapped, 0);
+		if (rv == FALSE && overlapped == NULL)
+		{
+			break;
+		}
+		InterlockedIncrement64(&completion_port->events_cnt);
+		if (overlapped != NULL)
+		{
+			enum ff_result result;
+
+			result = ff_dictionary_get_entry(completion_port->overlapped_dictionary, overlapped, &data[cnt]);
+			ff_assert(result == FF_SUCCESS);
+		}
+		else
+		{
+			data[cnt] = (const void *) key;
+		}
+	}
+
+	return cnt;
+}
+
 void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port, const void *data)
 {
 	ULONG_PTR key;
@@ -105,6 +229,23 @@ void ff_arch_completion_port_put(struct ff_arch_completion_port *completion_port
 	ff_assert(result != FALSE);
 }
 
+void ff_arch_completion_port_set_busy_poll(struct ff_arch_completion_port *completion_port, int interval, int is_socket_busy_poll)
+{
+	ff_assert(interval >= 0);
+
+	/* Windows sockets don't support busy polling of network devices */
+	(void)is_socket_busy_poll;
+	ff_arch_atomic_set(&completion_port->busy_poll_interval, interval);
+}
+
+void ff_arch_completion_port_get_stats(struct ff_arch_completion_port *completion_port, struct ff_arch_completion_port_stats *stats)
+{
+	stats->waits_cnt = InterlockedCompareExchange64(&completion_port->waits_cnt, 0, 0);
+	stats->events_cnt = InterlockedCompareExchange64(&completion_port->events_cnt, 0, 0);
+	stats->busy_poll_hits_cnt = InterlockedCompareExchange64(&completion_port->busy_poll_hits_cnt, 0, 0);
+	stats->busy_poll_misses_cnt = InterlockedCompareExchange64(&completion_port->busy_poll_misses_cnt, 0, 0);
+}
+
 void ff_win_completion_port_register_overlapped_data(struct ff_arch_completion_port *completion_port, LPOVERLAPPED overlapped, const void *data)
 {
 	enum ff_result result;
@@ -0,0 +1,25 @@
+#include "ff_win_stdafx.h"
+
+#include "private/arch/ff_arch_endpoint.h"
+
+/**
+ * Windows objects don't provide endpoints, so these functions are never called
+ * with valid endpoints. TransmitFile() could be used for file-to-socket transfers,
+ * but it is limited to a single pair of object types.
+ */
+
+int ff_arch_endpoint_can_transfer(const struct ff_arch_endpoint *src, const struct ff_arch_endpoint *dst)
+{
+	(void)src;
+	(void)dst;
+	return 0;
+}
+
+enum ff_result ff_arch_endpoint_transfer(struct ff_arch_endpoint *src, struct ff_arch_endpoint *dst, int len)
+{
+	(void)src;
+	(void)dst;
+	(void)len;
+	ff_assert(0);
+	return FF_FAILURE;
+}
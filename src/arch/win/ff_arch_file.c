@@ -5,12 +5,25 @@
 #include "private/ff_fiber.h"
 #include "ff_win_completion_port.h"
 
+#include <limits.h>
+
 struct ff_arch_file
 {
 	HANDLE handle;
 	int64_t curr_pos;
 };
 
+struct ff_arch_file_map
+{
+	HANDLE mapping;
+
+	/* the start of the view, which is aligned to the allocation granularity */
+	void *base;
+
+	/* the first byte of the view at the requested offset */
+	const uint8_t *data;
+};
+
 struct threadpool_open_file_data
 {
 	const wchar_t *path;
@@ -18,6 +31,12 @@ struct threadpool_open_file_data
 	HANDLE handle;
 };
 
+struct threadpool_map_prefault_data
+{
+	const uint8_t *addr;
+	SIZE_T len;
+};
+
 struct threadpool_erase_file_data
 {
 	const wchar_t *path;
@@ -79,6 +98,23 @@ static void threadpool_open_file_func(void *ctx)
 	}
 }
 
+static void threadpool_map_prefault_func(void *ctx)
+{
+	struct threadpool_map_prefault_data *data;
+	SYSTEM_INFO system_info;
+	SIZE_T i;
+	volatile uint8_t sink;
+
+	data = (struct threadpool_map_prefault_data *) ctx;
+	GetSystemInfo(&system_info);
+	for (i = 0; i < data->len; i += system_info.dwPageSize)
+	{
+		sink = data->addr[i];
+	}
+	sink = data->addr[data->len - 1];
+	(void)sink;
+}
+
 static void threadpool_erase_file_func(void *ctx)
 {
 	struct threadpool_erase_file_data *data;
@@ -146,7 +182,6 @@ static int complete_overlapped_io(struct ff_arch_file *file, OVERLAPPED *overlap
 	if (result != FALSE)
 	{
 		int_bytes_transferred = (int) bytes_transferred;
-		file->curr_pos += int_bytes_transferred;
 	}
 	else
 	{
@@ -177,7 +212,7 @@ struct ff_arch_file *ff_arch_file_open(const wchar_t *path, enum ff_arch_file_ac
 	data.path = path;
 	data.access_mode = access_mode;
 	data.handle = INVALID_HANDLE_VALUE;
-	ff_core_threadpool_execute(threadpool_open_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_open_file_func, &data);
 	if (data.handle == INVALID_HANDLE_VALUE)
 	{
 		const char *mode;
@@ -206,7 +241,12 @@ void ff_arch_file_close(struct ff_arch_file *file)
 	ff_free(file);
 }
 
-int ff_arch_file_read(struct ff_arch_file *file, void *buf, int len)
+/**
+ * @private
+ * Reads up to len bytes from the file at the given offset into the buf.
+ * Returns the number of bytes read, 0 if the end of file is reached or -1 on error.
+ */
+static int read_at(struct ff_arch_file *file, void *buf, int len, int64_t offset)
 {
 	OVERLAPPED overlapped;
 	BOOL result;
@@ -216,8 +256,8 @@ int ff_arch_file_read(struct ff_arch_file *file, void *buf, int len)
 	ff_assert(len >= 0);
 
 	memset(&overlapped, 0, sizeof(overlapped));
-	overlapped.Offset = (DWORD) file->curr_pos;
-	overlapped.OffsetHigh = (DWORD) (file->curr_pos >> 32);
+	overlapped.Offset = (DWORD) offset;
+	overlapped.OffsetHigh = (DWORD) (offset >> 32);
 	result = ReadFile(file->handle, buf, (DWORD) len, &bytes_read, &overlapped);
 	if (result == FALSE)
 	{
@@ -249,7 +289,12 @@ end:
 	return int_bytes_read;
 }
 
-int ff_arch_file_write(struct ff_arch_file *file, const void *buf, int len)
+/**
+ * @private
+ * Writes up to len bytes from the buf into the file at the given offset.
+ * Returns the number of bytes written or -1 on error.
+ */
+static int write_at(struct ff_arch_file *file, const void *buf, int len, int64_t offset)
 {
 	OVERLAPPED overlapped;
 	BOOL result;
@@ -259,8 +304,8 @@ int ff_arch_file_write(struct ff_arch_file *file, const void *buf, int len)
 	ff_assert(len >= 0);
 
 	memset(&overlapped, 0, sizeof(overlapped));
-	overlapped.Offset = (DWORD) file->curr_pos;
-	overlapped.OffsetHigh = (DWORD) (file->curr_pos >> 32);
+	overlapped.Offset = (DWORD) offset;
+	overlapped.OffsetHigh = (DWORD) (offset >> 32);
 	result = WriteFile(file->handle, buf, (DWORD) len, &bytes_written, &overlapped);
 	if (result == FALSE)
 	{
@@ -284,13 +329,231 @@ end:
 	return int_bytes_written;
 }
 
+int ff_arch_file_read(struct ff_arch_file *file, void *buf, int len)
+{
+	int bytes_read;
+
+	bytes_read = read_at(file, buf, len, file->curr_pos);
+	if (bytes_read > 0)
+	{
+		file->curr_pos += bytes_read;
+	}
+	return bytes_read;
+}
+
+int ff_arch_file_write(struct ff_arch_file *file, const void *buf, int len)
+{
+	int bytes_written;
+
+	bytes_written = write_at(file, buf, len, file->curr_pos);
+	if (bytes_written > 0)
+	{
+		file->curr_pos += bytes_written;
+	}
+	return bytes_written;
+}
+
+int ff_arch_file_readv(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt)
+{
+	int bytes_read;
+
+	bytes_read = ff_arch_file_preadv(file, iov, iov_cnt, file->curr_pos);
+	if (bytes_read > 0)
+	{
+		file->curr_pos += bytes_read;
+	}
+	return bytes_read;
+}
+
+int ff_arch_file_writev(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt)
+{
+	int bytes_written;
+
+	bytes_written = ff_arch_file_pwritev(file, iov, iov_cnt, file->curr_pos);
+	if (bytes_written > 0)
+	{
+		file->curr_pos += bytes_written;
+	}
+	return bytes_written;
+}
+
+int ff_arch_file_preadv(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	int total_bytes_read = 0;
+	int i;
+
+	ff_assert(iov_cnt > 0);
+	ff_assert(offset >= 0);
+
+	/* overlapped I/O doesn't support scatter reads into arbitrary buffers,
+	 * so buffers are read one by one until a short read
+	 */
+	for (i = 0; i < iov_cnt; i++)
+	{
+		int bytes_read;
+
+		if (iov[i].len > INT_MAX - total_bytes_read)
+		{
+			break;
+		}
+		bytes_read = read_at(file, iov[i].buf, iov[i].len, offset + total_bytes_read);
+		if (bytes_read == -1)
+		{
+			if (total_bytes_read == 0)
+			{
+				total_bytes_read = -1;
+			}
+			break;
+		}
+		total_bytes_read += bytes_read;
+		if (bytes_read < iov[i].len)
+		{
+			break;
+		}
+	}
+
+	return total_bytes_read;
+}
+
+int ff_arch_file_pwritev(struct ff_arch_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	int total_bytes_written = 0;
+	int i;
+
+	ff_assert(iov_cnt > 0);
+	ff_assert(offset >= 0);
+
+	/* overlapped I/O doesn't support gather writes from arbitrary buffers,
+	 * so buffers are written one by one until a short write
+	 */
+	for (i = 0; i < iov_cnt; i++)
+	{
+		int bytes_written;
+
+		if (iov[i].len > INT_MAX - total_bytes_written)
+		{
+			break;
+		}
+		bytes_written = write_at(file, iov[i].buf, iov[i].len, offset + total_bytes_written);
+		if (bytes_written == -1)
+		{
+			if (total_bytes_written == 0)
+			{
+				total_bytes_written = -1;
+			}
+			break;
+		}
+		total_bytes_written += bytes_written;
+		if (bytes_written < iov[i].len)
+		{
+			break;
+		}
+	}
+
+	return total_bytes_written;
+}
+
+struct ff_arch_file_map *ff_arch_file_map_create(struct ff_arch_file *file, int64_t offset, int64_t len)
+{
+	struct ff_arch_file_map *map;
+	SYSTEM_INFO system_info;
+	HANDLE mapping;
+	int64_t aligned_offset;
+	int64_t mapped_len;
+	void *base;
+
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	/* MapViewOfFile() requires the offset aligned to the allocation granularity */
+	GetSystemInfo(&system_info);
+	aligned_offset = offset - (offset % system_info.dwAllocationGranularity);
+	mapped_len = len + (offset - aligned_offset);
+	if ((uint64_t) mapped_len > (uint64_t) ((SIZE_T) -1))
+	{
+		ff_log_debug(L"the len=%lld is too big for mapping the file=%p into memory", (long long) len, file);
+		return NULL;
+	}
+
+	mapping = CreateFileMappingW(file->handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		DWORD last_error;
+
+		last_error = GetLastError();
+		ff_log_debug(L"cannot create the mapping for the file=%p. GetLastError()=%lu", file, last_error);
+		return NULL;
+	}
+	base = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD) (aligned_offset >> 32), (DWORD) aligned_offset, (SIZE_T) mapped_len);
+	if (base == NULL)
+	{
+		DWORD last_error;
+		BOOL result;
+
+		last_error = GetLastError();
+		ff_log_debug(L"cannot map %lld bytes of the file=%p at the offset=%lld. GetLastError()=%lu", (long long) len, file, (long long) offset, last_error);
+		result = CloseHandle(mapping);
+		ff_assert(result != FALSE);
+		return NULL;
+	}
+
+	map = (struct ff_arch_file_map *) ff_malloc(sizeof(*map));
+	map->mapping = mapping;
+	map->base = base;
+	map->data = ((const uint8_t *) base) + (offset - aligned_offset);
+
+	return map;
+}
+
+void ff_arch_file_map_delete(struct ff_arch_file_map *map)
+{
+	BOOL result;
+
+	result = UnmapViewOfFile(map->base);
+	ff_assert(result != FALSE);
+	result = CloseHandle(map->mapping);
+	ff_assert(result != FALSE);
+	ff_free(map);
+}
+
+const void *ff_arch_file_map_get_data(struct ff_arch_file_map *map)
+{
+	return map->data;
+}
+
+void ff_arch_file_map_advise(struct ff_arch_file_map *map, int64_t offset, int64_t len, enum ff_arch_file_map_advice advice)
+{
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	/* there is no madvise() counterpart for file views, so only the WILLNEED advice is honored
+	 * by prefaulting pages on the threadpool
+	 */
+	if (advice == FF_ARCH_FILE_MAP_ADVICE_WILLNEED)
+	{
+		ff_arch_file_map_prefault(map, offset, len);
+	}
+}
+
+void ff_arch_file_map_prefault(struct ff_arch_file_map *map, int64_t offset, int64_t len)
+{
+	struct threadpool_map_prefault_data data;
+
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	data.addr = map->data + offset;
+	data.len = (SIZE_T) len;
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_map_prefault_func, &data);
+}
+
 enum ff_result ff_arch_file_erase(const wchar_t *path)
 {
 	struct threadpool_erase_file_data data;
 
 	data.path = path;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_erase_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_erase_file_func, &data);
 	if (data.result != FF_SUCCESS)
 	{
 		ff_log_debug(L"cannot erase the file [%ls]. See previous messages for more info", path);
@@ -306,7 +569,7 @@ enum ff_result ff_arch_file_copy(const wchar_t *src_path, const wchar_t *dst_pat
 	data.src_path = src_path;
 	data.dst_path = dst_path;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_copy_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_copy_file_func, &data);
 	if (data.result != FF_SUCCESS)
 	{
 		ff_log_debug(L"cannot copy the file [%ls] to the [%ls]. See previous messages for more info", src_path, dst_path);
@@ -322,7 +585,7 @@ enum ff_result ff_arch_file_move(const wchar_t *src_path, const wchar_t *dst_pat
 	data.src_path = src_path;
 	data.dst_path = dst_path;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_move_file_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_move_file_func, &data);
 	if (data.result != FF_SUCCESS)
 	{
 		ff_log_debug(L"cannot move the file [%ls] to the [%ls]. See previous messages for more info", src_path, dst_path);
@@ -343,3 +606,10 @@ int64_t ff_arch_file_get_size(struct ff_arch_file *file)
 	file_size = (int64_t) size.QuadPart;
 	return file_size;
 }
+
+struct ff_arch_endpoint *ff_arch_file_get_endpoint(struct ff_arch_file *file)
+{
+	/* overlapped files don't support kernel-side transfers between arbitrary objects */
+	(void)file;
+	return NULL;
+}
@@ -54,10 +54,28 @@ int64_t ff_arch_misc_get_current_time()
 {
 	int64_t current_time;
 
-	current_time = GetTickCount();
+	/* GetTickCount() wraps around after 49.7 days, so the monotonic performance counter is used */
+	current_time = ff_arch_misc_get_precise_time() / (1000 * 1000);
 	return current_time;
 }
 
+int64_t ff_arch_misc_get_precise_time()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	BOOL result;
+	int64_t precise_time;
+
+	result = QueryPerformanceCounter(&counter);
+	ff_assert(result != FALSE);
+	result = QueryPerformanceFrequency(&frequency);
+	ff_assert(result != FALSE);
+	/* split the conversion in order to avoid overflow of the intermediate result */
+	precise_time = (counter.QuadPart / frequency.QuadPart) * 1000 * 1000 * 1000;
+	precise_time += ((counter.QuadPart % frequency.QuadPart) * 1000 * 1000 * 1000) / frequency.QuadPart;
+	return precise_time;
+}
+
 void ff_arch_misc_sleep(int interval)
 {
 	Sleep(interval);
@@ -86,7 +86,7 @@ enum ff_result ff_arch_net_addr_resolve(struct ff_arch_net_addr *addr, const wch
 	data.host = host;
 	data.port = port;
 	data.result = FF_FAILURE;
-	ff_core_threadpool_execute(threadpool_addr_resolve_func, &data);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_addr_resolve_func, &data);
 	if (data.result != FF_SUCCESS)
 	{
 		ff_log_debug(L"cannot resolve the [%ls:%d] address. See previous messages for more info", host, port);
@@ -0,0 +1,62 @@
+#include "ff_win_stdafx.h"
+
+#include "private/arch/ff_arch_semaphore.h"
+
+struct ff_arch_semaphore
+{
+	HANDLE handle;
+};
+
+struct ff_arch_semaphore *ff_arch_semaphore_create(int value)
+{
+	struct ff_arch_semaphore *semaphore;
+
+	ff_assert(value >= 0);
+
+	semaphore = (struct ff_arch_semaphore *) ff_malloc(sizeof(*semaphore));
+	semaphore->handle = CreateSemaphore(NULL, (LONG) value, MAXLONG, NULL);
+	ff_winapi_fatal_error_check(semaphore->handle != NULL, L"cannot create semaphore");
+
+	return semaphore;
+}
+
+void ff_arch_semaphore_delete(struct ff_arch_semaphore *semaphore)
+{
+	BOOL result;
+
+	result = CloseHandle(semaphore->handle);
+	ff_assert(result != FALSE);
+	ff_free(semaphore);
+}
+
+void ff_arch_semaphore_up(struct ff_arch_semaphore *semaphore)
+{
+	BOOL result;
+
+	result = ReleaseSemaphore(semaphore->handle, 1, NULL);
+	ff_winapi_fatal_error_check(result != FALSE, L"cannot release semaphore");
+}
+
+void ff_arch_semaphore_down(struct ff_arch_semaphore *semaphore)
+{
+	DWORD rv;
+
+	rv = WaitForSingleObject(semaphore->handle, INFINITE);
+	ff_winapi_fatal_error_check(rv == WAIT_OBJECT_0, L"cannot wait for semaphore");
+}
+
+enum ff_result ff_arch_semaphore_down_with_timeout(struct ff_arch_semaphore *semaphore, int timeout)
+{
+	DWORD rv;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(timeout > 0);
+
+	rv = WaitForSingleObject(semaphore->handle, (DWORD) timeout);
+	ff_winapi_fatal_error_check(rv == WAIT_OBJECT_0 || rv == WAIT_TIMEOUT, L"cannot wait for semaphore");
+	if (rv == WAIT_OBJECT_0)
+	{
+		result = FF_SUCCESS;
+	}
+	return result;
+}
@@ -4,6 +4,14 @@
 #include "ff_win_net.h"
 #include "ff_win_net_addr.h"
 
+#include <limits.h>
+
+/**
+ * the maximum number of buffers passed to WSARecv() and WSASend() by a single vectored operation.
+ * Callers transfer the remaining buffers by subsequent operations
+ */
+#define MAX_WSA_BUFS_CNT 64
+
 struct ff_arch_tcp
 {
 	SOCKET handle;
@@ -205,6 +213,116 @@ end:
 	return int_bytes_written;
 }
 
+/**
+ * @private
+ * Converts up to MAX_WSA_BUFS_CNT leading buffers from the iov into the wsa_bufs,
+ * so the total length of converted buffers fits into int.
+ * Returns the number of converted buffers.
+ */
+static DWORD convert_iovecs(WSABUF *wsa_bufs, const struct ff_iovec *iov, int iov_cnt)
+{
+	DWORD wsa_bufs_cnt;
+	int total_len;
+
+	ff_assert(iov_cnt > 0);
+
+	total_len = 0;
+	for (wsa_bufs_cnt = 0; wsa_bufs_cnt < (DWORD) iov_cnt && wsa_bufs_cnt < MAX_WSA_BUFS_CNT; wsa_bufs_cnt++)
+	{
+		ff_assert(iov[wsa_bufs_cnt].len >= 0);
+		if (iov[wsa_bufs_cnt].len > INT_MAX - total_len)
+		{
+			break;
+		}
+		wsa_bufs[wsa_bufs_cnt].len = (u_long) iov[wsa_bufs_cnt].len;
+		wsa_bufs[wsa_bufs_cnt].buf = (char *) iov[wsa_bufs_cnt].buf;
+		total_len += iov[wsa_bufs_cnt].len;
+	}
+	ff_assert(wsa_bufs_cnt > 0);
+
+	return wsa_bufs_cnt;
+}
+
+int ff_arch_tcp_readv(struct ff_arch_tcp *tcp, const struct ff_iovec *iov, int iov_cnt)
+{
+	int rv;
+	WSAOVERLAPPED overlapped;
+	WSABUF wsa_bufs[MAX_WSA_BUFS_CNT];
+	DWORD wsa_bufs_cnt;
+	int int_bytes_read = -1;
+	DWORD flags = 0;
+
+	if (!tcp->is_working)
+	{
+		ff_log_debug(L"tcp=%p was disconnected, so it cannot be used for reading to the iov=%p, iov_cnt=%d", tcp, iov, iov_cnt);
+		goto end;
+	}
+
+	wsa_bufs_cnt = convert_iovecs(wsa_bufs, iov, iov_cnt);
+	memset(&overlapped, 0, sizeof(overlapped));
+	rv = WSARecv(tcp->handle, wsa_bufs, wsa_bufs_cnt, NULL, &flags, &overlapped, NULL);
+	if (rv != 0)
+	{
+		int last_error;
+
+		last_error = WSAGetLastError();
+		if (last_error != WSA_IO_PENDING)
+		{
+			ff_log_debug(L"error while reading data from the tcp=%p to the iov=%p, iov_cnt=%d. WSAGetLastError()=%d", tcp, iov, iov_cnt, last_error);
+			goto end;
+		}
+	}
+
+	int_bytes_read = ff_win_net_complete_overlapped_io(tcp->handle, &overlapped);
+	if (int_bytes_read == -1)
+	{
+		ff_log_debug(L"error while reading data from the tcp=%p to the iov=%p, iov_cnt=%d using overlapped=%p. See previous messages for more info", tcp, iov, iov_cnt, &overlapped);
+	}
+
+end:
+	return int_bytes_read;
+}
+
+int ff_arch_tcp_writev(struct ff_arch_tcp *tcp, const struct ff_iovec *iov, int iov_cnt)
+{
+	int rv;
+	WSAOVERLAPPED overlapped;
+	WSABUF wsa_bufs[MAX_WSA_BUFS_CNT];
+	DWORD wsa_bufs_cnt;
+	int int_bytes_written = -1;
+	DWORD flags = 0;
+
+	if (!tcp->is_working)
+	{
+		ff_log_debug(L"tcp=%p was disconnected, so it cannot be used for writing from the iov=%p, iov_cnt=%d", tcp, iov, iov_cnt);
+		goto end;
+	}
+
+	wsa_bufs_cnt = convert_iovecs(wsa_bufs, iov, iov_cnt);
+	memset(&overlapped, 0, sizeof(overlapped));
+	rv = WSASend(tcp->handle, wsa_bufs, wsa_bufs_cnt, NULL, flags, &overlapped, NULL);
+	if (rv != 0)
+	{
+		int last_error;
+
+		last_error = WSAGetLastError();
+		if (last_error != WSA_IO_PENDING)
+		{
+			ff_log_debug(L"error while writing data to the tcp=%p from the iov=%p, iov_cnt=%d. WSAGetLastError()=%d", tcp, iov, iov_cnt, last_error);
+			goto end;
+		}
+	}
+
+	int_bytes_written = ff_win_net_complete_overlapped_io(tcp->handle, &overlapped);
+	if (int_bytes_written == -1)
+	{
+		ff_log_debug(L"error while writing data to the tcp=%p from the iov=%p, iov_cnt=%d using overlapped=%p. See previous messages for more info", tcp, iov, iov_cnt, &overlapped);
+	}
+
+end:
+	return int_bytes_written;
+}
+
 void ff_arch_tcp_disconnect(struct ff_arch_tcp *tcp)
 {
 	if (tcp->is_working)
@@ -220,3 +338,10 @@ void ff_arch_tcp_disconnect(struct ff_arch_tcp *tcp)
 		ff_log_debug(L"the tcp=%p was already disconnected, so it won't be disconnected again", tcp);
 	}
 }
+
+struct ff_arch_endpoint *ff_arch_tcp_get_endpoint(struct ff_arch_tcp *tcp)
+{
+	/* overlapped sockets don't support kernel-side transfers between arbitrary objects */
+	(void)tcp;
+	return NULL;
+}
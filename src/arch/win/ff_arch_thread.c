@@ -4,6 +4,8 @@
 
 #include <process.h>
 
+static __declspec(thread) void *thread_locals[FF_ARCH_THREAD_LOCAL_SLOTS_CNT];
+
 struct ff_arch_thread
 {
 	HANDLE handle;
@@ -57,3 +59,17 @@ void ff_arch_thread_join(struct ff_arch_thread *thread)
 	result = WaitForSingleObject(thread->handle, INFINITE);
 	ff_assert(result == WAIT_OBJECT_0);
 }
+
+void *ff_arch_thread_get_local(enum ff_arch_thread_local_slot slot)
+{
+	ff_assert(slot >= 0 && slot < FF_ARCH_THREAD_LOCAL_SLOTS_CNT);
+
+	return thread_locals[slot];
+}
+
+void ff_arch_thread_set_local(enum ff_arch_thread_local_slot slot, void *value)
+{
+	ff_assert(slot >= 0 && slot < FF_ARCH_THREAD_LOCAL_SLOTS_CNT);
+
+	thread_locals[slot] = value;
+}
@@ -0,0 +1,77 @@
+#include "ff_win_stdafx.h"
+
+#include "private/arch/ff_arch_timer.h"
+#include "private/ff_core.h"
+#include "ff_win_error_check.h"
+
+/**
+ * The ff_arch_misc_get_current_time() uses the monotonic performance counter, so the expiration time
+ * is converted into relative due time for the waitable timer.
+ */
+struct ff_arch_timer
+{
+	HANDLE handle;
+};
+
+static void threadpool_wait_timer_func(void *ctx)
+{
+	struct ff_arch_timer *timer;
+	DWORD rv;
+
+	timer = (struct ff_arch_timer *) ctx;
+	rv = WaitForSingleObject(timer->handle, INFINITE);
+	ff_winapi_fatal_error_check(rv == WAIT_OBJECT_0, L"cannot wait for the waitable timer");
+}
+
+struct ff_arch_timer *ff_arch_timer_create()
+{
+	struct ff_arch_timer *timer;
+
+	timer = (struct ff_arch_timer *) ff_malloc(sizeof(*timer));
+	timer->handle = CreateWaitableTimer(NULL, FALSE, NULL);
+	ff_winapi_fatal_error_check(timer->handle != NULL, L"cannot create waitable timer");
+
+	return timer;
+}
+
+void ff_arch_timer_delete(struct ff_arch_timer *timer)
+{
+	BOOL result;
+
+	result = CloseHandle(timer->handle);
+	ff_assert(result != FALSE);
+	ff_free(timer);
+}
+
+void ff_arch_timer_set(struct ff_arch_timer *timer, int64_t expiration_time)
+{
+	LARGE_INTEGER due_time;
+	int64_t interval;
+	BOOL result;
+
+	interval = expiration_time - (int64_t) GetTickCount();
+	if (interval < 0)
+	{
+		interval = 0;
+	}
+	/* negative due time means relative time in 100 nanosecond intervals */
+	due_time.QuadPart = -interval * 10000;
+	result = SetWaitableTimer(timer->handle, &due_time, 0, NULL, NULL, FALSE);
+	ff_winapi_fatal_error_check(result != FALSE, L"cannot set waitable timer");
+}
+
+void ff_arch_timer_reset(struct ff_arch_timer *timer)
+{
+	BOOL result;
+
+	result = CancelWaitableTimer(timer->handle);
+	ff_winapi_fatal_error_check(result != FALSE, L"cannot cancel waitable timer");
+}
+
+void ff_arch_timer_wait(struct ff_arch_timer *timer)
+{
+	/* waitable timers cannot be associated with the I/O completion port,
+	 * so wait for the timer in the threadpool
+	 */
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_wait_timer_func, timer);
+}
@@ -3,9 +3,11 @@
 #include "private/ff_blocking_queue.h"
 #include "private/ff_queue.h"
 #include "private/ff_semaphore.h"
+#include "private/arch/ff_arch_mutex.h"
 
 struct ff_blocking_queue
 {
+	struct ff_arch_mutex *mutex;
 	struct ff_queue *simple_queue;
 	struct ff_semaphore *producer_semaphore;
 	struct ff_semaphore *consumer_semaphore;
@@ -18,6 +20,7 @@ struct ff_blocking_queue *ff_blocking_queue_create(int max_size)
 	ff_assert(max_size > 0);
 
 	queue = (struct ff_blocking_queue *) ff_malloc(sizeof(*queue));
+	queue->mutex = ff_arch_mutex_create();
 	queue->simple_queue = ff_queue_create();
 	queue->producer_semaphore = ff_semaphore_create(0);
 	queue->consumer_semaphore = ff_semaphore_create(max_size);
@@ -30,14 +33,17 @@ void ff_blocking_queue_delete(struct ff_blocking_queue *queue)
 	ff_semaphore_delete(queue->consumer_semaphore);
 	ff_semaphore_delete(queue->producer_semaphore);
 	ff_queue_delete(queue->simple_queue);
+	ff_arch_mutex_delete(queue->mutex);
 	ff_free(queue);
 }
 
 void ff_blocking_queue_get(struct ff_blocking_queue *queue, const void **data)
 {
 	ff_semaphore_down(queue->producer_semaphore);
+	ff_arch_mutex_lock(queue->mutex);
 	ff_queue_front(queue->simple_queue, data);
 	ff_queue_pop(queue->simple_queue);
+	ff_arch_mutex_unlock(queue->mutex);
 	ff_semaphore_up(queue->consumer_semaphore);
 }
 
@@ -50,8 +56,10 @@ enum ff_result ff_blocking_queue_get_with_timeout(struct ff_blocking_queue *queu
 	result = ff_semaphore_down_with_timeout(queue->producer_semaphore, timeout);
 	if (result == FF_SUCCESS)
 	{
+		ff_arch_mutex_lock(queue->mutex);
 		ff_queue_front(queue->simple_queue, data);
 		ff_queue_pop(queue->simple_queue);
+		ff_arch_mutex_unlock(queue->mutex);
 		ff_semaphore_up(queue->consumer_semaphore);
 	}
 	else
@@ -64,7 +72,9 @@ enum ff_result ff_blocking_queue_get_with_timeout(struct ff_blocking_queue *queu
 void ff_blocking_queue_put(struct ff_blocking_queue *queue, const void *data)
 {
 	ff_semaphore_down(queue->consumer_semaphore);
+	ff_arch_mutex_lock(queue->mutex);
 	ff_queue_push(queue->simple_queue, data);
+	ff_arch_mutex_unlock(queue->mutex);
 	ff_semaphore_up(queue->producer_semaphore);
 }
 
@@ -77,7 +87,9 @@ enum ff_result ff_blocking_queue_put_with_timeout(struct ff_blocking_queue *queu
 	result = ff_semaphore_down_with_timeout(queue->consumer_semaphore, timeout);
 	if (result == FF_SUCCESS)
 	{
+		ff_arch_mutex_lock(queue->mutex);
 		ff_queue_push(queue->simple_queue, data);
+		ff_arch_mutex_unlock(queue->mutex);
 		ff_semaphore_up(queue->producer_semaphore);
 	}
 	else
@@ -91,6 +103,8 @@ int ff_blocking_queue_is_empty(struct ff_blocking_queue *queue)
 {
 	int is_empty;
 
+	ff_arch_mutex_lock(queue->mutex);
 	is_empty = ff_queue_is_empty(queue->simple_queue);
+	ff_arch_mutex_unlock(queue->mutex);
 	return is_empty;
 }
@@ -3,9 +3,11 @@
 #include "private/ff_blocking_stack.h"
 #include "private/ff_stack.h"
 #include "private/ff_semaphore.h"
+#include "private/arch/ff_arch_mutex.h"
 
 struct ff_blocking_stack
 {
+	struct ff_arch_mutex *mutex;
 	struct ff_stack *simple_stack;
 	struct ff_semaphore *producer_semaphore;
 	struct ff_semaphore *consumer_semaphore;
@@ -18,6 +20,7 @@ struct ff_blocking_stack *ff_blocking_stack_create(int max_size)
 	ff_assert(max_size > 0);
 
 	stack = (struct ff_blocking_stack *) ff_malloc(sizeof(*stack));
+	stack->mutex = ff_arch_mutex_create();
 	stack->simple_stack = ff_stack_create();
 	stack->producer_semaphore = ff_semaphore_create(0);
 	stack->consumer_semaphore = ff_semaphore_create(max_size);
@@ -30,14 +33,17 @@ void ff_blocking_stack_delete(struct ff_blocking_stack *stack)
 	ff_semaphore_delete(stack->consumer_semaphore);
 	ff_semaphore_delete(stack->producer_semaphore);
 	ff_stack_delete(stack->simple_stack);
+	ff_arch_mutex_delete(stack->mutex);
 	ff_free(stack);
 }
 
 void ff_blocking_stack_pop(struct ff_blocking_stack *stack, const void **data)
 {
 	ff_semaphore_down(stack->producer_semaphore);
+	ff_arch_mutex_lock(stack->mutex);
 	ff_stack_top(stack->simple_stack, data);
 	ff_stack_pop(stack->simple_stack);
+	ff_arch_mutex_unlock(stack->mutex);
 	ff_semaphore_up(stack->consumer_semaphore);
 }
 
@@ -50,8 +56,10 @@ enum ff_result ff_blocking_stack_pop_with_timeout(struct ff_blocking_stack *stac
 	result = ff_semaphore_down_with_timeout(stack->producer_semaphore, timeout);
 	if (result == FF_SUCCESS)
 	{
+		ff_arch_mutex_lock(stack->mutex);
 		ff_stack_top(stack->simple_stack, data);
 		ff_stack_pop(stack->simple_stack);
+		ff_arch_mutex_unlock(stack->mutex);
 		ff_semaphore_up(stack->consumer_semaphore);
 	}
 	else
@@ -64,7 +72,9 @@ enum ff_result ff_blocking_stack_pop_with_timeout(struct ff_blocking_stack *stac
 void ff_blocking_stack_push(struct ff_blocking_stack *stack, const void *data)
 {
 	ff_semaphore_down(stack->consumer_semaphore);
+	ff_arch_mutex_lock(stack->mutex);
 	ff_stack_push(stack->simple_stack, data);
+	ff_arch_mutex_unlock(stack->mutex);
 	ff_semaphore_up(stack->producer_semaphore);
 }
 
@@ -77,7 +87,9 @@ enum ff_result ff_blocking_stack_push_with_timeout(struct ff_blocking_stack *sta
 	result = ff_semaphore_down_with_timeout(stack->consumer_semaphore, timeout);
 	if (result == FF_SUCCESS)
 	{
+		ff_arch_mutex_lock(stack->mutex);
 		ff_stack_push(stack->simple_stack, data);
+		ff_arch_mutex_unlock(stack->mutex);
 		ff_semaphore_up(stack->producer_semaphore);
 	}
 	else
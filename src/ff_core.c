@@ -5,12 +5,14 @@
 #include "private/ff_fiber.h"
 #include "private/ff_threadpool.h"
 #include "private/ff_fiberpool.h"
-#include "private/ff_stack.h"
-#include "private/ff_container.h"
-#include "private/ff_mutex.h"
-#include "private/ff_semaphore.h"
+#include "private/ff_future.h"
+#include "private/ff_timer_wheel.h"
 #include "private/arch/ff_arch_completion_port.h"
 #include "private/arch/ff_arch_misc.h"
+#include "private/arch/ff_arch_mutex.h"
+#include "private/arch/ff_arch_thread.h"
+#include "private/arch/ff_arch_atomic.h"
+#include "private/arch/ff_arch_timer.h"
 
 /**
  * This number must be equal to 1.
@@ -18,64 +20,182 @@
 #define COMPLETION_PORT_CONCURRENCY  1
 
 /**
- * the maximum number of threads in the threadpool.
+ * the maximum number of threads in the blocking threadpool.
  */
 #define MAX_THREADPOOL_SIZE 500
 
+#define THREADPOOLS_CNT 2
+
+/**
+ * the time in milliseconds, after which idle threadpool threads exit.
+ */
+#define DEFAULT_THREADPOOL_IDLE_TIMEOUT 10000
+
+/**
+ * the maximum number of threadpool tasks, which process chunks for a single ff_core_parallel_for() call.
+ * Data for these tasks is allocated on the stack of the calling fiber.
+ */
+#define MAX_PARALLEL_FOR_TASKS_CNT 32
+
+#define CACHE_LINE_SIZE 64
+
 /**
  * the maximum number of fibers in the fiberpool.
  */
 #define MAX_FIBERPOOL_SIZE 5000
 
 /**
- * interval in milliseconds for timeout checker fiber,
- * which executes cancellation callbacks for timed out operations.
+ * the default time in milliseconds, after which idle fibers of the fiberpool exit.
+ */
+#define DEFAULT_FIBERPOOL_IDLE_TIMEOUT 10000
+
+/**
+ * the default maximum number of completions, which an idle scheduler harvests per wait.
  */
-#define TIMEOUT_CHECKER_INTERVAL 100
+#define DEFAULT_IO_BATCH_SIZE 256
 
-struct ff_core_timeout_operation_data
+/**
+ * the value of the timer_expiration_time, when the timer isn't armed.
+ */
+#define NO_EXPIRATION_TIME ((int64_t) (((uint64_t) -1) >> 1))
+
+/**
+ * stack size for scheduler threads.
+ * Fibers have their own stacks, so scheduler threads need only small stacks
+ * for running the idle loop.
+ */
+#define SCHEDULER_THREAD_STACK_SIZE 0x10000
+
+/**
+ * the number of fibers of each priority class, which the scheduler runs during a single round
+ * of weighted round-robin. The round ends when all non-empty classes exhaust their credits,
+ * so background fibers receive at least their share of each round.
+ */
+static const int PRIORITY_WEIGHTS[FF_FIBER_PRIORITIES_CNT] =
 {
-	int64_t expiration_time;
-	struct ff_container_entry *timeout_operation_entry;
-	ff_core_cancel_timeout_func cancel_timeout_func;
+	8, /* FF_FIBER_PRIORITY_HIGH */
+	4, /* FF_FIBER_PRIORITY_NORMAL */
+	1  /* FF_FIBER_PRIORITY_LOW */
+};
+
+struct generic_threadpool_data
+{
+	struct ff_threadpool_task task;
+	struct ff_arch_completion_port *completion_port;
 	struct ff_fiber *fiber;
+	ff_core_threadpool_func func;
 	void *ctx;
-	int is_expired;
 };
 
-struct timeout_checker_data
+/**
+ * @private
+ * The range of chunk indexes, which is assigned to the parallel_for task.
+ * Chunks are claimed from the start of the range by the owner task and by tasks, which steal them.
+ * Ranges are padded, so tasks claiming chunks from distinct ranges don't contend for the same cache line.
+ */
+struct parallel_for_range
 {
-	int64_t current_time;
+	int next_chunk;
+	int end_chunk;
+	char padding[CACHE_LINE_SIZE];
 };
 
-struct threadpool_sleep_data
+struct parallel_for_task
 {
-	int interval;
+	struct ff_threadpool_task threadpool_task;
+	struct parallel_for_data *data;
+	int index;
 };
 
-struct generic_threadpool_data
+struct parallel_for_data
 {
+	struct parallel_for_range ranges[MAX_PARALLEL_FOR_TASKS_CNT];
+	struct parallel_for_task tasks[MAX_PARALLEL_FOR_TASKS_CNT];
+	struct ff_arch_completion_port *completion_port;
 	struct ff_fiber *fiber;
-	ff_core_threadpool_func func;
+	ff_core_parallel_for_func func;
 	void *ctx;
+	int begin;
+	int end;
+	int grain;
+	int tasks_cnt;
+
+	/* the number of tasks, which haven't finished yet. The last task wakes up the fiber */
+	int pending_tasks_cnt;
 };
 
 struct deferred_func_data
 {
+	struct ff_core_timeout_operation_data timeout_operation_data;
 	ff_core_fiberpool_func func;
 	void *ctx;
-	struct ff_core_timeout_operation_data *timeout_operation_data;
 };
 
-struct core_data
+/**
+ * @private
+ * The scheduler runs fibers on a single thread.
+ * Each scheduler has its own run queue and its own completion port.
+ * Schedulers without runnable fibers steal fibers from run queues of other schedulers.
+ */
+struct scheduler
 {
+	/* completion port for I/O and threadpool completions of fibers, which run on the scheduler */
 	struct ff_arch_completion_port *completion_port;
-	struct ff_stack *pending_fibers;
-	struct ff_threadpool *threadpool;
+
+	/* guards pending_fibers and pinned_fibers, because other schedulers can steal from pending_fibers */
+	struct ff_arch_mutex *pending_fibers_mutex;
+
+	/* FIFO queues of runnable fibers for each priority class. These fibers can be executed by any scheduler */
+	struct ff_fiber_list pending_fibers[FF_FIBER_PRIORITIES_CNT];
+
+	/* the number of fibers, which each priority class can run till the end of the current round */
+	int priority_credits[FF_FIBER_PRIORITIES_CNT];
+
+	/* runnable fibers, which can be executed only by this scheduler */
+	struct ff_fiber_list pinned_fibers;
+
+	/* the number of fibers in pending_fibers and pinned_fibers and its high-water mark */
+	int pending_fibers_cnt;
+	int max_pending_fibers_cnt;
+
+	/* the number of switches between fibers on the scheduler. Only the scheduler's thread updates it */
+	int64_t context_switches_cnt;
+
+	/* the buffer for completions harvested from the completion_port. Only the scheduler's thread uses it */
+	const void **completions;
+	int completions_capacity;
+
+	/* the fiber, which runs the scheduler loop when there are no runnable fibers */
+	struct ff_fiber *idle_fiber;
+
+	/* the thread, which runs the scheduler. It is NULL for the first scheduler,
+	 * which runs on the thread called ff_core_initialize_with_schedulers()
+	 */
+	struct ff_arch_thread *thread;
+
+	/* non-zero while the scheduler waits for completions on the completion_port */
+	int is_idle;
+
+	int id;
+};
+
+struct core_data
+{
+	struct scheduler *schedulers;
+	int schedulers_cnt;
+	int idle_schedulers_cnt;
+	int io_batch_size;
+	int is_shutting_down;
+	struct ff_fiber *main_fiber;
+	/* threadpools indexed by enum ff_core_threadpool_type */
+	struct ff_threadpool *threadpools[THREADPOOLS_CNT];
 	struct ff_fiberpool *fiberpool;
-	struct ff_container *timeout_operations;
-	struct ff_mutex *timeout_operations_mutex;
-	struct ff_semaphore *timeout_operations_semaphore;
+	struct ff_timer_wheel *timeout_operations;
+	struct ff_arch_mutex *timeout_operations_mutex;
+	int timeout_operations_cnt;
+	struct ff_arch_timer *timer;
+	int64_t timer_expiration_time;
+	int is_timeout_checker_stopping;
 	struct ff_fiber *timeout_checker_fiber;
 };
 
@@ -88,33 +208,419 @@ static void generic_core_threadpool_func(void *ctx)
 
 	data = (struct generic_threadpool_data *) ctx;
 	data->func(data->ctx);
-	ff_arch_completion_port_put(core_ctx.completion_port, data->fiber);
+	ff_arch_completion_port_put(data->completion_port, data->fiber);
 }
 
-static void deferred_func(void *ctx)
+/**
+ * @private
+ * Returns the index of the claimed chunk or -1 if the range is exhausted.
+ */
+static int claim_parallel_for_chunk(struct parallel_for_range *range)
 {
-	struct deferred_func_data *data;
+	int chunk;
 
-	data = (struct deferred_func_data *) ctx;
-	data->func(data->ctx);
-	ff_core_deregister_timeout_operation(data->timeout_operation_data);
-	ff_free(data);
+	/* the check prevents next_chunk from growing without bound when many tasks steal from the exhausted range */
+	if (ff_arch_atomic_get(&range->next_chunk) >= range->end_chunk)
+	{
+		return -1;
+	}
+	chunk = ff_arch_atomic_add(&range->next_chunk, 1) - 1;
+	if (chunk >= range->end_chunk)
+	{
+		return -1;
+	}
+	return chunk;
+}
+
+static void parallel_for_threadpool_func(void *ctx)
+{
+	struct parallel_for_task *task;
+	struct parallel_for_data *data;
+	int i;
+
+	task = (struct parallel_for_task *) ctx;
+	data = task->data;
+
+	/* the task processes its own range first and then steals chunks from ranges of other tasks */
+	for (i = 0; i < data->tasks_cnt; i++)
+	{
+		struct parallel_for_range *range;
+		int chunk;
+
+		range = &data->ranges[(task->index + i) % data->tasks_cnt];
+		for (;;)
+		{
+			int64_t chunk_begin;
+			int64_t chunk_end;
+
+			chunk = claim_parallel_for_chunk(range);
+			if (chunk == -1)
+			{
+				break;
+			}
+			chunk_begin = data->begin + ((int64_t) chunk) * data->grain;
+			chunk_end = chunk_begin + data->grain;
+			if (chunk_end > data->end)
+			{
+				chunk_end = data->end;
+			}
+			data->func((int) chunk_begin, (int) chunk_end, data->ctx);
+		}
+	}
+
+	/* the data lives on the stack of the fiber, so it mustn't be accessed after the fiber is woken up */
+	if (ff_arch_atomic_add(&data->pending_tasks_cnt, -1) == 0)
+	{
+		ff_arch_completion_port_put(data->completion_port, data->fiber);
+	}
+}
+
+static struct scheduler *get_current_scheduler()
+{
+	struct scheduler *scheduler;
+
+	scheduler = (struct scheduler *) ff_arch_thread_get_local(FF_ARCH_THREAD_LOCAL_SCHEDULER);
+	ff_assert(scheduler != NULL);
+	return scheduler;
+}
+
+static void push_pending_fiber(struct scheduler *scheduler, struct ff_fiber *fiber)
+{
+	ff_arch_mutex_lock(scheduler->pending_fibers_mutex);
+	if (fiber == core_ctx.main_fiber)
+	{
+		/* the main fiber must always run on the thread, which initialized the core */
+		ff_assert(scheduler->id == 0);
+		ff_fiber_list_push_back(&scheduler->pinned_fibers, fiber);
+	}
+	else
+	{
+		enum ff_fiber_priority priority;
+
+		priority = ff_fiber_get_priority(fiber);
+		ff_fiber_list_push_back(&scheduler->pending_fibers[priority], fiber);
+	}
+	scheduler->pending_fibers_cnt++;
+	if (scheduler->pending_fibers_cnt > scheduler->max_pending_fibers_cnt)
+	{
+		scheduler->max_pending_fibers_cnt = scheduler->pending_fibers_cnt;
+	}
+	ff_arch_mutex_unlock(scheduler->pending_fibers_mutex);
 }
 
-static void threadpool_sleep(void *ctx)
+/**
+ * @private
+ * Pops the fiber from run queues using weighted round-robin between priority classes.
+ * pending_fibers_mutex must be locked.
+ */
+static struct ff_fiber *pop_weighted_fiber(struct scheduler *scheduler)
 {
-	struct threadpool_sleep_data *data;
+	struct ff_fiber *fiber;
+	int pass;
+	int priority;
 
-	data = (struct threadpool_sleep_data *) ctx;
-	ff_arch_misc_sleep(data->interval);
+	for (pass = 0; pass < 2; pass++)
+	{
+		for (priority = 0; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+		{
+			if (scheduler->priority_credits[priority] > 0)
+			{
+				fiber = ff_fiber_list_pop_front(&scheduler->pending_fibers[priority]);
+				if (fiber != NULL)
+				{
+					scheduler->priority_credits[priority]--;
+					return fiber;
+				}
+			}
+		}
+
+		/* all non-empty classes have exhausted their credits. Start the next round */
+		for (priority = 0; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+		{
+			scheduler->priority_credits[priority] = PRIORITY_WEIGHTS[priority];
+		}
+	}
+
+	return NULL;
 }
 
-static void internal_sleep(int interval)
+static struct ff_fiber *pop_pending_fiber(struct scheduler *scheduler, int is_steal)
 {
-	struct threadpool_sleep_data data;
+	struct ff_fiber *fiber = NULL;
 
-	data.interval = interval;
-	ff_core_threadpool_execute(threadpool_sleep, &data);
+	ff_arch_mutex_lock(scheduler->pending_fibers_mutex);
+	if (!is_steal)
+	{
+		fiber = ff_fiber_list_pop_front(&scheduler->pinned_fibers);
+	}
+	if (fiber == NULL)
+	{
+		fiber = pop_weighted_fiber(scheduler);
+	}
+	if (fiber != NULL)
+	{
+		scheduler->pending_fibers_cnt--;
+		ff_assert(scheduler->pending_fibers_cnt >= 0);
+	}
+	ff_arch_mutex_unlock(scheduler->pending_fibers_mutex);
+
+	return fiber;
+}
+
+static struct ff_fiber *steal_pending_fiber(struct scheduler *scheduler)
+{
+	struct ff_fiber *fiber = NULL;
+	int schedulers_cnt;
+	int i;
+
+	schedulers_cnt = core_ctx.schedulers_cnt;
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler *victim;
+
+		victim = &core_ctx.schedulers[(scheduler->id + i) % schedulers_cnt];
+		fiber = pop_pending_fiber(victim, 1);
+		if (fiber != NULL)
+		{
+			break;
+		}
+	}
+
+	return fiber;
+}
+
+static struct ff_fiber *find_pending_fiber(struct scheduler *scheduler)
+{
+	struct ff_fiber *fiber;
+
+	fiber = pop_pending_fiber(scheduler, 0);
+	if (fiber == NULL)
+	{
+		fiber = steal_pending_fiber(scheduler);
+	}
+
+	return fiber;
+}
+
+static void wakeup_scheduler(struct scheduler *scheduler)
+{
+	int is_idle;
+
+	is_idle = ff_arch_atomic_exchange(&scheduler->is_idle, 0);
+	if (is_idle)
+	{
+		ff_arch_atomic_add(&core_ctx.idle_schedulers_cnt, -1);
+		ff_arch_completion_port_put(scheduler->completion_port, NULL);
+	}
+}
+
+/**
+ * @private
+ * Wakes up an idle scheduler, so it can steal the fiber,
+ * which has been just added to the run queue of the given busy scheduler.
+ */
+static void wakeup_idle_scheduler(struct scheduler *busy_scheduler)
+{
+	int idle_schedulers_cnt;
+	int schedulers_cnt;
+	int i;
+
+	idle_schedulers_cnt = ff_arch_atomic_get(&core_ctx.idle_schedulers_cnt);
+	if (idle_schedulers_cnt > 0)
+	{
+		schedulers_cnt = core_ctx.schedulers_cnt;
+		for (i = 1; i < schedulers_cnt; i++)
+		{
+			struct scheduler *scheduler;
+			int is_idle;
+
+			scheduler = &core_ctx.schedulers[(busy_scheduler->id + i) % schedulers_cnt];
+			is_idle = ff_arch_atomic_get(&scheduler->is_idle);
+			if (is_idle)
+			{
+				wakeup_scheduler(scheduler);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @private
+ * Waits for completions on the scheduler's completion port and harvests up to io_batch_size
+ * of them at once. Returns the first completed fiber or NULL if only wakeup requests were received.
+ * The remaining completed fibers are pushed into the run queue, so idle schedulers can steal them.
+ */
+static struct ff_fiber *get_completed_fiber(struct scheduler *scheduler)
+{
+	struct ff_fiber *fiber = NULL;
+	int io_batch_size;
+	int completions_cnt;
+	int pushed_fibers_cnt = 0;
+	int i;
+
+	io_batch_size = ff_arch_atomic_get(&core_ctx.io_batch_size);
+	if (io_batch_size != scheduler->completions_capacity)
+	{
+		ff_free(scheduler->completions);
+		scheduler->completions = (const void **) ff_calloc(io_batch_size, sizeof(scheduler->completions[0]));
+		scheduler->completions_capacity = io_batch_size;
+	}
+
+	completions_cnt = ff_arch_completion_port_get_many(scheduler->completion_port, scheduler->completions, io_batch_size);
+	ff_assert(completions_cnt > 0);
+	for (i = 0; i < completions_cnt; i++)
+	{
+		struct ff_fiber *completed_fiber;
+
+		completed_fiber = (struct ff_fiber *) scheduler->completions[i];
+		if (completed_fiber == NULL)
+		{
+			/* wakeup request */
+			continue;
+		}
+		if (completed_fiber == core_ctx.main_fiber && scheduler->id != 0)
+		{
+			/* the fd, which the main fiber waited for, is registered in the completion port
+			 * of another scheduler. The main fiber must run on the first scheduler
+			 */
+			ff_core_schedule_fiber(completed_fiber);
+			continue;
+		}
+		if (fiber == NULL)
+		{
+			fiber = completed_fiber;
+		}
+		else
+		{
+			push_pending_fiber(scheduler, completed_fiber);
+			pushed_fibers_cnt++;
+		}
+	}
+	if (pushed_fibers_cnt > 0)
+	{
+		wakeup_idle_scheduler(scheduler);
+	}
+
+	return fiber;
+}
+
+/**
+ * @private
+ * The scheduler loop. It runs pending fibers, steals fibers from other schedulers
+ * and waits for completions on the completion port when there is nothing to run.
+ * Only loops of additional schedulers exit on core shutdown.
+ */
+static void run_scheduler_loop(struct scheduler *scheduler)
+{
+	for (;;)
+	{
+		struct ff_fiber *fiber;
+
+		fiber = find_pending_fiber(scheduler);
+		if (fiber == NULL)
+		{
+			int is_shutting_down;
+			int is_idle;
+
+			is_shutting_down = ff_arch_atomic_get(&core_ctx.is_shutting_down);
+			if (is_shutting_down && scheduler->id != 0)
+			{
+				break;
+			}
+
+			ff_arch_atomic_set(&scheduler->is_idle, 1);
+			ff_arch_atomic_add(&core_ctx.idle_schedulers_cnt, 1);
+			/* re-check run queues in order to avoid lost wakeups */
+			fiber = find_pending_fiber(scheduler);
+			if (fiber == NULL)
+			{
+				fiber = get_completed_fiber(scheduler);
+			}
+			is_idle = ff_arch_atomic_exchange(&scheduler->is_idle, 0);
+			if (is_idle)
+			{
+				ff_arch_atomic_add(&core_ctx.idle_schedulers_cnt, -1);
+			}
+			if (fiber == NULL)
+			{
+				/* wakeup request */
+				continue;
+			}
+		}
+		scheduler->context_switches_cnt++;
+		ff_fiber_switch(fiber);
+	}
+}
+
+static void idle_fiber_func(void *ctx)
+{
+	struct scheduler *scheduler;
+
+	(void)ctx;
+	scheduler = get_current_scheduler();
+	run_scheduler_loop(scheduler);
+	ff_assert(0);
+}
+
+static void scheduler_thread_func(void *ctx)
+{
+	struct scheduler *scheduler;
+
+	scheduler = (struct scheduler *) ctx;
+	ff_fiber_initialize();
+	ff_arch_thread_set_local(FF_ARCH_THREAD_LOCAL_SCHEDULER, scheduler);
+	scheduler->idle_fiber = ff_fiber_get_current();
+	run_scheduler_loop(scheduler);
+	ff_arch_thread_set_local(FF_ARCH_THREAD_LOCAL_SCHEDULER, NULL);
+	ff_fiber_shutdown();
+}
+
+static void initialize_scheduler(struct scheduler *scheduler, int id)
+{
+	int priority;
+
+	scheduler->completion_port = ff_arch_completion_port_create(COMPLETION_PORT_CONCURRENCY);
+	scheduler->pending_fibers_mutex = ff_arch_mutex_create();
+	for (priority = 0; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+	{
+		ff_fiber_list_initialize(&scheduler->pending_fibers[priority]);
+		scheduler->priority_credits[priority] = PRIORITY_WEIGHTS[priority];
+	}
+	ff_fiber_list_initialize(&scheduler->pinned_fibers);
+	scheduler->pending_fibers_cnt = 0;
+	scheduler->max_pending_fibers_cnt = 0;
+	scheduler->context_switches_cnt = 0;
+	scheduler->completions_capacity = DEFAULT_IO_BATCH_SIZE;
+	scheduler->completions = (const void **) ff_calloc(scheduler->completions_capacity, sizeof(scheduler->completions[0]));
+	scheduler->idle_fiber = NULL;
+	scheduler->thread = NULL;
+	scheduler->is_idle = 0;
+	scheduler->id = id;
+}
+
+static void shutdown_scheduler(struct scheduler *scheduler)
+{
+	int priority;
+
+	ff_assert(ff_fiber_list_is_empty(&scheduler->pinned_fibers));
+	for (priority = 0; priority < FF_FIBER_PRIORITIES_CNT; priority++)
+	{
+		ff_assert(ff_fiber_list_is_empty(&scheduler->pending_fibers[priority]));
+	}
+	ff_free(scheduler->completions);
+	ff_arch_mutex_delete(scheduler->pending_fibers_mutex);
+	ff_arch_completion_port_delete(scheduler->completion_port);
+}
+
+static void deferred_func(void *ctx)
+{
+	struct deferred_func_data *data;
+
+	data = (struct deferred_func_data *) ctx;
+	data->func(data->ctx);
+	ff_core_deregister_timeout_operation(&data->timeout_operation_data);
+	ff_free(data);
 }
 
 static void sleep_timeout_func(struct ff_fiber *fiber, void *ctx)
@@ -129,24 +635,42 @@ static void deferred_timeout_func(struct ff_fiber *fiber, void *ctx)
 	ff_core_fiberpool_execute_async(deferred_func, ctx);
 }
 
-static void timeout_operations_visitor_func(const void *data, void *ctx)
+static void expire_timeout_operation(struct ff_timer_wheel_node *node, void *ctx)
 {
 	struct ff_core_timeout_operation_data *timeout_operation_data;
-	struct timeout_checker_data *timeout_checker_data;
 
-	timeout_operation_data = (struct ff_core_timeout_operation_data *) data;
-	timeout_checker_data = (struct timeout_checker_data *) ctx;
-	if (!timeout_operation_data->is_expired)
+	(void)ctx;
+	timeout_operation_data = (struct ff_core_timeout_operation_data *) node;
+	ff_assert(!timeout_operation_data->is_expired);
+	timeout_operation_data->is_expired = 1;
+	timeout_operation_data->cancel_timeout_func(timeout_operation_data->fiber, timeout_operation_data->ctx);
+}
+
+/**
+ * @private
+ * Arms the timer for the earliest timeout operation.
+ * timeout_operations_mutex must be locked.
+ */
+static void update_timer()
+{
+	int is_empty;
+	int64_t expiration_time;
+
+	is_empty = ff_timer_wheel_is_empty(core_ctx.timeout_operations);
+	if (is_empty)
 	{
-		if (timeout_checker_data->current_time > timeout_operation_data->expiration_time)
+		/* don't wake up when there are no pending timeout operations */
+		if (core_ctx.timer_expiration_time != NO_EXPIRATION_TIME)
 		{
-			timeout_operation_data->cancel_timeout_func(timeout_operation_data->fiber, timeout_operation_data->ctx);
-			timeout_operation_data->is_expired = 1;
+			ff_arch_timer_reset(core_ctx.timer);
+			core_ctx.timer_expiration_time = NO_EXPIRATION_TIME;
 		}
 	}
 	else
 	{
-		ff_log_debug(L"timeout operation already expired. timeout_operation_data=%p, timeout_checker_data=%p", timeout_operation_data, timeout_checker_data);
+		expiration_time = ff_timer_wheel_get_next_expiration_time(core_ctx.timeout_operations);
+		ff_arch_timer_set(core_ctx.timer, expiration_time);
+		core_ctx.timer_expiration_time = expiration_time;
 	}
 }
 
@@ -155,81 +679,330 @@ static void timeout_checker_func(void *ctx)
 	(void)ctx;
 	for (;;)
 	{
-		struct timeout_checker_data timeout_checker_data;
-		int is_empty;
+		int64_t current_time;
+		int is_stopping;
 
-		ff_semaphore_down(core_ctx.timeout_operations_semaphore);
-		is_empty = ff_container_is_empty(core_ctx.timeout_operations);
-		if (is_empty)
+		current_time = ff_arch_misc_get_current_time();
+		ff_arch_mutex_lock(core_ctx.timeout_operations_mutex);
+		ff_timer_wheel_expire(core_ctx.timeout_operations, current_time, expire_timeout_operation, NULL);
+		/* the timeout checker stops only after all timeout operations have been deregistered */
+		is_stopping = core_ctx.is_timeout_checker_stopping && core_ctx.timeout_operations_cnt == 0;
+		if (!is_stopping)
+		{
+			update_timer();
+		}
+		ff_arch_mutex_unlock(core_ctx.timeout_operations_mutex);
+		if (is_stopping)
 		{
 			break;
 		}
-		timeout_checker_data.current_time = ff_arch_misc_get_current_time();
-		ff_mutex_lock(core_ctx.timeout_operations_mutex);
-		ff_container_for_each(core_ctx.timeout_operations, timeout_operations_visitor_func, &timeout_checker_data);
-		ff_mutex_unlock(core_ctx.timeout_operations_mutex);
-		ff_semaphore_up(core_ctx.timeout_operations_semaphore);
 
-		internal_sleep(TIMEOUT_CHECKER_INTERVAL);
+		ff_arch_timer_wait(core_ctx.timer);
 	}
 }
 
 void ff_core_initialize(const wchar_t *log_filename)
 {
+	ff_core_initialize_with_schedulers(log_filename, 1);
+}
+
+void ff_core_initialize_with_schedulers(const wchar_t *log_filename, int schedulers_cnt)
+{
+	struct scheduler *main_scheduler;
+	int i;
+
 	ff_assert(!is_core_initialized);
+	ff_assert(schedulers_cnt >= 0);
+
 	ff_log_initialize(log_filename);
+	if (schedulers_cnt == 0)
+	{
+		schedulers_cnt = ff_arch_misc_get_cpus_cnt();
+		ff_assert(schedulers_cnt > 0);
+	}
 	ff_fiber_initialize();
-	core_ctx.completion_port = ff_arch_completion_port_create(COMPLETION_PORT_CONCURRENCY);
-	ff_arch_misc_initialize(core_ctx.completion_port);
-	core_ctx.pending_fibers = ff_stack_create();
-	core_ctx.threadpool = ff_threadpool_create(MAX_THREADPOOL_SIZE);
-	core_ctx.fiberpool = ff_fiberpool_create(MAX_FIBERPOOL_SIZE);
-	core_ctx.timeout_operations = ff_container_create();
-	core_ctx.timeout_operations_mutex = ff_mutex_create();
-	core_ctx.timeout_operations_semaphore = ff_semaphore_create(0);
+	core_ctx.schedulers = (struct scheduler *) ff_calloc(schedulers_cnt, sizeof(core_ctx.schedulers[0]));
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		initialize_scheduler(&core_ctx.schedulers[i], i);
+	}
+	core_ctx.schedulers_cnt = schedulers_cnt;
+	core_ctx.idle_schedulers_cnt = 0;
+	core_ctx.io_batch_size = DEFAULT_IO_BATCH_SIZE;
+	core_ctx.is_shutting_down = 0;
+	core_ctx.main_fiber = ff_fiber_get_current();
+
+	main_scheduler = &core_ctx.schedulers[0];
+	main_scheduler->idle_fiber = ff_fiber_create(idle_fiber_func, 0);
+	ff_arch_thread_set_local(FF_ARCH_THREAD_LOCAL_SCHEDULER, main_scheduler);
+	ff_arch_misc_initialize(main_scheduler->completion_port);
+
+	core_ctx.threadpools[FF_CORE_THREADPOOL_BLOCKING] = ff_threadpool_create(MAX_THREADPOOL_SIZE, DEFAULT_THREADPOOL_IDLE_TIMEOUT);
+	core_ctx.threadpools[FF_CORE_THREADPOOL_COMPUTE] = ff_threadpool_create(ff_arch_misc_get_cpus_cnt(), DEFAULT_THREADPOOL_IDLE_TIMEOUT);
+	core_ctx.fiberpool = ff_fiberpool_create(MAX_FIBERPOOL_SIZE, DEFAULT_FIBERPOOL_IDLE_TIMEOUT);
+	ff_future_initialize();
+	core_ctx.timeout_operations = ff_timer_wheel_create(ff_arch_misc_get_current_time());
+	core_ctx.timeout_operations_mutex = ff_arch_mutex_create();
+	core_ctx.timeout_operations_cnt = 0;
+	core_ctx.timer = ff_arch_timer_create();
+	core_ctx.timer_expiration_time = NO_EXPIRATION_TIME;
+	core_ctx.is_timeout_checker_stopping = 0;
 	core_ctx.timeout_checker_fiber = ff_fiber_create(timeout_checker_func, 0);
 	ff_fiber_start(core_ctx.timeout_checker_fiber, NULL);
+
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler *scheduler;
+
+		scheduler = &core_ctx.schedulers[i];
+		scheduler->thread = ff_arch_thread_create(scheduler_thread_func, SCHEDULER_THREAD_STACK_SIZE);
+		ff_arch_thread_start(scheduler->thread, scheduler);
+	}
 	is_core_initialized = 1;
 }
 
 void ff_core_shutdown()
 {
+	struct scheduler *main_scheduler;
+	int schedulers_cnt;
+	int i;
+
 	ff_assert(is_core_initialized);
-	ff_semaphore_up(core_ctx.timeout_operations_semaphore);
+	ff_assert(ff_fiber_get_current() == core_ctx.main_fiber);
+
+	/* idle fibers of the fiberpool wait with timeout operations, which would delay the timeout checker's stop.
+	 * The fiberpool must keep working until the timeout checker stops, since deferred funcs are executed in it
+	 */
+	ff_fiberpool_set_idle_timeout(core_ctx.fiberpool, 0);
+	ff_arch_mutex_lock(core_ctx.timeout_operations_mutex);
+	core_ctx.is_timeout_checker_stopping = 1;
+	ff_arch_timer_set(core_ctx.timer, 0);
+	core_ctx.timer_expiration_time = 0;
+	ff_arch_mutex_unlock(core_ctx.timeout_operations_mutex);
 	ff_fiber_join(core_ctx.timeout_checker_fiber);
 	ff_fiber_delete(core_ctx.timeout_checker_fiber);
-	ff_semaphore_delete(core_ctx.timeout_operations_semaphore);
-	ff_mutex_delete(core_ctx.timeout_operations_mutex);
-	ff_container_delete(core_ctx.timeout_operations);
+	ff_arch_timer_delete(core_ctx.timer);
+	ff_assert(core_ctx.timeout_operations_cnt == 0);
+	ff_arch_mutex_delete(core_ctx.timeout_operations_mutex);
+	ff_timer_wheel_delete(core_ctx.timeout_operations);
 	ff_fiberpool_delete(core_ctx.fiberpool);
-	ff_threadpool_delete(core_ctx.threadpool);
-	ff_stack_delete(core_ctx.pending_fibers);
+	ff_future_shutdown();
+
+	schedulers_cnt = core_ctx.schedulers_cnt;
+	ff_arch_atomic_set(&core_ctx.is_shutting_down, 1);
+	for (i = 1; i < schedulers_cnt; i++)
+	{
+		struct scheduler *scheduler;
+
+		scheduler = &core_ctx.schedulers[i];
+		ff_arch_completion_port_put(scheduler->completion_port, NULL);
+		ff_arch_thread_join(scheduler->thread);
+		ff_arch_thread_delete(scheduler->thread);
+	}
+
+	for (i = 0; i < THREADPOOLS_CNT; i++)
+	{
+		ff_threadpool_delete(core_ctx.threadpools[i]);
+	}
 	ff_arch_misc_shutdown();
-	ff_arch_completion_port_delete(core_ctx.completion_port);
+	main_scheduler = &core_ctx.schedulers[0];
+	ff_fiber_delete(main_scheduler->idle_fiber);
+	ff_arch_thread_set_local(FF_ARCH_THREAD_LOCAL_SCHEDULER, NULL);
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		shutdown_scheduler(&core_ctx.schedulers[i]);
+	}
+	ff_free(core_ctx.schedulers);
 	ff_fiber_shutdown();
 	ff_log_shutdown();
 	is_core_initialized = 0;
 }
 
+void ff_core_set_busy_poll(int interval, int is_socket_busy_poll)
+{
+	int schedulers_cnt;
+	int i;
+
+	ff_assert(is_core_initialized);
+	ff_assert(interval >= 0);
+
+	schedulers_cnt = core_ctx.schedulers_cnt;
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		struct scheduler *scheduler;
+
+		scheduler = &core_ctx.schedulers[i];
+		ff_arch_completion_port_set_busy_poll(scheduler->completion_port, interval, is_socket_busy_poll);
+	}
+}
+
+void ff_core_set_io_batch_size(int batch_size)
+{
+	ff_assert(is_core_initialized);
+	ff_assert(batch_size > 0);
+
+	ff_arch_atomic_set(&core_ctx.io_batch_size, batch_size);
+}
+
+void ff_core_set_threadpool_idle_timeout(int idle_timeout)
+{
+	int i;
+
+	ff_assert(is_core_initialized);
+	ff_assert(idle_timeout > 0);
+
+	for (i = 0; i < THREADPOOLS_CNT; i++)
+	{
+		ff_threadpool_set_idle_timeout(core_ctx.threadpools[i], idle_timeout);
+	}
+}
+
+void ff_core_set_fiberpool_idle_timeout(int idle_timeout)
+{
+	ff_assert(is_core_initialized);
+	ff_assert(idle_timeout > 0);
+
+	ff_fiberpool_set_idle_timeout(core_ctx.fiberpool, idle_timeout);
+}
+
+void ff_core_get_stats(struct ff_core_stats *stats)
+{
+	struct ff_threadpool_stats threadpool_stats;
+	int schedulers_cnt;
+	int i;
+
+	ff_assert(is_core_initialized);
+
+	memset(stats, 0, sizeof(*stats));
+	schedulers_cnt = core_ctx.schedulers_cnt;
+	for (i = 0; i < schedulers_cnt; i++)
+	{
+		struct scheduler *scheduler;
+		struct ff_arch_completion_port_stats completion_port_stats;
+
+		scheduler = &core_ctx.schedulers[i];
+		/* the counter is updated without locks by the scheduler's thread,
+		 * so the value may be slightly outdated
+		 */
+		stats->context_switches_cnt += scheduler->context_switches_cnt;
+		ff_arch_mutex_lock(scheduler->pending_fibers_mutex);
+		if (scheduler->max_pending_fibers_cnt > stats->max_run_queue_depth)
+		{
+			stats->max_run_queue_depth = scheduler->max_pending_fibers_cnt;
+		}
+		ff_arch_mutex_unlock(scheduler->pending_fibers_mutex);
+		ff_arch_completion_port_get_stats(scheduler->completion_port, &completion_port_stats);
+		stats->completion_port_waits_cnt += completion_port_stats.waits_cnt;
+		stats->completion_port_events_cnt += completion_port_stats.events_cnt;
+		stats->busy_poll_hits_cnt += completion_port_stats.busy_poll_hits_cnt;
+		stats->busy_poll_misses_cnt += completion_port_stats.busy_poll_misses_cnt;
+	}
+
+	for (i = 0; i < THREADPOOLS_CNT; i++)
+	{
+		ff_threadpool_get_stats(core_ctx.threadpools[i], &threadpool_stats);
+		stats->threadpool_tasks_cnt += threadpool_stats.tasks_cnt;
+		stats->threadpool_total_queue_latency += threadpool_stats.total_queue_latency;
+		if (threadpool_stats.max_queue_latency > stats->threadpool_max_queue_latency)
+		{
+			stats->threadpool_max_queue_latency = threadpool_stats.max_queue_latency;
+		}
+		if (i == FF_CORE_THREADPOOL_BLOCKING)
+		{
+			stats->blocking_threadpool_threads_cnt = threadpool_stats.threads_cnt;
+		}
+		else
+		{
+			stats->compute_threadpool_threads_cnt = threadpool_stats.threads_cnt;
+		}
+	}
+	stats->fiberpool_fibers_cnt = ff_fiberpool_get_fibers_cnt(core_ctx.fiberpool);
+}
+
+int ff_core_get_schedulers_cnt()
+{
+	ff_assert(is_core_initialized);
+	return core_ctx.schedulers_cnt;
+}
+
 void ff_core_sleep(int interval)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_core_timeout_operation_data timeout_operation_data;
 
 	ff_assert(interval > 0);
 
-	timeout_operation_data = ff_core_register_timeout_operation(interval, sleep_timeout_func, NULL);
+	ff_core_register_timeout_operation(&timeout_operation_data, interval, sleep_timeout_func, NULL);
 	ff_core_yield_fiber();
-	ff_core_deregister_timeout_operation(timeout_operation_data);
+	ff_core_deregister_timeout_operation(&timeout_operation_data);
 }
 
-void ff_core_threadpool_execute(ff_core_threadpool_func func, void *ctx)
+void ff_core_threadpool_execute(enum ff_core_threadpool_type threadpool_type, ff_core_threadpool_func func, void *ctx)
 {
 	struct generic_threadpool_data data;
+	struct scheduler *scheduler;
+
+	ff_assert(threadpool_type == FF_CORE_THREADPOOL_BLOCKING || threadpool_type == FF_CORE_THREADPOOL_COMPUTE);
+
+	scheduler = get_current_scheduler();
+	data.completion_port = scheduler->completion_port;
+	data.fiber = ff_fiber_get_current();
+	data.func = func;
+	data.ctx = ctx;
+	ff_threadpool_execute_async(core_ctx.threadpools[threadpool_type], &data.task, generic_core_threadpool_func, &data);
+	ff_core_yield_fiber();
+}
+
+void ff_core_parallel_for(int begin, int end, int grain, ff_core_parallel_for_func func, void *ctx)
+{
+	struct parallel_for_data data;
+	struct scheduler *scheduler;
+	struct ff_threadpool *threadpool;
+	int chunks_cnt;
+	int tasks_cnt;
+	int i;
+
+	ff_assert(begin <= end);
+	ff_assert(grain > 0);
 
+	if (begin == end)
+	{
+		return;
+	}
+	chunks_cnt = (int) ((((int64_t) end) - begin + grain - 1) / grain);
+	tasks_cnt = ff_arch_misc_get_cpus_cnt();
+	if (tasks_cnt > MAX_PARALLEL_FOR_TASKS_CNT)
+	{
+		tasks_cnt = MAX_PARALLEL_FOR_TASKS_CNT;
+	}
+	if (tasks_cnt > chunks_cnt)
+	{
+		tasks_cnt = chunks_cnt;
+	}
+
+	scheduler = get_current_scheduler();
+	data.completion_port = scheduler->completion_port;
 	data.fiber = ff_fiber_get_current();
 	data.func = func;
 	data.ctx = ctx;
-	ff_threadpool_execute_async(core_ctx.threadpool, generic_core_threadpool_func, &data);
+	data.begin = begin;
+	data.end = end;
+	data.grain = grain;
+	data.tasks_cnt = tasks_cnt;
+	data.pending_tasks_cnt = tasks_cnt;
+	for (i = 0; i < tasks_cnt; i++)
+	{
+		/* chunks are distributed evenly, so sizes of ranges differ by at most one chunk */
+		data.ranges[i].next_chunk = (int) (((int64_t) chunks_cnt) * i / tasks_cnt);
+		data.ranges[i].end_chunk = (int) (((int64_t) chunks_cnt) * (i + 1) / tasks_cnt);
+		data.tasks[i].data = &data;
+		data.tasks[i].index = i;
+	}
+
+	threadpool = core_ctx.threadpools[FF_CORE_THREADPOOL_COMPUTE];
+	for (i = 0; i < tasks_cnt; i++)
+	{
+		ff_threadpool_execute_async(threadpool, &data.tasks[i].threadpool_task, parallel_for_threadpool_func, &data.tasks[i]);
+	}
 	ff_core_yield_fiber();
 }
 
@@ -238,6 +1011,11 @@ void ff_core_fiberpool_execute_async(ff_core_fiberpool_func func, void *ctx)
 	ff_fiberpool_execute_async(core_ctx.fiberpool, func, ctx);
 }
 
+void ff_core_fiberpool_execute_batch_async(ff_core_fiberpool_func func, void **ctxs, int ctxs_cnt)
+{
+	ff_fiberpool_execute_batch_async(core_ctx.fiberpool, func, ctxs, ctxs_cnt);
+}
+
 void ff_core_fiberpool_execute_deferred(ff_core_fiberpool_func func, void *ctx, int interval)
 {
 	struct deferred_func_data *data;
@@ -247,67 +1025,113 @@ void ff_core_fiberpool_execute_deferred(ff_core_fiberpool_func func, void *ctx,
 	data = (struct deferred_func_data *) ff_malloc(sizeof(*data));
 	data->func = func;
 	data->ctx = ctx;
-	data->timeout_operation_data = ff_core_register_timeout_operation(interval, deferred_timeout_func, data);
+	ff_core_register_timeout_operation(&data->timeout_operation_data, interval, deferred_timeout_func, data);
 }
 
-struct ff_core_timeout_operation_data *ff_core_register_timeout_operation(int timeout, ff_core_cancel_timeout_func cancel_timeout_func, void *ctx)
+void ff_core_register_timeout_operation(struct ff_core_timeout_operation_data *timeout_operation_data, int timeout, ff_core_cancel_timeout_func cancel_timeout_func, void *ctx)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
-	int64_t current_time;
+	int64_t expiration_time;
 
 	ff_assert(timeout > 0);
 
-	timeout_operation_data = (struct ff_core_timeout_operation_data *) ff_malloc(sizeof(*timeout_operation_data));
-	current_time = ff_arch_misc_get_current_time();
-	timeout_operation_data->expiration_time = current_time + timeout;
 	timeout_operation_data->cancel_timeout_func = cancel_timeout_func;
 	timeout_operation_data->fiber = ff_fiber_get_current();
 	timeout_operation_data->ctx = ctx;
 	timeout_operation_data->is_expired = 0;
 
-	ff_semaphore_up(core_ctx.timeout_operations_semaphore);
-	ff_mutex_lock(core_ctx.timeout_operations_mutex);
-	timeout_operation_data->timeout_operation_entry = ff_container_add_entry(core_ctx.timeout_operations, timeout_operation_data);
-	ff_mutex_unlock(core_ctx.timeout_operations_mutex);
-
-	return timeout_operation_data;
+	/* the current time is truncated to milliseconds, so round the expiration time up.
+	 * Otherwise the operation can expire almost immediately after the registration
+	 */
+	expiration_time = ff_arch_misc_get_current_time() + timeout + 1;
+	ff_arch_mutex_lock(core_ctx.timeout_operations_mutex);
+	ff_timer_wheel_add(core_ctx.timeout_operations, &timeout_operation_data->node, expiration_time);
+	core_ctx.timeout_operations_cnt++;
+	if (expiration_time < core_ctx.timer_expiration_time)
+	{
+		/* re-arm the timer, so the timeout checker wakes up in time for this operation */
+		ff_arch_timer_set(core_ctx.timer, expiration_time);
+		core_ctx.timer_expiration_time = expiration_time;
+	}
+	ff_arch_mutex_unlock(core_ctx.timeout_operations_mutex);
 }
 
 enum ff_result ff_core_deregister_timeout_operation(struct ff_core_timeout_operation_data *timeout_operation_data)
 {
 	enum ff_result result;
 
-	ff_mutex_lock(core_ctx.timeout_operations_mutex);
-	ff_container_remove_entry(timeout_operation_data->timeout_operation_entry);
-	ff_mutex_unlock(core_ctx.timeout_operations_mutex);
-	ff_semaphore_down(core_ctx.timeout_operations_semaphore);
-
+	ff_arch_mutex_lock(core_ctx.timeout_operations_mutex);
+	ff_timer_wheel_remove(core_ctx.timeout_operations, &timeout_operation_data->node);
+	core_ctx.timeout_operations_cnt--;
+	ff_assert(core_ctx.timeout_operations_cnt >= 0);
 	result = timeout_operation_data->is_expired ? FF_FAILURE : FF_SUCCESS;
-	ff_free(timeout_operation_data);
+	if (core_ctx.is_timeout_checker_stopping && core_ctx.timeout_operations_cnt == 0)
+	{
+		/* wake up the timeout checker, so it can stop */
+		ff_arch_timer_set(core_ctx.timer, 0);
+	}
+	ff_arch_mutex_unlock(core_ctx.timeout_operations_mutex);
+
 	return result;
 }
 
 void ff_core_schedule_fiber(struct ff_fiber *fiber)
 {
-	ff_stack_push(core_ctx.pending_fibers, fiber);
+	struct scheduler *scheduler;
+
+	if (fiber == core_ctx.main_fiber)
+	{
+		scheduler = &core_ctx.schedulers[0];
+		push_pending_fiber(scheduler, fiber);
+		wakeup_scheduler(scheduler);
+	}
+	else
+	{
+		scheduler = get_current_scheduler();
+		push_pending_fiber(scheduler, fiber);
+		wakeup_idle_scheduler(scheduler);
+	}
 }
 
 void ff_core_yield_fiber()
 {
-	int is_empty;
-	struct ff_fiber *next_fiber = NULL;
+	struct scheduler *scheduler;
+	struct ff_fiber *current_fiber;
+	struct ff_fiber *next_fiber;
 
-	is_empty = ff_stack_is_empty(core_ctx.pending_fibers);
-	if (!is_empty)
+	scheduler = get_current_scheduler();
+	current_fiber = ff_fiber_get_current();
+	ff_assert(current_fiber != scheduler->idle_fiber);
+	next_fiber = pop_pending_fiber(scheduler, 0);
+	if (next_fiber != NULL && next_fiber != current_fiber)
 	{
-		ff_stack_top(core_ctx.pending_fibers, (const void **) &next_fiber);
-		ff_assert(next_fiber != NULL);
-		ff_stack_pop(core_ctx.pending_fibers);
+		int is_running;
+
+		is_running = ff_fiber_is_running(next_fiber);
+		if (is_running)
+		{
+			/* the next_fiber is still switching out on another thread, which can wait
+			 * for the current_fiber at the moment. Let the idle fiber wait for the next_fiber,
+			 * so the current_fiber will be released.
+			 */
+			push_pending_fiber(scheduler, next_fiber);
+			next_fiber = NULL;
+		}
 	}
-	else
+	if (next_fiber == NULL)
 	{
-		ff_arch_completion_port_get(core_ctx.completion_port, (const void **) &next_fiber);
-		ff_assert(next_fiber != NULL);
+		next_fiber = scheduler->idle_fiber;
+	}
+	if (next_fiber != current_fiber)
+	{
+		scheduler->context_switches_cnt++;
 	}
 	ff_fiber_switch(next_fiber);
 }
+
+struct ff_arch_completion_port *ff_core_get_completion_port()
+{
+	struct scheduler *scheduler;
+
+	scheduler = get_current_scheduler();
+	return scheduler->completion_port;
+}
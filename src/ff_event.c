@@ -3,11 +3,12 @@
 #include "private/ff_event.h"
 #include "private/ff_core.h"
 #include "private/ff_fiber.h"
-#include "private/ff_stack.h"
+#include "private/arch/ff_arch_mutex.h"
 
 struct ff_event
 {
-	struct ff_stack *pending_fibers;
+	struct ff_arch_mutex *mutex;
+	struct ff_fiber_list pending_fibers;
 	enum ff_event_type event_type;
 	int is_set;
 };
@@ -18,7 +19,9 @@ static void cancel_event_wait(struct ff_fiber *fiber, void *ctx)
 	enum ff_result result;
 	
 	event = (struct ff_event *) ctx;
-	result = ff_stack_remove_entry(event->pending_fibers, fiber);
+	ff_arch_mutex_lock(event->mutex);
+	result = ff_fiber_list_remove(&event->pending_fibers, fiber);
+	ff_arch_mutex_unlock(event->mutex);
 	if (result == FF_SUCCESS)
 	{
 		ff_core_schedule_fiber(fiber);
@@ -34,7 +37,8 @@ struct ff_event *ff_event_create(enum ff_event_type event_type)
 	struct ff_event *event;
 
 	event = (struct ff_event *) ff_malloc(sizeof(*event));
-	event->pending_fibers = ff_stack_create();
+	event->mutex = ff_arch_mutex_create();
+	ff_fiber_list_initialize(&event->pending_fibers);
 	event->event_type = event_type;
 	event->is_set = 0;
 
@@ -43,31 +47,27 @@ struct ff_event *ff_event_create(enum ff_event_type event_type)
 
 void ff_event_delete(struct ff_event *event)
 {
-	ff_stack_delete(event->pending_fibers);
+	ff_assert(ff_fiber_list_is_empty(&event->pending_fibers));
+	ff_arch_mutex_delete(event->mutex);
 	ff_free(event);
 }
 
 void ff_event_set(struct ff_event *event)
 {
+	ff_arch_mutex_lock(event->mutex);
 	if (!event->is_set)
 	{
-		struct ff_stack *pending_fibers;
-
-		pending_fibers = event->pending_fibers;
 		for (;;)
 		{
 			struct ff_fiber *fiber;
-			int is_empty;
 
-			is_empty = ff_stack_is_empty(pending_fibers);
-			if (is_empty)
+			fiber = ff_fiber_list_pop_front(&event->pending_fibers);
+			if (fiber == NULL)
 			{
 				event->is_set = 1;
 				break;
 			}
 
-			ff_stack_top(pending_fibers, (const void **) &fiber);
-			ff_stack_pop(pending_fibers);
 			ff_core_schedule_fiber(fiber);
 			if (event->event_type == FF_EVENT_AUTO)
 			{
@@ -78,21 +78,26 @@ void ff_event_set(struct ff_event *event)
 			}
 		}
 	}
+	ff_arch_mutex_unlock(event->mutex);
 }
 
 void ff_event_reset(struct ff_event *event)
 {
+	ff_arch_mutex_lock(event->mutex);
 	event->is_set = 0;
+	ff_arch_mutex_unlock(event->mutex);
 }
 
 void ff_event_wait(struct ff_event *event)
 {
+	ff_arch_mutex_lock(event->mutex);
 	if (!event->is_set)
 	{
 		struct ff_fiber *current_fiber;
 
 		current_fiber = ff_fiber_get_current();
-		ff_stack_push(event->pending_fibers, current_fiber);
+		ff_fiber_list_push_front(&event->pending_fibers, current_fiber);
+		ff_arch_mutex_unlock(event->mutex);
 		ff_core_yield_fiber();
 		/* the event can be already reset (event->is_set == 0) at this moment:
 		 * f1: ff_event_reset(); // event->is_set = 0;
@@ -102,12 +107,16 @@ void ff_event_wait(struct ff_event *event)
 		 * f2: exit ff_event_wait(); // is is at this point and (event->is_set == 0).
 		 */
 	}
-	else if (event->event_type == FF_EVENT_AUTO)
+	else
 	{
-		/* autoreset event should be reset if it is set in order to
-		 * block subsequent ff_event_wait() calls.
-		 */
-		event->is_set = 0;
+		if (event->event_type == FF_EVENT_AUTO)
+		{
+			/* autoreset event should be reset if it is set in order to
+			 * block subsequent ff_event_wait() calls.
+			 */
+			event->is_set = 0;
+		}
+		ff_arch_mutex_unlock(event->mutex);
 	}
 }
 
@@ -117,16 +126,18 @@ enum ff_result ff_event_wait_with_timeout(struct ff_event *event, int timeout)
 
 	ff_assert(timeout > 0);
 
+	ff_arch_mutex_lock(event->mutex);
 	if (!event->is_set)
 	{
 		struct ff_fiber *current_fiber;
-		struct ff_core_timeout_operation_data *timeout_operation_data;
+		struct ff_core_timeout_operation_data timeout_operation_data;
 
 		current_fiber = ff_fiber_get_current();
-		ff_stack_push(event->pending_fibers, current_fiber);
-		timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_event_wait, event);
+		ff_fiber_list_push_front(&event->pending_fibers, current_fiber);
+		ff_arch_mutex_unlock(event->mutex);
+		ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_event_wait, event);
 		ff_core_yield_fiber();
-		result = ff_core_deregister_timeout_operation(timeout_operation_data);
+		result = ff_core_deregister_timeout_operation(&timeout_operation_data);
 		/* the event can be already reset (event->is_set == 0) at this moment:
 		 * f1: ff_event_reset(); // event->is_set = 0;
 		 * f2: enter ff_event_wait(); // f2 has been blocked
@@ -135,12 +146,16 @@ enum ff_result ff_event_wait_with_timeout(struct ff_event *event, int timeout)
 		 * f2: exit ff_event_wait(); // is is at this point and (event->is_set == 0).
 		 */
 	}
-	else if (event->event_type == FF_EVENT_AUTO)
+	else
 	{
-		/* autoreset event should be reset if it is set in order to
-		 * block subsequent ff_event_wait() calls.
-		 */
-		event->is_set = 0;
+		if (event->event_type == FF_EVENT_AUTO)
+		{
+			/* autoreset event should be reset if it is set in order to
+			 * block subsequent ff_event_wait() calls.
+			 */
+			event->is_set = 0;
+		}
+		ff_arch_mutex_unlock(event->mutex);
 	}
 	return result;
 }
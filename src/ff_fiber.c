@@ -4,11 +4,18 @@
 #include "private/ff_event.h"
 #include "private/ff_core.h"
 #include "private/arch/ff_arch_fiber.h"
+#include "private/arch/ff_arch_thread.h"
+#include "private/arch/ff_arch_atomic.h"
+#include "private/arch/ff_arch_completion_port.h"
+#include "private/arch/ff_arch_misc.h"
 
 #define DEFAULT_FIBER_STACK_SIZE 0x10000
 
 struct ff_fiber
 {
+	/* the link for ff_arch_completion_port_put(). It must be the first member of the structure */
+	struct ff_arch_completion_port_entry completion_port_entry;
+
 	/* context, which will be passed to the func */
 	void *ctx;
 
@@ -20,10 +27,78 @@ struct ff_fiber
 
 	/* platform-specific fiber */
 	struct ff_arch_fiber *arch_fiber;
+
+	/* hooks for the ff_fiber_list, which contains the fiber */
+	struct ff_fiber *list_prev;
+	struct ff_fiber *list_next;
+
+	/* the list, which contains the fiber, or NULL if the fiber isn't in a list */
+	struct ff_fiber_list *list;
+
+	/* the priority class, which determines the run queue for the fiber */
+	enum ff_fiber_priority priority;
+
+	/* the time in nanoseconds, when the fiber has been switched in last time */
+	int64_t switch_in_time;
+
+	/* cumulative time in nanoseconds, which the fiber has been running */
+	int64_t run_time;
+
+	/* the number of times the fiber has been switched in */
+	int64_t switches_cnt;
+
+	/* non-zero while some thread executes the fiber, i.e. uses its stack */
+	int is_running;
+};
+
+/**
+ * @private
+ * per-thread data. Each thread, which runs fibers, has its own copy of this structure.
+ */
+struct fiber_thread_data
+{
+	/* the fiber, which was created from the thread itself by the ff_fiber_initialize() */
+	struct ff_fiber main_fiber;
+
+	/* the fiber, which is currently executed on the thread */
+	struct ff_fiber *current_fiber;
+
+	/* the fiber, from which the thread has been switched to the current_fiber */
+	struct ff_fiber *previous_fiber;
 };
 
-static struct ff_fiber main_fiber;
-static struct ff_fiber *current_fiber = NULL;
+/**
+ * @private
+ * Returns per-thread data for the current thread.
+ * Always re-read this data after switching fibers, because the fiber
+ * can be resumed on another thread.
+ */
+static struct fiber_thread_data *get_thread_data()
+{
+	struct fiber_thread_data *thread_data;
+
+	thread_data = (struct fiber_thread_data *) ff_arch_thread_get_local(FF_ARCH_THREAD_LOCAL_FIBER);
+	ff_assert(thread_data != NULL);
+	return thread_data;
+}
+
+/**
+ * @private
+ * Marks the fiber, from which the current thread has been switched, as not running,
+ * so other threads can resume it.
+ * This function must be called on each entry to the fiber after the switch.
+ */
+static void complete_switch()
+{
+	struct fiber_thread_data *thread_data;
+	struct ff_fiber *previous_fiber;
+
+	thread_data = get_thread_data();
+	previous_fiber = thread_data->previous_fiber;
+	ff_assert(previous_fiber != NULL);
+	thread_data->previous_fiber = NULL;
+	ff_arch_atomic_set(&previous_fiber->is_running, 0);
+}
 
 /**
  * @private
@@ -33,6 +108,7 @@ static void generic_arch_fiber_func(void *ctx)
 {
 	struct ff_fiber *fiber;
 
+	complete_switch();
 	fiber = (struct ff_fiber *) ctx;
 	fiber->func(fiber->ctx);
 	ff_event_set(fiber->stop_event);
@@ -42,31 +118,78 @@ static void generic_arch_fiber_func(void *ctx)
 
 void ff_fiber_initialize()
 {
-	ff_assert(current_fiber == NULL);
-	main_fiber.ctx = NULL;
-	main_fiber.func = NULL;
-	main_fiber.stop_event = NULL;
-	main_fiber.arch_fiber = ff_arch_fiber_initialize();
-	current_fiber = &main_fiber;
+	struct fiber_thread_data *thread_data;
+
+	ff_assert(ff_arch_thread_get_local(FF_ARCH_THREAD_LOCAL_FIBER) == NULL);
+
+	thread_data = (struct fiber_thread_data *) ff_malloc(sizeof(*thread_data));
+	thread_data->main_fiber.completion_port_entry.next = NULL;
+	thread_data->main_fiber.ctx = NULL;
+	thread_data->main_fiber.func = NULL;
+	thread_data->main_fiber.stop_event = NULL;
+	thread_data->main_fiber.arch_fiber = ff_arch_fiber_initialize();
+	thread_data->main_fiber.list_prev = NULL;
+	thread_data->main_fiber.list_next = NULL;
+	thread_data->main_fiber.list = NULL;
+	thread_data->main_fiber.priority = FF_FIBER_PRIORITY_NORMAL;
+	thread_data->main_fiber.switch_in_time = ff_arch_misc_get_precise_time();
+	thread_data->main_fiber.run_time = 0;
+	thread_data->main_fiber.switches_cnt = 1;
+	thread_data->main_fiber.is_running = 1;
+	thread_data->current_fiber = &thread_data->main_fiber;
+	thread_data->previous_fiber = NULL;
+	ff_arch_thread_set_local(FF_ARCH_THREAD_LOCAL_FIBER, thread_data);
 }
 
 void ff_fiber_shutdown()
 {
-	ff_assert(current_fiber == &main_fiber);
+	struct fiber_thread_data *thread_data;
+
+	thread_data = get_thread_data();
+	ff_assert(thread_data->current_fiber == &thread_data->main_fiber);
 
-	ff_arch_fiber_shutdown(main_fiber.arch_fiber);
-	current_fiber = NULL;
+	ff_arch_fiber_shutdown(thread_data->main_fiber.arch_fiber);
+	ff_arch_thread_set_local(FF_ARCH_THREAD_LOCAL_FIBER, NULL);
+	ff_free(thread_data);
 }
 
 void ff_fiber_switch(struct ff_fiber *fiber)
 {
+	struct fiber_thread_data *thread_data;
+	struct ff_fiber *current_fiber;
+
+	thread_data = get_thread_data();
+	current_fiber = thread_data->current_fiber;
 	if (fiber != current_fiber)
 	{
-		current_fiber = fiber;
-		ff_arch_fiber_switch(fiber->arch_fiber);
+		int64_t switch_time;
+
+		/* the fiber can be still running on another thread, which is switching from it
+		 * right now. Wait until the switch will be completed.
+		 */
+		while (ff_arch_atomic_exchange(&fiber->is_running, 1))
+		{
+			ff_arch_atomic_pause();
+		}
+		switch_time = ff_arch_misc_get_precise_time();
+		current_fiber->run_time += switch_time - current_fiber->switch_in_time;
+		fiber->switch_in_time = switch_time;
+		fiber->switches_cnt++;
+		thread_data->current_fiber = fiber;
+		thread_data->previous_fiber = current_fiber;
+		ff_arch_fiber_switch(current_fiber->arch_fiber, fiber->arch_fiber);
+		complete_switch();
 	}
 }
 
+int ff_fiber_is_running(struct ff_fiber *fiber)
+{
+	int is_running;
+
+	is_running = ff_arch_atomic_get(&fiber->is_running);
+	return is_running;
+}
+
 struct ff_fiber *ff_fiber_create(ff_fiber_func fiber_func, int stack_size)
 {
 	struct ff_fiber *fiber;
@@ -79,19 +202,34 @@ struct ff_fiber *ff_fiber_create(ff_fiber_func fiber_func, int stack_size)
 	}
 
 	fiber = (struct ff_fiber *) ff_malloc(sizeof(*fiber));
+	fiber->completion_port_entry.next = NULL;
 	fiber->ctx = NULL;
 	fiber->func = fiber_func;
 	fiber->stop_event = ff_event_create(FF_EVENT_MANUAL);
 	fiber->arch_fiber = ff_arch_fiber_create(generic_arch_fiber_func, fiber, stack_size);
+	fiber->list_prev = NULL;
+	fiber->list_next = NULL;
+	fiber->list = NULL;
+	fiber->priority = FF_FIBER_PRIORITY_NORMAL;
+	fiber->switch_in_time = 0;
+	fiber->run_time = 0;
+	fiber->switches_cnt = 0;
+	fiber->is_running = 0;
 
 	return fiber;
 }
 
 void ff_fiber_delete(struct ff_fiber *fiber)
 {
-	ff_assert(fiber != current_fiber);
-	ff_assert(fiber != &main_fiber);
+	ff_assert(fiber != ff_fiber_get_current());
+	ff_assert(fiber->stop_event != NULL);
+	ff_assert(fiber->list == NULL);
 
+	/* the finished fiber can be still switching to another fiber on another thread */
+	while (ff_arch_atomic_get(&fiber->is_running))
+	{
+		ff_arch_atomic_pause();
+	}
 	ff_arch_fiber_delete(fiber->arch_fiber);
 	ff_event_delete(fiber->stop_event);
 	ff_free(fiber);
@@ -99,8 +237,8 @@ void ff_fiber_delete(struct ff_fiber *fiber)
 
 void ff_fiber_start(struct ff_fiber *fiber, void *ctx)
 {
-	ff_assert(fiber != current_fiber);
-	ff_assert(fiber != &main_fiber);
+	ff_assert(fiber != ff_fiber_get_current());
+	ff_assert(fiber->stop_event != NULL);
 
 	fiber->ctx = ctx;
 	ff_core_schedule_fiber(fiber);
@@ -108,13 +246,140 @@ void ff_fiber_start(struct ff_fiber *fiber, void *ctx)
 
 void ff_fiber_join(struct ff_fiber *fiber)
 {
-	ff_assert(fiber != current_fiber);
-	ff_assert(fiber != &main_fiber);
+	ff_assert(fiber != ff_fiber_get_current());
+	ff_assert(fiber->stop_event != NULL);
 
 	ff_event_wait(fiber->stop_event);
 }
 
+void ff_fiber_set_priority(struct ff_fiber *fiber, enum ff_fiber_priority priority)
+{
+	ff_assert(priority >= FF_FIBER_PRIORITY_HIGH && priority <= FF_FIBER_PRIORITY_LOW);
+
+	fiber->priority = priority;
+}
+
+enum ff_fiber_priority ff_fiber_get_priority(struct ff_fiber *fiber)
+{
+	return fiber->priority;
+}
+
+void ff_fiber_get_stats(struct ff_fiber *fiber, struct ff_fiber_stats *stats)
+{
+	stats->run_time = fiber->run_time;
+	stats->switches_cnt = fiber->switches_cnt;
+	if (fiber == ff_fiber_get_current())
+	{
+		/* take into account the time since the last switch to the current fiber */
+		stats->run_time += ff_arch_misc_get_precise_time() - fiber->switch_in_time;
+	}
+}
+
 struct ff_fiber *ff_fiber_get_current()
 {
-	return current_fiber;
+	struct fiber_thread_data *thread_data;
+
+	thread_data = get_thread_data();
+	return thread_data->current_fiber;
+}
+
+void ff_fiber_list_initialize(struct ff_fiber_list *list)
+{
+	list->head = NULL;
+	list->tail = NULL;
+}
+
+int ff_fiber_list_is_empty(struct ff_fiber_list *list)
+{
+	int is_empty;
+
+	is_empty = (list->head == NULL);
+	return is_empty;
+}
+
+void ff_fiber_list_push_front(struct ff_fiber_list *list, struct ff_fiber *fiber)
+{
+	ff_assert(fiber->list == NULL);
+
+	fiber->list_prev = NULL;
+	fiber->list_next = list->head;
+	if (list->head != NULL)
+	{
+		list->head->list_prev = fiber;
+	}
+	else
+	{
+		list->tail = fiber;
+	}
+	list->head = fiber;
+	fiber->list = list;
+}
+
+void ff_fiber_list_push_back(struct ff_fiber_list *list, struct ff_fiber *fiber)
+{
+	ff_assert(fiber->list == NULL);
+
+	fiber->list_prev = list->tail;
+	fiber->list_next = NULL;
+	if (list->tail != NULL)
+	{
+		list->tail->list_next = fiber;
+	}
+	else
+	{
+		list->head = fiber;
+	}
+	list->tail = fiber;
+	fiber->list = list;
+}
+
+struct ff_fiber *ff_fiber_list_pop_front(struct ff_fiber_list *list)
+{
+	struct ff_fiber *fiber;
+
+	fiber = list->head;
+	if (fiber != NULL)
+	{
+		enum ff_result result;
+
+		result = ff_fiber_list_remove(list, fiber);
+		ff_assert(result == FF_SUCCESS);
+	}
+
+	return fiber;
+}
+
+enum ff_result ff_fiber_list_remove(struct ff_fiber_list *list, struct ff_fiber *fiber)
+{
+	enum ff_result result = FF_FAILURE;
+
+	if (fiber->list == list)
+	{
+		if (fiber->list_prev != NULL)
+		{
+			fiber->list_prev->list_next = fiber->list_next;
+		}
+		else
+		{
+			list->head = fiber->list_next;
+		}
+		if (fiber->list_next != NULL)
+		{
+			fiber->list_next->list_prev = fiber->list_prev;
+		}
+		else
+		{
+			list->tail = fiber->list_prev;
+		}
+		fiber->list_prev = NULL;
+		fiber->list_next = NULL;
+		fiber->list = NULL;
+		result = FF_SUCCESS;
+	}
+	else
+	{
+		ff_log_debug(L"the list=%p doesn't contain the given fiber=%p", list, fiber);
+	}
+
+	return result;
 }
@@ -1,132 +1,420 @@
 #include "private/ff_common.h"
 
 #include "private/ff_fiberpool.h"
-#include "private/ff_blocking_stack.h"
+#include "private/ff_core.h"
+#include "private/ff_event.h"
 #include "private/ff_fiber.h"
+#include "private/arch/ff_arch_mutex.h"
+
+/**
+ * the maximum number of task nodes, which are kept in the free list for reuse.
+ */
+#define MAX_FREE_TASKS_CNT 1024
+
+struct fiberpool_task
+{
+	/* the link in the pending_tasks queue or in the free list */
+	struct fiberpool_task *next;
+	ff_fiberpool_func func;
+	void *ctx;
+};
 
 struct ff_fiberpool
 {
-	struct ff_blocking_stack *pending_tasks;
-	struct ff_fiber **fibers;
+	/* guards all the fields below, because worker fibers can run on different threads */
+	struct ff_arch_mutex *mutex;
+
+	/* FIFO queue of tasks, which wait for worker fibers */
+	struct fiberpool_task *pending_tasks_front;
+	struct fiberpool_task **pending_tasks_back_ptr;
+	int pending_tasks_cnt;
+
+	/* task nodes, which can be reused without memory allocation */
+	struct fiberpool_task *free_tasks;
+	int free_tasks_cnt;
+
+	/* worker fibers, which wait for tasks. The most recently idle fiber is woken up first,
+	 * so other fibers stay idle and exit after the idle timeout
+	 */
+	struct ff_fiber_list idle_fibers;
+
+	/* worker fibers, which have exited, but haven't been deleted yet.
+	 * Each exiting fiber deletes one of its predecessors, so the list doesn't grow
+	 * until the fiberpool is stopped
+	 */
+	struct ff_fiber_list exited_fibers;
+
+	/* it is set when the last worker fiber exits after the fiberpool is stopped */
+	struct ff_event *stop_event;
+
 	int max_fibers_cnt;
 	int running_fibers_cnt;
+
+	/* the number of worker fibers, which execute tasks */
 	int busy_fibers_cnt;
+
+	/* the time in milliseconds, after which idle worker fibers exit. Idle fibers never exit if it is 0 */
+	int idle_timeout;
+
+	int is_stopping;
 };
 
-struct fiberpool_task
+static void push_pending_task(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx)
 {
-	ff_fiberpool_func func;
-	void *ctx;
-};
+	struct fiberpool_task *task;
+
+	task = fiberpool->free_tasks;
+	if (task != NULL)
+	{
+		fiberpool->free_tasks = task->next;
+		fiberpool->free_tasks_cnt--;
+	}
+	else
+	{
+		task = (struct fiberpool_task *) ff_malloc(sizeof(*task));
+	}
+	task->next = NULL;
+	task->func = func;
+	task->ctx = ctx;
+
+	*fiberpool->pending_tasks_back_ptr = task;
+	fiberpool->pending_tasks_back_ptr = &task->next;
+	fiberpool->pending_tasks_cnt++;
+}
+
+/**
+ * @private
+ * Removes the oldest task from the queue and copies its func and ctx.
+ * Returns 0 if the queue is empty.
+ */
+static int pop_pending_task(struct ff_fiberpool *fiberpool, ff_fiberpool_func *func, void **ctx)
+{
+	struct fiberpool_task *task;
+
+	task = fiberpool->pending_tasks_front;
+	if (task == NULL)
+	{
+		ff_assert(fiberpool->pending_tasks_cnt == 0);
+		return 0;
+	}
+	fiberpool->pending_tasks_front = task->next;
+	if (fiberpool->pending_tasks_front == NULL)
+	{
+		fiberpool->pending_tasks_back_ptr = &fiberpool->pending_tasks_front;
+	}
+	fiberpool->pending_tasks_cnt--;
+	*func = task->func;
+	*ctx = task->ctx;
+
+	if (fiberpool->free_tasks_cnt < MAX_FREE_TASKS_CNT)
+	{
+		task->next = fiberpool->free_tasks;
+		fiberpool->free_tasks = task;
+		fiberpool->free_tasks_cnt++;
+	}
+	else
+	{
+		ff_free(task);
+	}
+	return 1;
+}
+
+static void cancel_idle_wait(struct ff_fiber *fiber, void *ctx)
+{
+	struct ff_fiberpool *fiberpool;
+	enum ff_result result;
+
+	fiberpool = (struct ff_fiberpool *) ctx;
+	ff_arch_mutex_lock(fiberpool->mutex);
+	result = ff_fiber_list_remove(&fiberpool->idle_fibers, fiber);
+	ff_arch_mutex_unlock(fiberpool->mutex);
+	if (result == FF_SUCCESS)
+	{
+		ff_core_schedule_fiber(fiber);
+	}
+	else
+	{
+		ff_log_debug(L"the fiber=%p has been woken up by a new task before the idle timeout expiration", fiber);
+	}
+}
+
+/**
+ * @private
+ * Waits for the next task. The fiberpool's mutex must be held. It is held on return too.
+ * Returns 0 if the worker fiber must exit, because the fiberpool is stopped or the fiber
+ * has stayed idle for longer than the idle timeout.
+ */
+static int wait_for_task(struct ff_fiberpool *fiberpool, ff_fiberpool_func *func, void **ctx)
+{
+	int is_timed_out = 0;
+
+	for (;;)
+	{
+		int idle_timeout;
+
+		if (pop_pending_task(fiberpool, func, ctx))
+		{
+			return 1;
+		}
+		if (fiberpool->is_stopping || is_timed_out)
+		{
+			return 0;
+		}
+
+		ff_fiber_list_push_front(&fiberpool->idle_fibers, ff_fiber_get_current());
+		idle_timeout = fiberpool->idle_timeout;
+		ff_arch_mutex_unlock(fiberpool->mutex);
+		if (idle_timeout > 0)
+		{
+			struct ff_core_timeout_operation_data timeout_operation_data;
+			enum ff_result result;
+
+			ff_core_register_timeout_operation(&timeout_operation_data, idle_timeout, cancel_idle_wait, fiberpool);
+			ff_core_yield_fiber();
+			result = ff_core_deregister_timeout_operation(&timeout_operation_data);
+			is_timed_out = (result != FF_SUCCESS);
+		}
+		else
+		{
+			ff_core_yield_fiber();
+		}
+		ff_arch_mutex_lock(fiberpool->mutex);
+	}
+}
+
+/**
+ * @private
+ * Releases the current worker fiber. The fiberpool's mutex must be held. It is released on return.
+ * The fiber cannot delete itself, so it is deleted by the next exiting fiber or by ff_fiberpool_delete().
+ * It must not yield after it is pushed into the exited_fibers list, since scheduling would move it into another list.
+ */
+static void exit_worker_fiber(struct ff_fiberpool *fiberpool)
+{
+	struct ff_fiber *prev_fiber = NULL;
+
+	if (!fiberpool->is_stopping)
+	{
+		prev_fiber = ff_fiber_list_pop_front(&fiberpool->exited_fibers);
+	}
+	if (prev_fiber != NULL)
+	{
+		ff_arch_mutex_unlock(fiberpool->mutex);
+		ff_fiber_join(prev_fiber);
+		ff_fiber_delete(prev_fiber);
+		ff_arch_mutex_lock(fiberpool->mutex);
+	}
+
+	ff_assert(fiberpool->running_fibers_cnt > 0);
+	fiberpool->running_fibers_cnt--;
+	ff_fiber_list_push_front(&fiberpool->exited_fibers, ff_fiber_get_current());
+	if (fiberpool->is_stopping && fiberpool->running_fibers_cnt == 0)
+	{
+		ff_event_set(fiberpool->stop_event);
+	}
+	ff_arch_mutex_unlock(fiberpool->mutex);
+}
 
 static void generic_fiberpool_func(void *ctx)
 {
 	struct ff_fiberpool *fiberpool;
-	struct ff_blocking_stack *pending_tasks;
 
 	fiberpool = (struct ff_fiberpool *) ctx;
-	pending_tasks = fiberpool->pending_tasks;
+	ff_arch_mutex_lock(fiberpool->mutex);
 	for (;;)
 	{
-		struct fiberpool_task *task;
+		ff_fiberpool_func task_func;
+		void *task_ctx;
 
-		ff_assert(fiberpool->busy_fibers_cnt > 0);
-		ff_assert(fiberpool->busy_fibers_cnt <= fiberpool->running_fibers_cnt);
+		ff_assert(fiberpool->busy_fibers_cnt >= 0);
+		ff_assert(fiberpool->busy_fibers_cnt < fiberpool->running_fibers_cnt);
 		ff_assert(fiberpool->running_fibers_cnt <= fiberpool->max_fibers_cnt);
+		if (!wait_for_task(fiberpool, &task_func, &task_ctx))
+		{
+			break;
+		}
+		fiberpool->busy_fibers_cnt++;
+		ff_arch_mutex_unlock(fiberpool->mutex);
+
+		task_func(task_ctx);
 
+		/* the task could change the priority of the worker fiber. Don't leak it to subsequent tasks */
+		ff_fiber_set_priority(ff_fiber_get_current(), FF_FIBER_PRIORITY_NORMAL);
+		ff_arch_mutex_lock(fiberpool->mutex);
 		fiberpool->busy_fibers_cnt--;
-		ff_blocking_stack_pop(pending_tasks, (const void **) &task);
-		if (task == NULL)
+	}
+	exit_worker_fiber(fiberpool);
+}
+
+/**
+ * @private
+ * Wakes up idle worker fibers for the given number of new tasks and starts new worker fibers
+ * if pending tasks outnumber worker fibers, which don't execute tasks.
+ * The fiberpool's mutex must be held.
+ */
+static void dispatch_pending_tasks(struct ff_fiberpool *fiberpool, int new_tasks_cnt)
+{
+	int i;
+
+	ff_assert(!fiberpool->is_stopping);
+	ff_assert(fiberpool->busy_fibers_cnt >= 0);
+	ff_assert(fiberpool->busy_fibers_cnt <= fiberpool->running_fibers_cnt);
+	ff_assert(fiberpool->running_fibers_cnt <= fiberpool->max_fibers_cnt);
+
+	for (i = 0; i < new_tasks_cnt; i++)
+	{
+		struct ff_fiber *fiber;
+
+		fiber = ff_fiber_list_pop_front(&fiberpool->idle_fibers);
+		if (fiber == NULL)
 		{
 			break;
 		}
-		fiberpool->busy_fibers_cnt++;
+		ff_core_schedule_fiber(fiber);
+	}
 
-		task->func(task->ctx);
-		ff_free(task);
+	while (fiberpool->pending_tasks_cnt > fiberpool->running_fibers_cnt - fiberpool->busy_fibers_cnt)
+	{
+		struct ff_fiber *worker_fiber;
+
+		if (fiberpool->running_fibers_cnt == fiberpool->max_fibers_cnt)
+		{
+			ff_log_debug(L"fiberpool=%p already has maximum size %d, so it cannot contain new fibers", fiberpool, fiberpool->max_fibers_cnt);
+			break;
+		}
+		worker_fiber = ff_fiber_create(generic_fiberpool_func, 0);
+		fiberpool->running_fibers_cnt++;
+		ff_fiber_start(worker_fiber, fiberpool);
 	}
-	fiberpool->running_fibers_cnt--;
 }
 
-static void add_worker_fiber(struct ff_fiberpool *fiberpool)
+/**
+ * @private
+ * Wakes up all the idle worker fibers. The fiberpool's mutex must be held.
+ */
+static void wake_idle_fibers(struct ff_fiberpool *fiberpool)
 {
-	struct ff_fiber *worker_fiber;
+	for (;;)
+	{
+		struct ff_fiber *fiber;
 
-	worker_fiber = ff_fiber_create(generic_fiberpool_func, 0);
-	fiberpool->fibers[fiberpool->running_fibers_cnt] = worker_fiber;
-	fiberpool->running_fibers_cnt++;
-	fiberpool->busy_fibers_cnt++;
-	ff_fiber_start(worker_fiber, fiberpool);
+		fiber = ff_fiber_list_pop_front(&fiberpool->idle_fibers);
+		if (fiber == NULL)
+		{
+			break;
+		}
+		ff_core_schedule_fiber(fiber);
+	}
 }
 
-struct ff_fiberpool *ff_fiberpool_create(int max_fibers_cnt)
+struct ff_fiberpool *ff_fiberpool_create(int max_fibers_cnt, int idle_timeout)
 {
 	struct ff_fiberpool *fiberpool;
 
 	ff_assert(max_fibers_cnt > 0);
+	ff_assert(idle_timeout >= 0);
 
 	fiberpool = (struct ff_fiberpool *) ff_malloc(sizeof(*fiberpool));
-	fiberpool->pending_tasks = ff_blocking_stack_create(max_fibers_cnt);
-	fiberpool->fibers = (struct ff_fiber **) ff_calloc(max_fibers_cnt, sizeof(fiberpool->fibers[0]));
+	fiberpool->mutex = ff_arch_mutex_create();
+	fiberpool->pending_tasks_front = NULL;
+	fiberpool->pending_tasks_back_ptr = &fiberpool->pending_tasks_front;
+	fiberpool->pending_tasks_cnt = 0;
+	fiberpool->free_tasks = NULL;
+	fiberpool->free_tasks_cnt = 0;
+	ff_fiber_list_initialize(&fiberpool->idle_fibers);
+	ff_fiber_list_initialize(&fiberpool->exited_fibers);
+	fiberpool->stop_event = ff_event_create(FF_EVENT_MANUAL);
 	fiberpool->max_fibers_cnt = max_fibers_cnt;
 	fiberpool->running_fibers_cnt = 0;
 	fiberpool->busy_fibers_cnt = 0;
+	fiberpool->idle_timeout = idle_timeout;
+	fiberpool->is_stopping = 0;
 
 	return fiberpool;
 }
 
 void ff_fiberpool_delete(struct ff_fiberpool *fiberpool)
 {
-	struct ff_blocking_stack *pending_tasks;
-	struct ff_fiber **fibers;
-	int i;
+	struct ff_fiber *fiber;
 	int running_fibers_cnt;
 
-	pending_tasks = fiberpool->pending_tasks;
+	/* worker fibers exit after the queue becomes empty, so all the pending tasks are executed */
+	ff_arch_mutex_lock(fiberpool->mutex);
+	fiberpool->is_stopping = 1;
+	wake_idle_fibers(fiberpool);
 	running_fibers_cnt = fiberpool->running_fibers_cnt;
-	for (i = 0; i < running_fibers_cnt; i++)
+	ff_arch_mutex_unlock(fiberpool->mutex);
+
+	if (running_fibers_cnt > 0)
 	{
-		ff_blocking_stack_push(pending_tasks, NULL);
+		ff_event_wait(fiberpool->stop_event);
 	}
-	fibers = fiberpool->fibers;
-	for (i = 0; i < running_fibers_cnt; i++)
+	for (;;)
 	{
-		struct ff_fiber *fiber;
-
-		fiber = fibers[i];
+		fiber = ff_fiber_list_pop_front(&fiberpool->exited_fibers);
+		if (fiber == NULL)
+		{
+			break;
+		}
 		ff_fiber_join(fiber);
 		ff_fiber_delete(fiber);
 	}
 	ff_assert(fiberpool->busy_fibers_cnt == 0);
 	ff_assert(fiberpool->running_fibers_cnt == 0);
+	ff_assert(fiberpool->pending_tasks_front == NULL);
+
+	while (fiberpool->free_tasks != NULL)
+	{
+		struct fiberpool_task *task;
 
-	ff_free(fibers);
-	ff_blocking_stack_delete(pending_tasks);
+		task = fiberpool->free_tasks;
+		fiberpool->free_tasks = task->next;
+		ff_free(task);
+	}
+	ff_event_delete(fiberpool->stop_event);
+	ff_arch_mutex_delete(fiberpool->mutex);
 	ff_free(fiberpool);
 }
 
 void ff_fiberpool_execute_async(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void *ctx)
 {
-	struct fiberpool_task *task;
+	ff_arch_mutex_lock(fiberpool->mutex);
+	push_pending_task(fiberpool, func, ctx);
+	dispatch_pending_tasks(fiberpool, 1);
+	ff_arch_mutex_unlock(fiberpool->mutex);
+}
 
-	ff_assert(fiberpool->busy_fibers_cnt >= 0);
-	ff_assert(fiberpool->busy_fibers_cnt <= fiberpool->running_fibers_cnt);
-	ff_assert(fiberpool->running_fibers_cnt <= fiberpool->max_fibers_cnt);
+void ff_fiberpool_execute_batch_async(struct ff_fiberpool *fiberpool, ff_fiberpool_func func, void **ctxs, int ctxs_cnt)
+{
+	int i;
 
-	task = (struct fiberpool_task *) ff_malloc(sizeof(*task));
-	task->func = func;
-	task->ctx = ctx;
-	ff_blocking_stack_push(fiberpool->pending_tasks, task);
+	ff_assert(ctxs_cnt >= 0);
 
-	if (fiberpool->running_fibers_cnt < fiberpool->max_fibers_cnt)
+	ff_arch_mutex_lock(fiberpool->mutex);
+	for (i = 0; i < ctxs_cnt; i++)
 	{
-		if (fiberpool->busy_fibers_cnt == fiberpool->running_fibers_cnt)
-		{
-			add_worker_fiber(fiberpool);
-		}
-	}
-	else
-	{
-		ff_log_debug(L"fiberpool=%p already has maximum size %d, so it cannot contain new fibers", fiberpool, fiberpool->max_fibers_cnt);
+		push_pending_task(fiberpool, func, ctxs[i]);
 	}
+	dispatch_pending_tasks(fiberpool, ctxs_cnt);
+	ff_arch_mutex_unlock(fiberpool->mutex);
+}
+
+void ff_fiberpool_set_idle_timeout(struct ff_fiberpool *fiberpool, int idle_timeout)
+{
+	ff_assert(idle_timeout >= 0);
+
+	/* idle fibers wait again with the new timeout */
+	ff_arch_mutex_lock(fiberpool->mutex);
+	fiberpool->idle_timeout = idle_timeout;
+	wake_idle_fibers(fiberpool);
+	ff_arch_mutex_unlock(fiberpool->mutex);
+}
+
+int ff_fiberpool_get_fibers_cnt(struct ff_fiberpool *fiberpool)
+{
+	int fibers_cnt;
+
+	ff_arch_mutex_lock(fiberpool->mutex);
+	fibers_cnt = fiberpool->running_fibers_cnt;
+	ff_arch_mutex_unlock(fiberpool->mutex);
+	return fibers_cnt;
 }
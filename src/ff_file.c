@@ -7,6 +7,12 @@
 
 #define BUFFER_SIZE 0x10000
 
+/**
+ * the maximum number of buffers for vectored I/O, which are copied on the stack.
+ * Larger arrays of buffers are copied into the heap
+ */
+#define MAX_STACK_IOVECS_CNT 16
+
 struct ff_file
 {
 	struct ff_arch_file *file;
@@ -15,9 +21,16 @@ struct ff_file
 		struct ff_read_stream_buffer *read_buffer;
 		struct ff_write_stream_buffer *write_buffer;
 	} buffers;
+	struct ff_stream_endpoint endpoint;
 	enum ff_file_access_mode access_mode;
 };
 
+struct ff_file_map
+{
+	struct ff_arch_file_map *map;
+	int64_t len;
+};
+
 static int file_read_func(void *ctx, void *buf, int len)
 {
 	struct ff_file *file;
@@ -50,6 +63,125 @@ static int file_write_func(void *ctx, const void *buf, int len)
 	return bytes_written;
 }
 
+static int file_readv_func(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_file *file;
+	int bytes_read;
+
+	ff_assert(iov_cnt > 0);
+
+	file = (struct ff_file *) ctx;
+	bytes_read = ff_arch_file_readv(file->file, iov, iov_cnt);
+	if (bytes_read == -1)
+	{
+		ff_log_debug(L"error while reading from the file=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", file, iov, iov_cnt);
+	}
+	return bytes_read;
+}
+
+static int file_writev_func(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_file *file;
+	int bytes_written;
+
+	ff_assert(iov_cnt > 0);
+
+	file = (struct ff_file *) ctx;
+	bytes_written = ff_arch_file_writev(file->file, iov, iov_cnt);
+	if (bytes_written == -1)
+	{
+		ff_log_debug(L"error while writing to the file=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", file, iov, iov_cnt);
+	}
+	return bytes_written;
+}
+
+/**
+ * @private
+ * Transfers all data from iov_cnt buffers of the iov at the given offset of the file.
+ * The iov is advanced in place after partial transfers.
+ */
+static enum ff_result transfer_at(struct ff_file *file, struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(iov_cnt >= 0);
+	ff_assert(offset >= 0);
+
+	while (iov_cnt > 0)
+	{
+		int bytes_transferred;
+
+		if (iov->len == 0)
+		{
+			iov++;
+			iov_cnt--;
+			continue;
+		}
+		if (file->access_mode == FF_FILE_READ)
+		{
+			bytes_transferred = ff_arch_file_preadv(file->file, iov, iov_cnt, offset);
+		}
+		else
+		{
+			bytes_transferred = ff_arch_file_pwritev(file->file, iov, iov_cnt, offset);
+		}
+		if (bytes_transferred == -1)
+		{
+			ff_log_debug(L"error while transferring data at the offset=%lld of the file=%p. See previous messages for more info", (long long) offset, file);
+			goto end;
+		}
+		if (bytes_transferred == 0)
+		{
+			ff_log_debug(L"end of the file=%p has been reached at the offset=%lld", file, (long long) offset);
+			goto end;
+		}
+		offset += bytes_transferred;
+		while (bytes_transferred > 0)
+		{
+			ff_assert(iov_cnt > 0);
+			if (bytes_transferred < iov->len)
+			{
+				iov->buf = ((char *) iov->buf) + bytes_transferred;
+				iov->len -= bytes_transferred;
+				break;
+			}
+			bytes_transferred -= iov->len;
+			iov++;
+			iov_cnt--;
+		}
+	}
+	result = FF_SUCCESS;
+
+end:
+	return result;
+}
+
+/**
+ * @private
+ * Copies the iov, so it can be advanced by transfer_at(), and transfers all data at the given offset.
+ */
+static enum ff_result transfer_vectored_at(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	struct ff_iovec stack_iov[MAX_STACK_IOVECS_CNT];
+	struct ff_iovec *iov_copy;
+	enum ff_result result;
+
+	ff_assert(iov_cnt >= 0);
+
+	iov_copy = stack_iov;
+	if (iov_cnt > MAX_STACK_IOVECS_CNT)
+	{
+		iov_copy = (struct ff_iovec *) ff_calloc(iov_cnt, sizeof(iov_copy[0]));
+	}
+	memcpy(iov_copy, iov, iov_cnt * sizeof(iov_copy[0]));
+	result = transfer_at(file, iov_copy, iov_cnt, offset);
+	if (iov_copy != stack_iov)
+	{
+		ff_free(iov_copy);
+	}
+	return result;
+}
+
 struct ff_file *ff_file_open(const wchar_t *path, enum ff_file_access_mode access_mode)
 {
 	struct ff_file *file;
@@ -71,13 +203,16 @@ struct ff_file *ff_file_open(const wchar_t *path, enum ff_file_access_mode acces
 	file = (struct ff_file *) ff_malloc(sizeof(*file));
 	file->file = arch_file;
 	file->access_mode = access_mode;
+	file->endpoint.arch_endpoint = ff_arch_file_get_endpoint(arch_file);
 	if (access_mode == FF_FILE_READ)
 	{
-		file->buffers.read_buffer = ff_read_stream_buffer_create(file_read_func, file, BUFFER_SIZE);
+		file->buffers.read_buffer = ff_read_stream_buffer_create(file_read_func, file_readv_func, file, BUFFER_SIZE);
+		file->endpoint.read_buffer = file->buffers.read_buffer;
 	}
 	else
 	{
-		file->buffers.write_buffer = ff_write_stream_buffer_create(file_write_func, file, BUFFER_SIZE);
+		file->buffers.write_buffer = ff_write_stream_buffer_create(file_write_func, file_writev_func, file, BUFFER_SIZE);
+		file->endpoint.read_buffer = NULL;
 	}
 
 end:
@@ -128,6 +263,36 @@ enum ff_result ff_file_write(struct ff_file *file, const void *buf, int len)
 	return result;
 }
 
+enum ff_result ff_file_readv(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result;
+
+	ff_assert(file->access_mode == FF_FILE_READ);
+	ff_assert(iov_cnt >= 0);
+
+	result = ff_read_stream_buffer_readv(file->buffers.read_buffer, iov, iov_cnt);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while reading from the file=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", file, iov, iov_cnt);
+	}
+	return result;
+}
+
+enum ff_result ff_file_writev(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result;
+
+	ff_assert(file->access_mode == FF_FILE_WRITE);
+	ff_assert(iov_cnt >= 0);
+
+	result = ff_write_stream_buffer_writev(file->buffers.write_buffer, iov, iov_cnt);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while writing to the file=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", file, iov, iov_cnt);
+	}
+	return result;
+}
+
 enum ff_result ff_file_flush(struct ff_file *file)
 {
 	enum ff_result result;
@@ -141,6 +306,76 @@ enum ff_result ff_file_flush(struct ff_file *file)
 	return result;
 }
 
+enum ff_result ff_file_pread(struct ff_file *file, void *buf, int len, int64_t offset)
+{
+	struct ff_iovec iov;
+	enum ff_result result;
+
+	ff_assert(file->access_mode == FF_FILE_READ);
+	ff_assert(len >= 0);
+	ff_assert(offset >= 0);
+
+	iov.buf = buf;
+	iov.len = len;
+	result = transfer_at(file, &iov, 1, offset);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while reading from the file=%p at the offset=%lld to the buf=%p, len=%d. See previous messages for more info", file, (long long) offset, buf, len);
+	}
+	return result;
+}
+
+enum ff_result ff_file_pwrite(struct ff_file *file, const void *buf, int len, int64_t offset)
+{
+	struct ff_iovec iov;
+	enum ff_result result;
+
+	ff_assert(file->access_mode == FF_FILE_WRITE);
+	ff_assert(len >= 0);
+	ff_assert(offset >= 0);
+
+	iov.buf = (void *) buf;
+	iov.len = len;
+	result = transfer_at(file, &iov, 1, offset);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while writing to the file=%p at the offset=%lld from the buf=%p, len=%d. See previous messages for more info", file, (long long) offset, buf, len);
+	}
+	return result;
+}
+
+enum ff_result ff_file_preadv(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	enum ff_result result;
+
+	ff_assert(file->access_mode == FF_FILE_READ);
+	ff_assert(iov_cnt >= 0);
+	ff_assert(offset >= 0);
+
+	result = transfer_vectored_at(file, iov, iov_cnt, offset);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while reading from the file=%p at the offset=%lld to the iov=%p, iov_cnt=%d. See previous messages for more info", file, (long long) offset, iov, iov_cnt);
+	}
+	return result;
+}
+
+enum ff_result ff_file_pwritev(struct ff_file *file, const struct ff_iovec *iov, int iov_cnt, int64_t offset)
+{
+	enum ff_result result;
+
+	ff_assert(file->access_mode == FF_FILE_WRITE);
+	ff_assert(iov_cnt >= 0);
+	ff_assert(offset >= 0);
+
+	result = transfer_vectored_at(file, iov, iov_cnt, offset);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while writing to the file=%p at the offset=%lld from the iov=%p, iov_cnt=%d. See previous messages for more info", file, (long long) offset, iov, iov_cnt);
+	}
+	return result;
+}
+
 enum ff_result ff_file_erase(const wchar_t *path)
 {
 	enum ff_result result;
@@ -184,3 +419,115 @@ int64_t ff_file_get_size(struct ff_file *file)
 	file_size = ff_arch_file_get_size(file->file);
 	return file_size;
 }
+
+enum ff_file_access_mode ff_file_get_access_mode(struct ff_file *file)
+{
+	return file->access_mode;
+}
+
+struct ff_stream_endpoint *ff_file_get_stream_endpoint(struct ff_file *file)
+{
+	struct ff_stream_endpoint *endpoint = NULL;
+
+	if (file->endpoint.arch_endpoint != NULL)
+	{
+		endpoint = &file->endpoint;
+	}
+	return endpoint;
+}
+
+struct ff_file_map *ff_file_map_create(struct ff_file *file, int64_t offset, int64_t len)
+{
+	struct ff_file_map *map = NULL;
+	struct ff_arch_file_map *arch_map;
+	int64_t file_size;
+
+	ff_assert(file->access_mode == FF_FILE_READ);
+	ff_assert(offset >= 0);
+	ff_assert(len > 0);
+
+	/* pages of the view past the end of the file cannot be accessed without SIGBUS */
+	file_size = ff_arch_file_get_size(file->file);
+	if (offset > file_size || len > file_size - offset)
+	{
+		ff_log_debug(L"cannot map %lld bytes of the file=%p at the offset=%lld past the end of the file with size=%lld", (long long) len, file, (long long) offset, (long long) file_size);
+		goto end;
+	}
+
+	arch_map = ff_arch_file_map_create(file->file, offset, len);
+	if (arch_map == NULL)
+	{
+		ff_log_debug(L"cannot map %lld bytes of the file=%p at the offset=%lld. See previous messages for more info", (long long) len, file, (long long) offset);
+		goto end;
+	}
+
+	map = (struct ff_file_map *) ff_malloc(sizeof(*map));
+	map->map = arch_map;
+	map->len = len;
+
+end:
+	return map;
+}
+
+void ff_file_map_delete(struct ff_file_map *map)
+{
+	ff_arch_file_map_delete(map->map);
+	ff_free(map);
+}
+
+const void *ff_file_map_get_data(struct ff_file_map *map)
+{
+	const void *data;
+
+	data = ff_arch_file_map_get_data(map->map);
+	return data;
+}
+
+int64_t ff_file_map_get_size(struct ff_file_map *map)
+{
+	return map->len;
+}
+
+void ff_file_map_advise(struct ff_file_map *map, int64_t offset, int64_t len, enum ff_file_map_advice advice)
+{
+	enum ff_arch_file_map_advice arch_advice;
+
+	ff_assert(offset >= 0);
+	ff_assert(len >= 0);
+	ff_assert(offset <= map->len && len <= map->len - offset);
+
+	switch (advice)
+	{
+	case FF_FILE_MAP_ADVICE_NORMAL:
+		arch_advice = FF_ARCH_FILE_MAP_ADVICE_NORMAL;
+		break;
+	case FF_FILE_MAP_ADVICE_SEQUENTIAL:
+		arch_advice = FF_ARCH_FILE_MAP_ADVICE_SEQUENTIAL;
+		break;
+	case FF_FILE_MAP_ADVICE_RANDOM:
+		arch_advice = FF_ARCH_FILE_MAP_ADVICE_RANDOM;
+		break;
+	case FF_FILE_MAP_ADVICE_WILLNEED:
+		arch_advice = FF_ARCH_FILE_MAP_ADVICE_WILLNEED;
+		break;
+	default:
+		ff_assert(0);
+		return;
+	}
+	if (len > 0)
+	{
+		ff_arch_file_map_advise(map->map, offset, len, arch_advice);
+	}
+}
+
+void ff_file_map_prefault(struct ff_file_map *map, int64_t offset, int64_t len)
+{
+	ff_assert(offset >= 0);
+	ff_assert(len >= 0);
+	ff_assert(offset <= map->len && len <= map->len - offset);
+
+	if (len > 0)
+	{
+		ff_arch_file_map_prefault(map->map, offset, len);
+	}
+}
@@ -0,0 +1,470 @@
+#include "private/ff_common.h"
+
+#include "private/ff_future.h"
+#include "private/ff_core.h"
+#include "private/ff_fiber.h"
+#include "private/arch/ff_arch_atomic.h"
+#include "private/arch/ff_arch_mutex.h"
+
+/**
+ * the maximum number of futures, which are kept in the free list for reuse.
+ */
+#define MAX_FREE_FUTURES_CNT 1024
+
+/**
+ * the maximum number of futures, which can be waited by ff_future_wait_any() without memory allocation.
+ */
+#define MAX_STACK_WAITERS_CNT 8
+
+enum future_state
+{
+	FUTURE_PENDING,
+	FUTURE_COMPLETED,
+	FUTURE_CANCELLED
+};
+
+/**
+ * @private
+ * The fiber, which waits for one or more futures.
+ * It is woken up at most once by the first completed future or by the timeout.
+ */
+struct future_wait_group
+{
+	struct ff_fiber *fiber;
+	int is_woken;
+};
+
+/**
+ * @private
+ * The link between the future and the wait group. It is allocated by the waiting fiber.
+ * It is accessed only under the mutex of the future, so the fiber can free it after unlinking.
+ */
+struct future_waiter
+{
+	struct future_waiter *prev;
+	struct future_waiter *next;
+	struct future_wait_group *group;
+	int is_linked;
+};
+
+struct ff_future
+{
+	/* the link in the free list */
+	struct ff_future *next_free;
+
+	/* guards waiters and completion of the future */
+	struct ff_arch_mutex *mutex;
+	struct future_waiter *waiters;
+
+	ff_future_func func;
+	void *ctx;
+	enum ff_core_threadpool_type threadpool_type;
+	int is_threadpool;
+
+	/* the result of the func, which is executed in the threadpool */
+	void *threadpool_result;
+
+	void *result;
+
+	/* one of the future_state values. It is read without the lock */
+	int state;
+
+	/* the future is referenced by its owner and by the fiber, which executes it */
+	int refs_cnt;
+};
+
+struct future_pool
+{
+	struct ff_arch_mutex *mutex;
+	struct ff_future *free_futures;
+	int free_futures_cnt;
+};
+
+static struct future_pool future_pool;
+
+static void delete_future(struct ff_future *future)
+{
+	ff_arch_mutex_delete(future->mutex);
+	ff_free(future);
+}
+
+static struct ff_future *acquire_future()
+{
+	struct ff_future *future;
+
+	ff_arch_mutex_lock(future_pool.mutex);
+	future = future_pool.free_futures;
+	if (future != NULL)
+	{
+		future_pool.free_futures = future->next_free;
+		future_pool.free_futures_cnt--;
+	}
+	ff_arch_mutex_unlock(future_pool.mutex);
+
+	if (future == NULL)
+	{
+		future = (struct ff_future *) ff_malloc(sizeof(*future));
+		future->mutex = ff_arch_mutex_create();
+	}
+	future->next_free = NULL;
+	future->waiters = NULL;
+	future->threadpool_result = NULL;
+	future->result = NULL;
+	future->state = FUTURE_PENDING;
+	future->refs_cnt = 2;
+	return future;
+}
+
+static void release_future(struct ff_future *future)
+{
+	int refs_cnt;
+
+	refs_cnt = ff_arch_atomic_add(&future->refs_cnt, -1);
+	ff_assert(refs_cnt >= 0);
+	if (refs_cnt == 0)
+	{
+		ff_assert(future->waiters == NULL);
+		ff_arch_mutex_lock(future_pool.mutex);
+		if (future_pool.free_futures_cnt < MAX_FREE_FUTURES_CNT)
+		{
+			future->next_free = future_pool.free_futures;
+			future_pool.free_futures = future;
+			future_pool.free_futures_cnt++;
+			future = NULL;
+		}
+		ff_arch_mutex_unlock(future_pool.mutex);
+		if (future != NULL)
+		{
+			delete_future(future);
+		}
+	}
+}
+
+static void wake_group(struct future_wait_group *group)
+{
+	if (ff_arch_atomic_exchange(&group->is_woken, 1) == 0)
+	{
+		ff_core_schedule_fiber(group->fiber);
+	}
+}
+
+static void cancel_future_wait(struct ff_fiber *fiber, void *ctx)
+{
+	struct future_wait_group *group;
+
+	(void)fiber;
+	group = (struct future_wait_group *) ctx;
+	wake_group(group);
+}
+
+/**
+ * @private
+ * Moves the pending future into the given final state and wakes up fibers, which wait for it.
+ */
+static void finish_future(struct ff_future *future, enum future_state state, void *result)
+{
+	ff_arch_mutex_lock(future->mutex);
+	if (future->state == FUTURE_PENDING)
+	{
+		struct future_waiter *waiter;
+
+		future->result = result;
+		ff_arch_atomic_set(&future->state, state);
+		waiter = future->waiters;
+		while (waiter != NULL)
+		{
+			waiter->is_linked = 0;
+			wake_group(waiter->group);
+			waiter = waiter->next;
+		}
+		future->waiters = NULL;
+	}
+	ff_arch_mutex_unlock(future->mutex);
+}
+
+static void future_threadpool_func(void *ctx)
+{
+	struct ff_future *future;
+
+	future = (struct ff_future *) ctx;
+	future->threadpool_result = future->func(future->ctx);
+}
+
+static void future_fiberpool_func(void *ctx)
+{
+	struct ff_future *future;
+
+	future = (struct ff_future *) ctx;
+	/* cancelled futures don't execute their funcs */
+	if (ff_arch_atomic_get(&future->state) == FUTURE_PENDING)
+	{
+		void *result;
+
+		if (future->is_threadpool)
+		{
+			ff_core_threadpool_execute(future->threadpool_type, future_threadpool_func, future);
+			result = future->threadpool_result;
+		}
+		else
+		{
+			result = future->func(future->ctx);
+		}
+		finish_future(future, FUTURE_COMPLETED, result);
+	}
+	release_future(future);
+}
+
+static void link_waiter(struct ff_future *future, struct future_waiter *waiter)
+{
+	waiter->prev = NULL;
+	waiter->next = future->waiters;
+	if (future->waiters != NULL)
+	{
+		future->waiters->prev = waiter;
+	}
+	future->waiters = waiter;
+	waiter->is_linked = 1;
+}
+
+static void unlink_waiter(struct ff_future *future, struct future_waiter *waiter)
+{
+	ff_arch_mutex_lock(future->mutex);
+	if (waiter->is_linked)
+	{
+		if (waiter->prev != NULL)
+		{
+			waiter->prev->next = waiter->next;
+		}
+		else
+		{
+			future->waiters = waiter->next;
+		}
+		if (waiter->next != NULL)
+		{
+			waiter->next->prev = waiter->prev;
+		}
+		waiter->is_linked = 0;
+	}
+	ff_arch_mutex_unlock(future->mutex);
+}
+
+/**
+ * @private
+ * Waits until any of the futures is completed or cancelled.
+ * Returns the index of this future or -1 if the timeout expired.
+ * The wait is infinite if the timeout is 0.
+ */
+static int wait_for_any_future(struct ff_future **futures, int futures_cnt, int timeout)
+{
+	struct future_wait_group group;
+	struct future_waiter stack_waiters[MAX_STACK_WAITERS_CNT];
+	struct future_waiter *waiters;
+	int linked_waiters_cnt;
+	int done_index = -1;
+	int i;
+
+	ff_assert(futures_cnt > 0);
+	ff_assert(timeout >= 0);
+
+	waiters = stack_waiters;
+	if (futures_cnt > MAX_STACK_WAITERS_CNT)
+	{
+		waiters = (struct future_waiter *) ff_calloc(futures_cnt, sizeof(waiters[0]));
+	}
+	group.fiber = ff_fiber_get_current();
+	group.is_woken = 0;
+
+	for (linked_waiters_cnt = 0; linked_waiters_cnt < futures_cnt; linked_waiters_cnt++)
+	{
+		struct ff_future *future;
+		struct future_waiter *waiter;
+
+		future = futures[linked_waiters_cnt];
+		waiter = &waiters[linked_waiters_cnt];
+		waiter->group = &group;
+		ff_arch_mutex_lock(future->mutex);
+		if (future->state != FUTURE_PENDING)
+		{
+			ff_arch_mutex_unlock(future->mutex);
+			done_index = linked_waiters_cnt;
+			break;
+		}
+		link_waiter(future, waiter);
+		ff_arch_mutex_unlock(future->mutex);
+	}
+
+	if (done_index == -1)
+	{
+		if (timeout > 0)
+		{
+			struct ff_core_timeout_operation_data timeout_operation_data;
+
+			ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_future_wait, &group);
+			ff_core_yield_fiber();
+			ff_core_deregister_timeout_operation(&timeout_operation_data);
+		}
+		else
+		{
+			ff_core_yield_fiber();
+		}
+	}
+	else if (ff_arch_atomic_exchange(&group.is_woken, 1) != 0)
+	{
+		/* one of already linked futures has been completed and has scheduled the current fiber,
+		 * so the fiber must yield in order to consume this wakeup
+		 */
+		ff_core_yield_fiber();
+	}
+
+	for (i = 0; i < linked_waiters_cnt; i++)
+	{
+		unlink_waiter(futures[i], &waiters[i]);
+	}
+	if (done_index == -1)
+	{
+		for (i = 0; i < futures_cnt; i++)
+		{
+			if (ff_arch_atomic_get(&futures[i]->state) != FUTURE_PENDING)
+			{
+				done_index = i;
+				break;
+			}
+		}
+	}
+
+	if (waiters != stack_waiters)
+	{
+		ff_free(waiters);
+	}
+	return done_index;
+}
+
+static enum ff_result get_future_result(struct ff_future *future)
+{
+	enum ff_result result = FF_FAILURE;
+
+	if (ff_arch_atomic_get(&future->state) == FUTURE_COMPLETED)
+	{
+		result = FF_SUCCESS;
+	}
+	return result;
+}
+
+void ff_future_initialize()
+{
+	future_pool.mutex = ff_arch_mutex_create();
+	future_pool.free_futures = NULL;
+	future_pool.free_futures_cnt = 0;
+}
+
+void ff_future_shutdown()
+{
+	while (future_pool.free_futures != NULL)
+	{
+		struct ff_future *future;
+
+		future = future_pool.free_futures;
+		future_pool.free_futures = future->next_free;
+		future_pool.free_futures_cnt--;
+		delete_future(future);
+	}
+	ff_assert(future_pool.free_futures_cnt == 0);
+	ff_arch_mutex_delete(future_pool.mutex);
+}
+
+struct ff_future *ff_future_fiberpool_execute_async(ff_future_func func, void *ctx)
+{
+	struct ff_future *future;
+
+	future = acquire_future();
+	future->func = func;
+	future->ctx = ctx;
+	future->is_threadpool = 0;
+	ff_core_fiberpool_execute_async(future_fiberpool_func, future);
+
+	return future;
+}
+
+struct ff_future *ff_future_threadpool_execute_async(enum ff_core_threadpool_type threadpool_type, ff_future_func func, void *ctx)
+{
+	struct ff_future *future;
+
+	/* the fiber from the fiberpool waits for the threadpool, so the caller isn't blocked */
+	future = acquire_future();
+	future->func = func;
+	future->ctx = ctx;
+	future->threadpool_type = threadpool_type;
+	future->is_threadpool = 1;
+	ff_core_fiberpool_execute_async(future_fiberpool_func, future);
+
+	return future;
+}
+
+void ff_future_delete(struct ff_future *future)
+{
+	release_future(future);
+}
+
+void ff_future_cancel(struct ff_future *future)
+{
+	finish_future(future, FUTURE_CANCELLED, NULL);
+}
+
+enum ff_result ff_future_wait(struct ff_future *future)
+{
+	enum ff_result result;
+	int done_index;
+
+	done_index = wait_for_any_future(&future, 1, 0);
+	ff_assert(done_index == 0);
+	result = get_future_result(future);
+	return result;
+}
+
+enum ff_result ff_future_wait_with_timeout(struct ff_future *future, int timeout)
+{
+	enum ff_result result = FF_FAILURE;
+	int done_index;
+
+	ff_assert(timeout > 0);
+
+	done_index = wait_for_any_future(&future, 1, timeout);
+	if (done_index == 0)
+	{
+		result = get_future_result(future);
+	}
+	return result;
+}
+
+enum ff_result ff_future_wait_all(struct ff_future **futures, int futures_cnt)
+{
+	enum ff_result result = FF_SUCCESS;
+	int i;
+
+	ff_assert(futures_cnt > 0);
+
+	for (i = 0; i < futures_cnt; i++)
+	{
+		if (ff_future_wait(futures[i]) != FF_SUCCESS)
+		{
+			result = FF_FAILURE;
+		}
+	}
+	return result;
+}
+
+int ff_future_wait_any(struct ff_future **futures, int futures_cnt)
+{
+	int done_index;
+
+	done_index = wait_for_any_future(futures, futures_cnt, 0);
+	ff_assert(done_index >= 0 && done_index < futures_cnt);
+	return done_index;
+}
+
+void *ff_future_get_result(struct ff_future *future)
+{
+	ff_assert(ff_arch_atomic_get(&future->state) == FUTURE_COMPLETED);
+
+	return future->result;
+}
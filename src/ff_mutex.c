@@ -1,13 +1,14 @@
 #include "private/ff_common.h"
 
 #include "private/ff_mutex.h"
-#include "private/ff_stack.h"
 #include "private/ff_core.h"
 #include "private/ff_fiber.h"
+#include "private/arch/ff_arch_mutex.h"
 
 struct ff_mutex
 {
-	struct ff_stack *pending_fibers;
+	struct ff_arch_mutex *guard;
+	struct ff_fiber_list pending_fibers;
 	int is_locked;
 };
 
@@ -16,7 +17,8 @@ struct ff_mutex *ff_mutex_create()
 	struct ff_mutex *mutex;
 	
 	mutex = (struct ff_mutex *) ff_malloc(sizeof(*mutex));
-	mutex->pending_fibers = ff_stack_create();
+	mutex->guard = ff_arch_mutex_create();
+	ff_fiber_list_initialize(&mutex->pending_fibers);
 	mutex->is_locked = 0;
 	return mutex;
 }
@@ -25,41 +27,39 @@ void ff_mutex_delete(struct ff_mutex *mutex)
 {
 	ff_assert(!mutex->is_locked);
 
-	ff_stack_delete(mutex->pending_fibers);
+	ff_assert(ff_fiber_list_is_empty(&mutex->pending_fibers));
+	ff_arch_mutex_delete(mutex->guard);
 	ff_free(mutex);
 }
 
 void ff_mutex_lock(struct ff_mutex *mutex)
 {
-	struct ff_stack *pending_fibers;
-
-	pending_fibers = mutex->pending_fibers;
+	ff_arch_mutex_lock(mutex->guard);
 	while (mutex->is_locked)
 	{
 		struct ff_fiber *current_fiber;
 
 		current_fiber = ff_fiber_get_current();
-		ff_stack_push(pending_fibers, current_fiber);
+		ff_fiber_list_push_front(&mutex->pending_fibers, current_fiber);
+		ff_arch_mutex_unlock(mutex->guard);
 		ff_core_yield_fiber();
+		ff_arch_mutex_lock(mutex->guard);
 	}
 	mutex->is_locked = 1;
+	ff_arch_mutex_unlock(mutex->guard);
 }
 
 void ff_mutex_unlock(struct ff_mutex *mutex)
 {
-	struct ff_stack *pending_fibers;
-	int is_empty;
+	struct ff_fiber *fiber;
 
+	ff_arch_mutex_lock(mutex->guard);
 	ff_assert(mutex->is_locked);
-	pending_fibers = mutex->pending_fibers;
-	is_empty = ff_stack_is_empty(pending_fibers);
-	if (!is_empty)
+	fiber = ff_fiber_list_pop_front(&mutex->pending_fibers);
+	if (fiber != NULL)
 	{
-		struct ff_fiber *fiber;
-
-		ff_stack_top(pending_fibers, (const void **) &fiber);
-		ff_stack_pop(pending_fibers);
 		ff_core_schedule_fiber(fiber);
 	}
 	mutex->is_locked = 0;
+	ff_arch_mutex_unlock(mutex->guard);
 }
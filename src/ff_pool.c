@@ -3,6 +3,7 @@
 #include "private/ff_pool.h"
 #include "private/ff_semaphore.h"
 #include "private/ff_stack.h"
+#include "private/arch/ff_arch_mutex.h"
 
 struct ff_pool
 {
@@ -11,6 +12,7 @@ struct ff_pool
 	void *entry_constructor_ctx;
 	void *entry_destructor_ctx;
 	struct ff_semaphore *semaphore;
+	struct ff_arch_mutex *mutex;
 	struct ff_stack *free_entries;
 	int max_size;
 	int current_size;
@@ -19,27 +21,36 @@ struct ff_pool
 
 static void get_free_entry(struct ff_pool *pool, void **entry)
 {
-        struct ff_stack *free_entries;
-
-        ff_assert(pool != NULL);
-        ff_assert(entry != NULL);
-
-        ff_assert(pool->current_size <= pool->max_size);
-        ff_assert(pool->busy_entries_cnt <= pool->current_size);
-        ff_assert(pool->busy_entries_cnt < pool->max_size);
-        ff_assert(pool->busy_entries_cnt >= 0);
-        free_entries = pool->free_entries;
-        if (pool->busy_entries_cnt == pool->current_size)
-        {
-                void *new_entry;
-
-                new_entry = pool->entry_constructor(pool->entry_constructor_ctx);
-                ff_stack_push(free_entries, new_entry);
-                pool->current_size++;
-        }
-        ff_stack_top(free_entries, (const void **) entry);
-        ff_stack_pop(free_entries);
-        pool->busy_entries_cnt++;
+	struct ff_stack *free_entries;
+	int is_new_entry = 0;
+
+	ff_assert(pool != NULL);
+	ff_assert(entry != NULL);
+
+	ff_arch_mutex_lock(pool->mutex);
+	ff_assert(pool->current_size <= pool->max_size);
+	ff_assert(pool->busy_entries_cnt <= pool->current_size);
+	ff_assert(pool->busy_entries_cnt < pool->max_size);
+	ff_assert(pool->busy_entries_cnt >= 0);
+	free_entries = pool->free_entries;
+	if (pool->busy_entries_cnt == pool->current_size)
+	{
+		/* the entry will be constructed outside the lock, because the constructor can block */
+		pool->current_size++;
+		is_new_entry = 1;
+	}
+	else
+	{
+		ff_stack_top(free_entries, (const void **) entry);
+		ff_stack_pop(free_entries);
+	}
+	pool->busy_entries_cnt++;
+	ff_arch_mutex_unlock(pool->mutex);
+
+	if (is_new_entry)
+	{
+		*entry = pool->entry_constructor(pool->entry_constructor_ctx);
+	}
 }
 
 struct ff_pool *ff_pool_create(int max_size, ff_pool_entry_constructor entry_constructor, void *entry_constructor_ctx, ff_pool_entry_destructor entry_destructor, void *entry_destructor_ctx)
@@ -56,6 +67,7 @@ struct ff_pool *ff_pool_create(int max_size, ff_pool_entry_constructor entry_con
 	pool->entry_constructor_ctx = entry_constructor_ctx;
 	pool->entry_destructor_ctx = entry_destructor_ctx;
 	pool->semaphore = ff_semaphore_create(max_size);
+	pool->mutex = ff_arch_mutex_create();
 	pool->free_entries = ff_stack_create();
 	pool->max_size = max_size;
 	pool->current_size = 0;
@@ -86,6 +98,7 @@ void ff_pool_delete(struct ff_pool *pool)
 		entry_destructor(entry_destructor_ctx, entry);
 	}
 	ff_stack_delete(free_entries);
+	ff_arch_mutex_delete(pool->mutex);
 	ff_semaphore_delete(pool->semaphore);
 	ff_free(pool);
 }
@@ -122,11 +135,13 @@ enum ff_result ff_pool_acquire_entry_with_timeout(struct ff_pool *pool, void **e
 
 void ff_pool_release_entry(struct ff_pool *pool, void *entry)
 {
+	ff_arch_mutex_lock(pool->mutex);
 	ff_assert(pool->current_size <= pool->max_size);
 	ff_assert(pool->busy_entries_cnt <= pool->current_size);
 	ff_assert(pool->busy_entries_cnt > 0);
 	ff_stack_push(pool->free_entries, entry);
 	pool->busy_entries_cnt--;
+	ff_arch_mutex_unlock(pool->mutex);
 
 	ff_semaphore_up(pool->semaphore);
 }
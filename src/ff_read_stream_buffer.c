@@ -2,9 +2,16 @@
 
 #include "private/ff_read_stream_buffer.h"
 
+/**
+ * the maximum number of buffers for vectored reads, which are copied on the stack.
+ * Larger arrays of buffers are copied into the heap
+ */
+#define MAX_STACK_IOVECS_CNT 16
+
 struct ff_read_stream_buffer
 {
 	ff_read_stream_func read_func;
+	ff_readv_stream_func readv_func;
 	void *read_func_ctx;
 	char *buf;
 	int capacity;
@@ -12,7 +19,74 @@ struct ff_read_stream_buffer
 	int start_pos;
 };
 
-struct ff_read_stream_buffer *ff_read_stream_buffer_create(ff_read_stream_func read_func, void *read_func_ctx, int capacity)
+/**
+ * @private
+ * Fills iov_cnt buffers from the iov by data from the underlying stream, so exactly len bytes are read into them.
+ * The last buffer of the iov must point to the empty buffer's memory, so data read ahead by the last
+ * readv_func call remains in the buffer. Other buffers must have exactly len bytes in total.
+ * The iov is advanced in place after partial reads.
+ */
+static enum ff_result read_vectored(struct ff_read_stream_buffer *buffer, struct ff_iovec *iov, int iov_cnt, int len)
+{
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(buffer->size == 0);
+	ff_assert(iov_cnt > 1);
+	ff_assert(len > 0);
+
+	while (len > 0)
+	{
+		int bytes_read;
+
+		if (iov->len == 0)
+		{
+			iov++;
+			iov_cnt--;
+			continue;
+		}
+		bytes_read = buffer->readv_func(buffer->read_func_ctx, iov, iov_cnt);
+		if (bytes_read == -1)
+		{
+			ff_log_debug(L"error while reading %d bytes to the iov=%p, iov_cnt=%d. See previous messages for more info", len, iov, iov_cnt);
+			goto end;
+		}
+		if (bytes_read == 0)
+		{
+			/* end of stream reached, but we didn't read requested len bytes of data,
+			 * so treat this as an error.
+			 */
+			ff_log_debug(L"end of stream reached, but %d bytes must be read into the iov=%p", len, iov);
+			goto end;
+		}
+		if (bytes_read >= len)
+		{
+			/* the rest of data has been read ahead into the buffer */
+			buffer->size = bytes_read - len;
+			buffer->start_pos = 0;
+			break;
+		}
+		len -= bytes_read;
+		while (bytes_read > 0)
+		{
+			ff_assert(iov_cnt > 1);
+			if (bytes_read < iov->len)
+			{
+				iov->buf = ((char *) iov->buf) + bytes_read;
+				iov->len -= bytes_read;
+				break;
+			}
+			bytes_read -= iov->len;
+			iov++;
+			iov_cnt--;
+		}
+	}
+	result = FF_SUCCESS;
+
+end:
+	return result;
+}
+
+struct ff_read_stream_buffer *ff_read_stream_buffer_create(ff_read_stream_func read_func, ff_readv_stream_func readv_func, void *read_func_ctx, int capacity)
 {
 	struct ff_read_stream_buffer *buffer;
 
@@ -20,6 +94,7 @@ struct ff_read_stream_buffer *ff_read_stream_buffer_create(ff_read_stream_func r
 
 	buffer = (struct ff_read_stream_buffer *) ff_malloc(sizeof(*buffer));
 	buffer->read_func = read_func;
+	buffer->readv_func = readv_func;
 	buffer->read_func_ctx = read_func_ctx;
 	buffer->buf = (char *) ff_calloc(capacity, sizeof(buffer->buf[0]));
 	buffer->capacity = capacity;
@@ -134,3 +209,112 @@ enum ff_result ff_read_stream_buffer_read(struct ff_read_stream_buffer *buffer,
 end:
 	return result;
 }
+
+enum ff_result ff_read_stream_buffer_readv(struct ff_read_stream_buffer *buffer, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_iovec stack_iov[MAX_STACK_IOVECS_CNT];
+	struct ff_iovec *iov_copy;
+	int iov_copy_cnt;
+	int offset;
+	int len;
+	int i;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(buffer->capacity > 0);
+	ff_assert(iov_cnt >= 0);
+
+	if (buffer->readv_func == NULL)
+	{
+		/* the underlying stream doesn't support scatter reads */
+		for (i = 0; i < iov_cnt; i++)
+		{
+			result = ff_read_stream_buffer_read(buffer, iov[i].buf, iov[i].len);
+			if (result != FF_SUCCESS)
+			{
+				ff_log_debug(L"error while reading data to the %d-th buffer of the iov=%p. See previous messages for more info", i, iov);
+				goto end;
+			}
+		}
+		result = FF_SUCCESS;
+		goto end;
+	}
+
+	/* fill leading buffers by data, which is already in the buffer */
+	i = 0;
+	offset = 0;
+	while (i < iov_cnt && buffer->size > 0)
+	{
+		int bytes_read;
+
+		ff_assert(iov[i].len >= 0);
+		bytes_read = iov[i].len - offset;
+		if (bytes_read > buffer->size)
+		{
+			bytes_read = buffer->size;
+		}
+		memcpy(((char *) iov[i].buf) + offset, buffer->buf + buffer->start_pos, bytes_read);
+		buffer->start_pos += bytes_read;
+		buffer->size -= bytes_read;
+		offset += bytes_read;
+		if (offset == iov[i].len)
+		{
+			i++;
+			offset = 0;
+		}
+	}
+
+	len = 0;
+	for (iov_copy_cnt = i; iov_copy_cnt < iov_cnt; iov_copy_cnt++)
+	{
+		ff_assert(iov[iov_copy_cnt].len >= 0);
+		len += iov[iov_copy_cnt].len;
+	}
+	len -= offset;
+	if (len == 0)
+	{
+		result = FF_SUCCESS;
+		goto end;
+	}
+
+	/* the buffer is empty, so read the rest of data directly into requested buffers
+	 * and read ahead the next chunk of data into the buffer by the same readv_func call
+	 */
+	iov_copy_cnt = iov_cnt - i + 1;
+	iov_copy = stack_iov;
+	if (iov_copy_cnt > MAX_STACK_IOVECS_CNT)
+	{
+		iov_copy = (struct ff_iovec *) ff_calloc(iov_copy_cnt, sizeof(iov_copy[0]));
+	}
+	memcpy(iov_copy, iov + i, (iov_copy_cnt - 1) * sizeof(iov_copy[0]));
+	iov_copy[0].buf = ((char *) iov_copy[0].buf) + offset;
+	iov_copy[0].len -= offset;
+	iov_copy[iov_copy_cnt - 1].buf = buffer->buf;
+	iov_copy[iov_copy_cnt - 1].len = buffer->capacity;
+	result = read_vectored(buffer, iov_copy, iov_copy_cnt, len);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while reading %d bytes to the iov=%p, iov_cnt=%d. See previous messages for more info", len, iov, iov_cnt);
+	}
+	if (iov_copy != stack_iov)
+	{
+		ff_free(iov_copy);
+	}
+
+end:
+	return result;
+}
+
+int ff_read_stream_buffer_read_buffered(struct ff_read_stream_buffer *buffer, const void **data, int len)
+{
+	int bytes_read;
+
+	ff_assert(buffer->size >= 0);
+	ff_assert(len >= 0);
+
+	bytes_read = len > buffer->size ? buffer->size : len;
+	*data = buffer->buf + buffer->start_pos;
+	buffer->start_pos += bytes_read;
+	buffer->size -= bytes_read;
+
+	return bytes_read;
+}
@@ -2,9 +2,11 @@
 
 #include "private/ff_semaphore.h"
 #include "private/ff_event.h"
+#include "private/arch/ff_arch_mutex.h"
 
 struct ff_semaphore
 {
+	struct ff_arch_mutex *mutex;
 	struct ff_event *event;
 	int value;
 };
@@ -16,6 +18,7 @@ struct ff_semaphore *ff_semaphore_create(int value)
 	ff_assert(value >= 0);
 
 	semaphore = (struct ff_semaphore *) ff_malloc(sizeof(*semaphore));
+	semaphore->mutex = ff_arch_mutex_create();
 	semaphore->event = ff_event_create(FF_EVENT_AUTO);
 	semaphore->value = value;
 
@@ -27,36 +30,41 @@ void ff_semaphore_delete(struct ff_semaphore *semaphore)
 	ff_assert(semaphore->value >= 0);
 
 	ff_event_delete(semaphore->event);
+	ff_arch_mutex_delete(semaphore->mutex);
 	ff_free(semaphore);
 }
 
 void ff_semaphore_up(struct ff_semaphore *semaphore)
 {
+	ff_arch_mutex_lock(semaphore->mutex);
 	ff_assert(semaphore->value >= 0);
-
 	semaphore->value++;
 	if (semaphore->value == 1)
 	{
 		ff_event_set(semaphore->event);
 	}
+	ff_arch_mutex_unlock(semaphore->mutex);
 }
 
 void ff_semaphore_down(struct ff_semaphore *semaphore)
 {
 	struct ff_event *event;
 
-	ff_assert(semaphore->value >= 0);
-
 	event = semaphore->event;
+	ff_arch_mutex_lock(semaphore->mutex);
+	ff_assert(semaphore->value >= 0);
 	while (semaphore->value == 0)
 	{
+		ff_arch_mutex_unlock(semaphore->mutex);
 		ff_event_wait(event);
+		ff_arch_mutex_lock(semaphore->mutex);
 	}
 	semaphore->value--;
 	if (semaphore->value > 0)
 	{
 		ff_event_set(event);
 	}
+	ff_arch_mutex_unlock(semaphore->mutex);
 }
 
 enum ff_result ff_semaphore_down_with_timeout(struct ff_semaphore *semaphore, int timeout)
@@ -64,23 +72,27 @@ enum ff_result ff_semaphore_down_with_timeout(struct ff_semaphore *semaphore, in
 	struct ff_event *event;
 	enum ff_result result = FF_SUCCESS;
 
-	ff_assert(semaphore->value >= 0);
 	ff_assert(timeout > 0);
 
 	event = semaphore->event;
+	ff_arch_mutex_lock(semaphore->mutex);
+	ff_assert(semaphore->value >= 0);
 	while (semaphore->value == 0)
 	{
+		ff_arch_mutex_unlock(semaphore->mutex);
 		result = ff_event_wait_with_timeout(event, timeout);
 		if (result != FF_SUCCESS)
 		{
 			goto end;
 		}
+		ff_arch_mutex_lock(semaphore->mutex);
 	}
 	semaphore->value--;
 	if (semaphore->value > 0)
 	{
 		ff_event_set(event);
 	}
+	ff_arch_mutex_unlock(semaphore->mutex);
 
 end:
 	return result;
@@ -2,6 +2,7 @@
 
 #include "private/ff_stream.h"
 #include "private/ff_hash.h"
+#include "private/ff_stream_endpoint.h"
 
 #define BUF_SIZE 0x10000
 
@@ -55,6 +56,56 @@ enum ff_result ff_stream_write(struct ff_stream *stream, const void *buf, int le
 	return result;
 }
 
+enum ff_result ff_stream_readv(struct ff_stream *stream, const struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result = FF_SUCCESS;
+	int i;
+
+	ff_assert(iov_cnt >= 0);
+
+	if (stream->vtable->readv != NULL)
+	{
+		result = stream->vtable->readv(stream->ctx, iov, iov_cnt);
+	}
+	else
+	{
+		for (i = 0; i < iov_cnt && result == FF_SUCCESS; i++)
+		{
+			result = stream->vtable->read(stream->ctx, iov[i].buf, iov[i].len);
+		}
+	}
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot read data from the stream=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", stream, iov, iov_cnt);
+	}
+	return result;
+}
+
+enum ff_result ff_stream_writev(struct ff_stream *stream, const struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result = FF_SUCCESS;
+	int i;
+
+	ff_assert(iov_cnt >= 0);
+
+	if (stream->vtable->writev != NULL)
+	{
+		result = stream->vtable->writev(stream->ctx, iov, iov_cnt);
+	}
+	else
+	{
+		for (i = 0; i < iov_cnt && result == FF_SUCCESS; i++)
+		{
+			result = stream->vtable->write(stream->ctx, iov[i].buf, iov[i].len);
+		}
+	}
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot write data to the stream=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", stream, iov, iov_cnt);
+	}
+	return result;
+}
+
 enum ff_result ff_stream_flush(struct ff_stream *stream)
 {
 	enum ff_result result;
@@ -72,6 +123,107 @@ void ff_stream_disconnect(struct ff_stream *stream)
 	stream->vtable->disconnect(stream->ctx);
 }
 
+/**
+ * @private
+ * Returns the pointer to the next len bytes of the stream, which supports direct reads.
+ * Returns NULL on error.
+ */
+static const void *read_direct(struct ff_stream *stream, int len)
+{
+	const void *data;
+
+	ff_assert(stream->vtable->read_direct != NULL);
+	ff_assert(len >= 0);
+
+	data = stream->vtable->read_direct(stream->ctx, len);
+	if (data == NULL)
+	{
+		ff_log_debug(L"cannot read directly %d bytes from the stream=%p. See previous messages for more info", len, stream);
+	}
+	return data;
+}
+
+/**
+ * @private
+ * Copies len bytes from the src_stream, which supports direct reads, to the dst_stream
+ * without the intermediate buffer.
+ */
+static enum ff_result copy_direct(struct ff_stream *src_stream, struct ff_stream *dst_stream, int len)
+{
+	const void *data;
+	enum ff_result result;
+
+	data = read_direct(src_stream, len);
+	if (data == NULL)
+	{
+		ff_log_debug(L"cannot read %d bytes directly from the src_stream=%p. See previous messages for more info", len, src_stream);
+		return FF_FAILURE;
+	}
+	result = ff_stream_write(dst_stream, data, len);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot write to the dst_stream=%p from data=%p, len=%d. See previous messages for more info", dst_stream, data, len);
+	}
+	return result;
+}
+
+/**
+ * @private
+ * Returns the endpoint of the stream or NULL if the stream isn't backed by the kernel object.
+ */
+static struct ff_stream_endpoint *get_endpoint(struct ff_stream *stream)
+{
+	struct ff_stream_endpoint *endpoint = NULL;
+
+	if (stream->vtable->get_endpoint != NULL)
+	{
+		endpoint = stream->vtable->get_endpoint(stream->ctx);
+	}
+	return endpoint;
+}
+
+/**
+ * @private
+ * Copies len bytes from the src_stream to the dst_stream in the kernel.
+ * Data, which is already buffered by streams, is processed first, so the order of data is preserved.
+ */
+static enum ff_result copy_by_endpoints(struct ff_stream *src_stream, struct ff_stream *dst_stream,
+	struct ff_stream_endpoint *src_endpoint, struct ff_stream_endpoint *dst_endpoint, int len)
+{
+	const void *data;
+	int bytes_read;
+	enum ff_result result;
+
+	bytes_read = ff_read_stream_buffer_read_buffered(src_endpoint->read_buffer, &data, len);
+	if (bytes_read > 0)
+	{
+		result = ff_stream_write(dst_stream, data, bytes_read);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"cannot write buffered data to the dst_stream=%p from data=%p, len=%d. See previous messages for more info", dst_stream, data, bytes_read);
+			return FF_FAILURE;
+		}
+		len -= bytes_read;
+	}
+	if (len == 0)
+	{
+		return FF_SUCCESS;
+	}
+
+	result = ff_stream_flush(dst_stream);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot flush the dst_stream=%p. See previous messages for more info", dst_stream);
+		return FF_FAILURE;
+	}
+	result = ff_arch_endpoint_transfer(src_endpoint->arch_endpoint, dst_endpoint->arch_endpoint, len);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"cannot transfer %d bytes from the src_stream=%p to the dst_stream=%p. See previous messages for more info", len, src_stream, dst_stream);
+	}
+	return result;
+}
+
 enum ff_result ff_stream_copy(struct ff_stream *src_stream, struct ff_stream *dst_stream, int len)
 {
 	uint8_t *buf;
@@ -79,6 +231,27 @@ enum ff_result ff_stream_copy(struct ff_stream *src_stream, struct ff_stream *ds
 
 	ff_assert(len >= 0);
 
+	if (src_stream->vtable->read_direct != NULL)
+	{
+		result = copy_direct(src_stream, dst_stream, len);
+		return result;
+	}
+	/* small copies are cheaper through the buffer than through the kernel-side transfer setup */
+	if (len >= BUF_SIZE)
+	{
+		struct ff_stream_endpoint *src_endpoint;
+		struct ff_stream_endpoint *dst_endpoint;
+
+		src_endpoint = get_endpoint(src_stream);
+		dst_endpoint = get_endpoint(dst_stream);
+		if (src_endpoint != NULL && dst_endpoint != NULL && src_endpoint->read_buffer != NULL &&
+			ff_arch_endpoint_can_transfer(src_endpoint->arch_endpoint, dst_endpoint->arch_endpoint))
+		{
+			result = copy_by_endpoints(src_stream, dst_stream, src_endpoint, dst_endpoint, len);
+			return result;
+		}
+	}
+
 	buf = (uint8_t *) ff_calloc(BUF_SIZE, sizeof(buf[0]));
 	while (len > 0)
 	{
@@ -115,6 +288,31 @@ enum ff_result ff_stream_get_hash(struct ff_stream *stream, int len, uint32_t st
 	ff_assert(len >= 0);
 
 	hash = start_value;
+	if (stream->vtable->read_direct != NULL)
+	{
+		const uint8_t *data;
+
+		data = (const uint8_t *) read_direct(stream, len);
+		if (data == NULL)
+		{
+			ff_log_debug(L"cannot read %d bytes directly from the stream=%p. See previous messages for more info", len, stream);
+			return FF_FAILURE;
+		}
+
+		/* the hash value depends on chunk boundaries, so chunks must match the buffered path below */
+		while (len > 0)
+		{
+			int chunk_size;
+
+			chunk_size = len > BUF_SIZE ? BUF_SIZE : len;
+			hash = ff_hash_uint8(hash, data, chunk_size);
+			data += chunk_size;
+			len -= chunk_size;
+		}
+		*hash_value = hash;
+		return FF_SUCCESS;
+	}
+
 	buf = (uint8_t *) ff_calloc(BUF_SIZE, sizeof(buf[0]));
 	while (len > 0)
 	{
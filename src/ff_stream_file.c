@@ -0,0 +1,198 @@
+#include "private/ff_common.h"
+
+#include "private/ff_stream_file.h"
+#include "private/ff_file.h"
+
+struct file_stream
+{
+	struct ff_file *file;
+
+	/* files cannot be disconnected, so the stream fails subsequent operations itself */
+	int is_disconnected;
+};
+
+static void delete_file(void *ctx)
+{
+	struct file_stream *stream;
+
+	stream = (struct file_stream *) ctx;
+	ff_file_close(stream->file);
+	ff_free(stream);
+}
+
+static enum ff_result read_from_file(void *ctx, void *buf, int len)
+{
+	struct file_stream *stream;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(len >= 0);
+
+	stream = (struct file_stream *) ctx;
+	if (stream->is_disconnected)
+	{
+		ff_log_debug(L"the file_stream=%p was already disconnected, so it cannot be used for reading data to the buf=%p, len=%d", stream, buf, len);
+	}
+	else if (ff_file_get_access_mode(stream->file) != FF_FILE_READ)
+	{
+		ff_log_debug(L"the file_stream=%p is write-only, so it cannot be used for reading data to the buf=%p, len=%d", stream, buf, len);
+	}
+	else
+	{
+		result = ff_file_read(stream->file, buf, len);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while reading from the file=%p to the buf=%p, len=%d. See previous messages for more info", stream->file, buf, len);
+		}
+	}
+	return result;
+}
+
+static enum ff_result write_to_file(void *ctx, const void *buf, int len)
+{
+	struct file_stream *stream;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(len >= 0);
+
+	stream = (struct file_stream *) ctx;
+	if (stream->is_disconnected)
+	{
+		ff_log_debug(L"the file_stream=%p was already disconnected, so it cannot be used for writing data from the buf=%p, len=%d", stream, buf, len);
+	}
+	else if (ff_file_get_access_mode(stream->file) != FF_FILE_WRITE)
+	{
+		ff_log_debug(L"the file_stream=%p is read-only, so it cannot be used for writing data from the buf=%p, len=%d", stream, buf, len);
+	}
+	else
+	{
+		result = ff_file_write(stream->file, buf, len);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while writing to the file=%p from the buf=%p, len=%d. See previous messages for more info", stream->file, buf, len);
+		}
+	}
+	return result;
+}
+
+static enum ff_result readv_from_file(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct file_stream *stream;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(iov_cnt >= 0);
+
+	stream = (struct file_stream *) ctx;
+	if (stream->is_disconnected)
+	{
+		ff_log_debug(L"the file_stream=%p was already disconnected, so it cannot be used for reading data to the iov=%p, iov_cnt=%d", stream, iov, iov_cnt);
+	}
+	else if (ff_file_get_access_mode(stream->file) != FF_FILE_READ)
+	{
+		ff_log_debug(L"the file_stream=%p is write-only, so it cannot be used for reading data to the iov=%p, iov_cnt=%d", stream, iov, iov_cnt);
+	}
+	else
+	{
+		result = ff_file_readv(stream->file, iov, iov_cnt);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while reading from the file=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", stream->file, iov, iov_cnt);
+		}
+	}
+	return result;
+}
+
+static enum ff_result writev_to_file(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct file_stream *stream;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(iov_cnt >= 0);
+
+	stream = (struct file_stream *) ctx;
+	if (stream->is_disconnected)
+	{
+		ff_log_debug(L"the file_stream=%p was already disconnected, so it cannot be used for writing data from the iov=%p, iov_cnt=%d", stream, iov, iov_cnt);
+	}
+	else if (ff_file_get_access_mode(stream->file) != FF_FILE_WRITE)
+	{
+		ff_log_debug(L"the file_stream=%p is read-only, so it cannot be used for writing data from the iov=%p, iov_cnt=%d", stream, iov, iov_cnt);
+	}
+	else
+	{
+		result = ff_file_writev(stream->file, iov, iov_cnt);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while writing to the file=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", stream->file, iov, iov_cnt);
+		}
+	}
+	return result;
+}
+
+static enum ff_result flush_file(void *ctx)
+{
+	struct file_stream *stream;
+	enum ff_result result = FF_SUCCESS;
+
+	stream = (struct file_stream *) ctx;
+	if (stream->is_disconnected)
+	{
+		ff_log_debug(L"the file_stream=%p was already disconnected, so it cannot be flushed", stream);
+		result = FF_FAILURE;
+	}
+	else if (ff_file_get_access_mode(stream->file) == FF_FILE_WRITE)
+	{
+		result = ff_file_flush(stream->file);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while flushing the file=%p. See previous messages for more info", stream->file);
+		}
+	}
+	return result;
+}
+
+static void disconnect_file(void *ctx)
+{
+	struct file_stream *stream;
+
+	stream = (struct file_stream *) ctx;
+	stream->is_disconnected = 1;
+}
+
+static struct ff_stream_endpoint *get_file_endpoint(void *ctx)
+{
+	struct file_stream *stream;
+	struct ff_stream_endpoint *endpoint = NULL;
+
+	stream = (struct file_stream *) ctx;
+	if (!stream->is_disconnected)
+	{
+		endpoint = ff_file_get_stream_endpoint(stream->file);
+	}
+	return endpoint;
+}
+
+static const struct ff_stream_vtable file_stream_vtable =
+{
+	delete_file,
+	read_from_file,
+	write_to_file,
+	flush_file,
+	disconnect_file,
+	NULL,
+	get_file_endpoint,
+	readv_from_file,
+	writev_to_file
+};
+
+struct ff_stream *ff_stream_file_create(struct ff_file *file)
+{
+	struct file_stream *file_stream;
+	struct ff_stream *stream;
+
+	file_stream = (struct file_stream *) ff_malloc(sizeof(*file_stream));
+	file_stream->file = file;
+	file_stream->is_disconnected = 0;
+
+	stream = ff_stream_create(&file_stream_vtable, file_stream);
+	return stream;
+}
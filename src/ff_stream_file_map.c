@@ -0,0 +1,120 @@
+#include "private/ff_common.h"
+
+#include "private/ff_stream_file_map.h"
+
+struct file_map_stream
+{
+	struct ff_file_map *map;
+	const uint8_t *data;
+	int64_t size;
+
+	/* the offset of the next byte to read */
+	int64_t offset;
+
+	int is_disconnected;
+};
+
+/**
+ * @private
+ * Returns the pointer to the next len bytes of the view and skips them.
+ * Returns NULL if the stream is disconnected or the view contains less than len bytes.
+ */
+static const void *read_direct_from_file_map(void *ctx, int len)
+{
+	struct file_map_stream *stream;
+	const void *data;
+
+	ff_assert(len >= 0);
+
+	stream = (struct file_map_stream *) ctx;
+	if (stream->is_disconnected)
+	{
+		ff_log_debug(L"cannot read from the disconnected file_map_stream=%p", stream);
+		return NULL;
+	}
+	if (len > stream->size - stream->offset)
+	{
+		ff_log_debug(L"cannot read %d bytes from the file_map_stream=%p at the offset=%lld, because its size=%lld", len, stream, (long long) stream->offset, (long long) stream->size);
+		return NULL;
+	}
+	data = stream->data + stream->offset;
+	stream->offset += len;
+	return data;
+}
+
+static void delete_file_map(void *ctx)
+{
+	struct file_map_stream *stream;
+
+	stream = (struct file_map_stream *) ctx;
+	ff_file_map_delete(stream->map);
+	ff_free(stream);
+}
+
+static enum ff_result read_from_file_map(void *ctx, void *buf, int len)
+{
+	const void *data;
+
+	ff_assert(len >= 0);
+
+	data = read_direct_from_file_map(ctx, len);
+	if (data == NULL)
+	{
+		ff_log_debug(L"error while reading from the file_map_stream=%p to the buf=%p, len=%d. See previous messages for more info", ctx, buf, len);
+		return FF_FAILURE;
+	}
+	memcpy(buf, data, len);
+	return FF_SUCCESS;
+}
+
+static enum ff_result write_to_file_map(void *ctx, const void *buf, int len)
+{
+	ff_assert(len >= 0);
+
+	ff_log_debug(L"cannot write to the read-only file_map_stream=%p from the buf=%p, len=%d", ctx, buf, len);
+	return FF_FAILURE;
+}
+
+static enum ff_result flush_file_map(void *ctx)
+{
+	/* there is nothing to flush in the read-only stream */
+	(void)ctx;
+	return FF_SUCCESS;
+}
+
+static void disconnect_file_map(void *ctx)
+{
+	struct file_map_stream *stream;
+
+	stream = (struct file_map_stream *) ctx;
+	stream->is_disconnected = 1;
+}
+
+static const struct ff_stream_vtable file_map_stream_vtable =
+{
+	delete_file_map,
+	read_from_file_map,
+	write_to_file_map,
+	flush_file_map,
+	disconnect_file_map,
+	read_direct_from_file_map,
+	NULL,
+	NULL,
+	NULL
+};
+
+struct ff_stream *ff_stream_file_map_create(struct ff_file_map *map)
+{
+	struct file_map_stream *file_map_stream;
+	struct ff_stream *stream;
+
+	file_map_stream = (struct file_map_stream *) ff_malloc(sizeof(*file_map_stream));
+	file_map_stream->map = map;
+	file_map_stream->data = (const uint8_t *) ff_file_map_get_data(map);
+	file_map_stream->size = ff_file_map_get_size(map);
+	file_map_stream->offset = 0;
+	file_map_stream->is_disconnected = 0;
+
+	stream = ff_stream_create(&file_map_stream_vtable, file_map_stream);
+	return stream;
+}
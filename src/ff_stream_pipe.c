@@ -66,7 +66,11 @@ static const struct ff_stream_vtable pipe_stream_vtable =
 	read_from_pipe,
 	write_to_pipe,
 	flush_pipe,
-	disconnect_pipe
+	disconnect_pipe,
+	NULL,
+	NULL,
+	NULL,
+	NULL
 };
 
 void ff_stream_pipe_create_pair(int buffer_size, struct ff_stream **stream1, struct ff_stream **stream2)
@@ -1,6 +1,7 @@
 #include "private/ff_common.h"
 
 #include "private/ff_stream_tcp.h"
+#include "private/ff_tcp.h"
 
 static void delete_tcp(void *ctx)
 {
@@ -42,6 +43,38 @@ static enum ff_result write_to_tcp(void *ctx, const void *buf, int len)
 	return result;
 }
 
+static enum ff_result readv_from_tcp(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_tcp *tcp;
+	enum ff_result result;
+
+	ff_assert(iov_cnt >= 0);
+
+	tcp = (struct ff_tcp *) ctx;
+	result = ff_tcp_readv(tcp, iov, iov_cnt);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while reading from the tcp=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", tcp, iov, iov_cnt);
+	}
+	return result;
+}
+
+static enum ff_result writev_to_tcp(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_tcp *tcp;
+	enum ff_result result;
+
+	ff_assert(iov_cnt >= 0);
+
+	tcp = (struct ff_tcp *) ctx;
+	result = ff_tcp_writev(tcp, iov, iov_cnt);
+	if (result != FF_SUCCESS)
+	{
+		ff_log_debug(L"error while writing to the tcp=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", tcp, iov, iov_cnt);
+	}
+	return result;
+}
+
 static enum ff_result flush_tcp(void *ctx)
 {
 	struct ff_tcp *tcp;
@@ -64,13 +97,27 @@ static void disconnect_tcp(void *ctx)
 	ff_tcp_disconnect(tcp);
 }
 
+static struct ff_stream_endpoint *get_tcp_endpoint(void *ctx)
+{
+	struct ff_tcp *tcp;
+	struct ff_stream_endpoint *endpoint;
+
+	tcp = (struct ff_tcp *) ctx;
+	endpoint = ff_tcp_get_stream_endpoint(tcp);
+	return endpoint;
+}
+
 static const struct ff_stream_vtable tcp_stream_vtable =
 {
 	delete_tcp,
 	read_from_tcp,
 	write_to_tcp,
 	flush_tcp,
-	disconnect_tcp
+	disconnect_tcp,
+	NULL,
+	get_tcp_endpoint,
+	readv_from_tcp,
+	writev_to_tcp
 };
 
 struct ff_stream *ff_stream_tcp_create(struct ff_tcp *tcp)
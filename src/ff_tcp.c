@@ -14,6 +14,7 @@ struct ff_tcp
 	struct ff_arch_tcp *tcp;
 	struct ff_read_stream_buffer *read_buffer;
 	struct ff_write_stream_buffer *write_buffer;
+	struct ff_stream_endpoint endpoint;
 	int is_active;
 };
 
@@ -49,14 +50,48 @@ static int tcp_write_func(void *ctx, const void *buf, int len)
 	return bytes_written;
 }
 
+static int tcp_readv_func(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_tcp *tcp;
+	int bytes_read;
+
+	ff_assert(iov_cnt > 0);
+
+	tcp = (struct ff_tcp *) ctx;
+	bytes_read = ff_arch_tcp_readv(tcp->tcp, iov, iov_cnt);
+	if (bytes_read == -1)
+	{
+		ff_log_debug(L"error while reading from the tcp=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", tcp, iov, iov_cnt);
+	}
+	return bytes_read;
+}
+
+static int tcp_writev_func(void *ctx, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_tcp *tcp;
+	int bytes_written;
+
+	ff_assert(iov_cnt > 0);
+
+	tcp = (struct ff_tcp *) ctx;
+	bytes_written = ff_arch_tcp_writev(tcp->tcp, iov, iov_cnt);
+	if (bytes_written == -1)
+	{
+		ff_log_debug(L"error while writing to the tcp=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", tcp, iov, iov_cnt);
+	}
+	return bytes_written;
+}
+
 static struct ff_tcp *create_from_arch_tcp(struct ff_arch_tcp *arch_tcp)
 {
 	struct ff_tcp *tcp;
 
 	tcp = (struct ff_tcp *) ff_malloc(sizeof(*tcp));
 	tcp->tcp = arch_tcp;
-	tcp->read_buffer = ff_read_stream_buffer_create(tcp_read_func, tcp, READ_BUFFER_SIZE);
-	tcp->write_buffer = ff_write_stream_buffer_create(tcp_write_func, tcp, WRITE_BUFFER_SIZE);
+	tcp->read_buffer = ff_read_stream_buffer_create(tcp_read_func, tcp_readv_func, tcp, READ_BUFFER_SIZE);
+	tcp->write_buffer = ff_write_stream_buffer_create(tcp_write_func, tcp_writev_func, tcp, WRITE_BUFFER_SIZE);
+	tcp->endpoint.arch_endpoint = ff_arch_tcp_get_endpoint(arch_tcp);
+	tcp->endpoint.read_buffer = tcp->read_buffer;
 	tcp->is_active = 0;
 
 	return tcp;
@@ -176,20 +211,20 @@ enum ff_result ff_tcp_read(struct ff_tcp *tcp, void *buf, int len)
 
 enum ff_result ff_tcp_read_with_timeout(struct ff_tcp *tcp, void *buf, int len, int timeout)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_core_timeout_operation_data timeout_operation_data;
 	enum ff_result result;
 	enum ff_result tmp_result;
 
 	ff_assert(len >= 0);
 	ff_assert(timeout > 0);
 
-	timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_tcp_operation, tcp);
+	ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_tcp_operation, tcp);
 	result = ff_tcp_read(tcp, buf, len);
 	if (result != FF_SUCCESS)
 	{
 		ff_log_debug(L"error while reading data from the tcp=%p to the buf=%p, len=%d using timeout=%d. See previous messages for more info", tcp, buf, len, timeout);
 	}
-	tmp_result = ff_core_deregister_timeout_operation(timeout_operation_data);
+	tmp_result = ff_core_deregister_timeout_operation(&timeout_operation_data);
 	if (tmp_result != FF_SUCCESS)
 	{
 		ff_log_debug(L"timeout=%d has been exceeded for read operation from the tcp=%p to the buf=%p, len=%d", timeout, tcp, buf, len);
@@ -221,20 +256,20 @@ enum ff_result ff_tcp_write(struct ff_tcp *tcp, const void *buf, int len)
 
 enum ff_result ff_tcp_write_with_timeout(struct ff_tcp *tcp, const void *buf, int len, int timeout)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_core_timeout_operation_data timeout_operation_data;
 	enum ff_result result;
 	enum ff_result tmp_result;
 
 	ff_assert(len >= 0);
 	ff_assert(timeout > 0);
 
-	timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_tcp_operation, tcp);
+	ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_tcp_operation, tcp);
 	result = ff_tcp_write(tcp, buf, len);
 	if (result != FF_SUCCESS)
 	{
 		ff_log_debug(L"error while writing data to the tcp=%p from the buf=%p, len=%d using timeout=%d. See previous messages for more info", tcp, buf, len, timeout);
 	}
-	tmp_result = ff_core_deregister_timeout_operation(timeout_operation_data);
+	tmp_result = ff_core_deregister_timeout_operation(&timeout_operation_data);
 	if (tmp_result != FF_SUCCESS)
 	{
 		ff_log_debug(L"timeout=%d has been exceeded for write operation to the tcp=%p from the buf=%p, len=%d", timeout, tcp, buf, len);
@@ -243,6 +278,48 @@ enum ff_result ff_tcp_write_with_timeout(struct ff_tcp *tcp, const void *buf, in
 	return result;
 }
 
+enum ff_result ff_tcp_readv(struct ff_tcp *tcp, const struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(iov_cnt >= 0);
+
+	if (tcp->is_active)
+	{
+		result = ff_read_stream_buffer_readv(tcp->read_buffer, iov, iov_cnt);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while reading data from the read_buffer=%p to the iov=%p, iov_cnt=%d. See previous messages for more info", tcp->read_buffer, iov, iov_cnt);
+		}
+	}
+	else
+	{
+		ff_log_debug(L"the tcp=%p was already disconnected, so it cannot be used for reading data to the iov=%p, iov_cnt=%d", tcp, iov, iov_cnt);
+	}
+	return result;
+}
+
+enum ff_result ff_tcp_writev(struct ff_tcp *tcp, const struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(iov_cnt >= 0);
+
+	if (tcp->is_active)
+	{
+		result = ff_write_stream_buffer_writev(tcp->write_buffer, iov, iov_cnt);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while writing data to the write_buffer=%p from the iov=%p, iov_cnt=%d. See previous messages for more info", tcp->write_buffer, iov, iov_cnt);
+		}
+	}
+	else
+	{
+		ff_log_debug(L"the tcp=%p was already disconnected, so it cannot be used for writing data from the iov=%p, iov_cnt=%d", tcp, iov, iov_cnt);
+	}
+	return result;
+}
+
 enum ff_result ff_tcp_flush(struct ff_tcp *tcp)
 {
 	enum ff_result result = FF_FAILURE;
@@ -264,19 +341,19 @@ enum ff_result ff_tcp_flush(struct ff_tcp *tcp)
 
 enum ff_result ff_tcp_flush_with_timeout(struct ff_tcp *tcp, int timeout)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_core_timeout_operation_data timeout_operation_data;
 	enum ff_result result;
 	enum ff_result tmp_result;
 
 	ff_assert(timeout > 0);
 
-	timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_tcp_operation, tcp);
+	ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_tcp_operation, tcp);
 	result = ff_tcp_flush(tcp);
 	if (result != FF_SUCCESS)
 	{
 		ff_log_debug(L"error while flushing the tcp=%p using timeout=%d. See previous messages for more info", tcp, timeout);
 	}
-	tmp_result = ff_core_deregister_timeout_operation(timeout_operation_data);
+	tmp_result = ff_core_deregister_timeout_operation(&timeout_operation_data);
 	if (tmp_result != FF_SUCCESS)
 	{
 		ff_log_debug(L"timeout=%d has been exceeded for flush operation on the tcp=%p", timeout, tcp);
@@ -297,3 +374,15 @@ void ff_tcp_disconnect(struct ff_tcp *tcp)
 		ff_log_debug(L"the tcp=%p was already disconnected, so it won't be disconnected again", tcp);
 	}
 }
+
+struct ff_stream_endpoint *ff_tcp_get_stream_endpoint(struct ff_tcp *tcp)
+{
+	struct ff_stream_endpoint *endpoint = NULL;
+
+	/* disconnected tcp must fail reads and writes, so the endpoint isn't returned for it */
+	if (tcp->is_active && tcp->endpoint.arch_endpoint != NULL)
+	{
+		endpoint = &tcp->endpoint;
+	}
+	return endpoint;
+}
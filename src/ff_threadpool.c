@@ -1,153 +1,594 @@
 #include "private/ff_common.h"
 
 #include "private/ff_threadpool.h"
-#include "private/arch/ff_arch_completion_port.h"
+#include "private/arch/ff_arch_atomic.h"
+#include "private/arch/ff_arch_semaphore.h"
 #include "private/arch/ff_arch_thread.h"
 #include "private/arch/ff_arch_misc.h"
 #include "private/arch/ff_arch_mutex.h"
 
 #define THREADPOOL_THREAD_STACK_SIZE 0x10000
 
+/**
+ * the number of cells in the task queue. It must be a power of 2.
+ * Tasks, which don't fit into the queue, are put into the overflow list.
+ */
+#define RING_SIZE 4096
+
+#define RING_MASK (RING_SIZE - 1)
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @private
+ * The cell of the bounded MPMC queue.
+ * The sequence tells whether the cell is ready for the producer or for the consumer at the given position.
+ */
+struct ring_cell
+{
+	int sequence;
+	struct ff_threadpool_task *task;
+};
+
+/**
+ * @private
+ * The slot for a worker thread. The slot is free if the thread is NULL.
+ * Each worker thread owns its stats, so it updates them without synchronization.
+ */
+struct worker
+{
+	struct ff_arch_thread *thread;
+	struct ff_threadpool *threadpool;
+	struct ff_threadpool_stats stats;
+
+	/* non-zero if the thread has exited due to the idle timeout, so it must be joined before the slot is reused */
+	int is_retired;
+};
+
 struct ff_threadpool
 {
-	struct ff_arch_completion_port *completion_port;
+	struct ring_cell ring[RING_SIZE];
+
+	/* producers and consumers update these positions concurrently, so they are placed on distinct cache lines */
+	int enqueue_position;
+	char enqueue_position_padding[CACHE_LINE_SIZE];
+	int dequeue_position;
+	char dequeue_position_padding[CACHE_LINE_SIZE];
+
+	/* FIFO list of tasks, which have been queued while the ring was full.
+	 * Producers append tasks to the list while it isn't empty, so these tasks aren't overtaken by newer tasks in the ring
+	 */
+	struct ff_arch_mutex *overflow_mutex;
+	struct ff_threadpool_task *overflow_tasks_front;
+	struct ff_threadpool_task **overflow_tasks_back_ptr;
+
+	/* it is updated under the overflow_mutex, but it is read without the lock */
+	int overflow_tasks_cnt;
+
+	/* the number of worker threads, which are going to block on the semaphore and haven't been woken up yet */
+	int parked_threads_cnt;
+
+	/* the number of worker threads, which look for a task in the queue or wait for it */
+	int idle_threads_cnt;
+
+	int is_stopping;
+
+	/* the time in milliseconds, after which idle worker threads exit */
+	int idle_timeout;
+
+	/* idle worker threads are parked on the semaphore */
+	struct ff_arch_semaphore *semaphore;
+
+	/* guards workers, running_threads_cnt and retired_stats */
 	struct ff_arch_mutex *mutex;
-	struct ff_arch_thread **threads;
+	struct worker *workers;
 	int max_threads_cnt;
 	int running_threads_cnt;
-	int busy_threads_cnt;
+
+	/* stats of worker threads, which have exited due to the idle timeout */
+	struct ff_threadpool_stats retired_stats;
 };
 
-struct threadpool_task
+/**
+ * @private
+ * Positions wrap around, so they are compared using unsigned arithmetic.
+ */
+static int get_distance(int position1, int position2)
 {
-	ff_threadpool_func func;
-	void *ctx;
-};
+	int distance;
+
+	distance = (int) ((unsigned int) position1 - (unsigned int) position2);
+	return distance;
+}
+
+static int advance_position(int position, int delta)
+{
+	int new_position;
+
+	new_position = (int) ((unsigned int) position + (unsigned int) delta);
+	return new_position;
+}
+
+static struct ring_cell *get_ring_cell(struct ff_threadpool *threadpool, int position)
+{
+	struct ring_cell *cell;
+
+	cell = &threadpool->ring[(unsigned int) position & RING_MASK];
+	return cell;
+}
+
+/**
+ * @private
+ * Returns the approximate number of tasks in the queue.
+ */
+static int get_queued_tasks_cnt(struct ff_threadpool *threadpool)
+{
+	int queued_tasks_cnt;
+
+	queued_tasks_cnt = get_distance(ff_arch_atomic_get(&threadpool->enqueue_position), ff_arch_atomic_get(&threadpool->dequeue_position));
+	queued_tasks_cnt += ff_arch_atomic_get(&threadpool->overflow_tasks_cnt);
+	return queued_tasks_cnt;
+}
+
+/**
+ * @private
+ * Returns 0 if the queue is full.
+ */
+static int enqueue_task(struct ff_threadpool *threadpool, struct ff_threadpool_task *task)
+{
+	struct ring_cell *cell;
+	int position;
+
+	position = ff_arch_atomic_get(&threadpool->enqueue_position);
+	for (;;)
+	{
+		int distance;
+
+		cell = get_ring_cell(threadpool, position);
+		distance = get_distance(ff_arch_atomic_get(&cell->sequence), position);
+		if (distance == 0)
+		{
+			int prev_position;
+
+			prev_position = ff_arch_atomic_compare_exchange(&threadpool->enqueue_position, position, advance_position(position, 1));
+			if (prev_position == position)
+			{
+				break;
+			}
+			position = prev_position;
+		}
+		else if (distance < 0)
+		{
+			/* the consumer hasn't released the cell since the previous lap */
+			return 0;
+		}
+		else
+		{
+			/* another producer has already occupied the cell */
+			position = ff_arch_atomic_get(&threadpool->enqueue_position);
+		}
+	}
+
+	cell->task = task;
+	ff_arch_atomic_set(&cell->sequence, advance_position(position, 1));
+	return 1;
+}
+
+/**
+ * @private
+ * Returns NULL if the queue is empty.
+ */
+static struct ff_threadpool_task *dequeue_task(struct ff_threadpool *threadpool)
+{
+	struct ring_cell *cell;
+	struct ff_threadpool_task *task;
+	int position;
+
+	position = ff_arch_atomic_get(&threadpool->dequeue_position);
+	for (;;)
+	{
+		int distance;
+
+		cell = get_ring_cell(threadpool, position);
+		distance = get_distance(ff_arch_atomic_get(&cell->sequence), advance_position(position, 1));
+		if (distance == 0)
+		{
+			int prev_position;
+
+			prev_position = ff_arch_atomic_compare_exchange(&threadpool->dequeue_position, position, advance_position(position, 1));
+			if (prev_position == position)
+			{
+				break;
+			}
+			position = prev_position;
+		}
+		else if (distance < 0)
+		{
+			/* the producer hasn't filled the cell yet */
+			return NULL;
+		}
+		else
+		{
+			/* another consumer has already taken the cell */
+			position = ff_arch_atomic_get(&threadpool->dequeue_position);
+		}
+	}
+
+	task = cell->task;
+	ff_arch_atomic_set(&cell->sequence, advance_position(position, RING_SIZE));
+	return task;
+}
+
+/**
+ * @private
+ * Puts the task into the ring or into the overflow list if the ring is full
+ * or if the overflow list already contains older tasks.
+ */
+static void push_task(struct ff_threadpool *threadpool, struct ff_threadpool_task *task)
+{
+	if (ff_arch_atomic_get(&threadpool->overflow_tasks_cnt) == 0 && enqueue_task(threadpool, task))
+	{
+		return;
+	}
+
+	task->next = NULL;
+	ff_arch_mutex_lock(threadpool->overflow_mutex);
+	*threadpool->overflow_tasks_back_ptr = task;
+	threadpool->overflow_tasks_back_ptr = &task->next;
+	ff_arch_atomic_add(&threadpool->overflow_tasks_cnt, 1);
+	ff_arch_mutex_unlock(threadpool->overflow_mutex);
+}
+
+/**
+ * @private
+ * Returns the next task from the ring or from the overflow list.
+ * The ring is drained first, since its tasks are older than tasks in the overflow list.
+ * Returns NULL if there are no tasks.
+ */
+static struct ff_threadpool_task *pop_task(struct ff_threadpool *threadpool)
+{
+	struct ff_threadpool_task *task;
+
+	task = dequeue_task(threadpool);
+	if (task == NULL && ff_arch_atomic_get(&threadpool->overflow_tasks_cnt) > 0)
+	{
+		ff_arch_mutex_lock(threadpool->overflow_mutex);
+		task = threadpool->overflow_tasks_front;
+		if (task != NULL)
+		{
+			threadpool->overflow_tasks_front = task->next;
+			if (threadpool->overflow_tasks_front == NULL)
+			{
+				threadpool->overflow_tasks_back_ptr = &threadpool->overflow_tasks_front;
+			}
+			ff_arch_atomic_add(&threadpool->overflow_tasks_cnt, -1);
+		}
+		ff_arch_mutex_unlock(threadpool->overflow_mutex);
+	}
+	return task;
+}
+
+/**
+ * @private
+ * Decrements parked_threads_cnt if it is positive.
+ * Returns 0 if there are no parked threads.
+ */
+static int claim_parked_thread(struct ff_threadpool *threadpool)
+{
+	for (;;)
+	{
+		int parked_threads_cnt;
+
+		parked_threads_cnt = ff_arch_atomic_get(&threadpool->parked_threads_cnt);
+		ff_assert(parked_threads_cnt >= 0);
+		if (parked_threads_cnt == 0)
+		{
+			return 0;
+		}
+		if (ff_arch_atomic_compare_exchange(&threadpool->parked_threads_cnt, parked_threads_cnt, parked_threads_cnt - 1) == parked_threads_cnt)
+		{
+			return 1;
+		}
+	}
+}
+
+static int wake_parked_thread(struct ff_threadpool *threadpool)
+{
+	int is_woken;
+
+	is_woken = claim_parked_thread(threadpool);
+	if (is_woken)
+	{
+		ff_arch_semaphore_up(threadpool->semaphore);
+	}
+	return is_woken;
+}
+
+/**
+ * @private
+ * Returns the next task from the queue or NULL if the threadpool is stopping.
+ * Parks the current thread on the semaphore while the queue is empty.
+ * Returns NULL if the thread stays parked for longer than the idle timeout.
+ */
+static struct ff_threadpool_task *get_task(struct ff_threadpool *threadpool)
+{
+	struct ff_threadpool_task *task;
+	enum ff_result result;
+
+	for (;;)
+	{
+		task = pop_task(threadpool);
+		if (task != NULL || ff_arch_atomic_get(&threadpool->is_stopping))
+		{
+			break;
+		}
+
+		/* the queue is re-checked after the thread becomes visible to producers, so their tasks cannot be missed */
+		ff_arch_atomic_add(&threadpool->parked_threads_cnt, 1);
+		task = pop_task(threadpool);
+		if (task != NULL || ff_arch_atomic_get(&threadpool->is_stopping))
+		{
+			if (!claim_parked_thread(threadpool))
+			{
+				/* a producer has already claimed the current thread, so consume its wakeup */
+				ff_arch_semaphore_down(threadpool->semaphore);
+			}
+			break;
+		}
+		result = ff_arch_semaphore_down_with_timeout(threadpool->semaphore, ff_arch_atomic_get(&threadpool->idle_timeout));
+		if (result != FF_SUCCESS)
+		{
+			if (claim_parked_thread(threadpool))
+			{
+				break;
+			}
+			/* a producer has claimed the current thread right after the timeout, so consume its wakeup */
+			ff_arch_semaphore_down(threadpool->semaphore);
+		}
+	}
+
+	return task;
+}
+
+static void add_stats(struct ff_threadpool_stats *stats, const struct ff_threadpool_stats *worker_stats)
+{
+	stats->tasks_cnt += worker_stats->tasks_cnt;
+	stats->total_queue_latency += worker_stats->total_queue_latency;
+	if (worker_stats->max_queue_latency > stats->max_queue_latency)
+	{
+		stats->max_queue_latency = worker_stats->max_queue_latency;
+	}
+}
+
+/**
+ * @private
+ * Releases the slot of the worker, which has been idle for longer than the idle timeout.
+ * Returns 0 if the worker must stay, because tasks have been queued after it became idle.
+ */
+static int retire_worker(struct worker *worker)
+{
+	struct ff_threadpool *threadpool;
+	int is_retired = 0;
+
+	threadpool = worker->threadpool;
+	ff_arch_mutex_lock(threadpool->mutex);
+	/* producers add worker threads after they check idle_threads_cnt, which the worker has already decremented.
+	 * So the task, which was queued before the check, is picked up either by the worker or by a new thread
+	 */
+	if (get_queued_tasks_cnt(threadpool) == 0)
+	{
+		ff_assert(threadpool->running_threads_cnt > 0);
+		threadpool->running_threads_cnt--;
+		add_stats(&threadpool->retired_stats, &worker->stats);
+		worker->is_retired = 1;
+		is_retired = 1;
+	}
+	ff_arch_mutex_unlock(threadpool->mutex);
+
+	return is_retired;
+}
 
 static void generic_threadpool_func(void *ctx)
 {
+	struct worker *worker;
 	struct ff_threadpool *threadpool;
-	struct ff_arch_completion_port *completion_port;
-	struct ff_arch_mutex *mutex;
 
-	threadpool = (struct ff_threadpool *) ctx;
-	completion_port = threadpool->completion_port;
-	mutex = threadpool->mutex;
+	worker = (struct worker *) ctx;
+	threadpool = worker->threadpool;
 	for (;;)
 	{
-		struct threadpool_task *task;
+		struct ff_threadpool_task *task;
+		int64_t queue_latency;
 
-		ff_arch_mutex_lock(mutex);
-		ff_assert(threadpool->busy_threads_cnt > 0);
-		ff_assert(threadpool->busy_threads_cnt <= threadpool->running_threads_cnt);
-		ff_assert(threadpool->running_threads_cnt <= threadpool->max_threads_cnt);
-		threadpool->busy_threads_cnt--;
-		ff_arch_mutex_unlock(mutex);
-		ff_arch_completion_port_get(completion_port, (const void **) &task);
+		ff_arch_atomic_add(&threadpool->idle_threads_cnt, 1);
+		task = get_task(threadpool);
+		ff_arch_atomic_add(&threadpool->idle_threads_cnt, -1);
 		if (task == NULL)
 		{
-			break;
+			if (ff_arch_atomic_get(&threadpool->is_stopping) || retire_worker(worker))
+			{
+				break;
+			}
+			continue;
+		}
+		queue_latency = ff_arch_misc_get_precise_time() - task->enqueue_time;
+		worker->stats.tasks_cnt++;
+		worker->stats.total_queue_latency += queue_latency;
+		if (queue_latency > worker->stats.max_queue_latency)
+		{
+			worker->stats.max_queue_latency = queue_latency;
 		}
-		ff_arch_mutex_lock(mutex);
-		threadpool->busy_threads_cnt++;
-		ff_arch_mutex_unlock(mutex);
 
+		/* the task can be freed by its owner as soon as the func returns, so it mustn't be accessed after the call */
 		task->func(task->ctx);
-		ff_free(task);
 	}
-	ff_arch_mutex_lock(mutex);
-	threadpool->running_threads_cnt--;
-	ff_arch_mutex_unlock(mutex);
 }
 
-static void add_worker_thread(struct ff_threadpool *threadpool)
+/**
+ * @private
+ * Returns the free slot for a new worker thread. Joins retired threads found on the way.
+ * The threadpool's mutex must be held.
+ */
+static struct worker *get_free_worker(struct ff_threadpool *threadpool)
 {
-	struct ff_arch_thread *worker_thread;
+	struct worker *worker;
+	int i;
 
-	worker_thread = ff_arch_thread_create(generic_threadpool_func, THREADPOOL_THREAD_STACK_SIZE);
+	for (i = 0; i < threadpool->max_threads_cnt; i++)
+	{
+		worker = &threadpool->workers[i];
+		if (worker->thread != NULL && worker->is_retired)
+		{
+			ff_arch_thread_join(worker->thread);
+			ff_arch_thread_delete(worker->thread);
+			worker->thread = NULL;
+		}
+		if (worker->thread == NULL)
+		{
+			return worker;
+		}
+	}
+	ff_assert(0);
+	return NULL;
+}
 
-	threadpool->threads[threadpool->running_threads_cnt] = worker_thread;
-	threadpool->running_threads_cnt++;
-	threadpool->busy_threads_cnt++;
+static void add_worker_thread(struct ff_threadpool *threadpool)
+{
+	ff_arch_mutex_lock(threadpool->mutex);
+	ff_assert(threadpool->running_threads_cnt <= threadpool->max_threads_cnt);
+	if (threadpool->running_threads_cnt < threadpool->max_threads_cnt)
+	{
+		struct worker *worker;
 
-	ff_arch_thread_start(worker_thread, threadpool);
+		worker = get_free_worker(threadpool);
+		worker->thread = ff_arch_thread_create(generic_threadpool_func, THREADPOOL_THREAD_STACK_SIZE);
+		worker->threadpool = threadpool;
+		worker->stats.tasks_cnt = 0;
+		worker->stats.total_queue_latency = 0;
+		worker->stats.max_queue_latency = 0;
+		worker->is_retired = 0;
+		threadpool->running_threads_cnt++;
+		ff_arch_thread_start(worker->thread, worker);
+	}
+	else
+	{
+		ff_log_debug(L"threadpool=%p already has maximum size %d, so it cannot contain new threads", threadpool, threadpool->max_threads_cnt);
+	}
+	ff_arch_mutex_unlock(threadpool->mutex);
 }
 
-struct ff_threadpool *ff_threadpool_create(int max_threads_cnt)
+struct ff_threadpool *ff_threadpool_create(int max_threads_cnt, int idle_timeout)
 {
 	struct ff_threadpool *threadpool;
-	int cpus_cnt;
+	int i;
 
 	ff_assert(max_threads_cnt > 0);
+	ff_assert(idle_timeout > 0);
 
-	cpus_cnt = ff_arch_misc_get_cpus_cnt();
 	threadpool = (struct ff_threadpool *) ff_malloc(sizeof(*threadpool));
-	threadpool->completion_port = ff_arch_completion_port_create(cpus_cnt);
+	for (i = 0; i < RING_SIZE; i++)
+	{
+		threadpool->ring[i].sequence = i;
+		threadpool->ring[i].task = NULL;
+	}
+	threadpool->enqueue_position = 0;
+	threadpool->dequeue_position = 0;
+	threadpool->overflow_mutex = ff_arch_mutex_create();
+	threadpool->overflow_tasks_front = NULL;
+	threadpool->overflow_tasks_back_ptr = &threadpool->overflow_tasks_front;
+	threadpool->overflow_tasks_cnt = 0;
+	threadpool->parked_threads_cnt = 0;
+	threadpool->idle_threads_cnt = 0;
+	threadpool->is_stopping = 0;
+	threadpool->idle_timeout = idle_timeout;
+	threadpool->semaphore = ff_arch_semaphore_create(0);
 	threadpool->mutex = ff_arch_mutex_create();
-	threadpool->threads = (struct ff_arch_thread **) ff_calloc(max_threads_cnt, sizeof(threadpool->threads[0]));
+	threadpool->workers = (struct worker *) ff_calloc(max_threads_cnt, sizeof(threadpool->workers[0]));
 	threadpool->max_threads_cnt = max_threads_cnt;
 	threadpool->running_threads_cnt = 0;
-	threadpool->busy_threads_cnt = 0;
+	threadpool->retired_stats.tasks_cnt = 0;
+	threadpool->retired_stats.total_queue_latency = 0;
+	threadpool->retired_stats.max_queue_latency = 0;
+	threadpool->retired_stats.threads_cnt = 0;
 
 	return threadpool;
 }
 
 void ff_threadpool_delete(struct ff_threadpool *threadpool)
 {
-	struct ff_arch_completion_port *completion_port;
-	struct ff_arch_thread **threads;
 	int i;
-	int running_threads_cnt;
 
-	completion_port = threadpool->completion_port;
-	running_threads_cnt = threadpool->running_threads_cnt;
-	for (i = 0; i < running_threads_cnt; i++)
+	/* worker threads exit after the queue becomes empty, so all the pending tasks are executed */
+	ff_arch_atomic_set(&threadpool->is_stopping, 1);
+	while (wake_parked_thread(threadpool))
 	{
-		ff_arch_completion_port_put(completion_port, NULL);
+		/* threads, which are going to park after this loop, notice is_stopping and don't block */
 	}
-	threads = threadpool->threads;
-	for (i = 0; i < running_threads_cnt; i++)
+	for (i = 0; i < threadpool->max_threads_cnt; i++)
 	{
 		struct ff_arch_thread *thread;
 
-		thread = threads[i];
-		ff_arch_thread_join(thread);
-		ff_arch_thread_delete(thread);
+		/* only producers assign threads to slots, so the slots can be read without the lock after they are gone */
+		thread = threadpool->workers[i].thread;
+		if (thread != NULL)
+		{
+			ff_arch_thread_join(thread);
+			ff_arch_thread_delete(thread);
+		}
 	}
-	ff_assert(threadpool->busy_threads_cnt == 0);
-	ff_assert(threadpool->running_threads_cnt == 0);
+	ff_assert(threadpool->parked_threads_cnt == 0);
+	ff_assert(threadpool->idle_threads_cnt == 0);
+	ff_assert(pop_task(threadpool) == NULL);
 
-	ff_free(threads);
+	ff_free(threadpool->workers);
+	ff_arch_mutex_delete(threadpool->overflow_mutex);
 	ff_arch_mutex_delete(threadpool->mutex);
-	ff_arch_completion_port_delete(completion_port);
+	ff_arch_semaphore_delete(threadpool->semaphore);
 	ff_free(threadpool);
 }
 
-void ff_threadpool_execute_async(struct ff_threadpool *threadpool, ff_threadpool_func func, void *ctx)
+void ff_threadpool_execute_async(struct ff_threadpool *threadpool, struct ff_threadpool_task *task, ff_threadpool_func func, void *ctx)
 {
-	struct threadpool_task *task;
-	struct ff_arch_mutex *mutex;
+	ff_assert(!ff_arch_atomic_get(&threadpool->is_stopping));
 
-	task = (struct threadpool_task *) ff_malloc(sizeof(*task));
 	task->func = func;
 	task->ctx = ctx;
-	ff_arch_completion_port_put(threadpool->completion_port, task);
+	task->enqueue_time = ff_arch_misc_get_precise_time();
+	/* producers are usually scheduler threads, so they never wait for free cells in the ring */
+	push_task(threadpool, task);
 
-	mutex = threadpool->mutex;
-	ff_arch_mutex_lock(mutex);
-	ff_assert(threadpool->busy_threads_cnt >= 0);
-	ff_assert(threadpool->busy_threads_cnt <= threadpool->running_threads_cnt);
-	ff_assert(threadpool->running_threads_cnt <= threadpool->max_threads_cnt);
-	if (threadpool->running_threads_cnt < threadpool->max_threads_cnt)
+	wake_parked_thread(threadpool);
+	if (get_queued_tasks_cnt(threadpool) > ff_arch_atomic_get(&threadpool->idle_threads_cnt))
 	{
-		if (threadpool->busy_threads_cnt == threadpool->running_threads_cnt)
-		{
-			add_worker_thread(threadpool);
-		}
+		/* idle worker threads cannot pick up all the queued tasks, so the burst of tasks doesn't run sequentially */
+		add_worker_thread(threadpool);
 	}
-	else
+}
+
+void ff_threadpool_set_idle_timeout(struct ff_threadpool *threadpool, int idle_timeout)
+{
+	ff_assert(idle_timeout > 0);
+
+	ff_arch_atomic_set(&threadpool->idle_timeout, idle_timeout);
+}
+
+void ff_threadpool_get_stats(struct ff_threadpool *threadpool, struct ff_threadpool_stats *stats)
+{
+	int i;
+
+	/* workers update their stats without synchronization, so the result can be slightly outdated */
+	ff_arch_mutex_lock(threadpool->mutex);
+	memcpy(stats, &threadpool->retired_stats, sizeof(*stats));
+	for (i = 0; i < threadpool->max_threads_cnt; i++)
 	{
-		ff_log_debug(L"threadpool=%p already has maximum size %d, so it cannot contain new threads", threadpool, threadpool->max_threads_cnt);
+		struct worker *worker;
+
+		worker = &threadpool->workers[i];
+		if (worker->thread != NULL && !worker->is_retired)
+		{
+			add_stats(stats, &worker->stats);
+		}
 	}
-	ff_arch_mutex_unlock(mutex);
+	stats->threads_cnt = threadpool->running_threads_cnt;
+	ff_arch_mutex_unlock(threadpool->mutex);
 }
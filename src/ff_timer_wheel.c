@@ -0,0 +1,261 @@
+#include "private/ff_common.h"
+
+#include "private/ff_timer_wheel.h"
+
+/**
+ * each level of the wheel contains (1 << SLOT_BITS) slots.
+ * Each slot of the level N covers (1 << (SLOT_BITS * N)) milliseconds.
+ */
+#define SLOT_BITS 6
+
+#define SLOTS_CNT (1 << SLOT_BITS)
+
+#define SLOT_MASK (SLOTS_CNT - 1)
+
+#define LEVELS_CNT 4
+
+/**
+ * the maximum distance in milliseconds between the current time and the slot of the node.
+ * Nodes, which expire later, are placed into the last slot and are re-inserted
+ * into the wheel when this slot is cascaded.
+ */
+#define MAX_DISTANCE ((((int64_t) 1) << (SLOT_BITS * LEVELS_CNT)) - 1)
+
+struct ff_timer_wheel
+{
+	/* heads of circular doubly-linked lists of nodes for each slot */
+	struct ff_timer_wheel_node slots[LEVELS_CNT][SLOTS_CNT];
+
+	/* the time in milliseconds, up to which all nodes were expired */
+	int64_t current_time;
+
+	int nodes_cnt;
+};
+
+static void initialize_list(struct ff_timer_wheel_node *head)
+{
+	head->prev = head;
+	head->next = head;
+}
+
+static void link_node(struct ff_timer_wheel_node *head, struct ff_timer_wheel_node *node)
+{
+	node->prev = head->prev;
+	node->next = head;
+	head->prev->next = node;
+	head->prev = node;
+}
+
+static void unlink_node(struct ff_timer_wheel_node *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->prev = NULL;
+	node->next = NULL;
+}
+
+/**
+ * @private
+ * Moves all nodes from the given slot into the list with the given head.
+ */
+static void detach_slot(struct ff_timer_wheel_node *slot, struct ff_timer_wheel_node *head)
+{
+	initialize_list(head);
+	if (slot->next != slot)
+	{
+		head->next = slot->next;
+		head->prev = slot->prev;
+		head->next->prev = head;
+		head->prev->next = head;
+		initialize_list(slot);
+	}
+}
+
+static void insert_node(struct ff_timer_wheel *timer_wheel, struct ff_timer_wheel_node *node)
+{
+	int64_t slot_time;
+	int64_t distance;
+	int level;
+	int slot_index;
+
+	slot_time = node->expiration_time;
+	if (slot_time <= timer_wheel->current_time)
+	{
+		/* the node should expire on the next tick */
+		slot_time = timer_wheel->current_time + 1;
+	}
+	distance = slot_time - timer_wheel->current_time;
+	if (distance > MAX_DISTANCE)
+	{
+		distance = MAX_DISTANCE;
+		slot_time = timer_wheel->current_time + distance;
+	}
+
+	for (level = 0; level < LEVELS_CNT - 1; level++)
+	{
+		if (distance < (((int64_t) 1) << (SLOT_BITS * (level + 1))))
+		{
+			break;
+		}
+	}
+	slot_index = (int) ((slot_time >> (SLOT_BITS * level)) & SLOT_MASK);
+	link_node(&timer_wheel->slots[level][slot_index], node);
+}
+
+/**
+ * @private
+ * Re-inserts nodes from the given slot of the given level into lower levels.
+ */
+static void cascade_slot(struct ff_timer_wheel *timer_wheel, int level, int slot_index)
+{
+	struct ff_timer_wheel_node head;
+
+	detach_slot(&timer_wheel->slots[level][slot_index], &head);
+	while (head.next != &head)
+	{
+		struct ff_timer_wheel_node *node;
+
+		node = head.next;
+		unlink_node(node);
+		insert_node(timer_wheel, node);
+	}
+}
+
+struct ff_timer_wheel *ff_timer_wheel_create(int64_t current_time)
+{
+	struct ff_timer_wheel *timer_wheel;
+	int level;
+	int slot_index;
+
+	timer_wheel = (struct ff_timer_wheel *) ff_malloc(sizeof(*timer_wheel));
+	for (level = 0; level < LEVELS_CNT; level++)
+	{
+		for (slot_index = 0; slot_index < SLOTS_CNT; slot_index++)
+		{
+			initialize_list(&timer_wheel->slots[level][slot_index]);
+		}
+	}
+	timer_wheel->current_time = current_time;
+	timer_wheel->nodes_cnt = 0;
+
+	return timer_wheel;
+}
+
+void ff_timer_wheel_delete(struct ff_timer_wheel *timer_wheel)
+{
+	ff_assert(timer_wheel->nodes_cnt == 0);
+
+	ff_free(timer_wheel);
+}
+
+void ff_timer_wheel_add(struct ff_timer_wheel *timer_wheel, struct ff_timer_wheel_node *node, int64_t expiration_time)
+{
+	ff_assert(timer_wheel->nodes_cnt >= 0);
+
+	node->expiration_time = expiration_time;
+	insert_node(timer_wheel, node);
+	timer_wheel->nodes_cnt++;
+}
+
+void ff_timer_wheel_remove(struct ff_timer_wheel *timer_wheel, struct ff_timer_wheel_node *node)
+{
+	if (node->next != NULL)
+	{
+		ff_assert(timer_wheel->nodes_cnt > 0);
+		unlink_node(node);
+		timer_wheel->nodes_cnt--;
+	}
+	else
+	{
+		ff_log_debug(L"the node=%p has been already expired, so it won't be removed from the timer_wheel=%p", node, timer_wheel);
+	}
+}
+
+void ff_timer_wheel_expire(struct ff_timer_wheel *timer_wheel, int64_t current_time, ff_timer_wheel_expire_func expire_func, void *ctx)
+{
+	while (timer_wheel->current_time < current_time)
+	{
+		struct ff_timer_wheel_node head;
+		int64_t tick;
+		int level;
+		int slot_index;
+
+		if (timer_wheel->nodes_cnt == 0)
+		{
+			/* there is nothing to expire, so skip the remaining ticks */
+			timer_wheel->current_time = current_time;
+			break;
+		}
+
+		timer_wheel->current_time++;
+		tick = timer_wheel->current_time;
+		for (level = 1; level < LEVELS_CNT; level++)
+		{
+			if ((tick & ((((int64_t) 1) << (SLOT_BITS * level)) - 1)) != 0)
+			{
+				break;
+			}
+			slot_index = (int) ((tick >> (SLOT_BITS * level)) & SLOT_MASK);
+			cascade_slot(timer_wheel, level, slot_index);
+		}
+
+		slot_index = (int) (tick & SLOT_MASK);
+		detach_slot(&timer_wheel->slots[0][slot_index], &head);
+		while (head.next != &head)
+		{
+			struct ff_timer_wheel_node *node;
+
+			node = head.next;
+			unlink_node(node);
+			timer_wheel->nodes_cnt--;
+			expire_func(node, ctx);
+		}
+	}
+}
+
+int64_t ff_timer_wheel_get_next_expiration_time(struct ff_timer_wheel *timer_wheel)
+{
+	int64_t next_expiration_time;
+	int level;
+
+	ff_assert(timer_wheel->nodes_cnt > 0);
+
+	next_expiration_time = timer_wheel->current_time + MAX_DISTANCE;
+	for (level = 0; level < LEVELS_CNT; level++)
+	{
+		int64_t block;
+		int i;
+
+		/* the slot of the level is processed at the start of its block */
+		block = timer_wheel->current_time >> (SLOT_BITS * level);
+		for (i = 1; i <= SLOTS_CNT; i++)
+		{
+			int slot_index;
+			struct ff_timer_wheel_node *slot;
+
+			slot_index = (int) ((block + i) & SLOT_MASK);
+			slot = &timer_wheel->slots[level][slot_index];
+			if (slot->next != slot)
+			{
+				int64_t slot_time;
+
+				slot_time = (block + i) << (SLOT_BITS * level);
+				if (slot_time < next_expiration_time)
+				{
+					next_expiration_time = slot_time;
+				}
+				break;
+			}
+		}
+	}
+
+	return next_expiration_time;
+}
+
+int ff_timer_wheel_is_empty(struct ff_timer_wheel *timer_wheel)
+{
+	int is_empty;
+
+	is_empty = (timer_wheel->nodes_cnt == 0);
+	return is_empty;
+}
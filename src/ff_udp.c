@@ -64,21 +64,21 @@ int ff_udp_read(struct ff_udp *udp, struct ff_arch_net_addr *peer_addr, void *bu
 
 int ff_udp_read_with_timeout(struct ff_udp *udp, struct ff_arch_net_addr *peer_addr, void *buf, int len, int timeout)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_core_timeout_operation_data timeout_operation_data;
 	enum ff_result result;
 	int bytes_read;
 
 	ff_assert(len >= 0);
 	ff_assert(timeout > 0);
 
-	timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_udp_operation, udp);
+	ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_udp_operation, udp);
 	bytes_read = ff_udp_read(udp, peer_addr, buf, len);
 	if (bytes_read == -1)
 	{
 		ff_log_debug(L"error while reading data from the udp=%p into the buf=%p, len=%d, peer_addr=%p using timeout=%d. See previous messages for more info",
 			udp, buf, len, peer_addr, timeout);
 	}
-	result = ff_core_deregister_timeout_operation(timeout_operation_data);
+	result = ff_core_deregister_timeout_operation(&timeout_operation_data);
 	if (result != FF_SUCCESS)
 	{
 		ff_log_debug(L"timeout=%d has been expired on read operation from the udp=%p into the buf=%p, len=%d, peer_addr=%p", timeout, udp, buf, len, peer_addr);
@@ -103,21 +103,21 @@ int ff_udp_write(struct ff_udp *udp, const struct ff_arch_net_addr *addr, const
 
 int ff_udp_write_with_timeout(struct ff_udp *udp, const struct ff_arch_net_addr *addr, const void *buf, int len, int timeout)
 {
-	struct ff_core_timeout_operation_data *timeout_operation_data;
+	struct ff_core_timeout_operation_data timeout_operation_data;
 	enum ff_result result;
 	int bytes_written;
 
 	ff_assert(len >= 0);
 	ff_assert(timeout > 0);
 
-	timeout_operation_data = ff_core_register_timeout_operation(timeout, cancel_udp_operation, udp);
+	ff_core_register_timeout_operation(&timeout_operation_data, timeout, cancel_udp_operation, udp);
 	bytes_written = ff_udp_write(udp, addr, buf, len);
 	if (bytes_written == -1)
 	{
 		ff_log_debug(L"error while writing data to the udp=%p from the buf=%p, len=%d, addr=%p using timeout=%d. See prevsious messages for more info",
 			udp, buf, len, addr, timeout);
 	}
-	result = ff_core_deregister_timeout_operation(timeout_operation_data);
+	result = ff_core_deregister_timeout_operation(&timeout_operation_data);
 	if (result != FF_SUCCESS)
 	{
 		ff_log_debug(L"timeout=%d has been expired on write operation to the udp=%p from the buf=%p, len=%d, addr=%p", timeout, udp, buf, len, addr);
@@ -2,16 +2,71 @@
 
 #include "private/ff_write_stream_buffer.h"
 
+/**
+ * the maximum number of buffers for vectored writes, which are copied on the stack.
+ * Larger arrays of buffers are copied into the heap
+ */
+#define MAX_STACK_IOVECS_CNT 16
+
 struct ff_write_stream_buffer
 {
 	ff_write_stream_func write_func;
+	ff_writev_stream_func writev_func;
 	void *write_func_ctx;
 	char *buf;
 	int capacity;
 	int start_pos;
 };
 
-struct ff_write_stream_buffer *ff_write_stream_buffer_create(ff_write_stream_func write_func, void *write_func_ctx, int capacity)
+/**
+ * @private
+ * Writes all data from iov_cnt buffers of the iov to the underlying stream.
+ * The iov is advanced in place after partial writes.
+ */
+static enum ff_result write_vectored(struct ff_write_stream_buffer *buffer, struct ff_iovec *iov, int iov_cnt)
+{
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(iov_cnt >= 0);
+
+	while (iov_cnt > 0)
+	{
+		int bytes_written;
+
+		if (iov->len == 0)
+		{
+			iov++;
+			iov_cnt--;
+			continue;
+		}
+		bytes_written = buffer->writev_func(buffer->write_func_ctx, iov, iov_cnt);
+		if (bytes_written == -1)
+		{
+			ff_log_debug(L"error while writing data from the iov=%p, iov_cnt=%d from buffer=%p. See previous messages for more info", iov, iov_cnt, buffer);
+			goto end;
+		}
+		ff_assert(bytes_written > 0);
+		while (bytes_written > 0)
+		{
+			ff_assert(iov_cnt > 0);
+			if (bytes_written < iov->len)
+			{
+				iov->buf = ((char *) iov->buf) + bytes_written;
+				iov->len -= bytes_written;
+				break;
+			}
+			bytes_written -= iov->len;
+			iov++;
+			iov_cnt--;
+		}
+	}
+	result = FF_SUCCESS;
+
+end:
+	return result;
+}
+
+struct ff_write_stream_buffer *ff_write_stream_buffer_create(ff_write_stream_func write_func, ff_writev_stream_func writev_func, void *write_func_ctx, int capacity)
 {
 	struct ff_write_stream_buffer *buffer;
 
@@ -19,6 +74,7 @@ struct ff_write_stream_buffer *ff_write_stream_buffer_create(ff_write_stream_fun
 
 	buffer = (struct ff_write_stream_buffer *) ff_malloc(sizeof(*buffer));
 	buffer->write_func = write_func;
+	buffer->writev_func = writev_func;
 	buffer->write_func_ctx = write_func_ctx;
 	buffer->buf = (char *) ff_calloc(capacity, sizeof(buffer->buf[0]));
 	buffer->capacity = capacity;
@@ -110,6 +166,91 @@ end:
 	return result;
 }
 
+enum ff_result ff_write_stream_buffer_writev(struct ff_write_stream_buffer *buffer, const struct ff_iovec *iov, int iov_cnt)
+{
+	struct ff_iovec stack_iov[MAX_STACK_IOVECS_CNT];
+	struct ff_iovec *iov_copy;
+	int i;
+	enum ff_result result = FF_FAILURE;
+
+	ff_assert(buffer->capacity > 0);
+	ff_assert(iov_cnt >= 0);
+
+	if (buffer->writev_func == NULL)
+	{
+		/* the underlying stream doesn't support gather writes */
+		for (i = 0; i < iov_cnt; i++)
+		{
+			result = ff_write_stream_buffer_write(buffer, iov[i].buf, iov[i].len);
+			if (result != FF_SUCCESS)
+			{
+				ff_log_debug(L"error while writing data from the %d-th buffer of the iov=%p. See previous messages for more info", i, iov);
+				goto end;
+			}
+		}
+		result = FF_SUCCESS;
+		goto end;
+	}
+
+	/* the copy holds the buffered data followed by requested buffers */
+	iov_copy = stack_iov;
+	if (iov_cnt + 1 > MAX_STACK_IOVECS_CNT)
+	{
+		iov_copy = (struct ff_iovec *) ff_calloc(iov_cnt + 1, sizeof(iov_copy[0]));
+	}
+
+	result = FF_SUCCESS;
+	i = 0;
+	while (i < iov_cnt)
+	{
+		int iov_copy_cnt;
+
+		ff_assert(iov[i].len >= 0);
+		ff_assert(buffer->start_pos >= 0);
+		ff_assert(buffer->start_pos <= buffer->capacity);
+
+		if (iov[i].len <= buffer->capacity - buffer->start_pos)
+		{
+			/* coalesce small buffers, so they are written by a single call after the buffer becomes full */
+			memcpy(buffer->buf + buffer->start_pos, iov[i].buf, iov[i].len);
+			buffer->start_pos += iov[i].len;
+			i++;
+			continue;
+		}
+
+		/* the buffer cannot hold the requested buffer, so write the buffered data together
+		 * with the requested buffer and subsequent buffers, which don't fit into the empty buffer,
+		 * by a single writev_func call without copying them into the buffer
+		 */
+		iov_copy_cnt = 0;
+		if (buffer->start_pos > 0)
+		{
+			iov_copy[0].buf = buffer->buf;
+			iov_copy[0].len = buffer->start_pos;
+			iov_copy_cnt++;
+		}
+		do
+		{
+			iov_copy[iov_copy_cnt] = iov[i];
+			iov_copy_cnt++;
+			i++;
+		} while (i < iov_cnt && iov[i].len > buffer->capacity);
+		result = write_vectored(buffer, iov_copy, iov_copy_cnt);
+		if (result != FF_SUCCESS)
+		{
+			ff_log_debug(L"error while writing data from the iov=%p, iov_cnt=%d. See previous messages for more info", iov, iov_cnt);
+			break;
+		}
+		buffer->start_pos = 0;
+	}
+	if (iov_copy != stack_iov)
+	{
+		ff_free(iov_copy);
+	}
+
+end:
+	return result;
+}
 
 enum ff_result ff_write_stream_buffer_flush(struct ff_write_stream_buffer *buffer)
 {
@@ -5,6 +5,7 @@
 #include "ff/ff_event.h"
 #include "ff/ff_mutex.h"
 #include "ff/ff_semaphore.h"
+#include "ff/ff_future.h"
 #include "ff/ff_blocking_queue.h"
 #include "ff/ff_blocking_stack.h"
 #include "ff/ff_pool.h"
@@ -15,11 +16,15 @@
 #include "ff/arch/ff_arch_net_addr.h"
 #include "ff/ff_tcp.h"
 #include "ff/ff_stream_tcp.h"
+#include "ff/ff_stream_file_map.h"
+#include "ff/ff_stream_file.h"
+#include "ff/ff_stream_pipe.h"
 #include "ff/ff_stream_acceptor_tcp.h"
 #include "ff/ff_stream_connector_tcp.h"
 #include "ff/ff_udp.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef NDEBUG
@@ -136,7 +141,7 @@ static void test_core_threadpool_execute(void)
 	ff_core_initialize(LOG_FILENAME);
 	a[0] = 1234;
 	a[1] = 4321;
-	ff_core_threadpool_execute(threadpool_int_increment, a);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_int_increment, a);
 	ASSERT(a[1] == a[0] + 1, "unexpected result");
 	ff_core_shutdown();
 }
@@ -152,12 +157,226 @@ static void test_core_threadpool_execute_multiple(void)
 
 		a[0] = i;
 		a[1] = i + 5;
-		ff_core_threadpool_execute(threadpool_int_increment, a);
+		ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_int_increment, a);
 		ASSERT(a[1] == a[0] + 1, "unexpected result");
 	}
 	ff_core_shutdown();
 }
 
+#define THREADPOOL_CONCURRENT_FIBERS_CNT 100
+#define THREADPOOL_CONCURRENT_TASKS_CNT 100
+
+static void threadpool_concurrent_fiber_func(void *ctx)
+{
+	int a[2];
+	int i;
+
+	(void)ctx;
+	for (i = 0; i < THREADPOOL_CONCURRENT_TASKS_CNT; i++)
+	{
+		a[0] = i;
+		a[1] = 0;
+		ff_core_threadpool_execute(FF_CORE_THREADPOOL_COMPUTE, threadpool_int_increment, a);
+		ASSERT(a[1] == i + 1, "unexpected result");
+	}
+}
+
+static void test_core_threadpool_execute_concurrent(void)
+{
+	struct ff_fiber *fibers[THREADPOOL_CONCURRENT_FIBERS_CNT];
+	struct ff_core_stats stats;
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 0);
+	for (i = 0; i < THREADPOOL_CONCURRENT_FIBERS_CNT; i++)
+	{
+		fibers[i] = ff_fiber_create(threadpool_concurrent_fiber_func, 0);
+		ff_fiber_start(fibers[i], NULL);
+	}
+	for (i = 0; i < THREADPOOL_CONCURRENT_FIBERS_CNT; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ff_core_get_stats(&stats);
+	ASSERT(stats.threadpool_tasks_cnt >= THREADPOOL_CONCURRENT_FIBERS_CNT * THREADPOOL_CONCURRENT_TASKS_CNT, "all the threadpool tasks should be counted");
+	ASSERT(stats.compute_threadpool_threads_cnt >= 1, "the compute threadpool should start threads");
+	ASSERT(stats.compute_threadpool_threads_cnt <= ff_core_get_schedulers_cnt(), "the compute threadpool cannot exceed the number of CPUs");
+	ASSERT(stats.blocking_threadpool_threads_cnt == 0, "the blocking threadpool shouldn't be used");
+	ff_core_shutdown();
+}
+
+/* it exceeds the number of cells in the threadpool's queue, so the rest of tasks go to the overflow list */
+#define THREADPOOL_OVERFLOW_FIBERS_CNT 4500
+
+struct threadpool_overflow_item
+{
+	volatile int *is_gate_open;
+	int a;
+};
+
+static void threadpool_overflow_func(void *ctx)
+{
+	struct threadpool_overflow_item *item;
+
+	/* the first task holds the only compute thread until all the tasks are queued */
+	item = (struct threadpool_overflow_item *) ctx;
+	while (!*item->is_gate_open)
+	{
+	}
+	item->a++;
+}
+
+static void threadpool_overflow_fiber_func(void *ctx)
+{
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_COMPUTE, threadpool_overflow_func, ctx);
+}
+
+static void test_core_threadpool_execute_overflow(void)
+{
+	struct threadpool_overflow_item *items;
+	void **ctxs;
+	volatile int is_gate_open = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	items = (struct threadpool_overflow_item *) ff_calloc(THREADPOOL_OVERFLOW_FIBERS_CNT, sizeof(items[0]));
+	ctxs = (void **) ff_calloc(THREADPOOL_OVERFLOW_FIBERS_CNT, sizeof(ctxs[0]));
+	for (i = 0; i < THREADPOOL_OVERFLOW_FIBERS_CNT; i++)
+	{
+		items[i].is_gate_open = &is_gate_open;
+		items[i].a = i;
+		ctxs[i] = &items[i];
+	}
+	ff_core_fiberpool_execute_batch_async(threadpool_overflow_fiber_func, ctxs, THREADPOOL_OVERFLOW_FIBERS_CNT);
+	ff_core_sleep(200);
+	is_gate_open = 1;
+	ff_core_shutdown();
+	for (i = 0; i < THREADPOOL_OVERFLOW_FIBERS_CNT; i++)
+	{
+		ASSERT(items[i].a == i + 1, "all the tasks should be executed");
+	}
+	ff_free(ctxs);
+	ff_free(items);
+}
+
+static void threadpool_idle_fiber_func(void *ctx)
+{
+	int a[2];
+
+	(void)ctx;
+	a[0] = 1;
+	a[1] = 0;
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_int_increment, a);
+	ASSERT(a[1] == 2, "unexpected result");
+}
+
+static void test_core_threadpool_idle_timeout(void)
+{
+	struct ff_fiber *fibers[10];
+	struct ff_core_stats stats;
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 2);
+	ff_core_set_threadpool_idle_timeout(10);
+	for (i = 0; i < 10; i++)
+	{
+		fibers[i] = ff_fiber_create(threadpool_idle_fiber_func, 0);
+		ff_fiber_start(fibers[i], NULL);
+	}
+	for (i = 0; i < 10; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ff_core_get_stats(&stats);
+	ASSERT(stats.blocking_threadpool_threads_cnt >= 1, "the blocking threadpool should start threads");
+	for (i = 0; i < 100; i++)
+	{
+		ff_core_get_stats(&stats);
+		if (stats.blocking_threadpool_threads_cnt == 0)
+		{
+			break;
+		}
+		ff_core_sleep(10);
+	}
+	ASSERT(stats.blocking_threadpool_threads_cnt == 0, "idle threads should exit after the idle timeout");
+	ASSERT(stats.threadpool_tasks_cnt >= 10, "tasks of exited threads should be counted");
+
+	/* the threadpool starts new threads after idle threads exit */
+	threadpool_idle_fiber_func(NULL);
+	ff_core_shutdown();
+}
+
+#define PARALLEL_FOR_ITEMS_CNT 10000
+
+static void parallel_for_increment_func(int begin, int end, void *ctx)
+{
+	int *items;
+	int i;
+
+	items = (int *) ctx;
+	ASSERT(begin < end, "the chunk shouldn't be empty");
+	for (i = begin; i < end; i++)
+	{
+		items[i]++;
+	}
+}
+
+static void parallel_for_fiber_func(void *ctx)
+{
+	int *items;
+	int i;
+
+	items = (int *) ctx;
+	ff_core_parallel_for(0, PARALLEL_FOR_ITEMS_CNT, 7, parallel_for_increment_func, items);
+	for (i = 0; i < PARALLEL_FOR_ITEMS_CNT; i++)
+	{
+		ASSERT(items[i] == 1, "each item should be processed exactly once");
+	}
+}
+
+static void test_core_parallel_for(void)
+{
+	struct ff_fiber *fibers[4];
+	int *items;
+	int grain;
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 0);
+	items = (int *) ff_calloc(PARALLEL_FOR_ITEMS_CNT * 4, sizeof(items[0]));
+
+	/* empty ranges don't call the func */
+	ff_core_parallel_for(10, 10, 1, parallel_for_increment_func, items);
+	ASSERT(items[10] == 0, "the empty range shouldn't be processed");
+
+	for (grain = 1; grain <= PARALLEL_FOR_ITEMS_CNT * 2; grain *= 13)
+	{
+		memset(items, 0, PARALLEL_FOR_ITEMS_CNT * sizeof(items[0]));
+		ff_core_parallel_for(5, PARALLEL_FOR_ITEMS_CNT, grain, parallel_for_increment_func, items);
+		for (i = 0; i < PARALLEL_FOR_ITEMS_CNT; i++)
+		{
+			ASSERT(items[i] == (i < 5 ? 0 : 1), "each item of the range should be processed exactly once");
+		}
+	}
+
+	/* concurrent calls from multiple fibers share the compute threadpool */
+	memset(items, 0, PARALLEL_FOR_ITEMS_CNT * 4 * sizeof(items[0]));
+	for (i = 0; i < 4; i++)
+	{
+		fibers[i] = ff_fiber_create(parallel_for_fiber_func, 0);
+		ff_fiber_start(fibers[i], items + PARALLEL_FOR_ITEMS_CNT * i);
+	}
+	for (i = 0; i < 4; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+
+	ff_free(items);
+	ff_core_shutdown();
+}
+
 static void fiberpool_int_increment(void *ctx)
 {
 	int *a;
@@ -190,6 +409,121 @@ static void test_core_fiberpool_execute_multiple(void)
 	ASSERT(a == 10, "unexpected result");
 }
 
+#define FIBERPOOL_ORDER_TASKS_CNT 100
+
+struct fiberpool_order_data
+{
+	int *order;
+	int *next_index;
+	int value;
+};
+
+static void fiberpool_order_func(void *ctx)
+{
+	struct fiberpool_order_data *data;
+
+	data = (struct fiberpool_order_data *) ctx;
+	data->order[*data->next_index] = data->value;
+	(*data->next_index)++;
+}
+
+static void test_core_fiberpool_execute_fifo(void)
+{
+	struct fiberpool_order_data data[FIBERPOOL_ORDER_TASKS_CNT];
+	int order[FIBERPOOL_ORDER_TASKS_CNT];
+	int next_index = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	for (i = 0; i < FIBERPOOL_ORDER_TASKS_CNT; i++)
+	{
+		data[i].order = order;
+		data[i].next_index = &next_index;
+		data[i].value = i;
+		ff_core_fiberpool_execute_async(fiberpool_order_func, &data[i]);
+	}
+	ff_core_shutdown();
+	ASSERT(next_index == FIBERPOOL_ORDER_TASKS_CNT, "all the tasks should be executed");
+	for (i = 0; i < FIBERPOOL_ORDER_TASKS_CNT; i++)
+	{
+		ASSERT(order[i] == i, "tasks should be executed in FIFO order");
+	}
+}
+
+static void test_core_fiberpool_execute_batch(void)
+{
+	int a[100];
+	void *ctxs[100];
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	for (i = 0; i < 100; i++)
+	{
+		a[i] = i;
+		ctxs[i] = &a[i];
+	}
+	ff_core_fiberpool_execute_batch_async(fiberpool_int_increment, ctxs, 100);
+	ff_core_shutdown();
+	for (i = 0; i < 100; i++)
+	{
+		ASSERT(a[i] == i + 1, "each context should be passed to the func exactly once");
+	}
+}
+
+struct fiberpool_sleep_data
+{
+	struct ff_mutex *mutex;
+	int a;
+};
+
+static void fiberpool_sleep_func(void *ctx)
+{
+	struct fiberpool_sleep_data *data;
+
+	data = (struct fiberpool_sleep_data *) ctx;
+	ff_core_sleep(10);
+	ff_mutex_lock(data->mutex);
+	data->a++;
+	ff_mutex_unlock(data->mutex);
+}
+
+static void test_core_fiberpool_idle_timeout(void)
+{
+	struct fiberpool_sleep_data data;
+	void *ctxs[10];
+	struct ff_core_stats stats;
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 2);
+	ff_core_set_fiberpool_idle_timeout(10);
+	data.mutex = ff_mutex_create();
+	data.a = 0;
+	for (i = 0; i < 10; i++)
+	{
+		ctxs[i] = &data;
+	}
+	ff_core_fiberpool_execute_batch_async(fiberpool_sleep_func, ctxs, 10);
+	ff_core_get_stats(&stats);
+	ASSERT(stats.fiberpool_fibers_cnt == 10, "the fiberpool should start a fiber per each sleeping task");
+	for (i = 0; i < 100; i++)
+	{
+		ff_core_get_stats(&stats);
+		if (stats.fiberpool_fibers_cnt == 0)
+		{
+			break;
+		}
+		ff_core_sleep(10);
+	}
+	ASSERT(stats.fiberpool_fibers_cnt == 0, "idle fibers should exit after the idle timeout");
+	ASSERT(data.a == 10, "all the tasks should be executed");
+
+	/* the fiberpool should start new fibers after idle fibers exit */
+	ff_core_fiberpool_execute_batch_async(fiberpool_sleep_func, ctxs, 10);
+	ff_core_shutdown();
+	ASSERT(data.a == 20, "all the tasks should be executed");
+	ff_mutex_delete(data.mutex);
+}
+
 static void test_core_fiberpool_execute_deferred(void)
 {
 	int a = 0;
@@ -218,6 +552,360 @@ static void test_core_fiberpool_execute_deferred_multiple(void)
 	ASSERT(a == 10, "unexpected result");
 }
 
+static void test_core_fiberpool_execute_deferred_intervals(void)
+{
+	int a = 0;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	for (i = 0; i < 10; i++)
+	{
+		ff_core_fiberpool_execute_deferred(fiberpool_int_increment, &a, i + 1);
+		ff_core_fiberpool_execute_deferred(fiberpool_int_increment, &a, 5000 + i * 100);
+	}
+	ff_core_sleep(500);
+	ASSERT(a == 10, "unexpected result");
+	ff_core_shutdown();
+	ASSERT(a == 20, "unexpected result");
+}
+
+static void test_core_init_with_schedulers(void)
+{
+	int schedulers_cnt;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 4);
+	schedulers_cnt = ff_core_get_schedulers_cnt();
+	ASSERT(schedulers_cnt == 4, "unexpected number of schedulers");
+	ff_core_shutdown();
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 0);
+	schedulers_cnt = ff_core_get_schedulers_cnt();
+	ASSERT(schedulers_cnt > 0, "unexpected number of schedulers");
+	ff_core_sleep(10);
+	ff_core_shutdown();
+}
+
+struct schedulers_data
+{
+	struct ff_mutex *mutex;
+	int cnt;
+};
+
+static void schedulers_func(void *ctx)
+{
+	struct schedulers_data *data;
+	int a[2];
+	int i;
+
+	data = (struct schedulers_data *) ctx;
+	for (i = 0; i < 10; i++)
+	{
+		a[0] = i;
+		a[1] = 0;
+		ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_int_increment, a);
+		ASSERT(a[1] == i + 1, "unexpected result");
+		ff_mutex_lock(data->mutex);
+		data->cnt++;
+		ff_mutex_unlock(data->mutex);
+		ff_core_sleep(1);
+	}
+}
+
+static void test_core_schedulers_multiple(void)
+{
+	struct schedulers_data data;
+	int cnt;
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 4);
+	data.mutex = ff_mutex_create();
+	data.cnt = 0;
+	for (i = 0; i < 100; i++)
+	{
+		ff_core_fiberpool_execute_async(schedulers_func, &data);
+	}
+	do
+	{
+		ff_core_sleep(10);
+		ff_mutex_lock(data.mutex);
+		cnt = data.cnt;
+		ff_mutex_unlock(data.mutex);
+	} while (cnt < 1000);
+	ff_mutex_delete(data.mutex);
+	ff_core_shutdown();
+	ASSERT(data.cnt == 1000, "unexpected result");
+}
+
+static void test_core_stats(void)
+{
+	struct ff_core_stats stats;
+	struct ff_fiber *fiber;
+	int a[2];
+	int b = 0;
+
+	ff_core_initialize(LOG_FILENAME);
+	a[0] = 1;
+	a[1] = 0;
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_int_increment, a);
+	fiber = ff_fiber_create(fiberpool_int_increment, 0);
+	ff_fiber_start(fiber, &b);
+	ff_fiber_join(fiber);
+	ff_fiber_delete(fiber);
+	ff_core_sleep(10);
+	ff_core_get_stats(&stats);
+	ASSERT(stats.context_switches_cnt > 0, "fiber switches should be counted");
+	ASSERT(stats.max_run_queue_depth > 0, "the run queue should contain fibers");
+	ASSERT(stats.completion_port_waits_cnt > 0, "completion port waits should be counted");
+	ASSERT(stats.completion_port_events_cnt >= stats.completion_port_waits_cnt, "each completion port wait should return events");
+	ASSERT(stats.threadpool_tasks_cnt >= 1, "threadpool tasks should be counted");
+	ASSERT(stats.threadpool_max_queue_latency >= 0, "unexpected threadpool queue latency");
+	ASSERT(stats.threadpool_total_queue_latency >= stats.threadpool_max_queue_latency, "unexpected threadpool queue latency");
+	ff_core_shutdown();
+}
+
+#define TCP_ECHO_MESSAGES_CNT 100
+
+struct tcp_echo_server_data
+{
+	struct ff_tcp *tcp_server;
+	int clients_cnt;
+};
+
+static void tcp_echo_connection_func(void *ctx)
+{
+	struct ff_tcp *tcp;
+
+	tcp = (struct ff_tcp *) ctx;
+	for (;;)
+	{
+		int message;
+		enum ff_result result;
+
+		result = ff_tcp_read(tcp, &message, sizeof(message));
+		if (result != FF_SUCCESS)
+		{
+			break;
+		}
+		result = ff_tcp_write(tcp, &message, sizeof(message));
+		ASSERT(result == FF_SUCCESS, "cannot write data to the tcp");
+		result = ff_tcp_flush(tcp);
+		ASSERT(result == FF_SUCCESS, "cannot flush the tcp");
+	}
+	ff_tcp_delete(tcp);
+}
+
+static void tcp_echo_server_func(void *ctx)
+{
+	struct tcp_echo_server_data *data;
+	struct ff_arch_net_addr *client_addr;
+	int i;
+
+	data = (struct tcp_echo_server_data *) ctx;
+	client_addr = ff_arch_net_addr_create();
+	for (i = 0; i < data->clients_cnt; i++)
+	{
+		struct ff_tcp *tcp_client;
+
+		tcp_client = ff_tcp_accept(data->tcp_server, client_addr);
+		ASSERT(tcp_client != NULL, "ff_tcp_accept() should return valid tcp_client");
+		ff_core_fiberpool_execute_async(tcp_echo_connection_func, tcp_client);
+	}
+	ff_arch_net_addr_delete(client_addr);
+}
+
+/**
+ * Connects to the echo server and verifies TCP_ECHO_MESSAGES_CNT round trips
+ */
+static void tcp_echo_client(const struct ff_arch_net_addr *addr)
+{
+	struct ff_tcp *tcp;
+	enum ff_result result;
+	int i;
+
+	tcp = ff_tcp_create();
+	result = ff_tcp_connect(tcp, addr);
+	ASSERT(result == FF_SUCCESS, "client should connect to the echo server");
+	for (i = 0; i < TCP_ECHO_MESSAGES_CNT; i++)
+	{
+		int message;
+
+		result = ff_tcp_write(tcp, &i, sizeof(i));
+		ASSERT(result == FF_SUCCESS, "cannot write data to the tcp");
+		result = ff_tcp_flush(tcp);
+		ASSERT(result == FF_SUCCESS, "cannot flush the tcp");
+		result = ff_tcp_read(tcp, &message, sizeof(message));
+		ASSERT(result == FF_SUCCESS, "cannot read data from the tcp");
+		ASSERT(message == i, "the echo server should return the same message");
+	}
+	ff_tcp_delete(tcp);
+}
+
+static void test_core_busy_poll(void)
+{
+	struct tcp_echo_server_data data;
+	struct ff_arch_net_addr *addr;
+	struct ff_core_stats stats;
+	enum ff_result result;
+	int a[2];
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 2);
+	ff_core_set_busy_poll(1000, 1);
+	for (i = 0; i < 10; i++)
+	{
+		a[0] = i;
+		a[1] = 0;
+		ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, threadpool_int_increment, a);
+		ASSERT(a[1] == i + 1, "unexpected result");
+		ff_core_sleep(1);
+	}
+
+	/* sockets created after ff_core_set_busy_poll() busy-poll network devices too */
+	addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 43220);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	data.tcp_server = ff_tcp_create();
+	data.clients_cnt = 1;
+	result = ff_tcp_bind(data.tcp_server, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "server should be bound to local address");
+	ff_core_fiberpool_execute_async(tcp_echo_server_func, &data);
+	tcp_echo_client(addr);
+	ff_core_get_stats(&stats);
+	ASSERT(stats.busy_poll_hits_cnt > 0, "spinning should find completions of echo round trips");
+
+	/* nothing happens during the sleep, so spinning must run out of the budget */
+	ff_core_sleep(10);
+	ff_core_get_stats(&stats);
+	ASSERT(stats.busy_poll_misses_cnt > 0, "spinning shouldn't find completions while schedulers are idle");
+
+	ff_core_set_busy_poll(0, 0);
+	ff_core_sleep(1);
+	ff_tcp_delete(data.tcp_server);
+	ff_arch_net_addr_delete(addr);
+	ff_core_shutdown();
+}
+
+#define TCP_ECHO_CLIENTS_CNT 20
+
+static void schedulers_tcp_client_func(void *ctx)
+{
+	struct ff_arch_net_addr *addr;
+
+	addr = (struct ff_arch_net_addr *) ctx;
+	tcp_echo_client(addr);
+}
+
+static void test_core_schedulers_tcp(void)
+{
+	struct tcp_echo_server_data server_data;
+	struct ff_fiber *fibers[TCP_ECHO_CLIENTS_CNT];
+	struct ff_arch_net_addr *addr;
+	enum ff_result result;
+	int i;
+
+	/* sockets are registered in the completion port of the scheduler, which creates them,
+	 * while fibers, which use them, can migrate between schedulers
+	 */
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 4);
+	addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 43221);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	server_data.tcp_server = ff_tcp_create();
+	server_data.clients_cnt = TCP_ECHO_CLIENTS_CNT;
+	result = ff_tcp_bind(server_data.tcp_server, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "server should be bound to local address");
+	ff_core_fiberpool_execute_async(tcp_echo_server_func, &server_data);
+	for (i = 0; i < TCP_ECHO_CLIENTS_CNT; i++)
+	{
+		fibers[i] = ff_fiber_create(schedulers_tcp_client_func, 0);
+		ff_fiber_start(fibers[i], addr);
+	}
+	for (i = 0; i < TCP_ECHO_CLIENTS_CNT; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ff_tcp_delete(server_data.tcp_server);
+	ff_arch_net_addr_delete(addr);
+	ff_core_shutdown();
+}
+
+/**
+ * Runs TCP_ECHO_CLIENTS_CNT concurrent echo clients with the given io batch size.
+ * Returns the average number of completions harvested per completion port wait.
+ */
+static double run_io_batch_echo(const struct ff_arch_net_addr *addr, int batch_size)
+{
+	struct ff_fiber *fibers[TCP_ECHO_CLIENTS_CNT];
+	struct ff_core_stats stats_before;
+	struct ff_core_stats stats_after;
+	int64_t waits_cnt;
+	int64_t events_cnt;
+	int i;
+
+	ff_core_set_io_batch_size(batch_size);
+	ff_core_get_stats(&stats_before);
+	for (i = 0; i < TCP_ECHO_CLIENTS_CNT; i++)
+	{
+		fibers[i] = ff_fiber_create(schedulers_tcp_client_func, 0);
+		ff_fiber_start(fibers[i], (void *) addr);
+	}
+	for (i = 0; i < TCP_ECHO_CLIENTS_CNT; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ff_core_get_stats(&stats_after);
+	waits_cnt = stats_after.completion_port_waits_cnt - stats_before.completion_port_waits_cnt;
+	events_cnt = stats_after.completion_port_events_cnt - stats_before.completion_port_events_cnt;
+	ASSERT(waits_cnt > 0, "echo clients should wait for I/O completions");
+	return (double) events_cnt / waits_cnt;
+}
+
+static void test_core_io_batch_size(void)
+{
+	struct tcp_echo_server_data server_data;
+	struct ff_arch_net_addr *addr;
+	double events_per_wait;
+	enum ff_result result;
+#ifndef WIN32
+	const char *backend;
+	int is_uring_allowed;
+
+	/* io_uring harvests all available completions per wait regardless of the io batch size,
+	 * so the scheduler's completion port is forced to use epoll
+	 */
+	backend = getenv("FF_IO_URING");
+	is_uring_allowed = (backend == NULL || strcmp(backend, "0") != 0);
+	setenv("FF_IO_URING", "0", 1);
+	ff_core_initialize(LOG_FILENAME);
+	if (is_uring_allowed)
+	{
+		unsetenv("FF_IO_URING");
+	}
+#else
+	ff_core_initialize(LOG_FILENAME);
+#endif
+
+	addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 43222);
+	ASSERT(result == FF_SUCCESS, "localhost address should be resolved successfully");
+	server_data.tcp_server = ff_tcp_create();
+	server_data.clients_cnt = 2 * TCP_ECHO_CLIENTS_CNT;
+	result = ff_tcp_bind(server_data.tcp_server, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "server should be bound to local address");
+	ff_core_fiberpool_execute_async(tcp_echo_server_func, &server_data);
+
+	events_per_wait = run_io_batch_echo(addr, 1);
+	ASSERT(events_per_wait == 1.0, "each wait should harvest a single completion with the io batch size 1");
+	events_per_wait = run_io_batch_echo(addr, 100);
+	ASSERT(events_per_wait > 2.0, "waits should harvest completions of concurrent clients in batches");
+
+	ff_tcp_delete(server_data.tcp_server);
+	ff_arch_net_addr_delete(addr);
+	ff_core_shutdown();
+}
+
 static void test_core_all(void)
 {
 	test_core_init();
@@ -226,10 +914,24 @@ static void test_core_all(void)
 	test_core_sleep_multiple();
 	test_core_threadpool_execute();
 	test_core_threadpool_execute_multiple();
+	test_core_threadpool_execute_concurrent();
+	test_core_threadpool_execute_overflow();
+	test_core_threadpool_idle_timeout();
+	test_core_parallel_for();
 	test_core_fiberpool_execute();
 	test_core_fiberpool_execute_multiple();
+	test_core_fiberpool_execute_fifo();
+	test_core_fiberpool_execute_batch();
+	test_core_fiberpool_idle_timeout();
 	test_core_fiberpool_execute_deferred();
 	test_core_fiberpool_execute_deferred_multiple();
+	test_core_fiberpool_execute_deferred_intervals();
+	test_core_init_with_schedulers();
+	test_core_schedulers_multiple();
+	test_core_stats();
+	test_core_busy_poll();
+	test_core_schedulers_tcp();
+	test_core_io_batch_size();
 }
 
 /* end of ff_core tests */
@@ -256,7 +958,7 @@ static void log_threadpool_func(void *ctx)
 static void test_log_threadpool(void)
 {
 	ff_core_initialize(LOG_FILENAME);
-	ff_core_threadpool_execute(log_threadpool_func, NULL);
+	ff_core_threadpool_execute(FF_CORE_THREADPOOL_BLOCKING, log_threadpool_func, NULL);
 	ff_core_shutdown();
 }
 
@@ -428,11 +1130,128 @@ static void test_fiber_start_multiple(void)
 	ff_core_shutdown();
 }
 
+struct fiber_order_data
+{
+	int order[10];
+	int cnt;
+};
+
+static void fiber_order_func(void *ctx)
+{
+	struct fiber_order_data *data;
+	int i;
+
+	data = (struct fiber_order_data *) ((void **)ctx)[0];
+	i = *(int *) ((void **)ctx)[1];
+	data->order[data->cnt] = i;
+	data->cnt++;
+}
+
+static void run_fibers_in_order(struct fiber_order_data *data, const enum ff_fiber_priority *priorities)
+{
+	struct ff_fiber *fibers[10];
+	void *ctxs[10][2];
+	int ids[10];
+	int i;
+
+	data->cnt = 0;
+	for (i = 0; i < 10; i++)
+	{
+		ids[i] = i;
+		ctxs[i][0] = data;
+		ctxs[i][1] = &ids[i];
+		fibers[i] = ff_fiber_create(fiber_order_func, 0);
+		ff_fiber_set_priority(fibers[i], priorities[i]);
+	}
+	for (i = 0; i < 10; i++)
+	{
+		ff_fiber_start(fibers[i], ctxs[i]);
+	}
+	for (i = 0; i < 10; i++)
+	{
+		ff_fiber_join(fibers[i]);
+		ff_fiber_delete(fibers[i]);
+	}
+	ASSERT(data->cnt == 10, "all fibers should be executed");
+}
+
+static void test_fiber_fifo_order(void)
+{
+	struct fiber_order_data data;
+	enum ff_fiber_priority priorities[10];
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	for (i = 0; i < 10; i++)
+	{
+		priorities[i] = FF_FIBER_PRIORITY_NORMAL;
+	}
+	run_fibers_in_order(&data, priorities);
+	for (i = 0; i < 10; i++)
+	{
+		ASSERT(data.order[i] == i, "fibers with the same priority should run in FIFO order");
+	}
+	ff_core_shutdown();
+}
+
+static void test_fiber_priority(void)
+{
+	struct fiber_order_data data;
+	enum ff_fiber_priority priorities[10];
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	/* fibers 0-4 have low priority, fibers 5-9 have high priority */
+	for (i = 0; i < 10; i++)
+	{
+		priorities[i] = (i < 5) ? FF_FIBER_PRIORITY_LOW : FF_FIBER_PRIORITY_HIGH;
+	}
+	run_fibers_in_order(&data, priorities);
+	for (i = 0; i < 5; i++)
+	{
+		ASSERT(data.order[i] == i + 5, "high priority fibers should run before low priority fibers");
+		ASSERT(data.order[i + 5] == i, "low priority fibers should run in FIFO order");
+	}
+	ff_core_shutdown();
+}
+
+static void fiber_stats_func(void *ctx)
+{
+	(void)ctx;
+	ff_core_sleep(1);
+	ff_core_sleep(1);
+}
+
+static void test_fiber_stats(void)
+{
+	struct ff_fiber *fiber;
+	struct ff_fiber_stats stats;
+
+	ff_core_initialize(LOG_FILENAME);
+	fiber = ff_fiber_create(fiber_stats_func, 0);
+	ff_fiber_get_stats(fiber, &stats);
+	ASSERT(stats.switches_cnt == 0, "the fiber shouldn't run before ff_fiber_start()");
+	ASSERT(stats.run_time == 0, "the fiber shouldn't run before ff_fiber_start()");
+	ff_fiber_start(fiber, NULL);
+	ff_fiber_join(fiber);
+	ff_fiber_get_stats(fiber, &stats);
+	ASSERT(stats.switches_cnt == 3, "the fiber should be switched in on start and after each sleep");
+	ASSERT(stats.run_time > 0, "the fiber should accumulate run time");
+	ff_fiber_delete(fiber);
+	ff_fiber_get_stats(ff_fiber_get_current(), &stats);
+	ASSERT(stats.switches_cnt > 0, "the current fiber should be switched in at least once");
+	ASSERT(stats.run_time > 0, "the current fiber should accumulate run time");
+	ff_core_shutdown();
+}
+
 static void test_fiber_all(void)
 {
 	test_fiber_create_delete();
 	test_fiber_start_join();
 	test_fiber_start_multiple();
+	test_fiber_fifo_order();
+	test_fiber_priority();
+	test_fiber_stats();
 }
 
 /* end of ff_fiber tests */
@@ -633,22 +1452,84 @@ static void test_event_auto_multiple(void)
 	data[0] = event;
 	data[1] = done_event;
 	data[2] = &a;
-	for (i = 0; i < 15; i++)
+	for (i = 0; i < 15; i++)
+	{
+		ff_core_fiberpool_execute_async(fiberpool_event_func, data);
+	}
+	ASSERT(a == 0, "a shouldn't change while event isn't set");
+	for (i = 0; i < 14; i++)
+	{
+		enum ff_result result;
+
+		ff_event_set(event);
+		result = ff_event_wait_with_timeout(done_event, 1);
+		ASSERT(result != FF_SUCCESS, "done_event should remain 'not set'");
+	}
+	ff_event_set(event);
+	ff_event_wait(done_event);
+	ASSERT(a == 15, "a should have value 15 after done_event set");
+	ff_event_delete(done_event);
+	ff_event_delete(event);
+	ff_core_shutdown();
+}
+
+static void fiberpool_event_timeout_func(void *ctx)
+{
+	struct ff_event *event, *done_event;
+	int *a;
+	int *timeouts_cnt;
+	enum ff_result result;
+
+	event = (struct ff_event *) ((void **)ctx)[0];
+	done_event = (struct ff_event *) ((void **)ctx)[1];
+	a = (int *) ((void **)ctx)[2];
+	timeouts_cnt = (int *) ((void **)ctx)[3];
+
+	/* odd fibers time out, so they are removed from the middle of the event's wait queue */
+	if ((*a)++ % 2)
+	{
+		result = ff_event_wait_with_timeout(event, 10);
+		ASSERT(result != FF_SUCCESS, "event should timeout");
+		(*timeouts_cnt)++;
+	}
+	else
+	{
+		ff_event_wait(event);
+	}
+	(*a)--;
+	if (*a == 0)
+	{
+		ff_event_set(done_event);
+	}
+}
+
+static void test_event_timeout_multiple(void)
+{
+	struct ff_event *event, *done_event;
+	int i;
+	int a = 0;
+	int timeouts_cnt = 0;
+	void *data[4];
+
+	ff_core_initialize(LOG_FILENAME);
+	event = ff_event_create(FF_EVENT_MANUAL);
+	done_event = ff_event_create(FF_EVENT_MANUAL);
+	data[0] = event;
+	data[1] = done_event;
+	data[2] = &a;
+	data[3] = &timeouts_cnt;
+	for (i = 0; i < 20; i++)
 	{
-		ff_core_fiberpool_execute_async(fiberpool_event_func, data);
+		ff_core_fiberpool_execute_async(fiberpool_event_timeout_func, data);
 	}
-	ASSERT(a == 0, "a shouldn't change while event isn't set");
-	for (i = 0; i < 14; i++)
+	while (timeouts_cnt < 10)
 	{
-		enum ff_result result;
-
-		ff_event_set(event);
-		result = ff_event_wait_with_timeout(done_event, 1);
-		ASSERT(result != FF_SUCCESS, "done_event should remain 'not set'");
+		ff_core_sleep(10);
 	}
+	ASSERT(a == 10, "fibers without timeout should remain blocked");
 	ff_event_set(event);
 	ff_event_wait(done_event);
-	ASSERT(a == 15, "a should have value 15 after done_event set");
+	ASSERT(a == 0, "all fibers should be waken up after ff_event_set");
 	ff_event_delete(done_event);
 	ff_event_delete(event);
 	ff_core_shutdown();
@@ -664,6 +1545,7 @@ static void test_event_all(void)
 	test_event_auto_timeout();
 	test_event_manual_multiple();
 	test_event_auto_multiple();
+	test_event_timeout_multiple();
 }
 
 /* end of ff_event tests */
@@ -782,6 +1664,157 @@ static void test_semaphore_all(void)
 
 /* end of ff_semaphore tests */
 
+/* start of ff_future tests */
+
+static void *future_increment_func(void *ctx)
+{
+	int *a;
+
+	a = (int *) ctx;
+	return (void *) (a + 1);
+}
+
+static void *future_sleep_func(void *ctx)
+{
+	int *interval;
+
+	interval = (int *) ctx;
+	ff_core_sleep(*interval);
+	return ctx;
+}
+
+static void test_future_basic(void)
+{
+	struct ff_future *future;
+	enum ff_result result;
+	int a[2];
+
+	ff_core_initialize(LOG_FILENAME);
+	future = ff_future_fiberpool_execute_async(future_increment_func, a);
+	result = ff_future_wait(future);
+	ASSERT(result == FF_SUCCESS, "the future should be completed");
+	ASSERT(ff_future_get_result(future) == a + 1, "unexpected result");
+	/* the completed future can be waited multiple times */
+	result = ff_future_wait_with_timeout(future, 1);
+	ASSERT(result == FF_SUCCESS, "the future should be completed");
+	ff_future_delete(future);
+
+	future = ff_future_threadpool_execute_async(FF_CORE_THREADPOOL_COMPUTE, future_increment_func, a);
+	result = ff_future_wait(future);
+	ASSERT(result == FF_SUCCESS, "the future should be completed");
+	ASSERT(ff_future_get_result(future) == a + 1, "unexpected result");
+	ff_future_delete(future);
+	ff_core_shutdown();
+}
+
+static void test_future_wait_all(void)
+{
+	struct ff_future *futures[20];
+	enum ff_result result;
+	int a[21];
+	int i;
+
+	ff_core_initialize_with_schedulers(LOG_FILENAME, 2);
+	for (i = 0; i < 20; i++)
+	{
+		if (i % 2 == 0)
+		{
+			futures[i] = ff_future_fiberpool_execute_async(future_increment_func, a + i);
+		}
+		else
+		{
+			futures[i] = ff_future_threadpool_execute_async(FF_CORE_THREADPOOL_BLOCKING, future_increment_func, a + i);
+		}
+	}
+	result = ff_future_wait_all(futures, 20);
+	ASSERT(result == FF_SUCCESS, "all the futures should be completed");
+	for (i = 0; i < 20; i++)
+	{
+		ASSERT(ff_future_get_result(futures[i]) == a + i + 1, "unexpected result");
+		ff_future_delete(futures[i]);
+	}
+	ff_core_shutdown();
+}
+
+static void test_future_wait_any(void)
+{
+	struct ff_future *futures[10];
+	int intervals[10];
+	int index;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	for (i = 0; i < 10; i++)
+	{
+		/* futures[7] completes first. The number of futures exceeds the number of waiters on the stack */
+		intervals[i] = (i == 7) ? 1 : 200;
+		futures[i] = ff_future_fiberpool_execute_async(future_sleep_func, &intervals[i]);
+	}
+	index = ff_future_wait_any(futures, 10);
+	ASSERT(index == 7, "the fastest future should be returned");
+	ASSERT(ff_future_get_result(futures[7]) == &intervals[7], "unexpected result");
+	index = ff_future_wait_any(futures, 10);
+	ASSERT(index == 7, "the completed future should be returned immediately");
+
+	/* cancelled futures are discarded without waiting for their funcs */
+	for (i = 0; i < 10; i++)
+	{
+		ff_future_cancel(futures[i]);
+		ff_future_delete(futures[i]);
+	}
+	ff_core_shutdown();
+}
+
+static void future_cancel_func(void *ctx)
+{
+	struct ff_future *future;
+
+	future = (struct ff_future *) ctx;
+	ff_future_cancel(future);
+}
+
+static void test_future_cancel(void)
+{
+	struct ff_future *futures[2];
+	struct ff_future *future;
+	enum ff_result result;
+	int interval;
+	int index;
+
+	ff_core_initialize(LOG_FILENAME);
+	interval = 200;
+	future = ff_future_fiberpool_execute_async(future_sleep_func, &interval);
+	result = ff_future_wait_with_timeout(future, 10);
+	ASSERT(result == FF_FAILURE, "the future shouldn't be completed during the timeout");
+	ff_future_cancel(future);
+	result = ff_future_wait(future);
+	ASSERT(result == FF_FAILURE, "the cancelled future should fail");
+	result = ff_future_wait_all(&future, 1);
+	ASSERT(result == FF_FAILURE, "the cancelled future should fail");
+	ff_future_delete(future);
+
+	/* the cancellation wakes up fibers, which wait for the future */
+	futures[0] = ff_future_fiberpool_execute_async(future_sleep_func, &interval);
+	futures[1] = ff_future_fiberpool_execute_async(future_sleep_func, &interval);
+	ff_core_fiberpool_execute_deferred(future_cancel_func, futures[1], 10);
+	index = ff_future_wait_any(futures, 2);
+	ASSERT(index == 1, "the cancelled future should be returned");
+	ff_future_cancel(futures[0]);
+	ff_future_delete(futures[0]);
+	ff_future_delete(futures[1]);
+	ff_core_shutdown();
+}
+
+static void test_future_all(void)
+{
+	test_future_basic();
+	test_future_wait_all();
+	test_future_wait_any();
+	test_future_cancel();
+}
+
+/* end of ff_future tests */
+
 /* start of ff_blocking_queue tests */
 
 static void test_blocking_queue_create_delete(void)
@@ -1438,71 +2471,509 @@ static void test_file_tmp_unique(void)
 	ASSERT(is_equal, "unexpected data read from the file");
 	ff_file_close(file);
 
-	result = ff_file_erase(tmp_file_path);
-	ASSERT(result == FF_SUCCESS, "cannot erase temporary file");
-	delete_tmp_unique_file_path(tmp_file_path);
+	result = ff_file_erase(tmp_file_path);
+	ASSERT(result == FF_SUCCESS, "cannot erase temporary file");
+	delete_tmp_unique_file_path(tmp_file_path);
+	ff_core_shutdown();
+}
+
+static void test_file_basic(void)
+{
+	struct ff_file *file;
+	int64_t size;
+	uint8_t data[] = "hello, world!\n";
+	uint8_t buf[sizeof(data) - 1];
+	int is_equal;
+	enum ff_result result;
+
+	ff_core_initialize(LOG_FILENAME);
+
+	file = ff_file_open(L"test.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "file should be created");
+	size = ff_file_get_size(file);
+	ASSERT(size == 0, "file should be empty");
+	result = ff_file_write(file, data, sizeof(data) - 1);
+	ASSERT(result == FF_SUCCESS, "all the data should be written to the file");
+	result = ff_file_flush(file);
+	ASSERT(result == FF_SUCCESS, "file should be flushed successfully");
+	ff_file_close(file);
+
+	file = ff_file_open(L"test.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "file should exist");
+	size = ff_file_get_size(file);
+	ASSERT(size == sizeof(data) - 1, "wrong file size");
+	result = ff_file_read(file, buf, sizeof(data) - 1);
+	ASSERT(result == FF_SUCCESS, "unexpected length of data read from the file");
+	is_equal = (memcmp(data, buf, sizeof(data) - 1) == 0);
+	ASSERT(is_equal, "wrong data read from the file");
+	ff_file_close(file);
+
+	result = ff_file_copy(L"test.txt", L"test1.txt");
+	ASSERT(result == FF_SUCCESS, "file should be copied");
+	result = ff_file_copy(L"test.txt", L"test1.txt");
+	ASSERT(result != FF_SUCCESS, "cannot copy to existing file");
+	result = ff_file_move(L"test.txt", L"test2.txt");
+	ASSERT(result == FF_SUCCESS, "file should be moved");
+	result = ff_file_move(L"test.txt", L"test2.txt");
+	ASSERT(result != FF_SUCCESS, "cannot move to existing file");
+
+	file = ff_file_open(L"test1.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "file copy should exist");
+	result = ff_file_read(file, buf, sizeof(data) - 1);
+	ASSERT(result == FF_SUCCESS, "unexpected length of file copy");
+	is_equal = (memcmp(data, buf, sizeof(data) - 1) == 0);
+	ASSERT(is_equal, "wrong contents of the file copy");
+	ff_file_close(file);
+
+	file = ff_file_open(L"test1.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "file should be truncated");
+	size = ff_file_get_size(file);
+	ASSERT(size == 0, "truncated file should be empty");
+	ff_file_close(file);
+
+	result = ff_file_erase(L"test1.txt");
+	ASSERT(result == FF_SUCCESS, "file1 should be deleted");
+	result = ff_file_erase(L"test2.txt");
+	ASSERT(result == FF_SUCCESS, "file2 should be deleted");
+
+	ff_core_shutdown();
+}
+
+#define LARGE_FILE_BLOCKS_CNT 256
+#define LARGE_FILE_BLOCK_SIZE 4096
+#define LARGE_FILE_READERS_CNT 10
+
+static void fill_large_file_block(uint8_t *block, int block_num)
+{
+	int i;
+
+	for (i = 0; i < LARGE_FILE_BLOCK_SIZE; i++)
+	{
+		block[i] = (uint8_t) (block_num + i);
+	}
+}
+
+static void large_file_reader_func(void *ctx)
+{
+	struct ff_event *done_event;
+	struct ff_file *file;
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	done_event = (struct ff_event *) ctx;
+	file = ff_file_open(L"test_large.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the large file");
+	for (i = 0; i < LARGE_FILE_BLOCKS_CNT; i++)
+	{
+		fill_large_file_block(expected_block, i);
+		result = ff_file_read(file, block, LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot read the block from the large file");
+		is_equal = (memcmp(block, expected_block, LARGE_FILE_BLOCK_SIZE) == 0);
+		ASSERT(is_equal, "wrong block read from the large file");
+	}
+	result = ff_file_read(file, block, 1);
+	ASSERT(result == FF_FAILURE, "the end of the large file should be reached");
+	ff_file_close(file);
+	ff_event_set(done_event);
+}
+
+static void test_file_large(void)
+{
+	struct ff_file *file;
+	struct ff_event *done_events[LARGE_FILE_READERS_CNT];
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
+	int64_t size;
+	enum ff_result result;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+
+	file = ff_file_open(L"test_large.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the large file");
+	for (i = 0; i < LARGE_FILE_BLOCKS_CNT; i++)
+	{
+		fill_large_file_block(block, i);
+		result = ff_file_write(file, block, LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot write the block into the large file");
+	}
+	result = ff_file_flush(file);
+	ASSERT(result == FF_SUCCESS, "cannot flush the large file");
+	size = ff_file_get_size(file);
+	ASSERT(size == ((int64_t) LARGE_FILE_BLOCKS_CNT) * LARGE_FILE_BLOCK_SIZE, "wrong size of the large file");
+	ff_file_close(file);
+
+	/* concurrent readers share the scheduler, so the file I/O mustn't block it */
+	for (i = 0; i < LARGE_FILE_READERS_CNT; i++)
+	{
+		done_events[i] = ff_event_create(FF_EVENT_AUTO);
+		ff_core_fiberpool_execute_async(large_file_reader_func, done_events[i]);
+	}
+	for (i = 0; i < LARGE_FILE_READERS_CNT; i++)
+	{
+		ff_event_wait(done_events[i]);
+		ff_event_delete(done_events[i]);
+	}
+
+	result = ff_file_erase(L"test_large.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the large file");
+	ff_core_shutdown();
+}
+
+struct positional_reader_data
+{
+	struct ff_file *file;
+	struct ff_event *done_event;
+	int reader_num;
+};
+
+static void positional_file_reader_func(void *ctx)
+{
+	struct positional_reader_data *data;
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	data = (struct positional_reader_data *) ctx;
+	for (i = 0; i < LARGE_FILE_BLOCKS_CNT; i++)
+	{
+		int block_num;
+
+		/* each reader visits all blocks in its own order */
+		block_num = (i * 7 + data->reader_num * 31) % LARGE_FILE_BLOCKS_CNT;
+		fill_large_file_block(expected_block, block_num);
+		result = ff_file_pread(data->file, block, LARGE_FILE_BLOCK_SIZE, ((int64_t) block_num) * LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot read the block at the given offset");
+		is_equal = (memcmp(block, expected_block, LARGE_FILE_BLOCK_SIZE) == 0);
+		ASSERT(is_equal, "wrong block read at the given offset");
+	}
+	ff_event_set(data->done_event);
+}
+
+static void test_file_positional(void)
+{
+	struct ff_file *file;
+	struct positional_reader_data readers_data[LARGE_FILE_READERS_CNT];
+	struct ff_iovec iov[3];
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t head[100];
+	uint8_t tail[LARGE_FILE_BLOCK_SIZE - 100];
+	int64_t size;
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+
+	/* write blocks in the reverse order, the first block is written by two halves using pwritev */
+	file = ff_file_open(L"test_positional.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the file");
+	for (i = LARGE_FILE_BLOCKS_CNT - 1; i > 0; i--)
+	{
+		fill_large_file_block(block, i);
+		result = ff_file_pwrite(file, block, LARGE_FILE_BLOCK_SIZE, ((int64_t) i) * LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot write the block at the given offset");
+	}
+	fill_large_file_block(block, 0);
+	iov[0].buf = block;
+	iov[0].len = LARGE_FILE_BLOCK_SIZE / 2;
+	iov[1].buf = block + LARGE_FILE_BLOCK_SIZE / 2;
+	iov[1].len = 0;
+	iov[2].buf = block + LARGE_FILE_BLOCK_SIZE / 2;
+	iov[2].len = LARGE_FILE_BLOCK_SIZE / 2;
+	result = ff_file_pwritev(file, iov, 3, 0);
+	ASSERT(result == FF_SUCCESS, "cannot write buffers at the given offset");
+	size = ff_file_get_size(file);
+	ASSERT(size == ((int64_t) LARGE_FILE_BLOCKS_CNT) * LARGE_FILE_BLOCK_SIZE, "wrong size of the file");
+	ff_file_close(file);
+
+	file = ff_file_open(L"test_positional.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+
+	/* the block crossing the boundary of the first two blocks is read into two buffers */
+	iov[0].buf = head;
+	iov[0].len = sizeof(head);
+	iov[1].buf = tail;
+	iov[1].len = sizeof(tail);
+	result = ff_file_preadv(file, iov, 2, LARGE_FILE_BLOCK_SIZE / 2);
+	ASSERT(result == FF_SUCCESS, "cannot read buffers at the given offset");
+	fill_large_file_block(block, 0);
+	fill_large_file_block(expected_block, 1);
+	is_equal = (memcmp(head, block + LARGE_FILE_BLOCK_SIZE / 2, sizeof(head)) == 0);
+	ASSERT(is_equal, "wrong data read into the first buffer");
+	is_equal = (memcmp(tail, block + LARGE_FILE_BLOCK_SIZE / 2 + sizeof(head), LARGE_FILE_BLOCK_SIZE / 2 - sizeof(head)) == 0);
+	ASSERT(is_equal, "wrong data read into the second buffer");
+	is_equal = (memcmp(tail + LARGE_FILE_BLOCK_SIZE / 2 - sizeof(head), expected_block, LARGE_FILE_BLOCK_SIZE / 2) == 0);
+	ASSERT(is_equal, "wrong data read into the second buffer");
+
+	result = ff_file_pread(file, block, 2, size - 1);
+	ASSERT(result == FF_FAILURE, "reading past the end of the file should fail");
+
+	/* positional reads don't change the current position of the file */
+	result = ff_file_read(file, block, LARGE_FILE_BLOCK_SIZE);
+	ASSERT(result == FF_SUCCESS, "cannot read the first block");
+	fill_large_file_block(expected_block, 0);
+	is_equal = (memcmp(block, expected_block, LARGE_FILE_BLOCK_SIZE) == 0);
+	ASSERT(is_equal, "wrong first block");
+
+	/* many fibers concurrently read random blocks of the same file */
+	for (i = 0; i < LARGE_FILE_READERS_CNT; i++)
+	{
+		readers_data[i].file = file;
+		readers_data[i].done_event = ff_event_create(FF_EVENT_AUTO);
+		readers_data[i].reader_num = i;
+		ff_core_fiberpool_execute_async(positional_file_reader_func, &readers_data[i]);
+	}
+	for (i = 0; i < LARGE_FILE_READERS_CNT; i++)
+	{
+		ff_event_wait(readers_data[i].done_event);
+		ff_event_delete(readers_data[i].done_event);
+	}
+	ff_file_close(file);
+
+	result = ff_file_erase(L"test_positional.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	ff_core_shutdown();
+}
+
+static void create_large_file(const wchar_t *path)
+{
+	struct ff_file *file;
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
+	enum ff_result result;
+	int i;
+
+	file = ff_file_open(path, FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the large file");
+	for (i = 0; i < LARGE_FILE_BLOCKS_CNT; i++)
+	{
+		fill_large_file_block(block, i);
+		result = ff_file_write(file, block, LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot write the block into the large file");
+	}
+	result = ff_file_flush(file);
+	ASSERT(result == FF_SUCCESS, "cannot flush the large file");
+	ff_file_close(file);
+}
+
+static void test_file_map(void)
+{
+	struct ff_file *file;
+	struct ff_file_map *map;
+	const uint8_t *data;
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	int64_t size;
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	create_large_file(L"test_map.txt");
+	file = ff_file_open(L"test_map.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	size = ff_file_get_size(file);
+
+	/* the view starts and ends in the middle of pages */
+	map = ff_file_map_create(file, 100, size - 200);
+	ASSERT(map != NULL, "cannot map the file");
+	ff_file_close(file);
+	ASSERT(ff_file_map_get_size(map) == size - 200, "wrong size of the view");
+
+	ff_file_map_advise(map, 0, size - 200, FF_FILE_MAP_ADVICE_RANDOM);
+	ff_file_map_advise(map, 1, 10, FF_FILE_MAP_ADVICE_WILLNEED);
+	ff_file_map_advise(map, 0, size - 200, FF_FILE_MAP_ADVICE_SEQUENTIAL);
+	ff_file_map_prefault(map, 0, size - 200);
+	ff_file_map_prefault(map, LARGE_FILE_BLOCK_SIZE + 5, 1);
+	ff_file_map_advise(map, 0, size - 200, FF_FILE_MAP_ADVICE_NORMAL);
+
+	/* the view remains valid after the file is closed */
+	data = (const uint8_t *) ff_file_map_get_data(map);
+	fill_large_file_block(expected_block, 0);
+	is_equal = (memcmp(data, expected_block + 100, LARGE_FILE_BLOCK_SIZE - 100) == 0);
+	ASSERT(is_equal, "wrong data in the first block of the view");
+	for (i = 1; i < LARGE_FILE_BLOCKS_CNT - 1; i++)
+	{
+		fill_large_file_block(expected_block, i);
+		is_equal = (memcmp(data + i * LARGE_FILE_BLOCK_SIZE - 100, expected_block, LARGE_FILE_BLOCK_SIZE) == 0);
+		ASSERT(is_equal, "wrong data in the view");
+	}
+	fill_large_file_block(expected_block, LARGE_FILE_BLOCKS_CNT - 1);
+	is_equal = (memcmp(data + i * LARGE_FILE_BLOCK_SIZE - 100, expected_block, LARGE_FILE_BLOCK_SIZE - 100) == 0);
+	ASSERT(is_equal, "wrong data in the last block of the view");
+	ff_file_map_delete(map);
+
+	result = ff_file_erase(L"test_map.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	ff_core_shutdown();
+}
+
+static void test_file_map_past_eof(void)
+{
+	struct ff_file *file;
+	struct ff_file_map *map;
+	uint8_t data[] = "hello";
+	enum ff_result result;
+
+	ff_core_initialize(LOG_FILENAME);
+	file = ff_file_open(L"test_map.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the file");
+	result = ff_file_write(file, data, sizeof(data) - 1);
+	ASSERT(result == FF_SUCCESS, "cannot write to the file");
+	result = ff_file_flush(file);
+	ASSERT(result == FF_SUCCESS, "cannot flush the file");
+	ff_file_close(file);
+
+	file = ff_file_open(L"test_map.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	map = ff_file_map_create(file, 0, 1024 * 1024);
+	ASSERT(map == NULL, "the view past the end of the file shouldn't be created");
+	map = ff_file_map_create(file, 3, sizeof(data) - 3);
+	ASSERT(map == NULL, "the view, which ends past the end of the file, shouldn't be created");
+	map = ff_file_map_create(file, sizeof(data), 1);
+	ASSERT(map == NULL, "the view, which starts past the end of the file, shouldn't be created");
+
+	map = ff_file_map_create(file, 1, sizeof(data) - 2);
+	ASSERT(map != NULL, "the view at the end of the file should be created");
+	ff_file_close(file);
+	ASSERT(ff_file_map_get_size(map) == sizeof(data) - 2, "wrong size of the view");
+	ff_file_map_prefault(map, 0, sizeof(data) - 2);
+	ASSERT(memcmp(ff_file_map_get_data(map), data + 1, sizeof(data) - 2) == 0, "wrong data in the view");
+	ff_file_map_delete(map);
+
+	result = ff_file_erase(L"test_map.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
 	ff_core_shutdown();
 }
 
-static void test_file_basic(void)
+static void test_file_copy_large(void)
 {
 	struct ff_file *file;
-	int64_t size;
-	uint8_t data[] = "hello, world!\n";
-	uint8_t buf[sizeof(data) - 1];
-	int is_equal;
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
 	enum ff_result result;
+	int is_equal;
+	int i;
 
 	ff_core_initialize(LOG_FILENAME);
-
-	file = ff_file_open(L"test.txt", FF_FILE_WRITE);
-	ASSERT(file != NULL, "file should be created");
-	size = ff_file_get_size(file);
-	ASSERT(size == 0, "file should be empty");
-	result = ff_file_write(file, data, sizeof(data) - 1);
-	ASSERT(result == FF_SUCCESS, "all the data should be written to the file");
-	result = ff_file_flush(file);
-	ASSERT(result == FF_SUCCESS, "file should be flushed successfully");
+	create_large_file(L"test_copy_src.txt");
+	result = ff_file_copy(L"test_copy_src.txt", L"test_copy_dst.txt");
+	ASSERT(result == FF_SUCCESS, "cannot copy the large file");
+	result = ff_file_copy(L"test_copy_src.txt", L"test_copy_dst.txt");
+	ASSERT(result == FF_FAILURE, "the existing file shouldn't be overwritten by the copy");
+
+	file = ff_file_open(L"test_copy_dst.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the copy of the large file");
+	ASSERT(ff_file_get_size(file) == ((int64_t) LARGE_FILE_BLOCKS_CNT) * LARGE_FILE_BLOCK_SIZE, "wrong size of the copy");
+	for (i = 0; i < LARGE_FILE_BLOCKS_CNT; i++)
+	{
+		fill_large_file_block(expected_block, i);
+		result = ff_file_read(file, block, LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot read the block from the copy");
+		is_equal = (memcmp(block, expected_block, LARGE_FILE_BLOCK_SIZE) == 0);
+		ASSERT(is_equal, "wrong block in the copy");
+	}
 	ff_file_close(file);
 
-	file = ff_file_open(L"test.txt", FF_FILE_READ);
-	ASSERT(file != NULL, "file should exist");
-	size = ff_file_get_size(file);
-	ASSERT(size == sizeof(data) - 1, "wrong file size");
-	result = ff_file_read(file, buf, sizeof(data) - 1);
-	ASSERT(result == FF_SUCCESS, "unexpected length of data read from the file");
-	is_equal = (memcmp(data, buf, sizeof(data) - 1) == 0);
-	ASSERT(is_equal, "wrong data read from the file");
-	ff_file_close(file);
+	result = ff_file_erase(L"test_copy_src.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the source file");
+	result = ff_file_erase(L"test_copy_dst.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the copy");
+	ff_core_shutdown();
+}
 
-	result = ff_file_copy(L"test.txt", L"test1.txt");
-	ASSERT(result == FF_SUCCESS, "file should be copied");
-	result = ff_file_copy(L"test.txt", L"test1.txt");
-	ASSERT(result != FF_SUCCESS, "cannot copy to existing file");
-	result = ff_file_move(L"test.txt", L"test2.txt");
-	ASSERT(result == FF_SUCCESS, "file should be moved");
-	result = ff_file_move(L"test.txt", L"test2.txt");
-	ASSERT(result != FF_SUCCESS, "cannot move to existing file");
+#define VECTORED_BODY_SIZE (3 * 0x10000 + 123)
+#define VECTORED_SMALL_IOVECS_CNT 20
 
-	file = ff_file_open(L"test1.txt", FF_FILE_READ);
-	ASSERT(file != NULL, "file copy should exist");
-	result = ff_file_read(file, buf, sizeof(data) - 1);
-	ASSERT(result == FF_SUCCESS, "unexpected length of file copy");
-	is_equal = (memcmp(data, buf, sizeof(data) - 1) == 0);
-	ASSERT(is_equal, "wrong contents of the file copy");
+static void test_file_vectored(void)
+{
+	struct ff_file *file;
+	struct ff_iovec iov[VECTORED_SMALL_IOVECS_CNT + 3];
+	uint8_t small[VECTORED_SMALL_IOVECS_CNT];
+	uint8_t read_small[VECTORED_SMALL_IOVECS_CNT];
+	uint8_t header[3];
+	uint8_t trailer[3];
+	uint8_t *body;
+	uint8_t *read_body;
+	int64_t size;
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	body = (uint8_t *) ff_calloc(VECTORED_BODY_SIZE, sizeof(body[0]));
+	read_body = (uint8_t *) ff_calloc(VECTORED_BODY_SIZE, sizeof(read_body[0]));
+	for (i = 0; i < VECTORED_BODY_SIZE; i++)
+	{
+		body[i] = (uint8_t) (i * 7);
+	}
+	iov[0].buf = (void *) "hdr";
+	iov[0].len = 3;
+	iov[1].buf = body;
+	iov[1].len = VECTORED_BODY_SIZE;
+	iov[2].buf = (void *) "trl";
+	iov[2].len = 3;
+	for (i = 0; i < VECTORED_SMALL_IOVECS_CNT; i++)
+	{
+		small[i] = (uint8_t) i;
+		iov[i + 3].buf = &small[i];
+		iov[i + 3].len = 1;
+	}
+
+	file = ff_file_open(L"test_file_vectored.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the file");
+	result = ff_file_writev(file, iov, VECTORED_SMALL_IOVECS_CNT + 3);
+	ASSERT(result == FF_SUCCESS, "cannot write buffers to the file");
+	result = ff_file_writev(file, iov, 1);
+	ASSERT(result == FF_SUCCESS, "cannot write the buffer to the file");
+	result = ff_file_flush(file);
+	ASSERT(result == FF_SUCCESS, "cannot flush the file");
 	ff_file_close(file);
 
-	file = ff_file_open(L"test1.txt", FF_FILE_WRITE);
-	ASSERT(file != NULL, "file should be truncated");
+	file = ff_file_open(L"test_file_vectored.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
 	size = ff_file_get_size(file);
-	ASSERT(size == 0, "truncated file should be empty");
+	ASSERT(size == 3 + VECTORED_BODY_SIZE + 3 + VECTORED_SMALL_IOVECS_CNT + 3, "wrong size of the file");
+
+	/* the read leaves data in the read buffer, so buffers are filled partially from it */
+	result = ff_file_read(file, header, 2);
+	ASSERT(result == FF_SUCCESS, "cannot read the file");
+	iov[0].buf = header + 2;
+	iov[0].len = 1;
+	iov[1].buf = read_body;
+	iov[2].buf = trailer;
+	for (i = 0; i < VECTORED_SMALL_IOVECS_CNT; i++)
+	{
+		iov[i + 3].buf = &read_small[i];
+	}
+	result = ff_file_readv(file, iov, VECTORED_SMALL_IOVECS_CNT + 3);
+	ASSERT(result == FF_SUCCESS, "cannot read buffers from the file");
+	is_equal = (memcmp(header, "hdr", 3) == 0);
+	ASSERT(is_equal, "wrong header read from the file");
+	is_equal = (memcmp(read_body, body, VECTORED_BODY_SIZE) == 0);
+	ASSERT(is_equal, "wrong body read from the file");
+	is_equal = (memcmp(trailer, "trl", 3) == 0);
+	ASSERT(is_equal, "wrong trailer read from the file");
+	is_equal = (memcmp(read_small, small, VECTORED_SMALL_IOVECS_CNT) == 0);
+	ASSERT(is_equal, "wrong small buffers read from the file");
+	iov[0].buf = header;
+	iov[0].len = 3;
+	result = ff_file_readv(file, iov, 1);
+	ASSERT(result == FF_SUCCESS, "cannot read the last buffer from the file");
+	is_equal = (memcmp(header, "hdr", 3) == 0);
+	ASSERT(is_equal, "wrong last buffer read from the file");
+	result = ff_file_readv(file, iov, 1);
+	ASSERT(result == FF_FAILURE, "the end of file should be reached");
 	ff_file_close(file);
 
-	result = ff_file_erase(L"test1.txt");
-	ASSERT(result == FF_SUCCESS, "file1 should be deleted");
-	result = ff_file_erase(L"test2.txt");
-	ASSERT(result == FF_SUCCESS, "file2 should be deleted");
-
+	result = ff_file_erase(L"test_file_vectored.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	ff_free(read_body);
+	ff_free(body);
 	ff_core_shutdown();
 }
 
@@ -1512,6 +2983,12 @@ static void test_file_all(void)
 	test_file_create_delete();
 	test_file_tmp_unique();
 	test_file_basic();
+	test_file_large();
+	test_file_positional();
+	test_file_vectored();
+	test_file_map();
+	test_file_map_past_eof();
+	test_file_copy_large();
 }
 
 /* end of ff_file tests */
@@ -1863,14 +3340,496 @@ static void test_stream_tcp_basic(void)
 	ff_core_shutdown();
 }
 
+struct stream_tcp_vectored_data
+{
+	struct ff_tcp *server_tcp;
+	const struct ff_iovec *iov;
+	int iov_cnt;
+};
+
+static void stream_tcp_vectored_func(void *ctx)
+{
+	struct stream_tcp_vectored_data *data;
+	struct ff_arch_net_addr *remote_addr;
+	struct ff_tcp *client_tcp;
+	struct ff_stream *client_stream;
+	enum ff_result result;
+
+	data = (struct stream_tcp_vectored_data *) ctx;
+	remote_addr = ff_arch_net_addr_create();
+	client_tcp = ff_tcp_accept(data->server_tcp, remote_addr);
+	ASSERT(client_tcp != NULL, "cannot accept local TCP connection");
+	client_stream = ff_stream_tcp_create(client_tcp);
+	result = ff_stream_writev(client_stream, data->iov, data->iov_cnt);
+	ASSERT(result == FF_SUCCESS, "error when writing buffers to tcp stream");
+	result = ff_stream_flush(client_stream);
+	ASSERT(result == FF_SUCCESS, "error when flushing tcp stream");
+	ff_stream_delete(client_stream);
+	ff_arch_net_addr_delete(remote_addr);
+}
+
+static void test_stream_tcp_vectored(void)
+{
+	struct stream_tcp_vectored_data data;
+	struct ff_arch_net_addr *addr;
+	struct ff_tcp *client_tcp;
+	struct ff_stream *client_stream;
+	struct ff_iovec iov[VECTORED_SMALL_IOVECS_CNT + 3];
+	struct ff_iovec read_iov[3];
+	uint8_t small[VECTORED_SMALL_IOVECS_CNT];
+	uint8_t *body;
+	uint8_t *expected_data;
+	uint8_t *read_data;
+	int total_len;
+	int offset;
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	ff_core_initialize(LOG_FILENAME);
+	body = (uint8_t *) ff_calloc(VECTORED_BODY_SIZE, sizeof(body[0]));
+	for (i = 0; i < VECTORED_BODY_SIZE; i++)
+	{
+		body[i] = (uint8_t) (i * 7);
+	}
+	iov[0].buf = (void *) "header";
+	iov[0].len = 6;
+	iov[1].buf = body;
+	iov[1].len = VECTORED_BODY_SIZE;
+	iov[2].buf = (void *) "trailer";
+	iov[2].len = 7;
+	for (i = 0; i < VECTORED_SMALL_IOVECS_CNT; i++)
+	{
+		small[i] = (uint8_t) i;
+		iov[i + 3].buf = &small[i];
+		iov[i + 3].len = 1;
+	}
+	total_len = 0;
+	for (i = 0; i < VECTORED_SMALL_IOVECS_CNT + 3; i++)
+	{
+		total_len += iov[i].len;
+	}
+	expected_data = (uint8_t *) ff_calloc(total_len, sizeof(expected_data[0]));
+	read_data = (uint8_t *) ff_calloc(total_len, sizeof(read_data[0]));
+	offset = 0;
+	for (i = 0; i < VECTORED_SMALL_IOVECS_CNT + 3; i++)
+	{
+		memcpy(expected_data + offset, iov[i].buf, iov[i].len);
+		offset += iov[i].len;
+	}
+
+	data.server_tcp = ff_tcp_create();
+	data.iov = iov;
+	data.iov_cnt = VECTORED_SMALL_IOVECS_CNT + 3;
+	addr = ff_arch_net_addr_create();
+	result = ff_arch_net_addr_resolve(addr, L"localhost", 8396);
+	ASSERT(result == FF_SUCCESS, "cannot resolve localhost address");
+	result = ff_tcp_bind(data.server_tcp, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "cannot bind server tcp");
+	ff_core_fiberpool_execute_async(stream_tcp_vectored_func, &data);
+	client_tcp = ff_tcp_create();
+	result = ff_tcp_connect(client_tcp, addr);
+	ASSERT(result == FF_SUCCESS, "cannot connect to local tcp");
+	client_stream = ff_stream_tcp_create(client_tcp);
+
+	/* boundaries of read buffers don't match boundaries of written buffers */
+	read_iov[0].buf = read_data;
+	read_iov[0].len = 4;
+	read_iov[1].buf = read_data + 4;
+	read_iov[1].len = total_len - 14;
+	read_iov[2].buf = read_data + total_len - 10;
+	read_iov[2].len = 10;
+	result = ff_stream_readv(client_stream, read_iov, 3);
+	ASSERT(result == FF_SUCCESS, "cannot read buffers from the stream");
+	is_equal = (memcmp(read_data, expected_data, total_len) == 0);
+	ASSERT(is_equal, "unexpected data received from the stream");
+	result = ff_stream_readv(client_stream, read_iov, 1);
+	ASSERT(result != FF_SUCCESS, "stream should be disconnected");
+
+	ff_stream_delete(client_stream);
+	ff_arch_net_addr_delete(addr);
+	ff_tcp_delete(data.server_tcp);
+	ff_free(read_data);
+	ff_free(expected_data);
+	ff_free(body);
+	ff_core_shutdown();
+}
+
 static void test_stream_tcp_all(void)
 {
 	test_stream_tcp_create_delete();
 	test_stream_tcp_basic();
+	test_stream_tcp_vectored();
 }
 
 /* end of ff_stream_tcp tests */
 
+/* start of ff_stream_file_map tests */
+
+static struct ff_stream *create_file_map_stream(const wchar_t *path)
+{
+	struct ff_file *file;
+	struct ff_file_map *map;
+	struct ff_stream *stream;
+
+	create_large_file(path);
+	file = ff_file_open(path, FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	map = ff_file_map_create(file, 0, ff_file_get_size(file));
+	ASSERT(map != NULL, "cannot map the file");
+	ff_file_close(file);
+	stream = ff_stream_file_map_create(map);
+	return stream;
+}
+
+static void test_stream_file_map_basic(void)
+{
+	struct ff_stream *stream;
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t buf[10];
+	uint32_t hash_value;
+	uint32_t expected_hash_value;
+	enum ff_result result;
+	int is_equal;
+
+	ff_core_initialize(LOG_FILENAME);
+	stream = create_file_map_stream(L"test_map_stream.txt");
+
+	fill_large_file_block(expected_block, 0);
+	result = ff_stream_read(stream, buf, sizeof(buf));
+	ASSERT(result == FF_SUCCESS, "cannot read from the stream");
+	is_equal = (memcmp(buf, expected_block, sizeof(buf)) == 0);
+	ASSERT(is_equal, "wrong data read from the stream");
+
+	/* the hash is calculated directly over the mapped memory */
+	expected_hash_value = ff_hash_uint8(123, expected_block + sizeof(buf), LARGE_FILE_BLOCK_SIZE - sizeof(buf));
+	result = ff_stream_get_hash(stream, LARGE_FILE_BLOCK_SIZE - sizeof(buf), 123, &hash_value);
+	ASSERT(result == FF_SUCCESS, "cannot calculate the hash of the stream");
+	ASSERT(hash_value == expected_hash_value, "wrong hash of the stream");
+	result = ff_stream_get_hash(stream, (LARGE_FILE_BLOCKS_CNT - 1) * LARGE_FILE_BLOCK_SIZE, 123, &hash_value);
+	ASSERT(result == FF_SUCCESS, "cannot calculate the hash of the rest of the stream");
+
+	result = ff_stream_read(stream, buf, 1);
+	ASSERT(result == FF_FAILURE, "the end of the stream should be reached");
+	result = ff_stream_write(stream, buf, 1);
+	ASSERT(result == FF_FAILURE, "the stream should be read-only");
+	result = ff_stream_flush(stream);
+	ASSERT(result == FF_SUCCESS, "cannot flush the stream");
+	ff_stream_delete(stream);
+
+	stream = create_file_map_stream(L"test_map_stream.txt");
+	ff_stream_disconnect(stream);
+	result = ff_stream_read(stream, buf, 1);
+	ASSERT(result == FF_FAILURE, "the stream should be disconnected");
+	ff_stream_delete(stream);
+
+	result = ff_file_erase(L"test_map_stream.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	ff_core_shutdown();
+}
+
+struct stream_file_map_copy_data
+{
+	struct ff_stream *stream;
+	struct ff_event *done_event;
+};
+
+static void stream_file_map_copy_reader_func(void *ctx)
+{
+	struct stream_file_map_copy_data *data;
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	uint8_t block[LARGE_FILE_BLOCK_SIZE];
+	enum ff_result result;
+	int is_equal;
+	int i;
+
+	data = (struct stream_file_map_copy_data *) ctx;
+	for (i = 0; i < LARGE_FILE_BLOCKS_CNT; i++)
+	{
+		fill_large_file_block(expected_block, i);
+		result = ff_stream_read(data->stream, block, LARGE_FILE_BLOCK_SIZE);
+		ASSERT(result == FF_SUCCESS, "cannot read from the pipe stream");
+		is_equal = (memcmp(block, expected_block, LARGE_FILE_BLOCK_SIZE) == 0);
+		ASSERT(is_equal, "wrong data copied from the file map stream");
+	}
+	ff_event_set(data->done_event);
+}
+
+static void test_stream_file_map_copy(void)
+{
+	struct ff_stream *stream;
+	struct ff_stream *pipe_stream1;
+	struct ff_stream *pipe_stream2;
+	struct stream_file_map_copy_data data;
+	enum ff_result result;
+
+	ff_core_initialize(LOG_FILENAME);
+	stream = create_file_map_stream(L"test_map_copy.txt");
+	ff_stream_pipe_create_pair(LARGE_FILE_BLOCK_SIZE, &pipe_stream1, &pipe_stream2);
+	data.stream = pipe_stream2;
+	data.done_event = ff_event_create(FF_EVENT_AUTO);
+	ff_core_fiberpool_execute_async(stream_file_map_copy_reader_func, &data);
+
+	result = ff_stream_copy(stream, pipe_stream1, LARGE_FILE_BLOCKS_CNT * LARGE_FILE_BLOCK_SIZE);
+	ASSERT(result == FF_SUCCESS, "cannot copy the file map stream");
+	result = ff_stream_flush(pipe_stream1);
+	ASSERT(result == FF_SUCCESS, "cannot flush the pipe stream");
+	ff_event_wait(data.done_event);
+
+	result = ff_stream_copy(stream, pipe_stream1, 1);
+	ASSERT(result == FF_FAILURE, "the end of the file map stream should be reached");
+
+	ff_event_delete(data.done_event);
+	ff_stream_delete(pipe_stream1);
+	ff_stream_delete(pipe_stream2);
+	ff_stream_delete(stream);
+	result = ff_file_erase(L"test_map_copy.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	ff_core_shutdown();
+}
+
+static void test_stream_file_map_all(void)
+{
+	test_stream_file_map_basic();
+	test_stream_file_map_copy();
+}
+
+/* end of ff_stream_file_map tests */
+
+/* start of ff_stream_file tests */
+
+static void test_stream_file_basic(void)
+{
+	struct ff_file *file;
+	struct ff_stream *stream;
+	uint8_t buf[4];
+	enum ff_result result;
+	int is_equal;
+
+	ff_core_initialize(LOG_FILENAME);
+	file = ff_file_open(L"test_stream_file.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the file");
+	stream = ff_stream_file_create(file);
+	result = ff_stream_write(stream, "test", 4);
+	ASSERT(result == FF_SUCCESS, "cannot write to the file stream");
+	result = ff_stream_read(stream, buf, 1);
+	ASSERT(result == FF_FAILURE, "the stream opened for writing cannot be read");
+	result = ff_stream_flush(stream);
+	ASSERT(result == FF_SUCCESS, "cannot flush the file stream");
+	ff_stream_delete(stream);
+
+	file = ff_file_open(L"test_stream_file.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	stream = ff_stream_file_create(file);
+	result = ff_stream_read(stream, buf, 4);
+	ASSERT(result == FF_SUCCESS, "cannot read from the file stream");
+	is_equal = (memcmp(buf, "test", 4) == 0);
+	ASSERT(is_equal, "wrong data read from the file stream");
+	result = ff_stream_write(stream, "test", 4);
+	ASSERT(result == FF_FAILURE, "the stream opened for reading cannot be written");
+	result = ff_stream_flush(stream);
+	ASSERT(result == FF_SUCCESS, "the stream opened for reading can be flushed");
+	result = ff_stream_read(stream, buf, 1);
+	ASSERT(result == FF_FAILURE, "the end of the file stream should be reached");
+	ff_stream_disconnect(stream);
+	result = ff_stream_flush(stream);
+	ASSERT(result == FF_FAILURE, "the file stream should be disconnected");
+	ff_stream_delete(stream);
+
+	result = ff_file_erase(L"test_stream_file.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the file");
+	ff_core_shutdown();
+}
+
+#define STREAM_FILE_COPY_HEADER_SIZE 10
+#define STREAM_FILE_COPY_PREFIX_SIZE 5
+#define STREAM_FILE_COPY_TCP_SIZE (LARGE_FILE_BLOCKS_CNT * LARGE_FILE_BLOCK_SIZE / 2)
+#define STREAM_FILE_COPY_FILE_SIZE (LARGE_FILE_BLOCKS_CNT * LARGE_FILE_BLOCK_SIZE - STREAM_FILE_COPY_HEADER_SIZE - STREAM_FILE_COPY_PREFIX_SIZE - STREAM_FILE_COPY_TCP_SIZE)
+
+struct stream_file_copy_data
+{
+	struct ff_tcp *sender_server_tcp;
+	struct ff_tcp *receiver_server_tcp;
+	struct ff_event *done_event;
+};
+
+static void verify_large_file_data(const uint8_t *data, int offset, int len)
+{
+	uint8_t expected_block[LARGE_FILE_BLOCK_SIZE];
+	int is_equal;
+
+	while (len > 0)
+	{
+		int block_offset;
+		int chunk_size;
+
+		block_offset = offset % LARGE_FILE_BLOCK_SIZE;
+		chunk_size = LARGE_FILE_BLOCK_SIZE - block_offset;
+		if (chunk_size > len)
+		{
+			chunk_size = len;
+		}
+		fill_large_file_block(expected_block, offset / LARGE_FILE_BLOCK_SIZE);
+		is_equal = (memcmp(data, expected_block + block_offset, chunk_size) == 0);
+		ASSERT(is_equal, "wrong data copied from the large file");
+		data += chunk_size;
+		offset += chunk_size;
+		len -= chunk_size;
+	}
+}
+
+static void stream_file_copy_sender_func(void *ctx)
+{
+	struct stream_file_copy_data *data;
+	struct ff_arch_net_addr *remote_addr;
+	struct ff_tcp *tcp;
+	struct ff_stream *tcp_stream;
+	struct ff_stream *file_stream;
+	struct ff_file *file;
+	uint8_t header[STREAM_FILE_COPY_HEADER_SIZE];
+	enum ff_result result;
+
+	data = (struct stream_file_copy_data *) ctx;
+	remote_addr = ff_arch_net_addr_create();
+	tcp = ff_tcp_accept(data->sender_server_tcp, remote_addr);
+	ASSERT(tcp != NULL, "cannot accept the connection");
+	tcp_stream = ff_stream_tcp_create(tcp);
+	file = ff_file_open(L"test_stream_file_copy_src.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	file_stream = ff_stream_file_create(file);
+
+	/* the rest of data buffered by the file stream must be copied before data sent by the kernel */
+	result = ff_stream_read(file_stream, header, sizeof(header));
+	ASSERT(result == FF_SUCCESS, "cannot read the header from the file stream");
+	verify_large_file_data(header, 0, sizeof(header));
+	result = ff_stream_copy(file_stream, tcp_stream, LARGE_FILE_BLOCKS_CNT * LARGE_FILE_BLOCK_SIZE - sizeof(header));
+	ASSERT(result == FF_SUCCESS, "cannot copy data from the file stream to the tcp stream");
+	result = ff_stream_flush(tcp_stream);
+	ASSERT(result == FF_SUCCESS, "cannot flush the tcp stream");
+
+	ff_stream_delete(file_stream);
+	ff_stream_delete(tcp_stream);
+	ff_arch_net_addr_delete(remote_addr);
+}
+
+static void stream_file_copy_receiver_func(void *ctx)
+{
+	struct stream_file_copy_data *data;
+	struct ff_arch_net_addr *remote_addr;
+	struct ff_tcp *tcp;
+	struct ff_stream *tcp_stream;
+	uint8_t *buf;
+	enum ff_result result;
+
+	data = (struct stream_file_copy_data *) ctx;
+	remote_addr = ff_arch_net_addr_create();
+	tcp = ff_tcp_accept(data->receiver_server_tcp, remote_addr);
+	ASSERT(tcp != NULL, "cannot accept the connection");
+	tcp_stream = ff_stream_tcp_create(tcp);
+	buf = (uint8_t *) ff_calloc(STREAM_FILE_COPY_TCP_SIZE, sizeof(buf[0]));
+	result = ff_stream_read(tcp_stream, buf, STREAM_FILE_COPY_TCP_SIZE);
+	ASSERT(result == FF_SUCCESS, "cannot read data copied between tcp streams");
+	verify_large_file_data(buf, STREAM_FILE_COPY_HEADER_SIZE + STREAM_FILE_COPY_PREFIX_SIZE, STREAM_FILE_COPY_TCP_SIZE);
+	ff_free(buf);
+
+	ff_stream_delete(tcp_stream);
+	ff_arch_net_addr_delete(remote_addr);
+	ff_event_set(data->done_event);
+}
+
+/**
+ * Copies the file to the tcp stream, then copies received data partially to another tcp stream
+ * and partially to the file. This covers all kernel-side transfers, which are supported by ff_stream_copy().
+ */
+static void test_stream_file_copy(void)
+{
+	struct stream_file_copy_data data;
+	struct ff_arch_net_addr *addr;
+	struct ff_tcp *tcp;
+	struct ff_stream *src_stream;
+	struct ff_stream *dst_stream;
+	struct ff_file *file;
+	uint8_t prefix[STREAM_FILE_COPY_PREFIX_SIZE];
+	uint8_t *buf;
+	enum ff_result result;
+
+	ff_core_initialize(LOG_FILENAME);
+	create_large_file(L"test_stream_file_copy_src.txt");
+	data.done_event = ff_event_create(FF_EVENT_AUTO);
+	addr = ff_arch_net_addr_create();
+
+	data.sender_server_tcp = ff_tcp_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 8394);
+	ASSERT(result == FF_SUCCESS, "cannot resolve the address");
+	result = ff_tcp_bind(data.sender_server_tcp, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "cannot bind the sender server tcp");
+	ff_core_fiberpool_execute_async(stream_file_copy_sender_func, &data);
+	tcp = ff_tcp_create();
+	result = ff_tcp_connect(tcp, addr);
+	ASSERT(result == FF_SUCCESS, "cannot connect to the sender");
+	src_stream = ff_stream_tcp_create(tcp);
+
+	data.receiver_server_tcp = ff_tcp_create();
+	result = ff_arch_net_addr_resolve(addr, L"127.0.0.1", 8395);
+	ASSERT(result == FF_SUCCESS, "cannot resolve the address");
+	result = ff_tcp_bind(data.receiver_server_tcp, addr, FF_TCP_SERVER);
+	ASSERT(result == FF_SUCCESS, "cannot bind the receiver server tcp");
+	ff_core_fiberpool_execute_async(stream_file_copy_receiver_func, &data);
+	tcp = ff_tcp_create();
+	result = ff_tcp_connect(tcp, addr);
+	ASSERT(result == FF_SUCCESS, "cannot connect to the receiver");
+	dst_stream = ff_stream_tcp_create(tcp);
+
+	/* the prefix leaves data buffered by the src_stream, which must be copied first */
+	result = ff_stream_read(src_stream, prefix, sizeof(prefix));
+	ASSERT(result == FF_SUCCESS, "cannot read the prefix from the tcp stream");
+	verify_large_file_data(prefix, STREAM_FILE_COPY_HEADER_SIZE, sizeof(prefix));
+	result = ff_stream_copy(src_stream, dst_stream, STREAM_FILE_COPY_TCP_SIZE);
+	ASSERT(result == FF_SUCCESS, "cannot copy data between tcp streams");
+	result = ff_stream_flush(dst_stream);
+	ASSERT(result == FF_SUCCESS, "cannot flush the tcp stream");
+	ff_event_wait(data.done_event);
+	ff_stream_delete(dst_stream);
+
+	file = ff_file_open(L"test_stream_file_copy_dst.txt", FF_FILE_WRITE);
+	ASSERT(file != NULL, "cannot create the file");
+	dst_stream = ff_stream_file_create(file);
+	result = ff_stream_copy(src_stream, dst_stream, STREAM_FILE_COPY_FILE_SIZE);
+	ASSERT(result == FF_SUCCESS, "cannot copy data from the tcp stream to the file stream");
+	result = ff_stream_flush(dst_stream);
+	ASSERT(result == FF_SUCCESS, "cannot flush the file stream");
+	ff_stream_delete(dst_stream);
+	ff_stream_delete(src_stream);
+
+	file = ff_file_open(L"test_stream_file_copy_dst.txt", FF_FILE_READ);
+	ASSERT(file != NULL, "cannot open the file");
+	ASSERT(ff_file_get_size(file) == STREAM_FILE_COPY_FILE_SIZE, "wrong size of the copied file");
+	buf = (uint8_t *) ff_calloc(STREAM_FILE_COPY_FILE_SIZE, sizeof(buf[0]));
+	result = ff_file_read(file, buf, STREAM_FILE_COPY_FILE_SIZE);
+	ASSERT(result == FF_SUCCESS, "cannot read the copied file");
+	verify_large_file_data(buf, STREAM_FILE_COPY_HEADER_SIZE + STREAM_FILE_COPY_PREFIX_SIZE + STREAM_FILE_COPY_TCP_SIZE, STREAM_FILE_COPY_FILE_SIZE);
+	ff_free(buf);
+	ff_file_close(file);
+
+	ff_tcp_delete(data.receiver_server_tcp);
+	ff_tcp_delete(data.sender_server_tcp);
+	ff_arch_net_addr_delete(addr);
+	ff_event_delete(data.done_event);
+	result = ff_file_erase(L"test_stream_file_copy_src.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the source file");
+	result = ff_file_erase(L"test_stream_file_copy_dst.txt");
+	ASSERT(result == FF_SUCCESS, "cannot erase the destination file");
+	ff_core_shutdown();
+}
+
+static void test_stream_file_all(void)
+{
+	test_stream_file_basic();
+	test_stream_file_copy();
+}
+
+/* end of ff_stream_file tests */
+
 
 /* start of ff_stream_acceptor_tcp tests */
 
@@ -2316,6 +4275,7 @@ static void test_all(void)
 	test_event_all();
 	test_mutex_all();
 	test_semaphore_all();
+	test_future_all();
 	test_blocking_queue_all();
 	test_blocking_stack_all();
 	test_pool_all();
@@ -2325,6 +4285,8 @@ static void test_all(void)
 	test_arch_net_addr_all();
 	test_tcp_all();
 	test_stream_tcp_all();
+	test_stream_file_map_all();
+	test_stream_file_all();
 	test_stream_acceptor_tcp_all();
 	test_stream_connector_tcp_all();
 	test_udp_all();